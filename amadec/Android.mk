@@ -24,7 +24,7 @@ LOCAL_CFLAGS += -DALSA_OUT
 LOCAL_SHARED_LIBRARIES += libasound
  
 LOCAL_SRC_FILES := \
-           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c feeder.c adec_write.c adec_read.c\
+           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c adec-frame-skip.c feeder.c adec_write.c adec_read.c\
            dsp/audiodsp-ctl.c audio_out/alsa-out.c audio_out/aml_resample.c audiodsp_update_format.c spdif_api.c pcmenc_api.c \
            dts_transenc_api.c dts_enc.c adec_omx_brige.c ../amavutils/amconfigutils.c  adec-wfd.c
  
@@ -75,7 +75,7 @@ else
 endif
 
 LOCAL_SRC_FILES := \
-           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c feeder.c adec_write.c adec_read.c\
+           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c adec-frame-skip.c feeder.c adec_write.c adec_read.c\
            dsp/audiodsp-ctl.c audio_out/android-out.cpp audio_out/aml_resample.c audiodsp_update_format.c spdif_api.c pcmenc_api.c \
            dts_transenc_api.c dts_enc.c adec_omx_brige.c ../amavutils/amconfigutils.c  adec-wfd.c
 
@@ -116,7 +116,7 @@ else
 endif
 
 LOCAL_SRC_FILES := \
-           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c feeder.c adec_write.c adec_read.c\
+           adec-external-ctrl.c adec-internal-mgt.c adec-ffmpeg-mgt.c adec-message.c adec-pts-mgt.c adec-frame-skip.c feeder.c adec_write.c adec_read.c\
            dsp/audiodsp-ctl.c audio_out/android-out.cpp audio_out/aml_resample.c audiodsp_update_format.c \
            spdif_api.c pcmenc_api.c dts_transenc_api.c dts_enc.c adec_omx_brige.c ../amavutils/amconfigutils.c  adec-wfd.c
 
@@ -7,6 +7,7 @@
 #include <dlfcn.h>
 
 #include <adec-pts-mgt.h>
+#include <adec-frame-skip.h>
 #include <adec_write.h>
 #include <adec_omx_brige.h>
 #include <Amsysfsutils.h>
@@ -722,6 +723,7 @@ static int start_adec(aml_audio_dec_t *audec)
              audec->auto_mute = 0;
          }
          aout_ops->start(audec);
+         adec_pts_first_audio(audec);
          audec->state = ACTIVE;
     }
     else
@@ -1105,10 +1107,13 @@ void *audio_decode_loop(void *args)
     g_bst->format = audec->format;
     inlen=0;
     nNextFrameSize=adec_ops->nInBufSize;    
+    audec->frame_skip_state = FRAME_SKIP_IDLE;
+    audec->frame_skip_enable = adec_frame_skip_format(nAudioFormat);
     while (1){
 exit_decode_loop:
 
           if(audec->exit_decode_thread){//detect quit condition
+               audec->frame_skip_enable = 0;
                if (inbuf){
                    free(inbuf);
                    inbuf = NULL;
@@ -1155,6 +1160,22 @@ exit_decode_loop:
           {
                while (declen<rlen && !audec->exit_decode_thread) 
                {
+                     // start up drop,frames before the target pts are not decoded
+                     if(audec->frame_skip_state == FRAME_SKIP_REQUEST || audec->frame_skip_state == FRAME_SKIP_RUNNING){
+                          dlen = adec_frame_skip(audec, (unsigned char *)inbuf+declen, inlen);
+                          if(dlen < 0){
+                               pRestData=malloc(inlen);
+                               if(pRestData)
+                                   memcpy(pRestData, (uint8_t *)(inbuf+declen), inlen);
+                               break;
+                          }
+                          if(dlen > 0){
+                               declen += dlen;
+                               inlen -= dlen;
+                               audec->decode_offset += dlen;
+                               continue;
+                          }
+                     }
                      outlen = AVCODEC_MAX_AUDIO_FRAME_SIZE;
                      if(nAudioFormat == ACODEC_FMT_COOK || nAudioFormat == ACODEC_FMT_RAAC || nAudioFormat == ACODEC_FMT_AMR){
                           if(needdata > 0){
@@ -1168,7 +1189,9 @@ exit_decode_loop:
 
                       dlen = adec_ops->decode(audec->adec_ops, outbuf, &outlen, inbuf+declen, inlen);	
 			  if(outlen > 0 )		  
-			  	check_audio_info_changed(audec);		  
+			  	check_audio_info_changed(audec);
+			  if(outlen > 0 && outlen <= AVCODEC_MAX_AUDIO_FRAME_SIZE)
+			  	audec->pcm_bytes_decoded += outlen;
                        if(outlen > AVCODEC_MAX_AUDIO_FRAME_SIZE){
                                adec_print("!!!!!fatal error,out buffer overwriten,out len %d,actual %d",outlen,AVCODEC_MAX_AUDIO_FRAME_SIZE);
                       }
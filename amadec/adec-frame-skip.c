@@ -0,0 +1,438 @@
+/**
+ * \file adec-frame-skip.c
+ * \brief  Compressed frame skip for the start up audio drop.
+ * \version 1.0.0
+ * \date 2014-06-20
+ *
+ * When audio starts behind video, adec_pts_droppcm() used to decode all the
+ * audio up to the video pts and throw the pcm away. With the arm decoder the
+ * stream goes through audio_decode_loop(), so whole frames before the
+ * reference pts can be stepped over from their headers alone and only the
+ * part of a frame before it is decoded and dropped as pcm.
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+
+#include <adec-frame-skip.h>
+
+#define FRAME_SKIP_RESYNC_MAX   4096    //junk bytes allowed before the first frame
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*---------------------------------------------------------------------------
+ * frame headers
+ *-------------------------------------------------------------------------*/
+static const int adts_samplerate[16] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+    16000, 12000, 11025, 8000, 7350, 0, 0, 0
+};
+
+static int adts_parse(const unsigned char *p, int len, adec_frame_info_t *info)
+{
+    int size;
+    if (len < 7) {
+        return 0;
+    }
+    /* syncword, layer 0 */
+    if (p[0] != 0xff || (p[1] & 0xf6) != 0xf0) {
+        return -1;
+    }
+    info->samplerate = adts_samplerate[(p[2] >> 2) & 0xf];
+    size = ((p[3] & 0x3) << 11) | (p[4] << 3) | (p[5] >> 5);
+    if (!info->samplerate || size < 7) {
+        return -1;
+    }
+    info->frame_size = size;
+    info->samples = 1024 * ((p[6] & 0x3) + 1);
+    return 1;
+}
+
+static const int ac3_samplerate[3] = {48000, 44100, 32000};
+static const int ac3_bitrate[19] = {
+    32, 40, 48, 56, 64, 80, 96, 112, 128, 160,
+    192, 224, 256, 320, 384, 448, 512, 576, 640
+};
+static const int eac3_blocks[4] = {1, 2, 3, 6};
+
+static int ac3_parse(const unsigned char *p, int len, adec_frame_info_t *info)
+{
+    int bsid, fscod, code, words;
+    if (len < 6) {
+        return 0;
+    }
+    if (p[0] != 0x0b || p[1] != 0x77) {
+        return -1;
+    }
+    bsid = p[5] >> 3;
+    fscod = p[4] >> 6;
+    if (bsid <= 10) {
+        code = p[4] & 0x3f;
+        if (fscod == 3 || code >= 38) {
+            return -1;
+        }
+        /* 16 bit words per 1536 samples, 44.1K frames are padded on the odd codes */
+        if (fscod == 0) {
+            words = ac3_bitrate[code >> 1] * 2;
+        } else if (fscod == 1) {
+            words = ac3_bitrate[code >> 1] * 96000 / 44100 + (code & 1);
+        } else {
+            words = ac3_bitrate[code >> 1] * 3;
+        }
+        info->frame_size = words * 2;
+        info->samplerate = ac3_samplerate[fscod];
+        info->samples = 1536;
+        return 1;
+    }
+    if (bsid > 16) {
+        return -1;
+    }
+    /* E-AC-3, a dependent substream plays along with the independent frame before it */
+    info->frame_size = ((((p[2] & 0x7) << 8) | p[3]) + 1) * 2;
+    if (fscod == 3) {
+        int fscod2 = (p[4] >> 4) & 0x3;
+        if (fscod2 == 3) {
+            return -1;
+        }
+        info->samplerate = ac3_samplerate[fscod2] / 2;
+        info->samples = 1536;
+    } else {
+        info->samplerate = ac3_samplerate[fscod];
+        info->samples = 256 * eac3_blocks[(p[4] >> 4) & 0x3];
+    }
+    if ((p[2] >> 6) == 1) {
+        info->samples = 0;
+    }
+    return 1;
+}
+
+static const int mpa_bitrate[2][3][15] = {
+    {   /* MPEG-1, layer 1/2/3 */
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    },
+    {   /* MPEG-2/2.5 */
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+    },
+};
+static const int mpa_samplerate[3] = {44100, 48000, 32000};
+
+static int mpa_parse(const unsigned char *p, int len, adec_frame_info_t *info)
+{
+    int version, layer, index, sr, pad, lsf, bitrate;
+    if (len < 4) {
+        return 0;
+    }
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0) {
+        return -1;
+    }
+    version = (p[1] >> 3) & 0x3;    //3 MPEG-1, 2 MPEG-2, 0 MPEG-2.5
+    layer = 3 - ((p[1] >> 1) & 0x3);  //0 layer 1 .. 2 layer 3
+    index = p[2] >> 4;
+    sr = (p[2] >> 2) & 0x3;
+    pad = (p[2] >> 1) & 0x1;
+    /* free format has no size in the header, leave it to the decoder */
+    if (version == 1 || layer == 3 || index == 0 || index == 15 || sr == 3) {
+        return -1;
+    }
+    lsf = version != 3;
+    bitrate = mpa_bitrate[lsf][layer][index] * 1000;
+    info->samplerate = mpa_samplerate[sr] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+    if (layer == 0) {
+        info->frame_size = (12 * bitrate / info->samplerate + pad) * 4;
+        info->samples = 384;
+    } else if (layer == 1 || !lsf) {
+        info->frame_size = 144 * bitrate / info->samplerate + pad;
+        info->samples = 1152;
+    } else {
+        info->frame_size = 72 * bitrate / info->samplerate + pad;
+        info->samples = 576;
+    }
+    return 1;
+}
+
+static unsigned get_bits(const unsigned char *p, int pos, int n)
+{
+    unsigned v = 0;
+    while (n-- > 0) {
+        v = (v << 1) | ((p[pos >> 3] >> (7 - (pos & 7))) & 1);
+        pos++;
+    }
+    return v;
+}
+
+static const int dts_samplerate[16] = {
+    0, 8000, 16000, 32000, 0, 0, 11025, 22050,
+    44100, 0, 0, 12000, 24000, 48000, 0, 0
+};
+
+static int dts_parse(const unsigned char *p, int len, adec_frame_info_t *info)
+{
+    if (len < 12) {
+        return 0;
+    }
+    /* 16 bit big endian core */
+    if (p[0] == 0x7f && p[1] == 0xfe && p[2] == 0x80 && p[3] == 0x01) {
+        info->samples = (get_bits(p, 39, 7) + 1) * 32;
+        info->frame_size = get_bits(p, 46, 14) + 1;
+        info->samplerate = dts_samplerate[get_bits(p, 66, 4)];
+        if (!info->samplerate || info->frame_size < 96) {
+            return -1;
+        }
+        return 1;
+    }
+    /* DTS-HD extension substream, carried after the core of the same period */
+    if (p[0] == 0x64 && p[1] == 0x58 && p[2] == 0x20 && p[3] == 0x25) {
+        if (get_bits(p, 42, 1)) {
+            info->frame_size = get_bits(p, 55, 20) + 1;
+        } else {
+            info->frame_size = get_bits(p, 51, 16) + 1;
+        }
+        info->samples = 0;
+        info->samplerate = 48000;
+        return 1;
+    }
+    return -1;
+}
+
+/**
+ * \brief whether the frame headers of a format are known here
+ * \param format ACODEC_FMT_XXX
+ * \return 1 if known otherwise 0
+ */
+int adec_frame_skip_format(int format)
+{
+    switch (format) {
+    case ACODEC_FMT_AAC:
+    case ACODEC_FMT_AC3:
+    case ACODEC_FMT_EAC3:
+    case ACODEC_FMT_MPEG:
+    case ACODEC_FMT_MPEG1:
+    case ACODEC_FMT_MPEG2:
+    case ACODEC_FMT_DTS:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief parse the frame header at buf
+ * \param format ACODEC_FMT_XXX
+ * \param buf stream data
+ * \param len bytes available at buf
+ * \param info filled on success
+ * \return 1 on success, 0 if more data is needed for the header, -1 if no frame starts at buf
+ */
+int adec_frame_parse(int format, const unsigned char *buf, int len, adec_frame_info_t *info)
+{
+    switch (format) {
+    case ACODEC_FMT_AAC:
+        return adts_parse(buf, len, info);
+    case ACODEC_FMT_AC3:
+    case ACODEC_FMT_EAC3:
+        return ac3_parse(buf, len, info);
+    case ACODEC_FMT_MPEG:
+    case ACODEC_FMT_MPEG1:
+    case ACODEC_FMT_MPEG2:
+        return mpa_parse(buf, len, info);
+    case ACODEC_FMT_DTS:
+        return dts_parse(buf, len, info);
+    default:
+        return -1;
+    }
+}
+
+/**
+ * \brief frames to leave to the decoder ahead of the target
+ * \param format ACODEC_FMT_XXX
+ * \return frame count
+ *
+ * The transforms overlap with the previous frame, and layer 3 main data
+ * may start up to 511 bytes back in the bit reservoir, so the first
+ * frames after a skip decode wrong. They are decoded and dropped as pcm.
+ */
+int adec_frame_skip_preroll(int format)
+{
+    if (format == ACODEC_FMT_MPEG || format == ACODEC_FMT_MPEG1 || format == ACODEC_FMT_MPEG2) {
+        return 2;
+    }
+    return 1;
+}
+
+/*---------------------------------------------------------------------------
+ * decode loop side
+ *-------------------------------------------------------------------------*/
+static unsigned long frame_skip_lookup(aml_audio_dec_t *audec, unsigned long offset)
+{
+    unsigned long pts = offset;
+    if (audec->adsp_ops.dsp_file_fd < 0) {
+        return 0;
+    }
+    if (ioctl(audec->adsp_ops.dsp_file_fd, AMSTREAM_IOC_APTS_LOOKUP, &pts) < 0) {
+        return 0;
+    }
+    return pts;
+}
+
+static int frame_skip_bytes_per_sec(aml_audio_dec_t *audec)
+{
+    return audec->g_bst->samplerate * audec->g_bst->channels * 2;
+}
+
+/*
+ * no pcm is written while skipping, so what is buffered now was decoded
+ * before the skip and ends at frame_skip_pts. The apts lookup entries of
+ * the skipped frames are gone, so the pts extrapolation of armdec_get_pts()
+ * restarts from here.
+ */
+static void frame_skip_done(aml_audio_dec_t *audec, const char *why)
+{
+    int bytes_per_sec = frame_skip_bytes_per_sec(audec);
+    if (!__sync_bool_compare_and_swap(&audec->frame_skip_state, FRAME_SKIP_RUNNING, FRAME_SKIP_DONE)) {
+        return;
+    }
+    audec->frame_skip_pcm_level = audec->g_bst->buf_level;
+    if (bytes_per_sec > 0 && audec->frame_skip_frames > 0) {
+        audec->last_valid_pts = audec->frame_skip_pts -
+                                (int64_t)audec->frame_skip_pcm_level * 90000 / bytes_per_sec;
+        audec->out_len_after_last_valid_pts = 0;
+    }
+    adec_print("frame skip %s: %d frames, %d bytes, %lu ms of audio, next pts 0x%lx target 0x%lx, %lld us\n",
+               why, audec->frame_skip_frames, audec->frame_skip_bytes, audec->frame_skip_dur / 90,
+               audec->frame_skip_pts, audec->frame_skip_target, gettime() - audec->frame_skip_start_time);
+}
+
+/**
+ * \brief ask the decode loop to skip the frames ending before target
+ * \param audec pointer to audec
+ * \param target pts the audio should start from
+ * \param apts pts of the pcm buffer head
+ * \return 0 on success otherwise -1
+ *
+ * The decoder goes on until it picks the request up, the pcm it makes
+ * meanwhile is counted by pcm_bytes_decoded. The counter is taken before
+ * the buffer level so that a frame decoded in between is counted twice:
+ * the start pts can only come out late, and fewer frames skipped.
+ */
+int adec_frame_skip_request(aml_audio_dec_t *audec, unsigned long target, unsigned long apts)
+{
+    int bytes_per_sec = frame_skip_bytes_per_sec(audec);
+    int buffered;
+
+    if (!audec->frame_skip_enable || !adec_frame_skip_format(audec->format) || bytes_per_sec <= 0) {
+        return -1;
+    }
+    if (audec->frame_skip_state == FRAME_SKIP_REQUEST || audec->frame_skip_state == FRAME_SKIP_RUNNING) {
+        return -1;
+    }
+    audec->frame_skip_decoded = audec->pcm_bytes_decoded;
+    __sync_synchronize();
+    buffered = audec->g_bst->buf_level + audec->pcm_cache_size;
+    audec->frame_skip_target = target;
+    audec->frame_skip_pts = apts + (int64_t)buffered * 90000 / bytes_per_sec;
+    audec->frame_skip_frames = 0;
+    audec->frame_skip_bytes = 0;
+    audec->frame_skip_dur = 0;
+    audec->frame_skip_pcm_level = 0;
+    audec->frame_skip_start_time = gettime();
+    __sync_synchronize();
+    audec->frame_skip_state = FRAME_SKIP_REQUEST;
+    return 0;
+}
+
+/**
+ * \brief cancel a request not yet picked up, or end a running skip
+ * \param audec pointer to audec
+ * \return 0 if the skip never started otherwise 1
+ */
+int adec_frame_skip_stop(aml_audio_dec_t *audec)
+{
+    if (__sync_bool_compare_and_swap(&audec->frame_skip_state, FRAME_SKIP_REQUEST, FRAME_SKIP_IDLE)) {
+        return 0;
+    }
+    frame_skip_done(audec, "stopped");
+    return 1;
+}
+
+/**
+ * \brief skip the whole frames at the head of the decoder input
+ * \param audec pointer to audec
+ * \param buf decoder input, audec->decode_offset is its stream offset
+ * \param len bytes at buf
+ * \return bytes skipped, -1 if a frame to skip is not complete yet
+ *
+ * Called by the decode loop before each decode. Frames are stepped over
+ * while they end before the target minus the preroll, the pts of each
+ * frame is extrapolated from the frame durations and the apts lookup
+ * table where it has an entry.
+ */
+int adec_frame_skip(aml_audio_dec_t *audec, const unsigned char *buf, int len)
+{
+    adec_frame_info_t info;
+    unsigned long pts, dur;
+    int pos = 0, ret, preroll;
+
+    if (audec->frame_skip_state == FRAME_SKIP_REQUEST) {
+        if (!__sync_bool_compare_and_swap(&audec->frame_skip_state, FRAME_SKIP_REQUEST, FRAME_SKIP_RUNNING)) {
+            return 0;
+        }
+        audec->frame_skip_pts += (audec->pcm_bytes_decoded - audec->frame_skip_decoded) * 90000 /
+                                 frame_skip_bytes_per_sec(audec);
+    }
+    if (audec->frame_skip_state != FRAME_SKIP_RUNNING) {
+        return 0;
+    }
+    preroll = adec_frame_skip_preroll(audec->format);
+    while (pos < len && audec->frame_skip_state == FRAME_SKIP_RUNNING) {
+        ret = adec_frame_parse(audec->format, buf + pos, len - pos, &info);
+        if (ret == 0) {
+            break;
+        }
+        if (ret < 0) {
+            /* junk in front of the first frame goes with it, a lost sync later is the decoder's */
+            if (audec->frame_skip_frames == 0 && audec->frame_skip_bytes < FRAME_SKIP_RESYNC_MAX) {
+                audec->frame_skip_bytes++;
+                pos++;
+                continue;
+            }
+            frame_skip_done(audec, "lost sync");
+            return pos;
+        }
+        if (info.frame_size > len - pos) {
+            break;
+        }
+        dur = info.samples ? (unsigned long)((int64_t)info.samples * 90000 / info.samplerate) : 0;
+        pts = frame_skip_lookup(audec, audec->decode_offset + pos);
+        /* a lookup only moves it on,the extrapolation misses the gaps in the stream */
+        if (pts > audec->frame_skip_pts) {
+            audec->frame_skip_pts = pts;
+        }
+        if (audec->frame_skip_pts + dur * (preroll + 1) > audec->frame_skip_target) {
+            frame_skip_done(audec, "done");
+            return pos;
+        }
+        audec->frame_skip_pts += dur;
+        audec->frame_skip_dur += dur;
+        if (dur) {
+            audec->frame_skip_frames++;
+        }
+        audec->frame_skip_bytes += info.frame_size;
+        pos += info.frame_size;
+    }
+    return pos ? pos : -1;
+}
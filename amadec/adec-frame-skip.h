@@ -0,0 +1,39 @@
+/**
+ * \file adec-frame-skip.h
+ * \brief  Compressed frame skip for the start up audio drop.
+ * \version 1.0.0
+ * \date 2014-06-20
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#ifndef ADEC_FRAME_SKIP_H
+#define ADEC_FRAME_SKIP_H
+
+#include <audio-dec.h>
+ADEC_BEGIN_DECLS
+
+/* audec->frame_skip_state */
+#define FRAME_SKIP_IDLE     0
+#define FRAME_SKIP_REQUEST  1   //set by adec_pts_droppcm
+#define FRAME_SKIP_RUNNING  2   //the decode loop is skipping frames
+#define FRAME_SKIP_DONE     3
+
+typedef struct {
+    int frame_size;     ///< whole frame in bytes, header included
+    int samples;        ///< pcm samples per channel, 0 for dependent/extension substreams
+    int samplerate;
+} adec_frame_info_t;
+
+/**********************************************************************/
+
+int adec_frame_skip_format(int format);
+int adec_frame_parse(int format, const unsigned char *buf, int len, adec_frame_info_t *info);
+int adec_frame_skip_preroll(int format);
+int adec_frame_skip_request(aml_audio_dec_t *audec, unsigned long target, unsigned long apts);
+int adec_frame_skip_stop(aml_audio_dec_t *audec);
+int adec_frame_skip(aml_audio_dec_t *audec, const unsigned char *buf, int len);
+ADEC_END_DECLS
+
+#endif
@@ -185,6 +185,7 @@ static void start_adec(aml_audio_dec_t *audec)
         }
 
         aout_ops->resume(audec);
+        adec_pts_first_audio(audec);
 
     }
 }
@@ -682,7 +683,10 @@ int audiodec_init(aml_audio_dec_t *audec)
     pthread_t    tid;
     char value[PROPERTY_VALUE_MAX]={0};
     unsigned wfd = 0;	
+    struct timeval tv;
     adec_print("audiodec_init!");
+    gettimeofday(&tv, NULL);
+    audec->adec_init_time = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
     adec_message_pool_init(audec);
     get_output_func(audec);
     int nCodecType=audec->format;
@@ -15,6 +15,7 @@
 #include <errno.h>
 
 #include <adec-pts-mgt.h>
+#include <adec-frame-skip.h>
 #include <cutils/properties.h>
 #include <sys/time.h>
 #include <amthreadpool.h>
@@ -28,6 +29,7 @@ static int vdec_pts_pause(void);
 int droppcm_use_size(aml_audio_dec_t *audec, int drop_size);
 void droppcm_prop_ctrl(int *audio_ahead, int *pts_ahead_val);
 int droppcm_get_refpts(aml_audio_dec_t *audec, unsigned long *refpts);
+static int droppcm_skip_frames(aml_audio_dec_t *audec, unsigned long apts, int droppts, int drop_size);
 
 static int64_t gettime(void)
 {
@@ -266,7 +268,12 @@ int adec_pts_droppcm(aml_audio_dec_t *audec)
     adec_print("[%s::%d] audec->samplerated = %d, audec->channels = %d! \n",__FUNCTION__,__LINE__, audec->samplerate, audec->channels);
     adec_print("[%s::%d] droppts:0x%x, drop_size=%d,  audio ahead %d,ahead pts value %d \n",	__FUNCTION__,__LINE__, 
         droppts, drop_size, audio_ahead,pts_ahead_val);
-    if (droppcm_use_size(audec, drop_size) == -1) {
+    ret = droppcm_skip_frames(audec, apts, droppts, drop_size);
+    if (ret >= 0) {
+        adec_print("[%s::%d] frames skipped, pcm drop_size %d -> %d \n",__FUNCTION__,__LINE__, drop_size, ret);
+        drop_size = ret;
+    }
+    if (drop_size > 0 && droppcm_use_size(audec, drop_size) == -1) {
         adec_print("[%s::%d] timeout! data not enough! \n",__FUNCTION__,__LINE__);
     }
   
@@ -287,6 +294,86 @@ int adec_pts_droppcm(aml_audio_dec_t *audec)
     return 0;
 }
 
+/*
+ * Let the decode loop skip the whole frames before apts+droppts instead
+ * of decoding them. Until it gets to the next frame the decoder may wait
+ * for room in a full pcm buffer, that pcm is all before the target and is
+ * dropped here. Returns the pcm bytes still to drop: what was decoded
+ * before the skip and the part of the preroll frames before the target.
+ * -1 if the frames can't be skipped.
+ */
+static int droppcm_skip_frames(aml_audio_dec_t *audec, unsigned long apts, int droppts, int drop_size)
+{
+    char value[PROPERTY_VALUE_MAX]={0};
+    char buffer[8*1024];
+    unsigned long target = apts + droppts;
+    int bytes_per_ms = (audec->samplerate/1000) * audec->channels *2;
+    int drop_max_time = DROP_PCM_MAX_TIME; // unit:ms
+    int ret, state;
+    int64_t start_time;
+
+    if (!audec->frame_skip_enable || !audec->g_bst || bytes_per_ms <= 0
+        || !am_getconfig_bool_def("media.amadec.frameskip", 1)) {
+        return -1;
+    }
+    // everything to drop is decoded already
+    if (drop_size <= audec->g_bst->buf_level + audec->pcm_cache_size) {
+        return -1;
+    }
+    if (adec_frame_skip_request(audec, target, apts) < 0) {
+        return -1;
+    }
+    if(property_get("media.amplayer.dropmaxtime",value,NULL) > 0){
+        drop_max_time = atoi(value);
+    }
+
+    start_time = gettime();
+    while (!audec->need_stop) {
+        state = audec->frame_skip_state;
+        if (state == FRAME_SKIP_DONE || state == FRAME_SKIP_IDLE) {
+            break;
+        }
+        if (state == FRAME_SKIP_REQUEST) {
+            if (drop_size <= 0) {
+                if (adec_frame_skip_stop(audec) == 0) {
+                    return 0;
+                }
+                continue;
+            }
+            ret = audec->adsp_ops.dsp_read(&audec->adsp_ops, buffer, MIN(drop_size, 8192));
+            if (ret > 0) {
+                drop_size -= ret;
+                continue;
+            }
+        }
+        if ((gettime() - start_time)/1000 > drop_max_time) {
+            adec_print("[%s::%d] frame skip not done in %d ms \n",__FUNCTION__,__LINE__, drop_max_time);
+            break;
+        }
+        amthreadpool_thread_usleep(5000);
+    }
+    // nothing skipped,the pcm is still contiguous from apts
+    if (adec_frame_skip_stop(audec) == 0 || audec->frame_skip_frames == 0) {
+        return drop_size > 0 ? drop_size : 0;
+    }
+    droppts = target - audec->frame_skip_pts;
+    return audec->frame_skip_pcm_level + (droppts > 0 ? (droppts/90) * bytes_per_ms : 0);
+}
+
+/**
+ * \brief log the time from the decoder init to the audio output start
+ * \param audec pointer to audec
+ */
+void adec_pts_first_audio(aml_audio_dec_t *audec)
+{
+    if (audec->adec_init_time <= 0) {
+        return;
+    }
+    adec_print("first audio %lld ms after decoder init, frame skip %d frames %lu ms\n",
+               (gettime() - audec->adec_init_time)/1000, audec->frame_skip_frames, audec->frame_skip_dur/90);
+    audec->adec_init_time = 0;
+}
+
 /**
  * \brief pause pts manager
  * \return 0 on success otherwise -1
@@ -50,6 +50,7 @@ int adec_refresh_pts(aml_audio_dec_t *audec);
 int avsync_en(int e);
 int track_switch_pts(aml_audio_dec_t *audec);
 int adec_get_tsync_info(int *tsync_mode);
+void adec_pts_first_audio(aml_audio_dec_t *audec);
 ADEC_END_DECLS
 
 #endif
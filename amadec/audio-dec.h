@@ -170,6 +170,20 @@ struct aml_audio_dec {
     int tsync_mode;
     adec_thread_mgt_t thread_mgt;
     int dtshdll_flag;
+
+    /* compressed frame skip before the pcm drop, see adec-frame-skip.c */
+    int frame_skip_enable;          // the decode loop can skip frames
+    int frame_skip_state;
+    unsigned long frame_skip_target;
+    unsigned long frame_skip_pts;   // pts of the next frame
+    unsigned long frame_skip_dur;
+    int frame_skip_frames;
+    int frame_skip_bytes;
+    int frame_skip_pcm_level;       // pcm decoded before the skip, still buffered
+    int64_t frame_skip_decoded;     // pcm_bytes_decoded at the request
+    int64_t pcm_bytes_decoded;
+    int64_t frame_skip_start_time;
+    int64_t adec_init_time;         // for the time to first audio
 };
 
 //from amcodec
@@ -1,4 +1,9 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/time.h>
 #include <amthreadpool.h>
+#include <amconfigutils.h>
 #include <itemlist.h>
 
 #define LOG_TAG "amthreadpool"
@@ -31,6 +36,7 @@ typedef struct threadpool_thread_data {
     pthread_mutex_t pthread_mutex;
     pthread_cond_t pthread_cond;
     int on_requred_exit;
+    struct threadpool_thread_data *hash_next;
 } threadpool_thread_data_t;
 #define POOL_OF_ITEM(item) ((threadpool_t *)(item)->extdata[0])
 #define THREAD_OF_ITEM(item) ((threadpool_thread_data_t *)(item)->extdata[0])
@@ -48,14 +54,72 @@ static threadpool_t * amthreadpool_findthead_pool(pthread_t  pid)
     return NULL;
 }
 
+/*
+ * thread data lookups: the calling thread finds its own data through a
+ * thread specific key, any other thread through a pid hash. Both used to
+ * be a locked linear search of threadpool_threadlist, on every sleep and
+ * on every interrupt check of ffmpeg.
+ */
+#define THREAD_HASH_SIZE 64
+
+static pthread_key_t thread_data_key;
+static pthread_once_t thread_data_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t thread_hash_lock = PTHREAD_MUTEX_INITIALIZER;
+static threadpool_thread_data_t *thread_hash[THREAD_HASH_SIZE];
+
+static void amthreadpool_thread_key_init(void)
+{
+    pthread_key_create(&thread_data_key, NULL);
+}
+
+static unsigned int amthreadpool_thread_hash(pthread_t pid)
+{
+    return ((unsigned long)pid * 2654435761u >> 8) & (THREAD_HASH_SIZE - 1);
+}
+
+static void amthreadpool_thread_hash_add(threadpool_thread_data_t *t)
+{
+    unsigned int h = amthreadpool_thread_hash(t->pid);
+
+    pthread_once(&thread_data_once, amthreadpool_thread_key_init);
+    pthread_setspecific(thread_data_key, t);
+    pthread_mutex_lock(&thread_hash_lock);
+    t->hash_next = thread_hash[h];
+    thread_hash[h] = t;
+    pthread_mutex_unlock(&thread_hash_lock);
+}
+
+static void amthreadpool_thread_hash_del(threadpool_thread_data_t *t)
+{
+    threadpool_thread_data_t **pp;
+
+    pthread_mutex_lock(&thread_hash_lock);
+    for (pp = &thread_hash[amthreadpool_thread_hash(t->pid)]; *pp; pp = &(*pp)->hash_next) {
+        if (*pp == t) {
+            *pp = t->hash_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread_hash_lock);
+}
+
 static threadpool_thread_data_t * amthreadpool_findthead_thread_data(pthread_t pid)
 {
-    struct item *item;
-    item = itemlist_find_match_item(&threadpool_threadlist, pid);
-    if (item) {
-        return (threadpool_thread_data_t *)item->extdata[0];
+    threadpool_thread_data_t *t;
+
+    if (pthread_equal(pid, pthread_self())) {
+        /*threads register themselves, no data here means not a pool thread*/
+        pthread_once(&thread_data_once, amthreadpool_thread_key_init);
+        return (threadpool_thread_data_t *)pthread_getspecific(thread_data_key);
     }
-    return NULL;
+    pthread_mutex_lock(&thread_hash_lock);
+    for (t = thread_hash[amthreadpool_thread_hash(pid)]; t; t = t->hash_next) {
+        if (pthread_equal(t->pid, pid)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread_hash_lock);
+    return t;
 }
 
 /*creat thread pool  for main thread*/
@@ -113,6 +177,7 @@ static int amthreadpool_pool_del_thread(pthread_t pid)
     t1 = THREAD_OF_ITEM(item);
 	item_free(item);
     T_ASSERT_NO_NULL(t1);
+    amthreadpool_thread_hash_del(t1);
     pool = t1->pool;
     T_ASSERT_NO_NULL(pool);
     item = itemlist_get_match_item(&pool->threadlist, pid);
@@ -271,6 +336,14 @@ static int amthreadpool_release(pthread_t pid)
 }
 
 
+static void amthreadpool_thread_register(threadpool_thread_data_t *t, threadpool_t *pool)
+{
+    pthread_mutex_init(&t->pthread_mutex, NULL);
+    pthread_cond_init(&t->pthread_cond, NULL);
+    amthreadpool_pool_add_thread(pool, t->pid, t);
+    amthreadpool_thread_hash_add(t);
+}
+
 void * amthreadpool_start_thread(void *arg)
 {
     void *ret;
@@ -292,9 +365,7 @@ void * amthreadpool_start_thread(void *arg)
             t->pool = pool;
 
         }
-        pthread_mutex_init(&t->pthread_mutex, NULL);
-        pthread_cond_init(&t->pthread_cond, NULL);
-        amthreadpool_pool_add_thread(pool, t->pid, t);
+        amthreadpool_thread_register(t, pool);
     }
     ret = t->start_routine(t->arg);
     return ret;
@@ -347,8 +418,369 @@ int amthreadpool_pthread_join(pthread_t thid, void ** ret_val)
 }
 
 
+/*
+ * task pool: persistent workers for short jobs (probing, parsing,
+ * bandwidth estimation) that used to pay a pthread create and join each.
+ * Every worker has a local ring per priority, tasks submitted from a
+ * worker go there and are taken back LIFO while they are cache hot; the
+ * rest go to a global FIFO per priority. An idle worker takes in priority
+ * order its own ring, the global queue, then steals the oldest task of
+ * another worker. The workers are registered thread data with their own
+ * pool, so amthreadpool_thread_usleep() and the interrupt checks of a task
+ * work as in any player thread, and a task can be cancelled like one.
+ */
+#define TASK_PRIOS          3
+#define TASK_RING_SIZE      64
+#define TASK_MAX_WORKERS    16
+#define TASK_DEF_WORKERS    4
+
+enum {
+    TASK_QUEUED = 0,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_CANCELED,
+};
+
+struct amthreadpool_task {
+    void * (*fn)(void *);
+    void *arg;
+    void *ret;
+    int prio;
+    int state;
+    int refs;               /*one for the queue, one for the submitter*/
+    threadpool_thread_data_t *runner;
+    struct amthreadpool_task *next;
+};
+
+typedef struct task_ring {
+    amthreadpool_task_t *slot[TASK_RING_SIZE];
+    unsigned int head;      /*oldest*/
+    unsigned int tail;      /*next free*/
+} task_ring_t;
+
+typedef struct task_worker {
+    int index;
+    threadpool_thread_data_t *t;
+    pthread_mutex_t lock;
+    task_ring_t ring[TASK_PRIOS];
+} task_worker_t;
+
+typedef struct task_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    amthreadpool_task_t *head[TASK_PRIOS];
+    amthreadpool_task_t *tail[TASK_PRIOS];
+    int queued;             /*tasks in the rings and global queues, not yet taken*/
+    int nworkers;
+    task_worker_t worker[TASK_MAX_WORKERS];
+    amthreadpool_task_stats_t stats;
+} task_pool_t;
+
+static task_pool_t task_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+};
+static pthread_key_t task_worker_key;
+
+static int task_ring_push(task_ring_t *r, amthreadpool_task_t *task)
+{
+    if (r->tail - r->head >= TASK_RING_SIZE) {
+        return -1;
+    }
+    r->slot[r->tail++ % TASK_RING_SIZE] = task;
+    return 0;
+}
+
+static amthreadpool_task_t *task_ring_pop_back(task_ring_t *r)
+{
+    if (r->tail == r->head) {
+        return NULL;
+    }
+    return r->slot[--r->tail % TASK_RING_SIZE];
+}
+
+static amthreadpool_task_t *task_ring_pop_front(task_ring_t *r)
+{
+    if (r->tail == r->head) {
+        return NULL;
+    }
+    return r->slot[r->head++ % TASK_RING_SIZE];
+}
+
+/*called with task_pool.lock*/
+static void amthreadpool_task_put(amthreadpool_task_t *task)
+{
+    if (--task->refs == 0) {
+        free(task);
+    }
+}
+
+static amthreadpool_task_t *amthreadpool_task_take(task_worker_t *self, int *stolen)
+{
+    amthreadpool_task_t *task = NULL;
+    task_worker_t *w;
+    int prio, i, n = task_pool.nworkers;
+
+    *stolen = 0;
+    for (prio = 0; prio < TASK_PRIOS; prio++) {
+        pthread_mutex_lock(&self->lock);
+        task = task_ring_pop_back(&self->ring[prio]);
+        pthread_mutex_unlock(&self->lock);
+        if (task) {
+            return task;
+        }
+        pthread_mutex_lock(&task_pool.lock);
+        task = task_pool.head[prio];
+        if (task) {
+            task_pool.head[prio] = task->next;
+            if (!task_pool.head[prio]) {
+                task_pool.tail[prio] = NULL;
+            }
+        }
+        pthread_mutex_unlock(&task_pool.lock);
+        if (task) {
+            return task;
+        }
+        for (i = 1; i < n; i++) {
+            w = &task_pool.worker[(self->index + i) % n];
+            pthread_mutex_lock(&w->lock);
+            task = task_ring_pop_front(&w->ring[prio]);
+            pthread_mutex_unlock(&w->lock);
+            if (task) {
+                *stolen = 1;
+                return task;
+            }
+        }
+    }
+    return NULL;
+}
 
+static void *amthreadpool_task_worker(void *arg)
+{
+    task_worker_t *w = (task_worker_t *)arg;
+    threadpool_thread_data_t *t;
+    amthreadpool_task_t *task;
+    void *ret;
+    int stolen;
 
+    t = malloc(sizeof(threadpool_thread_data_t));
+    if (!t) {
+        ALOGE("malloc task worker data failed\n");
+        return NULL;
+    }
+    memset(t, 0, sizeof(threadpool_thread_data_t));
+    t->pid = pthread_self();
+    /*own pool: a cancel of the submitting player must not reach the workers*/
+    amthreadpool_thread_register(t, NULL);
+    w->t = t;
+    pthread_setspecific(task_worker_key, w);
+    for (;;) {
+        pthread_mutex_lock(&task_pool.lock);
+        while (task_pool.queued == 0) {
+            pthread_cond_wait(&task_pool.work_cond, &task_pool.lock);
+        }
+        task_pool.queued--;
+        pthread_mutex_unlock(&task_pool.lock);
+        /*queued is raised after the push, so a task is there for us*/
+        while (!(task = amthreadpool_task_take(w, &stolen))) {
+            sched_yield();
+        }
+        pthread_mutex_lock(&task_pool.lock);
+        if (task->state != TASK_QUEUED) {
+            /*cancelled or run by its waiter*/
+            amthreadpool_task_put(task);
+            pthread_mutex_unlock(&task_pool.lock);
+            continue;
+        }
+        task->state = TASK_RUNNING;
+        task->runner = t;
+        task_pool.stats.stolen += stolen;
+        pthread_mutex_unlock(&task_pool.lock);
+
+        ret = task->fn(task->arg);
+
+        pthread_mutex_lock(&t->pthread_mutex);
+        t->on_requred_exit = 0;
+        pthread_mutex_unlock(&t->pthread_mutex);
+        pthread_mutex_lock(&task_pool.lock);
+        task->ret = ret;
+        task->state = TASK_DONE;
+        task->runner = NULL;
+        task_pool.stats.completed++;
+        pthread_cond_broadcast(&task_pool.done_cond);
+        amthreadpool_task_put(task);
+        pthread_mutex_unlock(&task_pool.lock);
+    }
+    return NULL;
+}
+
+int amthreadpool_task_pool_init(int workers)
+{
+    pthread_t pid;
+    int i, p;
+
+    pthread_mutex_lock(&task_pool.lock);
+    if (task_pool.nworkers) {
+        pthread_mutex_unlock(&task_pool.lock);
+        return task_pool.nworkers;
+    }
+    if (workers <= 0) {
+        workers = (int)am_getconfig_float_def("media.amthreadpool.workers", TASK_DEF_WORKERS);
+    }
+    if (workers <= 0) {
+        workers = TASK_DEF_WORKERS;
+    }
+    if (workers > TASK_MAX_WORKERS) {
+        workers = TASK_MAX_WORKERS;
+    }
+    pthread_key_create(&task_worker_key, NULL);
+    for (i = 0; i < workers; i++) {
+        memset(&task_pool.worker[i], 0, sizeof(task_worker_t));
+        task_pool.worker[i].index = i;
+        pthread_mutex_init(&task_pool.worker[i].lock, NULL);
+    }
+    task_pool.nworkers = workers;
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&pid, NULL, amthreadpool_task_worker, &task_pool.worker[i])) {
+            ALOGE("task worker %d create failed\n", i);
+            break;
+        }
+        pthread_detach(pid);
+    }
+    if (i == 0) {
+        pthread_key_delete(task_worker_key);
+    }
+    /*no local pushes can target a worker that never started*/
+    task_pool.nworkers = i;
+    task_pool.stats.workers = i;
+    for (p = 0; p < TASK_PRIOS; p++) {
+        task_pool.head[p] = task_pool.tail[p] = NULL;
+    }
+    pthread_mutex_unlock(&task_pool.lock);
+    ALOGI("task pool started with %d workers\n", i);
+    return i > 0 ? i : -1;
+}
+
+amthreadpool_task_t *amthreadpool_task_submit(void * (*fn)(void *), void *arg, int prio)
+{
+    amthreadpool_task_t *task;
+    task_worker_t *w;
+    int local = -1;
+
+    if (!fn || (!task_pool.nworkers && amthreadpool_task_pool_init(0) < 0)) {
+        return NULL;
+    }
+    if (prio < AMTHREADPOOL_PRIO_HIGH || prio > AMTHREADPOOL_PRIO_LOW) {
+        prio = AMTHREADPOOL_PRIO_NORMAL;
+    }
+    task = malloc(sizeof(amthreadpool_task_t));
+    if (!task) {
+        return NULL;
+    }
+    memset(task, 0, sizeof(amthreadpool_task_t));
+    task->fn = fn;
+    task->arg = arg;
+    task->prio = prio;
+    task->state = TASK_QUEUED;
+    task->refs = 2;
+    w = (task_worker_t *)pthread_getspecific(task_worker_key);
+    if (w) {
+        pthread_mutex_lock(&w->lock);
+        local = task_ring_push(&w->ring[prio], task);
+        pthread_mutex_unlock(&w->lock);
+    }
+    pthread_mutex_lock(&task_pool.lock);
+    if (local < 0) {
+        if (task_pool.tail[prio]) {
+            task_pool.tail[prio]->next = task;
+        } else {
+            task_pool.head[prio] = task;
+        }
+        task_pool.tail[prio] = task;
+    }
+    task_pool.queued++;
+    task_pool.stats.submitted++;
+    pthread_cond_signal(&task_pool.work_cond);
+    pthread_mutex_unlock(&task_pool.lock);
+    return task;
+}
+
+int amthreadpool_task_run(void * (*fn)(void *), void *arg, int prio)
+{
+    amthreadpool_task_t *task = amthreadpool_task_submit(fn, arg, prio);
+    if (!task) {
+        return -1;
+    }
+    pthread_mutex_lock(&task_pool.lock);
+    amthreadpool_task_put(task);
+    pthread_mutex_unlock(&task_pool.lock);
+    return 0;
+}
+
+void *amthreadpool_task_wait(amthreadpool_task_t *task)
+{
+    task_worker_t *w;
+    void *ret;
+
+    if (!task) {
+        return NULL;
+    }
+    w = (task_worker_t *)pthread_getspecific(task_worker_key);
+    pthread_mutex_lock(&task_pool.lock);
+    if (w && task->state == TASK_QUEUED) {
+        /*a worker waiting on a queued task runs it, all workers waiting would deadlock*/
+        task->state = TASK_RUNNING;
+        task->runner = w->t;
+        task_pool.stats.inline_runs++;
+        pthread_mutex_unlock(&task_pool.lock);
+        ret = task->fn(task->arg);
+        pthread_mutex_lock(&task_pool.lock);
+        task->ret = ret;
+        task->state = TASK_DONE;
+        task->runner = NULL;
+        task_pool.stats.completed++;
+    }
+    while (task->state == TASK_QUEUED || task->state == TASK_RUNNING) {
+        pthread_cond_wait(&task_pool.done_cond, &task_pool.lock);
+    }
+    ret = task->ret;
+    amthreadpool_task_put(task);
+    pthread_mutex_unlock(&task_pool.lock);
+    return ret;
+}
+
+int amthreadpool_task_cancel(amthreadpool_task_t *task)
+{
+    int ret = -1;
+
+    if (!task) {
+        return -1;
+    }
+    pthread_mutex_lock(&task_pool.lock);
+    if (task->state == TASK_QUEUED) {
+        /*left in its queue, the worker taking it drops it*/
+        task->state = TASK_CANCELED;
+        task_pool.stats.canceled++;
+        pthread_cond_broadcast(&task_pool.done_cond);
+        ret = 0;
+    } else if (task->state == TASK_RUNNING && task->runner) {
+        amthreadpool_thread_wake_t(task->runner, 3);
+        ret = 1;
+    }
+    pthread_mutex_unlock(&task_pool.lock);
+    return ret;
+}
+
+int amthreadpool_task_get_stats(amthreadpool_task_stats_t *stats)
+{
+    pthread_mutex_lock(&task_pool.lock);
+    *stats = task_pool.stats;
+    stats->queued = task_pool.queued;
+    pthread_mutex_unlock(&task_pool.lock);
+    return 0;
+}
 
 /*creat thread pool  system init*/
 int amthreadpool_system_init(void)
@@ -0,0 +1,391 @@
+/*
+ * startup/seek tracepoints.
+ *
+ * a trace session is opened per player pid; events from the player thread
+ * and from the stream layers (loop buffer, hls) go to the ring of the session
+ * bound to the calling thread. events of threads that never bound a session
+ * are dropped, they can't be told apart between players.
+ * completed phases are kept in a per phase history for p50/p95/p99 queries,
+ * the ring can be exported as chrome://tracing JSON.
+ *
+ * recording takes no lock: ring and history slots are claimed with an atomic
+ * counter and published with a sequence number that readers check before and
+ * after copying. only session open/bind/close take trace_lock.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "include/amtrace.h"
+
+#define AMTRACE_SESSIONS    8
+#define AMTRACE_RING        512
+#define AMTRACE_HISTORY     128
+
+typedef struct {
+    volatile unsigned int seq;  /* slot index + 1 once written, 0 while being written */
+    int tid;
+    short phase;
+    char type;
+    int64_t ts;
+    int64_t arg;
+} amtrace_ev_t;
+
+typedef struct {
+    volatile int used;
+    volatile int id;
+    volatile unsigned int gen;  /* bumped on (re)open, older bindings stop recording */
+    int64_t start_us;
+    int64_t begin_us[AMTRACE_PHASE_MAX];
+    unsigned int once_mask;
+    unsigned int wr;
+    amtrace_ev_t ring[AMTRACE_RING];
+} amtrace_session_t;
+
+typedef struct {
+    volatile unsigned int seq;
+    int id;
+    int64_t dur_us;
+} amtrace_hist_t;
+
+/* per thread binding, the pthread key value */
+typedef struct {
+    amtrace_session_t *s;
+    unsigned int gen;
+    int tid;
+} amtrace_bind_t;
+
+static amtrace_session_t trace_sessions[AMTRACE_SESSIONS];
+static amtrace_hist_t trace_hist[AMTRACE_PHASE_MAX][AMTRACE_HISTORY];
+static unsigned int trace_hist_wr[AMTRACE_PHASE_MAX];
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t trace_key;
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+
+static const char *trace_phase_names[AMTRACE_PHASE_MAX] = {
+    "startup",
+    "open",
+    "probe",
+    "dec_init",
+    "decoder_init",
+    "header_feed",
+    "first_write",
+    "first_pts",
+    "seek",
+    "seek_stream",
+    "seek_reset",
+    "lpbuf_seek",
+    "hls_playlist",
+    "hls_segment_open",
+    "hls_seek",
+};
+
+static int64_t amtrace_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void amtrace_key_init(void)
+{
+    pthread_key_create(&trace_key, free);
+}
+
+static amtrace_session_t *amtrace_find_session(int id)
+{
+    int i;
+    for (i = 0; i < AMTRACE_SESSIONS; i++) {
+        if (trace_sessions[i].used && trace_sessions[i].id == id) {
+            return &trace_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static amtrace_bind_t *amtrace_current(void)
+{
+    amtrace_bind_t *b;
+    pthread_once(&trace_key_once, amtrace_key_init);
+    b = pthread_getspecific(trace_key);
+    if (!b || !b->s || b->s->gen != b->gen) {
+        return NULL;
+    }
+    return b;
+}
+
+static void amtrace_add_history(int id, int phase, int64_t dur_us)
+{
+    unsigned int idx = __sync_fetch_and_add(&trace_hist_wr[phase], 1);
+    amtrace_hist_t *h = &trace_hist[phase][idx % AMTRACE_HISTORY];
+    h->seq = 0;
+    __sync_synchronize();
+    h->id = id;
+    h->dur_us = dur_us;
+    __sync_synchronize();
+    h->seq = idx + 1;
+}
+
+const char *amtrace_phase_name(int phase)
+{
+    if (phase < 0 || phase >= AMTRACE_PHASE_MAX) {
+        return "unknown";
+    }
+    return trace_phase_names[phase];
+}
+
+int amtrace_session_open(int id)
+{
+    amtrace_session_t *s;
+    int i;
+
+    pthread_mutex_lock(&trace_lock);
+    s = amtrace_find_session(id);
+    if (!s) {
+        for (i = 0; i < AMTRACE_SESSIONS; i++) {
+            if (!trace_sessions[i].used) {
+                s = &trace_sessions[i];
+                break;
+            }
+        }
+    }
+    if (!s) {
+        /* all slots kept for dumping, reuse the oldest session */
+        s = &trace_sessions[0];
+        for (i = 1; i < AMTRACE_SESSIONS; i++) {
+            if (trace_sessions[i].start_us < s->start_us) {
+                s = &trace_sessions[i];
+            }
+        }
+    }
+    /* writers still holding the old generation drop their events from here */
+    __sync_fetch_and_add(&s->gen, 1);
+    s->used = 0;
+    __sync_synchronize();
+    s->id = id;
+    s->start_us = amtrace_now_us();
+    memset(s->begin_us, 0, sizeof(s->begin_us));
+    s->once_mask = 0;
+    s->wr = 0;
+    memset(s->ring, 0, sizeof(s->ring));
+    __sync_synchronize();
+    s->used = 1;
+    pthread_mutex_unlock(&trace_lock);
+    return amtrace_session_bind(id);
+}
+
+int amtrace_session_bind(int id)
+{
+    amtrace_session_t *s;
+    amtrace_bind_t *b;
+
+    pthread_once(&trace_key_once, amtrace_key_init);
+    b = pthread_getspecific(trace_key);
+    if (!b) {
+        b = malloc(sizeof(*b));
+        if (!b) {
+            return -1;
+        }
+        b->s = NULL;
+        b->tid = (int)syscall(__NR_gettid);
+        pthread_setspecific(trace_key, b);
+    }
+    pthread_mutex_lock(&trace_lock);
+    s = amtrace_find_session(id);
+    b->s = s;
+    b->gen = s ? s->gen : 0;
+    pthread_mutex_unlock(&trace_lock);
+    return s ? 0 : -1;
+}
+
+int amtrace_session_close(int id)
+{
+    /* the ring stays readable until the slot is reused */
+    amtrace_bind_t *b = amtrace_current();
+    if (b && b->s->id == id) {
+        b->s = NULL;
+    }
+    return 0;
+}
+
+static void amtrace_record(amtrace_session_t *s, int tid, int phase, char type, int64_t arg)
+{
+    amtrace_ev_t *ev;
+    unsigned int idx, bit = 1u << phase;
+    int64_t now, begin;
+
+    now = amtrace_now_us();
+    if (type == AMTRACE_EV_BEGIN) {
+        __sync_lock_test_and_set(&s->begin_us[phase], now);
+    } else if (type == AMTRACE_EV_END) {
+        begin = __sync_lock_test_and_set(&s->begin_us[phase], 0);
+        if (!begin) {
+            /* end without begin, e.g. seek aborted before it started */
+            return;
+        }
+        amtrace_add_history(s->id, phase, now - begin);
+    } else if (arg < 0) {
+        /* once mark */
+        if (__sync_fetch_and_or(&s->once_mask, bit) & bit) {
+            return;
+        }
+        arg = now - s->start_us;
+        amtrace_add_history(s->id, phase, arg);
+    }
+    idx = __sync_fetch_and_add(&s->wr, 1);
+    ev = &s->ring[idx % AMTRACE_RING];
+    ev->seq = 0;
+    __sync_synchronize();
+    ev->ts = now;
+    ev->arg = arg;
+    ev->tid = tid;
+    ev->phase = phase;
+    ev->type = type;
+    __sync_synchronize();
+    ev->seq = idx + 1;
+}
+
+void amtrace_event(int id, int phase, char type, int64_t arg)
+{
+    amtrace_session_t *s;
+
+    if (phase < 0 || phase >= AMTRACE_PHASE_MAX) {
+        return;
+    }
+    s = amtrace_find_session(id);
+    if (s) {
+        amtrace_record(s, (int)syscall(__NR_gettid), phase, type, arg);
+    }
+}
+
+static void amtrace_bound_event(int phase, char type, int64_t arg)
+{
+    amtrace_bind_t *b;
+
+    if (phase < 0 || phase >= AMTRACE_PHASE_MAX) {
+        return;
+    }
+    b = amtrace_current();
+    if (b) {
+        amtrace_record(b->s, b->tid, phase, type, arg);
+    }
+}
+
+void amtrace_begin(int phase)
+{
+    amtrace_bound_event(phase, AMTRACE_EV_BEGIN, 0);
+}
+
+void amtrace_end(int phase)
+{
+    amtrace_bound_event(phase, AMTRACE_EV_END, 0);
+}
+
+void amtrace_mark(int phase)
+{
+    amtrace_bound_event(phase, AMTRACE_EV_INSTANT, 0);
+}
+
+void amtrace_mark_once(int phase)
+{
+    amtrace_bound_event(phase, AMTRACE_EV_INSTANT, -1);
+}
+
+int amtrace_in_phase(int phase)
+{
+    amtrace_bind_t *b;
+
+    if (phase < 0 || phase >= AMTRACE_PHASE_MAX) {
+        return 0;
+    }
+    b = amtrace_current();
+    return b && __sync_fetch_and_add(&b->s->begin_us[phase], 0) != 0;
+}
+
+static int amtrace_cmp_dur(const void *a, const void *b)
+{
+    int64_t d = *(const int64_t *)a - *(const int64_t *)b;
+    return d < 0 ? -1 : (d > 0);
+}
+
+int amtrace_get_stat(int id, int phase, amtrace_stat_t *stat)
+{
+    int64_t dur[AMTRACE_HISTORY];
+    unsigned int i, n, cnt = 0;
+
+    if (!stat || phase < 0 || phase >= AMTRACE_PHASE_MAX) {
+        return -1;
+    }
+    memset(stat, 0, sizeof(*stat));
+    n = trace_hist_wr[phase] < AMTRACE_HISTORY ? trace_hist_wr[phase] : AMTRACE_HISTORY;
+    for (i = 0; i < n; i++) {
+        amtrace_hist_t *h = &trace_hist[phase][i];
+        unsigned int seq = h->seq;
+        int hid;
+        int64_t d;
+        __sync_synchronize();
+        hid = h->id;
+        d = h->dur_us;
+        __sync_synchronize();
+        if (!seq || h->seq != seq) {
+            continue;   /* being written */
+        }
+        if (id < 0 || hid == id) {
+            dur[cnt++] = d;
+        }
+    }
+    if (!cnt) {
+        return 0;
+    }
+    qsort(dur, cnt, sizeof(dur[0]), amtrace_cmp_dur);
+    stat->count = cnt;
+    stat->p50_us = dur[cnt * 50 / 100];
+    stat->p95_us = dur[cnt * 95 / 100];
+    stat->p99_us = dur[cnt * 99 / 100];
+    stat->max_us = dur[cnt - 1];
+    return 0;
+}
+
+int amtrace_dump_chrome(int id, int fd)
+{
+    amtrace_session_t *s, *copy;
+    unsigned int i, first, n = 0;
+    char buf[256];
+    int len;
+
+    if (fd < 0) {
+        return -1;
+    }
+    copy = malloc(sizeof(*copy));
+    if (!copy) {
+        return -1;
+    }
+    s = amtrace_find_session(id);
+    if (!s) {
+        free(copy);
+        return -1;
+    }
+    memcpy(copy, s, sizeof(*copy));
+    __sync_synchronize();
+
+    write(fd, "{\"traceEvents\":[\n", 17);
+    first = copy->wr > AMTRACE_RING ? copy->wr - AMTRACE_RING : 0;
+    for (i = first; i < copy->wr; i++) {
+        amtrace_ev_t *ev = &copy->ring[i % AMTRACE_RING];
+        if (ev->seq != i + 1 || s->ring[i % AMTRACE_RING].seq != ev->seq) {
+            continue;   /* overwritten or being written while copied */
+        }
+        len = snprintf(buf, sizeof(buf),
+                       "%s{\"name\":\"%s\",\"cat\":\"player\",\"ph\":\"%c\",%s\"ts\":%lld,\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%lld}}\n",
+                       n++ ? "," : "", amtrace_phase_name(ev->phase), ev->type,
+                       ev->type == AMTRACE_EV_INSTANT ? "\"s\":\"p\"," : "",
+                       (long long)ev->ts, id, ev->tid, (long long)ev->arg);
+        write(fd, buf, len);
+    }
+    write(fd, "]}\n", 3);
+    free(copy);
+    return 0;
+}
@@ -25,6 +25,39 @@ int amthreadpool_system_init(void);
 int amthreadpool_system_dump_info(void);
 int amthreadpool_on_requare_exit(pthread_t pid);
 
+/*
+ * task pool, persistent workers for short jobs.
+ * submit returns a handle that must be given to amthreadpool_task_wait(),
+ * which returns the task's return value and frees it; a cancelled task
+ * that never ran returns NULL. amthreadpool_task_run() is fire and forget.
+ * cancel returns 0 if the task was dropped before running, 1 if it is
+ * running and was asked to exit (amthreadpool_on_requare_exit(0) in the
+ * task), -1 if it is already done.
+ */
+#define AMTHREADPOOL_PRIO_HIGH      0
+#define AMTHREADPOOL_PRIO_NORMAL    1
+#define AMTHREADPOOL_PRIO_LOW       2
+
+typedef struct amthreadpool_task amthreadpool_task_t;
+
+typedef struct {
+    int workers;
+    int queued;
+    unsigned int submitted;
+    unsigned int completed;
+    unsigned int canceled;
+    unsigned int stolen;
+    unsigned int inline_runs;
+} amthreadpool_task_stats_t;
+
+/*workers <= 0: media.amthreadpool.workers, default 4; started on first submit otherwise*/
+int amthreadpool_task_pool_init(int workers);
+amthreadpool_task_t *amthreadpool_task_submit(void * (*fn)(void *), void *arg, int prio);
+int amthreadpool_task_run(void * (*fn)(void *), void *arg, int prio);
+void *amthreadpool_task_wait(amthreadpool_task_t *task);
+int amthreadpool_task_cancel(amthreadpool_task_t *task);
+int amthreadpool_task_get_stats(amthreadpool_task_stats_t *stats);
+
 
 
 #ifdef AMTHREADPOOL_DEBUG
@@ -0,0 +1,72 @@
+#ifndef AMTRACE_H
+#define AMTRACE_H
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * startup/seek phase tracepoints.
+ * events go to a small ring per trace session (one per player pid),
+ * completed phases also feed a duration history for percentile queries.
+ */
+typedef enum {
+    AMTRACE_STARTUP = 0,        ///< player thread start -> first video/audio pts
+    AMTRACE_OPEN,               ///< ffmpeg_open_file
+    AMTRACE_PROBE,              ///< stream info probing
+    AMTRACE_DEC_INIT,           ///< player_dec_init
+    AMTRACE_DECODER_INIT,       ///< player_decoder_init, codec devices
+    AMTRACE_HEADER_FEED,        ///< codec header feeding
+    AMTRACE_FIRST_WRITE,        ///< session start -> first codec_write
+    AMTRACE_FIRST_PTS,          ///< session start -> first pts checked out
+    AMTRACE_SEEK,               ///< seek request -> first pts after seek
+    AMTRACE_SEEK_STREAM,        ///< time_search in the demuxer
+    AMTRACE_SEEK_RESET,         ///< decoder reset after seek
+    AMTRACE_LPBUF_SEEK,         ///< loop buffer seek outside buffered data
+    AMTRACE_HLS_PLAYLIST,       ///< hls playlist download and parse
+    AMTRACE_HLS_SEGMENT_OPEN,   ///< hls segment connect
+    AMTRACE_HLS_SEEK,           ///< hls session seek
+    AMTRACE_PHASE_MAX
+} amtrace_phase_t;
+
+#define AMTRACE_EV_BEGIN    'B'
+#define AMTRACE_EV_END      'E'
+#define AMTRACE_EV_INSTANT  'i'
+
+typedef struct {
+    int count;                  ///< number of completed phases
+    int64_t p50_us;
+    int64_t p95_us;
+    int64_t p99_us;
+    int64_t max_us;
+} amtrace_stat_t;
+
+/* open (or restart) the session of id and bind it to the calling thread */
+int amtrace_session_open(int id);
+/* bind the calling thread to an opened session, used by worker threads */
+int amtrace_session_bind(int id);
+int amtrace_session_close(int id);
+
+/* events on the session bound to the calling thread, dropped on threads
+ * that never bound one; recording does not lock */
+void amtrace_begin(int phase);
+void amtrace_end(int phase);
+void amtrace_mark(int phase);
+/* the first mark of a phase in a session only, e.g. first write */
+void amtrace_mark_once(int phase);
+/* 1 while a phase is begun and not yet ended */
+int amtrace_in_phase(int phase);
+
+void amtrace_event(int id, int phase, char type, int64_t arg);
+
+/* percentiles of the last completed phases of id, id < 0 for all sessions */
+int amtrace_get_stat(int id, int phase, amtrace_stat_t *stat);
+/* write the ring of id as chrome://tracing JSON */
+int amtrace_dump_chrome(int id, int fd);
+const char *amtrace_phase_name(int phase);
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
@@ -4,6 +4,8 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES := \
 	codec/codec_ctrl.c \
 	codec/codec_h_ctrl.c \
+	codec/codec_h_emu.c \
+	codec/codec_bufpool.c \
 	codec/codec_msg.c \
 	audio_ctl/audio_ctrl.c
 
@@ -25,6 +27,8 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES := \
 	codec/codec_ctrl.c \
 	codec/codec_h_ctrl.c \
+	codec/codec_h_emu.c \
+	codec/codec_bufpool.c \
 	codec/codec_msg.c \
 	audio_ctl/audio_ctrl.c
 
@@ -0,0 +1,391 @@
+/**
+* @file codec_bufpool.c
+* @brief  Pooled es buffers and batched submission to codec devices
+* @version 1.0.0
+* @date 2013-08-12
+*/
+/* Copyright (C) 2007-2011, Amlogic Inc.
+* All right reserved
+*
+*/
+/*
+ * Clients that keep their own staging buffers copy every packet once more
+ * before codec_write(). A pool hands out buffers the client demuxes or
+ * decrypts into directly; submitted buffers are queued and written out
+ * with one writev() per run of buffers, a run ends before the next buffer
+ * whose pts has to be checked in (the driver binds a pts to the current
+ * write offset, so it must go in right before its data).
+ *
+ * codec_buf_get()/codec_buf_put() may be called from any thread, submit,
+ * flush and reset from the one thread feeding the codec.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <codec_error.h>
+#include <codec.h>
+#include "codec_h_ctrl.h"
+
+#define CODEC_BUF_MAX_IOV       64
+#define CODEC_BUF_ALIGN         64
+#define CODEC_BUF_DEF_BATCH     16
+#define CODEC_BUF_DEF_BYTES     (256 * 1024)
+#define CODEC_BUF_FLAG_CHECKED  (1 << 16)   /* pts went in, pool private */
+
+struct codec_buf_pool {
+    codec_para_t *pcodec;
+    pthread_mutex_t lock;
+    codec_buf_t *bufs;
+    unsigned char *mem;
+    int count;
+    codec_buf_t *free_list;
+
+    codec_buf_t *head;          ///< submitted, not fully written
+    codec_buf_t *tail;
+    int queued;
+    int queued_bytes;
+    int head_off;               ///< bytes of head already written
+    int head_started;           ///< pts of head handled
+
+    int batch;
+    int batch_bytes;
+    unsigned long pts_gap;
+    unsigned long last_pts;
+    int last_pts_valid;
+
+    codec_buf_stat_t stat;
+};
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pool_create  Allocate a pool of es buffers for a codec
+*
+* @param[in]  pcodec  Pointer of codec parameter structure, already inited
+* @param[in]  count   Number of buffers
+* @param[in]  size    Capacity of each buffer
+*
+* @return     The pool, or NULL if out of memory
+*/
+/* --------------------------------------------------------------------------*/
+codec_buf_pool_t *codec_buf_pool_create(codec_para_t *pcodec, int count, int size)
+{
+    codec_buf_pool_t *pool;
+    int i, stride;
+
+    if (!pcodec || count <= 0 || size <= 0) {
+        return NULL;
+    }
+    pool = calloc(1, sizeof(codec_buf_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    stride = (size + CODEC_BUF_ALIGN - 1) & ~(CODEC_BUF_ALIGN - 1);
+    pool->bufs = calloc(count, sizeof(codec_buf_t));
+    pool->mem = malloc((size_t)stride * count);
+    if (!pool->bufs || !pool->mem) {
+        CODEC_PRINT("[%s]no memory for %d x %d bytes\n", __FUNCTION__, count, size);
+        free(pool->bufs);
+        free(pool->mem);
+        free(pool);
+        return NULL;
+    }
+    for (i = 0; i < count; i++) {
+        pool->bufs[i].data = pool->mem + (size_t)stride * i;
+        pool->bufs[i].size = size;
+        pool->bufs[i].next = i + 1 < count ? &pool->bufs[i + 1] : NULL;
+    }
+    pool->free_list = &pool->bufs[0];
+    pool->count = count;
+    pool->pcodec = pcodec;
+    pool->batch = CODEC_BUF_DEF_BATCH;
+    pool->batch_bytes = CODEC_BUF_DEF_BYTES;
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pool_destroy  Free a pool, queued data is dropped
+*
+* @param[in]  pool  Buffer pool
+*/
+/* --------------------------------------------------------------------------*/
+void codec_buf_pool_destroy(codec_buf_pool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->bufs);
+    free(pool->mem);
+    free(pool);
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pool_set_batch  Set when codec_buf_submit() flushes
+*
+* @param[in]  pool     Buffer pool
+* @param[in]  buffers  Flush once this many buffers are queued, 1 writes each at once
+* @param[in]  bytes    Flush once this many bytes are queued
+*/
+/* --------------------------------------------------------------------------*/
+void codec_buf_pool_set_batch(codec_buf_pool_t *pool, int buffers, int bytes)
+{
+    pool->batch = buffers > 0 ? buffers : 1;
+    pool->batch_bytes = bytes > 0 ? bytes : CODEC_BUF_DEF_BYTES;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pool_set_pts_gap  Check in at most one pts per gap
+*
+* Audio packets are small and each carries a pts, checking all of them in
+* splits every writev. The decoder interpolates between checked in pts, so
+* dropping those closer than gap to the last one lets whole runs of audio
+* packets go out in one call.
+*
+* @param[in]  pool  Buffer pool
+* @param[in]  gap   Minimum distance of checked in pts, 90KHz, 0 checks in all
+*/
+/* --------------------------------------------------------------------------*/
+void codec_buf_pool_set_pts_gap(codec_buf_pool_t *pool, unsigned long gap)
+{
+    pool->pts_gap = gap;
+}
+
+static void codec_buf_release_locked(codec_buf_pool_t *pool, codec_buf_t *buf)
+{
+    buf->len = 0;
+    buf->flags = 0;
+    buf->next = pool->free_list;
+    pool->free_list = buf;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pool_reset  Drop everything queued, e.g. after codec_reset()
+*
+* @param[in]  pool  Buffer pool
+*/
+/* --------------------------------------------------------------------------*/
+void codec_buf_pool_reset(codec_buf_pool_t *pool)
+{
+    codec_buf_t *buf, *next;
+
+    pthread_mutex_lock(&pool->lock);
+    for (buf = pool->head; buf; buf = next) {
+        next = buf->next;
+        codec_buf_release_locked(pool, buf);
+    }
+    pool->head = pool->tail = NULL;
+    pool->queued = 0;
+    pool->queued_bytes = 0;
+    pool->head_off = 0;
+    pool->head_started = 0;
+    pool->last_pts_valid = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void codec_buf_pool_get_stat(codec_buf_pool_t *pool, codec_buf_stat_t *stat)
+{
+    pthread_mutex_lock(&pool->lock);
+    *stat = pool->stat;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_get  Take a free buffer from the pool
+*
+* @param[in]  pool  Buffer pool
+*
+* @return     An empty buffer, or NULL when all are queued or held,
+*             codec_buf_flush() frees the written ones
+*/
+/* --------------------------------------------------------------------------*/
+codec_buf_t *codec_buf_get(codec_buf_pool_t *pool)
+{
+    codec_buf_t *buf;
+
+    pthread_mutex_lock(&pool->lock);
+    buf = pool->free_list;
+    if (buf) {
+        pool->free_list = buf->next;
+        buf->next = NULL;
+        buf->len = 0;
+        buf->flags = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return buf;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_put  Give back a buffer without submitting it
+*
+* @param[in]  pool  Buffer pool
+* @param[in]  buf   Buffer from codec_buf_get()
+*/
+/* --------------------------------------------------------------------------*/
+void codec_buf_put(codec_buf_pool_t *pool, codec_buf_t *buf)
+{
+    pthread_mutex_lock(&pool->lock);
+    codec_buf_release_locked(pool, buf);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* a run of buffers written in one call ends before a buffer whose pts goes in */
+static int codec_buf_needs_checkin(codec_buf_pool_t *pool, codec_buf_t *buf)
+{
+    if (!(buf->flags & CODEC_BUF_FLAG_PTS)) {
+        return 0;
+    }
+    if (pool->pts_gap && pool->last_pts_valid &&
+        (unsigned long)(buf->pts - pool->last_pts) < pool->pts_gap) {
+        return 0;
+    }
+    return 1;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_flush  Write the queued buffers to the codec device
+*
+* Stops at the first short write (non-blocking codec with a full buffer),
+* the rest stays queued for the next call.
+*
+* @param[in]  pool  Buffer pool
+*
+* @return     Bytes written, or < 0 with errno set if nothing could be written
+*/
+/* --------------------------------------------------------------------------*/
+int codec_buf_flush(codec_buf_pool_t *pool)
+{
+    struct iovec iov[CODEC_BUF_MAX_IOV];
+    codec_buf_t *buf;
+    int total = 0, want, ret, n, left;
+
+    while (pool->head) {
+        buf = pool->head;
+        if (!pool->head_started) {
+            pool->head_started = 1;
+            if (codec_buf_needs_checkin(pool, buf)) {
+                if (codec_checkin_pts(pool->pcodec, buf->pts) != 0) {
+                    CODEC_PRINT("[%s]checkin pts 0x%lx failed\n", __FUNCTION__, buf->pts);
+                }
+                buf->flags |= CODEC_BUF_FLAG_CHECKED;
+                pool->stat.ioctls++;
+                pool->last_pts = buf->pts;
+                pool->last_pts_valid = 1;
+            }
+        }
+        iov[0].iov_base = buf->data + pool->head_off;
+        iov[0].iov_len = buf->len - pool->head_off;
+        want = buf->len - pool->head_off;
+        n = 1;
+        for (buf = buf->next; buf && n < CODEC_BUF_MAX_IOV && !codec_buf_needs_checkin(pool, buf); buf = buf->next) {
+            iov[n].iov_base = buf->data;
+            iov[n].iov_len = buf->len;
+            want += buf->len;
+            n++;
+        }
+        ret = 0;
+        if (want > 0) {
+            ret = codec_h_writev(pool->pcodec->handle, iov, n);
+            pool->stat.writes++;
+        }
+        if (ret < 0) {
+            return total > 0 ? total : ret;
+        }
+        total += ret;
+        pool->stat.bytes += ret;
+
+        pthread_mutex_lock(&pool->lock);
+        left = ret;
+        while (pool->head && left >= pool->head->len - pool->head_off) {
+            buf = pool->head;
+            left -= buf->len - pool->head_off;
+            pool->head = buf->next;
+            pool->queued--;
+            pool->queued_bytes -= buf->len;
+            pool->head_off = 0;
+            pool->stat.buffers++;
+            if ((buf->flags & (CODEC_BUF_FLAG_PTS | CODEC_BUF_FLAG_CHECKED)) == CODEC_BUF_FLAG_PTS) {
+                pool->stat.pts_dropped++;
+            }
+            codec_buf_release_locked(pool, buf);
+        }
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        pool->head_off += left;
+        pthread_mutex_unlock(&pool->lock);
+        /* a short write leaves the rest of this run queued, its pts are settled */
+        pool->head_started = ret < want;
+        if (ret < want) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_submit  Queue a filled buffer for the codec
+*
+* The queue is flushed once it holds the batch size in buffers or bytes;
+* call codec_buf_flush() to push out the rest, e.g. when input pauses.
+*
+* @param[in]  pool  Buffer pool
+* @param[in]  buf   Buffer from codec_buf_get() with len, pts and flags set
+*
+* @return     0 for success, < 0 if the flush failed for another reason than a full buffer
+*/
+/* --------------------------------------------------------------------------*/
+int codec_buf_submit(codec_buf_pool_t *pool, codec_buf_t *buf)
+{
+    int ret;
+
+    pthread_mutex_lock(&pool->lock);
+    buf->next = NULL;
+    if (pool->tail) {
+        pool->tail->next = buf;
+    } else {
+        pool->head = buf;
+    }
+    pool->tail = buf;
+    pool->queued++;
+    pool->queued_bytes += buf->len;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->queued >= pool->batch || pool->queued_bytes >= pool->batch_bytes) {
+        ret = codec_buf_flush(pool);
+        if (ret < 0 && errno != EAGAIN) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_buf_pending  Bytes submitted but not written yet
+*
+* @param[in]  pool  Buffer pool
+*
+* @return     Bytes still queued
+*/
+/* --------------------------------------------------------------------------*/
+int codec_buf_pending(codec_buf_pool_t *pool)
+{
+    int n;
+
+    pthread_mutex_lock(&pool->lock);
+    n = pool->queued_bytes - pool->head_off;
+    pthread_mutex_unlock(&pool->lock);
+    return n;
+}
@@ -10,6 +10,8 @@
 * 
 */
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -17,6 +19,7 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <codec_error.h>
 #include <codec.h>
@@ -26,6 +29,17 @@
 #include <sys/times.h>
 #define msleep(n)	usleep(n*1000)
 //--------------------------------
+
+static int codec_h_emu_device(const char *port_addr)
+{
+    if (!codec_h_emu_enabled()) {
+        return 0;
+    }
+    return !strncmp(port_addr, "/dev/amstream_", 14) ||
+           !strcmp(port_addr, CODEC_CNTL_DEVICE) ||
+           !strcmp(port_addr, CODEC_AUDIO_UTILS_DEVICE);
+}
+
 /* --------------------------------------------------------------------------*/
 /**
 * @brief  codec_h_open  Open codec devices by file name 
@@ -40,6 +54,9 @@ CODEC_HANDLE codec_h_open(const char *port_addr, int flags)
 {
     int r;
 	int retry_open_times=0;
+    if (codec_h_emu_device(port_addr)) {
+        return codec_h_emu_open(port_addr, flags);
+    }
 retry_open:
     r = open(port_addr, flags);
     if (r<0 /*&& r==EBUSY*/) {
@@ -72,6 +89,9 @@ retry_open:
 CODEC_HANDLE codec_h_open_rd(const char *port_addr)
 {
     int r;
+    if (codec_h_emu_device(port_addr)) {
+        return codec_h_emu_open(port_addr, O_RDONLY);
+    }
     r = open(port_addr, O_RDONLY);
     if (r < 0) {
         CODEC_PRINT("Init [%s] failed,ret = %d errno=%d\n", port_addr, r, errno);
@@ -92,6 +112,9 @@ CODEC_HANDLE codec_h_open_rd(const char *port_addr)
 int codec_h_close(CODEC_HANDLE h)
 {
 	int r;
+    if (codec_h_emu_is_handle(h)) {
+        return codec_h_emu_close(h);
+    }
     if (h >= 0) {
         r = close(h);
 		if (r < 0) {
@@ -119,6 +142,9 @@ int codec_h_control(CODEC_HANDLE h, int cmd, unsigned long paramter)
     if (h < 0) {
         return -1;
     }
+    if (codec_h_emu_is_handle(h)) {
+        return codec_h_emu_control(h, cmd, paramter);
+    }
     r = ioctl(h, cmd, paramter);
     if (r < 0) {
         CODEC_PRINT("send control failed,handle=%d,cmd=%x,paramter=%x, t=%x errno=%d\n", h, cmd, paramter, r, errno);
@@ -141,6 +167,9 @@ int codec_h_control(CODEC_HANDLE h, int cmd, unsigned long paramter)
 int codec_h_read(CODEC_HANDLE handle, void *buffer, int size)
 {
     int r;
+    if (codec_h_emu_is_handle(handle)) {
+        return codec_h_emu_read(handle, buffer, size);
+    }
     r = read(handle, buffer, size);
 	if (r < 0) {
         CODEC_PRINT("read failed,handle=%d,ret=%d errno=%d\n", handle, r, errno);  
@@ -162,6 +191,9 @@ int codec_h_read(CODEC_HANDLE handle, void *buffer, int size)
 int codec_h_write(CODEC_HANDLE handle, void *buffer, int size)
 {
     int r;
+    if (codec_h_emu_is_handle(handle)) {
+        return codec_h_emu_write(handle, buffer, size);
+    }
     r = write(handle, buffer, size);
 	if (r < 0 && errno != EAGAIN) {
         CODEC_PRINT("write failed,handle=%d,ret=%d errno=%d\n", handle, r, errno);  
@@ -169,5 +201,29 @@ int codec_h_write(CODEC_HANDLE handle, void *buffer, int size)
     return r;
 }
 
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_h_writev  Write several buffers to codec devices in one call
+*
+* @param[in]   handle  Codec device handler
+* @param[in]   iov     Buffers to be written, in order
+* @param[in]   iovcnt  Number of buffers
+*
+* @return      write length or fail if < 0, a short write stops at any byte
+*/
+/* --------------------------------------------------------------------------*/
+int codec_h_writev(CODEC_HANDLE handle, const struct iovec *iov, int iovcnt)
+{
+    int r;
+    if (codec_h_emu_is_handle(handle)) {
+        return codec_h_emu_writev(handle, iov, iovcnt);
+    }
+    r = writev(handle, iov, iovcnt);
+    if (r < 0 && errno != EAGAIN) {
+        CODEC_PRINT("writev failed,handle=%d,ret=%d errno=%d\n", handle, r, errno);
+    }
+    return r;
+}
+
 
 
@@ -12,6 +12,8 @@
 
 #ifndef CODEC_HEADER_H_H
 #define CODEC_HEADER_H_H
+#include <stdint.h>
+#include <sys/uio.h>
 #include <codec_type.h>
 #include <codec_error.h>
 
@@ -46,9 +48,32 @@
 CODEC_HANDLE codec_h_open(const char *port_addr, int flags);
 int codec_h_close(CODEC_HANDLE h);
 int codec_h_write(CODEC_HANDLE , void *, int);
+int codec_h_writev(CODEC_HANDLE, const struct iovec *, int);
 int codec_h_read(CODEC_HANDLE, void *, int);
 int codec_h_control(CODEC_HANDLE h, int cmd, unsigned long paramter);
 
+/* userspace stand-in for the amstream devices, see codec_h_emu.c */
+typedef struct {
+    int vbuf_size;
+    int abuf_size;
+    int video_bps;
+    int audio_bps;
+    int width;
+    int height;
+    int fps;
+} codec_emu_para_t;
+
+int codec_h_emu_config(const codec_emu_para_t *para);
+int codec_h_emu_enabled(void);
+int codec_h_emu_is_handle(CODEC_HANDLE h);
+int codec_h_emu_stat(int64_t *writes, int64_t *bytes, int64_t *ioctls);
+CODEC_HANDLE codec_h_emu_open(const char *port_addr, int flags);
+int codec_h_emu_close(CODEC_HANDLE h);
+int codec_h_emu_write(CODEC_HANDLE h, void *buffer, int size);
+int codec_h_emu_writev(CODEC_HANDLE h, const struct iovec *iov, int iovcnt);
+int codec_h_emu_read(CODEC_HANDLE h, void *buffer, int size);
+int codec_h_emu_control(CODEC_HANDLE h, int cmd, unsigned long paramter);
+
 
 
 #endif
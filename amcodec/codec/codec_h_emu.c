@@ -0,0 +1,699 @@
+/**
+* @file codec_h_emu.c
+* @brief  Userspace emulation of the amstream devices behind codec_h_*
+* @version 1.0.0
+* @date 2013-06-24
+*/
+/* Copyright (C) 2007-2011, Amlogic Inc.
+* All right reserved
+*
+*/
+/*
+ * When AMCODEC_EMU=1 is set in the environment (or codec_h_emu_config()
+ * is called), codec_h_open() hands out emulated handles for the
+ * /dev/amstream_* and /dev/amvideo nodes, so the player pipeline runs on a
+ * box without the decoder hardware.
+ *
+ * Each stream buffer fills with codec_h_write() and drains at the
+ * configured bitrate (AMCODEC_EMU_VBPS / AMCODEC_EMU_ABPS, bits per second).
+ * A PTS checked in with AMSTREAM_IOC_TSTAMP is checked out once the drain
+ * passes the byte offset it was checked in at. The system clock starts
+ * from the first checked out PTS, as tsync does in audio master mode.
+ *
+ * The /sys nodes of the decoder drivers go through codec_emu_sysfs_get()
+ * and codec_emu_sysfs_set(): tsync pts, video buffer use and frame count
+ * answer from the same model, other nodes just keep what was written.
+ * Values are decimal, the pts nodes are hex with a 0x prefix.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <codec_error.h>
+#include <codec.h>
+#include "codec_h_ctrl.h"
+
+#define EMU_HANDLE_BASE     0x40000000
+#define EMU_MAX_DEVICES     16
+#define EMU_PTS_SLOTS       256
+#define EMU_PTS_FREQ_MS     90
+
+#define EMU_DEFAULT_VBUF    (6 * 1024 * 1024)
+#define EMU_DEFAULT_ABUF    (768 * 1024)
+#define EMU_DEFAULT_VBPS    (8 * 1000 * 1000)
+#define EMU_DEFAULT_ABPS    (256 * 1000)
+
+#define EMU_SYSFS_NODES     64
+
+enum {
+    EMU_DEV_VIDEO = 0,
+    EMU_DEV_AUDIO,
+    EMU_DEV_MUX,
+    EMU_DEV_SUB,
+    EMU_DEV_CNTL,
+};
+
+typedef struct {
+    int64_t offset;
+    unsigned long pts;
+} emu_pts_t;
+
+typedef struct {
+    int used;
+    int type;
+    int flags;
+    int buf_size;
+    int bps;
+    int64_t total_in;
+    int64_t total_out;
+    int64_t last_us;
+    emu_pts_t pts[EMU_PTS_SLOTS];
+    int pts_rd;
+    int pts_wr;
+    unsigned long last_checkin;
+    unsigned long last_checkout;
+    int format;
+    int samplerate;
+    int channels;
+} emu_dev_t;
+
+typedef struct {
+    char path[96];
+    char val[64];
+} emu_sysfs_t;
+
+typedef struct {
+    int inited;
+    int enabled;
+    codec_emu_para_t para;
+    emu_dev_t dev[EMU_MAX_DEVICES];
+    unsigned long vpts;
+    unsigned long apts;
+    unsigned long pcr_base;
+    int64_t pcr_start_us;
+    int pcr_running;
+    int paused;
+    int64_t writes;
+    int64_t write_bytes;
+    int64_t ioctls;
+    int vframes;
+    emu_sysfs_t sysfs[EMU_SYSFS_NODES];
+} emu_state_t;
+
+static emu_state_t emu;
+static pthread_mutex_t emu_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t emu_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int emu_getenv_int(const char *name, int def)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+static void emu_init_locked(void)
+{
+    if (emu.inited) {
+        return;
+    }
+    emu.inited = 1;
+    emu.enabled = emu_getenv_int("AMCODEC_EMU", 0);
+    emu.para.vbuf_size = emu_getenv_int("AMCODEC_EMU_VBUF", EMU_DEFAULT_VBUF);
+    emu.para.abuf_size = emu_getenv_int("AMCODEC_EMU_ABUF", EMU_DEFAULT_ABUF);
+    emu.para.video_bps = emu_getenv_int("AMCODEC_EMU_VBPS", EMU_DEFAULT_VBPS);
+    emu.para.audio_bps = emu_getenv_int("AMCODEC_EMU_ABPS", EMU_DEFAULT_ABPS);
+    emu.para.width = 1920;
+    emu.para.height = 1080;
+    emu.para.fps = 30;
+}
+
+static emu_dev_t *emu_get_dev(CODEC_HANDLE h)
+{
+    int idx = h - EMU_HANDLE_BASE;
+    if (idx < 0 || idx >= EMU_MAX_DEVICES || !emu.dev[idx].used) {
+        return NULL;
+    }
+    return &emu.dev[idx];
+}
+
+static unsigned long emu_pcrscr_locked(int64_t now)
+{
+    if (!emu.pcr_running) {
+        return emu.pcr_base;
+    }
+    return emu.pcr_base + (unsigned long)((now - emu.pcr_start_us) * EMU_PTS_FREQ_MS / 1000);
+}
+
+static void emu_pcr_start_locked(unsigned long pts, int64_t now)
+{
+    if (!emu.pcr_running) {
+        emu.pcr_base = pts;
+        emu.pcr_start_us = now;
+        emu.pcr_running = !emu.paused;
+    }
+}
+
+/* drain the buffer at its bitrate up to now and check out passed pts */
+static void emu_update_locked(emu_dev_t *dev, int64_t now)
+{
+    int64_t level, drain;
+
+    if (dev->type == EMU_DEV_CNTL || dev->type == EMU_DEV_SUB) {
+        dev->last_us = now;
+        return;
+    }
+    level = dev->total_in - dev->total_out;
+    if (!emu.paused && level > 0 && dev->last_us) {
+        drain = (now - dev->last_us) * dev->bps / 8 / 1000000;
+        if (drain > level) {
+            drain = level;
+        }
+        dev->total_out += drain;
+    }
+    if (!emu.paused || !dev->last_us) {
+        dev->last_us = now;
+    }
+
+    while (dev->pts_rd != dev->pts_wr && dev->pts[dev->pts_rd].offset <= dev->total_out) {
+        unsigned long pts = dev->pts[dev->pts_rd].pts;
+        dev->last_checkout = pts;
+        if (dev->type == EMU_DEV_AUDIO) {
+            emu.apts = pts;
+        } else {
+            emu.vpts = pts;
+            emu.vframes++;
+        }
+        emu_pcr_start_locked(pts, now);
+        dev->pts_rd = (dev->pts_rd + 1) % EMU_PTS_SLOTS;
+    }
+
+    /* muxed streams are not parsed, their pts follow the system clock */
+    if (dev->type == EMU_DEV_MUX && dev->total_out > 0) {
+        emu_pcr_start_locked(emu.pcr_base, now);
+        emu.vpts = emu.apts = emu_pcrscr_locked(now);
+    }
+}
+
+static void emu_update_all_locked(int64_t now)
+{
+    int i;
+    for (i = 0; i < EMU_MAX_DEVICES; i++) {
+        if (emu.dev[i].used) {
+            emu_update_locked(&emu.dev[i], now);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_h_emu_config  Enable emulation and set its parameters
+*
+* @param[in]  para  Emulation parameters, NULL to disable emulation
+*
+* @return     0 for success
+*/
+/* --------------------------------------------------------------------------*/
+int codec_h_emu_config(const codec_emu_para_t *para)
+{
+    pthread_mutex_lock(&emu_lock);
+    emu_init_locked();
+    emu.enabled = para != NULL;
+    if (para) {
+        emu.para = *para;
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_h_emu_enabled  Check if codec devices are emulated
+*
+* @return     1 when emulated, 0 for real devices
+*/
+/* --------------------------------------------------------------------------*/
+int codec_h_emu_enabled(void)
+{
+    int enabled;
+    pthread_mutex_lock(&emu_lock);
+    emu_init_locked();
+    enabled = emu.enabled;
+    pthread_mutex_unlock(&emu_lock);
+    return enabled;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_h_emu_is_handle  Check if a handle belongs to the emulation
+*
+* @param[in]  h  Codec device handler
+*
+* @return     1 for an emulated handle
+*/
+/* --------------------------------------------------------------------------*/
+int codec_h_emu_is_handle(CODEC_HANDLE h)
+{
+    return h >= EMU_HANDLE_BASE && h < EMU_HANDLE_BASE + EMU_MAX_DEVICES;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_h_emu_stat  Get the emulation call counters
+*
+* @param[out]  writes      Number of codec_h_write/codec_h_writev calls
+* @param[out]  bytes       Number of bytes accepted by them
+* @param[out]  ioctls      Number of codec_h_control calls
+*
+* @return     0 for success
+*/
+/* --------------------------------------------------------------------------*/
+int codec_h_emu_stat(int64_t *writes, int64_t *bytes, int64_t *ioctls)
+{
+    pthread_mutex_lock(&emu_lock);
+    if (writes) {
+        *writes = emu.writes;
+    }
+    if (bytes) {
+        *bytes = emu.write_bytes;
+    }
+    if (ioctls) {
+        *ioctls = emu.ioctls;
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return 0;
+}
+
+CODEC_HANDLE codec_h_emu_open(const char *port_addr, int flags)
+{
+    emu_dev_t *dev = NULL;
+    int i;
+
+    pthread_mutex_lock(&emu_lock);
+    emu_init_locked();
+    for (i = 0; i < EMU_MAX_DEVICES; i++) {
+        if (!emu.dev[i].used) {
+            dev = &emu.dev[i];
+            break;
+        }
+    }
+    if (!dev) {
+        pthread_mutex_unlock(&emu_lock);
+        CODEC_PRINT("[%s]no free emulated device for %s\n", __FUNCTION__, port_addr);
+        return -EBUSY;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->used = 1;
+    dev->flags = flags;
+    if (!strcmp(port_addr, CODEC_VIDEO_ES_DEVICE) || !strcmp(port_addr, CODEC_VIDEO_HEVC_DEVICE)) {
+        dev->type = EMU_DEV_VIDEO;
+        emu.vframes = 0;
+        dev->buf_size = emu.para.vbuf_size;
+        dev->bps = emu.para.video_bps;
+    } else if (!strcmp(port_addr, CODEC_AUDIO_ES_DEVICE)) {
+        dev->type = EMU_DEV_AUDIO;
+        dev->buf_size = emu.para.abuf_size;
+        dev->bps = emu.para.audio_bps;
+    } else if (!strcmp(port_addr, CODEC_TS_DEVICE) || !strcmp(port_addr, CODEC_PS_DEVICE) ||
+               !strcmp(port_addr, CODEC_RM_DEVICE)) {
+        dev->type = EMU_DEV_MUX;
+        dev->buf_size = emu.para.vbuf_size + emu.para.abuf_size;
+        dev->bps = emu.para.video_bps + emu.para.audio_bps;
+    } else if (!strcmp(port_addr, CODEC_SUB_DEVICE) || !strcmp(port_addr, CODEC_SUB_READ_DEVICE)) {
+        dev->type = EMU_DEV_SUB;
+    } else {
+        dev->type = EMU_DEV_CNTL;
+    }
+    pthread_mutex_unlock(&emu_lock);
+    CODEC_PRINT("[%s]%s emulated as handle %d\n", __FUNCTION__, port_addr, EMU_HANDLE_BASE + i);
+    return (CODEC_HANDLE)(EMU_HANDLE_BASE + i);
+}
+
+int codec_h_emu_close(CODEC_HANDLE h)
+{
+    emu_dev_t *dev;
+    int i, streams = 0;
+
+    pthread_mutex_lock(&emu_lock);
+    dev = emu_get_dev(h);
+    if (dev) {
+        dev->used = 0;
+    }
+    for (i = 0; i < EMU_MAX_DEVICES; i++) {
+        if (emu.dev[i].used && emu.dev[i].type != EMU_DEV_CNTL) {
+            streams++;
+        }
+    }
+    if (!streams) {
+        emu.vpts = emu.apts = 0;
+        emu.pcr_base = 0;
+        emu.pcr_running = 0;
+        emu.paused = 0;
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return 0;
+}
+
+/* the emulation only models the buffer level, the data itself is dropped */
+static int emu_accept(CODEC_HANDLE h, int size)
+{
+    emu_dev_t *dev;
+    int64_t free_len;
+
+    pthread_mutex_lock(&emu_lock);
+    for (;;) {
+        dev = emu_get_dev(h);
+        if (!dev) {
+            pthread_mutex_unlock(&emu_lock);
+            errno = EBADF;
+            return -1;
+        }
+        emu_update_locked(dev, emu_now_us());
+        free_len = dev->buf_size - (dev->total_in - dev->total_out);
+        if (dev->type == EMU_DEV_SUB || dev->type == EMU_DEV_CNTL) {
+            free_len = size;
+        }
+        if (free_len > 0 || (dev->flags & O_NONBLOCK)) {
+            break;
+        }
+        pthread_mutex_unlock(&emu_lock);
+        usleep(2000);
+        pthread_mutex_lock(&emu_lock);
+    }
+    if (free_len <= 0) {
+        pthread_mutex_unlock(&emu_lock);
+        errno = EAGAIN;
+        return -1;
+    }
+    if (size > free_len) {
+        size = (int)free_len;
+    }
+    if (dev->type != EMU_DEV_SUB && dev->type != EMU_DEV_CNTL) {
+        dev->total_in += size;
+    }
+    emu.writes++;
+    emu.write_bytes += size;
+    pthread_mutex_unlock(&emu_lock);
+    return size;
+}
+
+int codec_h_emu_write(CODEC_HANDLE h, void *buffer, int size)
+{
+    return emu_accept(h, size);
+}
+
+int codec_h_emu_writev(CODEC_HANDLE h, const struct iovec *iov, int iovcnt)
+{
+    int i, size = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    return emu_accept(h, size);
+}
+
+int codec_h_emu_read(CODEC_HANDLE h, void *buffer, int size)
+{
+    return 0;
+}
+
+static void emu_fill_buf_status(emu_dev_t *dev, struct buf_status *st)
+{
+    int64_t level = dev->total_in - dev->total_out;
+    st->size = dev->buf_size;
+    st->data_len = (int)level;
+    st->free_len = dev->buf_size - (int)level;
+    st->read_pointer = dev->buf_size ? (unsigned int)(dev->total_out % dev->buf_size) : 0;
+    st->write_pointer = dev->buf_size ? (unsigned int)(dev->total_in % dev->buf_size) : 0;
+}
+
+static emu_dev_t *emu_find_type_locked(int type)
+{
+    int i;
+    for (i = 0; i < EMU_MAX_DEVICES; i++) {
+        if (emu.dev[i].used && emu.dev[i].type == type) {
+            return &emu.dev[i];
+        }
+    }
+    return NULL;
+}
+
+int codec_h_emu_control(CODEC_HANDLE h, int cmd, unsigned long paramter)
+{
+    struct am_io_param *am_io = (struct am_io_param *)paramter;
+    emu_dev_t *dev, *peer;
+    int64_t now = emu_now_us();
+    int ret = 0;
+
+    pthread_mutex_lock(&emu_lock);
+    dev = emu_get_dev(h);
+    if (!dev) {
+        pthread_mutex_unlock(&emu_lock);
+        errno = EBADF;
+        return -1;
+    }
+    emu.ioctls++;
+    emu_update_all_locked(now);
+
+    switch (cmd) {
+    case AMSTREAM_IOC_VB_SIZE:
+    case AMSTREAM_IOC_AB_SIZE:
+        if ((int)paramter > 0 && dev->type != EMU_DEV_CNTL) {
+            dev->buf_size = (int)paramter;
+        }
+        break;
+    case AMSTREAM_IOC_VFORMAT:
+    case AMSTREAM_IOC_AFORMAT:
+        dev->format = (int)paramter;
+        break;
+    case AMSTREAM_IOC_SAMPLERATE:
+        dev->samplerate = (int)paramter;
+        break;
+    case AMSTREAM_IOC_ACHANNEL:
+        dev->channels = (int)paramter;
+        break;
+    case AMSTREAM_IOC_TSTAMP:
+        if ((dev->pts_wr + 1) % EMU_PTS_SLOTS == dev->pts_rd) {
+            /* table full, drop the oldest entry like the pts manager does */
+            dev->pts_rd = (dev->pts_rd + 1) % EMU_PTS_SLOTS;
+        }
+        dev->pts[dev->pts_wr].offset = dev->total_in;
+        dev->pts[dev->pts_wr].pts = paramter;
+        dev->pts_wr = (dev->pts_wr + 1) % EMU_PTS_SLOTS;
+        dev->last_checkin = paramter;
+        break;
+    case AMSTREAM_IOC_VB_STATUS:
+        peer = dev->type == EMU_DEV_AUDIO ? emu_find_type_locked(EMU_DEV_VIDEO) : dev;
+        if (peer && peer->type != EMU_DEV_CNTL) {
+            emu_fill_buf_status(peer, &am_io->status);
+        } else {
+            memset(&am_io->status, 0, sizeof(am_io->status));
+        }
+        break;
+    case AMSTREAM_IOC_AB_STATUS:
+        peer = dev->type == EMU_DEV_VIDEO ? emu_find_type_locked(EMU_DEV_AUDIO) : dev;
+        if (peer && peer->type != EMU_DEV_CNTL) {
+            emu_fill_buf_status(peer, &am_io->status);
+        } else {
+            memset(&am_io->status, 0, sizeof(am_io->status));
+        }
+        break;
+    case AMSTREAM_IOC_VDECSTAT:
+        am_io->vstatus.width = emu.para.width;
+        am_io->vstatus.height = emu.para.height;
+        am_io->vstatus.fps = emu.para.fps;
+        am_io->vstatus.error_count = 0;
+        am_io->vstatus.status = STAT_TIMER_INIT | STAT_MC_LOAD | STAT_ISR_REG | STAT_VF_HOOK | STAT_TIMER_ARM | STAT_VDEC_RUN;
+        break;
+    case AMSTREAM_IOC_ADECSTAT:
+        am_io->astatus.channels = dev->channels ? dev->channels : 2;
+        am_io->astatus.sample_rate = dev->samplerate ? dev->samplerate : 48000;
+        am_io->astatus.resolution = 16;
+        am_io->astatus.error_count = 0;
+        am_io->astatus.status = 1;
+        break;
+    case AMSTREAM_IOC_APTS:
+        *(unsigned int *)paramter = emu.apts;
+        break;
+    case AMSTREAM_IOC_VPTS:
+        *(unsigned int *)paramter = emu.vpts;
+        break;
+    case AMSTREAM_IOC_PCRSCR:
+        *(unsigned int *)paramter = emu_pcrscr_locked(now);
+        break;
+    case AMSTREAM_IOC_SET_PCRSCR:
+    case AMSTREAM_IOC_SET_APTS:
+        emu.pcr_base = paramter;
+        emu.pcr_start_us = now;
+        emu.pcr_running = !emu.paused;
+        break;
+    case AMSTREAM_IOC_VPAUSE:
+        if ((int)paramter && !emu.paused) {
+            emu.pcr_base = emu_pcrscr_locked(now);
+            emu.pcr_running = 0;
+            emu.paused = 1;
+        } else if (!(int)paramter && emu.paused) {
+            emu.paused = 0;
+            emu.pcr_start_us = now;
+            emu.pcr_running = 1;
+        }
+        break;
+    case AMSTREAM_IOC_GET_LAST_CHECKIN_APTS:
+    case AMSTREAM_IOC_GET_LAST_CHECKOUT_APTS:
+    case AMSTREAM_IOC_GET_LAST_CHECKIN_VPTS:
+    case AMSTREAM_IOC_GET_LAST_CHECKOUT_VPTS:
+        peer = emu_find_type_locked((cmd == AMSTREAM_IOC_GET_LAST_CHECKIN_APTS ||
+                                     cmd == AMSTREAM_IOC_GET_LAST_CHECKOUT_APTS) ? EMU_DEV_AUDIO : EMU_DEV_VIDEO);
+        if (!peer) {
+            peer = dev;
+        }
+        *(unsigned long *)paramter = (cmd == AMSTREAM_IOC_GET_LAST_CHECKIN_APTS ||
+                                      cmd == AMSTREAM_IOC_GET_LAST_CHECKIN_VPTS) ?
+                                     peer->last_checkin : peer->last_checkout;
+        break;
+    case AMSTREAM_IOC_GET_AUDIO_CUR_DELAY_MS:
+    case AMSTREAM_IOC_GET_VIDEO_CUR_DELAY_MS:
+        peer = emu_find_type_locked(cmd == AMSTREAM_IOC_GET_AUDIO_CUR_DELAY_MS ? EMU_DEV_AUDIO : EMU_DEV_VIDEO);
+        if (!peer) {
+            peer = dev;
+        }
+        *(int *)paramter = peer->bps ? (int)((peer->total_in - peer->total_out) * 8 * 1000 / peer->bps) : 0;
+        break;
+    case AMSTREAM_IOC_GET_AUDIO_AVG_BITRATE_BPS:
+        *(int *)paramter = emu.para.audio_bps;
+        break;
+    case AMSTREAM_IOC_GET_VIDEO_AVG_BITRATE_BPS:
+        *(int *)paramter = emu.para.video_bps;
+        break;
+    case AMSTREAM_IOC_SUB_LENGTH:
+    case AMSTREAM_IOC_SUB_NUM:
+    case AMSTREAM_IOC_TRICK_STAT:
+    case AMSTREAM_IOC_GET_SYNC_ADISCON:
+    case AMSTREAM_IOC_GET_SYNC_VDISCON:
+    case AMSTREAM_IOC_GET_SYNC_ADISCON_DIFF:
+    case AMSTREAM_IOC_GET_SYNC_VDISCON_DIFF:
+    case AMSTREAM_IOC_GET_FREERUN_MODE:
+    case AMSTREAM_IOC_GET_VIDEO_DELAY_LIMIT_MS:
+    case AMSTREAM_IOC_GET_AUDIO_DELAY_LIMIT_MS:
+        *(int *)paramter = 0;
+        break;
+    default:
+        /* everything else only configures the hardware, accept it */
+        break;
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return ret;
+}
+
+static emu_sysfs_t *emu_sysfs_find_locked(const char *path, int create)
+{
+    emu_sysfs_t *free_node = NULL;
+    int i;
+
+    for (i = 0; i < EMU_SYSFS_NODES; i++) {
+        if (!emu.sysfs[i].path[0]) {
+            if (!free_node) {
+                free_node = &emu.sysfs[i];
+            }
+        } else if (!strcmp(emu.sysfs[i].path, path)) {
+            return &emu.sysfs[i];
+        }
+    }
+    if (!create || !free_node || strlen(path) >= sizeof(free_node->path)) {
+        return NULL;
+    }
+    strcpy(free_node->path, path);
+    return free_node;
+}
+
+static int emu_sysfs_path(const char *path)
+{
+    return path && !strncmp(path, "/sys/", 5) && codec_h_emu_enabled();
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_emu_sysfs_get  Read a driver sysfs node of the emulation
+*
+* @param[in]   path    sysfs node
+* @param[out]  valstr  Node value
+* @param[in]   size    Size of valstr
+*
+* @return     0 for success, -1 when the devices are not emulated
+*/
+/* --------------------------------------------------------------------------*/
+int codec_emu_sysfs_get(const char *path, char *valstr, int size)
+{
+    emu_sysfs_t *node;
+    emu_dev_t *dev;
+    int64_t now = emu_now_us();
+
+    if (!emu_sysfs_path(path) || size <= 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&emu_lock);
+    emu_update_all_locked(now);
+    if (!strcmp(path, "/sys/class/tsync/pts_pcrscr")) {
+        snprintf(valstr, size, "0x%lx", emu_pcrscr_locked(now));
+    } else if (!strcmp(path, "/sys/class/tsync/pts_video")) {
+        snprintf(valstr, size, "0x%lx", emu.vpts);
+    } else if (!strcmp(path, "/sys/class/tsync/pts_audio")) {
+        snprintf(valstr, size, "0x%lx", emu.apts);
+    } else if (!strcmp(path, "/sys/class/amstream/videobufused")) {
+        dev = emu_find_type_locked(EMU_DEV_VIDEO);
+        if (!dev) {
+            dev = emu_find_type_locked(EMU_DEV_MUX);
+        }
+        snprintf(valstr, size, "%d", dev && dev->total_in > dev->total_out);
+    } else if (!strcmp(path, "/sys/module/amvideo/parameters/new_frame_count")) {
+        snprintf(valstr, size, "%d", emu_find_type_locked(EMU_DEV_VIDEO) ? emu.vframes : 0);
+    } else {
+        node = emu_sysfs_find_locked(path, 0);
+        snprintf(valstr, size, "%s", node ? node->val : "");
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------*/
+/**
+* @brief  codec_emu_sysfs_set  Write a driver sysfs node of the emulation
+*
+* @param[in]  path  sysfs node
+* @param[in]  val   Value to write
+*
+* @return     0 for success, -1 when the devices are not emulated
+*/
+/* --------------------------------------------------------------------------*/
+int codec_emu_sysfs_set(const char *path, const char *val)
+{
+    emu_sysfs_t *node;
+
+    if (!emu_sysfs_path(path) || !val) {
+        return -1;
+    }
+    pthread_mutex_lock(&emu_lock);
+    if (!strcmp(path, "/sys/class/tsync/pts_pcrscr")) {
+        emu.pcr_base = strtoul(val, NULL, 0);
+        emu.pcr_start_us = emu_now_us();
+        emu.pcr_running = !emu.paused;
+    } else {
+        node = emu_sysfs_find_locked(path, 1);
+        if (node) {
+            snprintf(node->val, sizeof(node->val), "%s", val);
+        } else {
+            CODEC_PRINT("[%s]no room for %s\n", __FUNCTION__, path);
+        }
+    }
+    pthread_mutex_unlock(&emu_lock);
+    return 0;
+}
@@ -51,6 +51,18 @@ int codec_set_dec_reset(codec_para_t *pcodec);
 
 int codec_write(codec_para_t *pcodec, void *buffer, int len);
 int codec_checkin_pts(codec_para_t *pcodec, unsigned long pts);
+
+codec_buf_pool_t *codec_buf_pool_create(codec_para_t *pcodec, int count, int size);
+void codec_buf_pool_destroy(codec_buf_pool_t *pool);
+void codec_buf_pool_set_batch(codec_buf_pool_t *pool, int buffers, int bytes);
+void codec_buf_pool_set_pts_gap(codec_buf_pool_t *pool, unsigned long gap);
+void codec_buf_pool_reset(codec_buf_pool_t *pool);
+void codec_buf_pool_get_stat(codec_buf_pool_t *pool, codec_buf_stat_t *stat);
+codec_buf_t *codec_buf_get(codec_buf_pool_t *pool);
+void codec_buf_put(codec_buf_pool_t *pool, codec_buf_t *buf);
+int codec_buf_submit(codec_buf_pool_t *pool, codec_buf_t *buf);
+int codec_buf_flush(codec_buf_pool_t *pool);
+int codec_buf_pending(codec_buf_pool_t *pool);
 int codec_get_vbuf_state(codec_para_t *, struct buf_status *);
 int codec_get_abuf_state(codec_para_t *, struct buf_status *);
 int codec_get_vdec_state(codec_para_t *, struct vdec_status *);
@@ -118,4 +130,9 @@ int codec_set_vsync_upint(codec_para_t *pcodec, unsigned int mode);
 
 int codec_get_last_checkout_apts(codec_para_t* pcodec, unsigned long *apts);
 int codec_get_last_checkin_apts(codec_para_t* pcodec, unsigned long *apts);
+
+/* driver sysfs nodes while the devices are emulated (AMCODEC_EMU),
+ * -1 when they are not and the real node is to be used */
+int codec_emu_sysfs_get(const char *path, char *valstr, int size);
+int codec_emu_sysfs_set(const char *path, const char *val);
 #endif
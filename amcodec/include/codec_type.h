@@ -16,6 +16,7 @@
 #include "amports/vformat.h"
 #include "amports/aformat.h"
 #include "ppmgr/ppmgr.h"
+#include <stdint.h>
 
 typedef int CODEC_HANDLE;
 
@@ -134,4 +135,25 @@ typedef struct {
 #define AUDIO_ARM_DECODER 1
 #define AUDIO_FFMPEG_DECODER 2
 #define AUDIO_ARMWFD_DECODER  3
+
+//es buffer handed out by codec_buf_get(), filled in place by the client
+#define CODEC_BUF_FLAG_PTS  (1 << 0)    ///< pts is valid, checked in before the data
+typedef struct codec_buf {
+    unsigned char *data;
+    int size;                   ///< capacity of data
+    int len;                    ///< bytes filled by the client
+    unsigned long pts;          ///< 90KHz
+    int flags;
+    struct codec_buf *next;     ///< private to the pool
+} codec_buf_t;
+
+typedef struct codec_buf_pool codec_buf_pool_t;
+
+typedef struct {
+    int64_t writes;             ///< write/writev calls on the stream device
+    int64_t ioctls;             ///< pts checkins
+    int64_t bytes;
+    int64_t buffers;            ///< buffers written out
+    int64_t pts_dropped;        ///< pts not checked in because of the pts gap
+} codec_buf_stat_t;
 #endif
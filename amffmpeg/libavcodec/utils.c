@@ -78,6 +78,7 @@ void av_fast_malloc(void *ptr, unsigned int *size, size_t min_size)
 
 /* encoder management */
 static AVCodec *first_avcodec = NULL;
+static AVCodec **last_avcodec = &first_avcodec;
 
 AVCodec *av_codec_next(AVCodec *c){
     if(c) return c->next;
@@ -88,10 +89,11 @@ void avcodec_register(AVCodec *codec)
 {
     AVCodec **p;
     avcodec_init();
-    p = &first_avcodec;
+    p = last_avcodec;
     while (*p != NULL) p = &(*p)->next;
     *p = codec;
     codec->next = NULL;
+    last_avcodec = &codec->next;
 }
 
 unsigned avcodec_get_edge_width(void)
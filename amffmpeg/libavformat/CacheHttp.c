@@ -73,6 +73,7 @@ typedef struct {
     int ignore_http_range_req;
     int http_error_code;	
     int64_t estimate_bitrate;	
+    int stalled;    //-1 nothing read since open/seek,1 reader waiting on an empty fifo
     struct list_mgt *m3u_mgt;
 } CacheHttpContext;
 
@@ -198,6 +199,7 @@ int CacheHttp_Open(void ** handle,const char* headers,void* arg)
 	s->is_ts_file=0;
     s->ignore_http_range_req = 0;
     s->http_error_code = 0;
+    s->stalled = -1;
     memset(s->headers, 0x00, sizeof(s->headers));
     s->fifo = NULL;
     float value=0.0;
@@ -269,12 +271,17 @@ int CacheHttp_Read(void * handle, uint8_t * cache, int size)
            // Maximum amount available
            size = FFMIN( avail, size);
            av_fifo_generic_read(s->fifo, cache, size, NULL);
+           s->stalled = 0;
     	    pthread_mutex_unlock(&s->read_mutex);
            return size;        
        } else if(s->EXITED) {
            pthread_mutex_unlock(&s->read_mutex); 
            return 0;
        } else if(!s->finish_flag) {
+           if(s->stalled == 0) {
+               s->stalled = 1;
+               s->m3u_mgt->stall_num++;
+           }
            pthread_mutex_unlock(&s->read_mutex);          
            //read just need retry
            return AVERROR(EAGAIN);
@@ -302,6 +309,7 @@ int CacheHttp_Reset(void * handle, int cmf_flag)
     pthread_mutex_lock(&s->read_mutex);
     if(s->fifo)
         av_fifo_reset(s->fifo);
+    s->stalled = -1;
     pthread_mutex_unlock(&s->read_mutex);
     s->RESET = 0;
     s->finish_flag = 0;
@@ -322,6 +330,7 @@ int CacheHttp_Seek(void * handle, int64_t pos)
     pthread_mutex_lock(&s->read_mutex);
     if(s->fifo)
         av_fifo_reset(s->fifo);
+    s->stalled = -1;
     pthread_mutex_unlock(&s->read_mutex);
     s->RESET = 0;
     s->finish_flag = 0;
@@ -667,6 +676,8 @@ OPEN_RETRY:
                             s->fifo->wptr = s->fifo->buffer;
                         s->fifo->wndx += left;
                         s->item_pos += left;
+                        if(s->item_pos == left)
+                            markSegmentDataArrived((void*)s->m3u_mgt);
                    } else if(left == AVERROR(EAGAIN) || (left < 0 &&!s->ignore_http_range_req&& s->have_list_end&& left != AVERROR_EOF)) {
                         pthread_mutex_unlock(&s->read_mutex);
                         continue;
@@ -52,6 +52,7 @@ int url_interrupt_cb(void);
 
 URLProtocol *first_protocol = NULL;
 static int (*url_interrupt_cb_ext)(int) = NULL;
+static URLProtocolLoaderCB *url_protocol_loader_cb = NULL;
 
 
 URLProtocol *av_protocol_next(URLProtocol *p)
@@ -234,6 +235,7 @@ int ffurl_alloc(URLContext **puc, const char *filename, int flags)
     URLProtocol *up;
     char proto_str[128], proto_nested[128], *ptr;
     size_t proto_len = strspn(filename, URL_SCHEME_CHARS);
+    int loaded = 0;
 
     if (filename[proto_len] != ':' || is_dos_path(filename))
         strcpy(proto_str, "file");
@@ -244,6 +246,7 @@ int ffurl_alloc(URLContext **puc, const char *filename, int flags)
     if ((ptr = strchr(proto_nested, '+')))
         *ptr = '\0';
 
+retry:
     up = first_protocol;
     while (up != NULL) {
         if (!strcmp(proto_str, up->name))
@@ -253,6 +256,10 @@ int ffurl_alloc(URLContext **puc, const char *filename, int flags)
             return url_alloc_for_protocol (puc, up, filename, flags);
         up = up->next;
     }
+    if (!loaded && url_protocol_loader_cb && url_protocol_loader_cb(proto_str) > 0) {
+        loaded = 1;
+        goto retry;
+    }
     *puc = NULL;
     return AVERROR(ENOENT);
 }
@@ -488,6 +495,11 @@ void avio_set_interrupt_cb(URLInterruptCB *interrupt_cb )
     url_interrupt_cb_ext = interrupt_cb;
 }
 
+void avio_set_protocol_loader_cb(URLProtocolLoaderCB *loader_cb)
+{
+    url_protocol_loader_cb = loader_cb;
+}
+
 #if FF_API_OLD_AVIO
 int av_url_read_pause(URLContext *h, int pause)
 {
@@ -142,6 +142,8 @@ typedef struct URLContext {
 	int is_segment_media;
     int priv_flags;	
     int64_t priv_info;	
+    char *etag;             /**< ETag of the http response,NULL if none */
+    char *last_modified;    /**< Last-Modified of the http response,NULL if none */
 } URLContext;
 
 #define FLAGS_ISCMF	1<<0 
@@ -457,6 +459,15 @@ int avio_check(const char *url, int flags);
  */
 void avio_set_interrupt_cb(URLInterruptCB *interrupt_cb);
 
+/**
+ * The callback is called when no registered protocol handles the scheme
+ * of the url being opened, so that the protocols of external modules can
+ * be registered on first use. It returns >0 if the modules are loaded and
+ * the lookup is worth trying again, once. 'NULL' means no loader.
+ */
+typedef int URLProtocolLoaderCB(const char *name);
+void avio_set_protocol_loader_cb(URLProtocolLoaderCB *loader_cb);
+
 /**
  * Allocate and initialize an AVIOContext for buffered I/O. It must be later
  * freed with av_free().
@@ -32,6 +32,7 @@
 #include "aviolpcache.h"
 #include "aviolpbuf.h"
 #include "amconfigutils.h"
+#include "amtrace.h"
 /*
 										Pos		
 buffer    rp                         wp                   buffer_end 
@@ -470,6 +471,7 @@ int64_t url_lpseek(URLContext *s, int64_t offset, int whence)
 			lp->rp-=lp->buffer_size;
 		lp_unlock(&lp->mutex);
 		read_offset=offset1-valid_data_can_seek_forward;
+		amtrace_begin(AMTRACE_LPBUF_SEEK);
 		while(read_offset>0){
 			ret=url_lpread(s,NULL,read_offset);/*do read seek*/
 			if(ret>0)
@@ -479,6 +481,7 @@ int64_t url_lpseek(URLContext *s, int64_t offset, int whence)
 				break;
 			}
 		}
+		amtrace_end(AMTRACE_LPBUF_SEEK);
 		lp_lock(&lp->mutex);
 	}else
 	{/*not support in buffer seek,do low level seek now*/
@@ -490,12 +493,17 @@ int64_t url_lpseek(URLContext *s, int64_t offset, int whence)
 		if(lp->cache_enable && offset<lp->file_size){
 			/*if cache enable not need to seek here,seek  on cache missed*/
 			;/*do't do seek here*/
-		}else if ((offset1=s->prot->url_seek(s, offset, SEEK_SET)) < 0)
-		{
-			lp->valid_data_size=0;/*seek failed clear all old datas*/
-			offset1 = s->prot->url_seek(s, lp->pos, SEEK_SET);/*clear the lowlevel errors*/
-			lp_unlock(&lp->mutex);
-			return  offset1;
+		}else {
+			amtrace_begin(AMTRACE_LPBUF_SEEK);
+			offset1=s->prot->url_seek(s, offset, SEEK_SET);
+			amtrace_end(AMTRACE_LPBUF_SEEK);
+			if (offset1 < 0)
+			{
+				lp->valid_data_size=0;/*seek failed clear all old datas*/
+				offset1 = s->prot->url_seek(s, lp->pos, SEEK_SET);/*clear the lowlevel errors*/
+				lp_unlock(&lp->mutex);
+				return  offset1;
+			}
 		}
 		lp->rp=lp->buffer;
 		lp->wp=lp->buffer;
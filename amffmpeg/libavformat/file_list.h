@@ -149,6 +149,10 @@ typedef struct list_mgt
     int parser_finish_flag;
     int measure_bw;
     int read_eof_flag;	
+    int64_t switch_start_time;    //variant switched,no data of it yet
+    int switch_timed_num;
+    int64_t switch_time_total;
+    int stall_num;
 }list_mgt_t;
 
 typedef struct list_demux
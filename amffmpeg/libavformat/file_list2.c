@@ -1133,6 +1133,7 @@ static struct list_item * switchto_next_item(struct list_mgt *mgt) {
         //av_log(NULL, AV_LOG_INFO, "current playing item index: %d,current playing seq:%d\n", mgt->playing_item_index, mgt->playing_item_seq);
         int is_switch = select_best_variant(mgt);
         if (is_switch>0) { //will remove this tricks.
+            mgt->switch_start_time = av_gettime();
             
             if (mgt->item_num > 0) {		   	
                 list_delall_item(mgt);
@@ -1505,6 +1506,9 @@ static int list_close(URLContext *h)
     }
     mgt->listclose = 1;
     CacheHttp_Close(mgt->cache_http_handle);
+    RLOG("Switch up:%d,down:%d,avg time to switch:%lld ms,stalls:%d\n",
+        mgt->switch_up_num,mgt->switch_down_num,
+        mgt->switch_timed_num>0?mgt->switch_time_total/mgt->switch_timed_num/1000:0ll,mgt->stall_num);
     list_delall_item(mgt);
     int i;
     for (i = 0; i < mgt->n_variants; i++) {
@@ -1727,6 +1731,18 @@ int switchNextSegment(void* hSession)
 	mgt->current_item = switchto_next_item(mgt);
 	return 0;
 }
+void markSegmentDataArrived(void* hSession)
+{
+	if(hSession == NULL){
+		return;
+	}
+	struct list_mgt* mgt = (struct list_mgt*)hSession;
+	if(mgt->switch_start_time > 0){
+		mgt->switch_time_total += av_gettime()-mgt->switch_start_time;
+		mgt->switch_timed_num++;
+		mgt->switch_start_time = 0;
+	}
+}
 URLProtocol *get_file_list_protocol(void)
 {
     return &file_list_protocol;
@@ -12,6 +12,8 @@ list_item_t* getCurrentSegment(void* hSession);
 int switchNextSegment(void* hSession);
 const char* getCurrentSegmentUrl(void* hSession);
 long long getTotalDuration(void* hSession);
+//first data of the current segment is in the buffer
+void markSegmentDataArrived(void* hSession);
 
 
 #ifdef __cplusplus
@@ -89,6 +89,8 @@ typedef struct {
     int keep_alive;
     int keep_alive_timeout;
     int flags;
+    char etag[128];             /**< validators of the response,for conditional requests */
+    char last_modified[64];
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -562,6 +564,12 @@ static int process_line(URLContext *h, char *line, int line_count,
             av_log(h, AV_LOG_ERROR, "s->location=%s\n",s->location);
       
             *new_location = 1;
+        } else if (!strcasecmp (tag, "ETag")) {
+            av_strlcpy(s->etag, p, sizeof(s->etag));
+            h->etag = s->etag;
+        } else if (!strcasecmp (tag, "Last-Modified")) {
+            av_strlcpy(s->last_modified, p, sizeof(s->last_modified));
+            h->last_modified = s->last_modified;
         } else if (!strcasecmp (tag, "Content-Length") && s->filesize == -1) {
             s->filesize = atoll(p);
         } else if (!strcasecmp (tag, "Content-Range")) {
@@ -717,6 +725,10 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     s->willclose = 1;
     s->do_readseek_size=0;//
     s->http_code = -1;
+    s->etag[0] = '\0';
+    s->last_modified[0] = '\0';
+    h->etag = NULL;
+    h->last_modified = NULL;
     if (post) {
         /* Pretend that it did work. We didn't read any header yet, since
          * we've still to send the POST data, but the code calling this
@@ -775,6 +787,9 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
         av_log(h, AV_LOG_INFO, "http_read maybe reach EOS,force to exit,current: %lld,file size:%lld\n",s->off,s->filesize);        
         return 0;
     }
+    if(s->http_code == 304 || s->http_code == 204){
+        return 0;/*no body,don't wait for one on a kept-alive link*/
+    }
     bandwidth_measure_start_read(s->bandwidth_measure);	
 retry:
     if (url_interrupt_cb()) {
@@ -87,6 +87,20 @@ typedef struct {
     unsigned flags;
 } MOVTrackExt;
 
+/** position of the compact index cursor, see mov_build_index */
+typedef struct {
+    unsigned int sample;        ///< current sample number
+    unsigned int chunk;         ///< chunk holding the sample
+    unsigned int chunk_sample;  ///< sample number inside the chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int stps_index;
+    int64_t pos;
+    int64_t dts;
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int ffindex;          ///< AVStream index
@@ -128,6 +142,16 @@ typedef struct MOVStreamContext {
 
     int readed_count;	  ///readed count/ /by zz.
     int64_t track_end;    ///< used for dts generation in fragmented movie files
+
+    int compact_index;    ///< samples resolved from the sample tables, index_entries holds sync samples only
+    int compact_key_off;  ///< 1 when stss/stps sample numbers start at 1
+    int64_t compact_first_dts;
+    unsigned int *stsc_first_sample; ///< first sample of each stsc entry
+    unsigned int *stts_first_sample; ///< first sample of each stts entry
+    int64_t *stts_first_dts;         ///< dts of the first sample of each stts entry
+    MOVSampleCursor cursor;
+    AVIndexEntry cursor_entry;       ///< entry of cursor.sample, valid when cursor_valid
+    int cursor_valid;
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -81,6 +81,10 @@ typedef struct MOVParseTableEntry {
 static const MOVParseTableEntry mov_default_parse_table[];
 #define MAX_READ_SEEK (1024*1024*3-32*1024)//DEF_MAX_READ_SEEK-block_read_size
 #define LIMIT_BUFSIZE (6.8*1024*1024)
+/* tracks with more samples keep the sample tables instead of a full index */
+#define MOV_COMPACT_INDEX_MIN_SAMPLES (1 << 17)
+/* sync entry spacing of compact tracks without stss */
+#define MOV_COMPACT_INDEX_STEP 64
 
 static int mov_metadata_track_or_disc_number(MOVContext *c, AVIOContext *pb, unsigned len, const char *type)
 {
@@ -1660,6 +1664,346 @@ static int mov_read_ctts(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+/*
+ * compact index: long recordings (hours of 60 fps video) would need tens of
+ * MB of AVIndexEntry. Instead the stts/stsc/stsz/stco tables are kept as
+ * read, samples are resolved by a cursor that steps sequentially and seeks
+ * by binary search over small per table entry prefix sums.
+ * st->index_entries only holds the sync samples for generic users.
+ */
+static int mov_cursor_seek(MOVStreamContext *sc, unsigned int sample)
+{
+    MOVSampleCursor *c = &sc->cursor;
+    unsigned int a, b, m, per_chunk, first_chunk, chunk_first;
+    unsigned int i;
+
+    if (sample >= sc->sample_count)
+        return -1;
+
+    /* stsc entry holding the sample */
+    a = 0;
+    b = sc->stsc_count;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (sc->stsc_first_sample[m] <= sample)
+            a = m;
+        else
+            b = m;
+    }
+    per_chunk = sc->stsc_data[a].count;
+    first_chunk = sc->stsc_data[a].first - 1;
+    c->stsc_index = a;
+    c->chunk = first_chunk + (sample - sc->stsc_first_sample[a]) / per_chunk;
+    if (c->chunk >= sc->chunk_count)
+        return -1;
+    chunk_first = sc->stsc_first_sample[a] + (c->chunk - first_chunk) * per_chunk;
+    c->chunk_sample = sample - chunk_first;
+    c->pos = sc->chunk_offsets[c->chunk];
+    if (sc->sample_size > 0) {
+        c->pos += (int64_t)sc->sample_size * c->chunk_sample;
+    } else {
+        for (i = chunk_first; i < sample; i++)
+            c->pos += sc->sample_sizes[i];
+    }
+
+    /* stts entry holding the sample */
+    a = 0;
+    b = sc->stts_count;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (sc->stts_first_sample[m] <= sample)
+            a = m;
+        else
+            b = m;
+    }
+    c->stts_index = a;
+    c->stts_sample = sample - sc->stts_first_sample[a];
+    c->dts = sc->stts_first_dts[a] + (int64_t)c->stts_sample * sc->stts_data[a].duration;
+
+    /* next sync samples at or after the sample */
+    a = 0;
+    b = sc->keyframe_count;
+    while (a < b) {
+        m = (a + b) >> 1;
+        if ((unsigned)sc->keyframes[m] < sample + sc->compact_key_off)
+            a = m + 1;
+        else
+            b = m;
+    }
+    c->stss_index = a;
+    a = 0;
+    b = sc->stps_count;
+    while (a < b) {
+        m = (a + b) >> 1;
+        if (sc->stps_data[m] < sample + sc->compact_key_off)
+            a = m + 1;
+        else
+            b = m;
+    }
+    c->stps_index = a;
+    c->sample = sample;
+    return 0;
+}
+
+static int mov_cursor_next(MOVStreamContext *sc)
+{
+    MOVSampleCursor *c = &sc->cursor;
+    unsigned int key = c->sample + 1 + sc->compact_key_off;
+
+    if (c->sample + 1 >= sc->sample_count)
+        return -1;
+    c->pos += sc->sample_size > 0 ? sc->sample_size : sc->sample_sizes[c->sample];
+    c->sample++;
+    if (++c->chunk_sample >= sc->stsc_data[c->stsc_index].count) {
+        c->chunk++;
+        c->chunk_sample = 0;
+        if (c->chunk >= sc->chunk_count)
+            return -1;
+        if (c->stsc_index + 1 < sc->stsc_count &&
+            c->chunk + 1 == sc->stsc_data[c->stsc_index + 1].first)
+            c->stsc_index++;
+        c->pos = sc->chunk_offsets[c->chunk];
+    }
+    c->dts += sc->stts_data[c->stts_index].duration;
+    if (++c->stts_sample == sc->stts_data[c->stts_index].count &&
+        c->stts_index + 1 < sc->stts_count) {
+        c->stts_index++;
+        c->stts_sample = 0;
+    }
+    while (c->stss_index < sc->keyframe_count && (unsigned)sc->keyframes[c->stss_index] < key)
+        c->stss_index++;
+    while (c->stps_index < sc->stps_count && sc->stps_data[c->stps_index] < key)
+        c->stps_index++;
+    return 0;
+}
+
+static void mov_cursor_fill(MOVStreamContext *sc)
+{
+    MOVSampleCursor *c = &sc->cursor;
+    AVIndexEntry *e = &sc->cursor_entry;
+    unsigned int key = c->sample + sc->compact_key_off;
+    int keyframe = !sc->keyframe_count ||
+                   (c->stss_index < sc->keyframe_count && (unsigned)sc->keyframes[c->stss_index] == key) ||
+                   (c->stps_index < sc->stps_count && sc->stps_data[c->stps_index] == key);
+
+    e->pos = c->pos;
+    e->timestamp = c->dts;
+    e->size = sc->sample_size > 0 ? sc->sample_size : sc->sample_sizes[c->sample];
+    e->min_distance = 0;
+    e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+}
+
+static int mov_nb_samples(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->compact_index ? (int)sc->sample_count : st->nb_index_entries;
+}
+
+/* sample n of the track, NULL past the end */
+static AVIndexEntry *mov_get_sample(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->compact_index)
+        return n >= 0 && n < st->nb_index_entries ? &st->index_entries[n] : NULL;
+    if (n < 0 || n >= sc->sample_count)
+        return NULL;
+    if (sc->cursor_valid && sc->cursor.sample == n)
+        return &sc->cursor_entry;
+    if (sc->cursor_valid && sc->cursor.sample + 1 == n) {
+        sc->cursor_valid = mov_cursor_next(sc) == 0;
+    } else {
+        sc->cursor_valid = mov_cursor_seek(sc, n) == 0;
+    }
+    if (!sc->cursor_valid)
+        return NULL;
+    mov_cursor_fill(sc);
+    return &sc->cursor_entry;
+}
+
+static int64_t mov_sample_dts(AVStream *st, int n)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int a, b, m;
+
+    if (!sc->compact_index)
+        return st->index_entries[n].timestamp;
+    a = 0;
+    b = sc->stts_count;
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+        if (sc->stts_first_sample[m] <= (unsigned)n)
+            a = m;
+        else
+            b = m;
+    }
+    return sc->stts_first_dts[a] + (int64_t)(n - sc->stts_first_sample[a]) * sc->stts_data[a].duration;
+}
+
+/* same semantics as av_index_search_timestamp over all samples */
+static int mov_compact_search_timestamp(AVStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int a, b, m, dur;
+    int64_t n;
+
+    if (timestamp < sc->stts_first_dts[0]) {
+        n = -1;
+    } else {
+        a = 0;
+        b = sc->stts_count;
+        while (b - a > 1) {
+            m = (a + b) >> 1;
+            if (sc->stts_first_dts[m] <= timestamp)
+                a = m;
+            else
+                b = m;
+        }
+        dur = sc->stts_data[a].duration;
+        n = sc->stts_first_sample[a];
+        if (dur)
+            n += (timestamp - sc->stts_first_dts[a]) / dur;
+        if (a + 1 < sc->stts_count && n >= sc->stts_first_sample[a + 1])
+            n = sc->stts_first_sample[a + 1] - 1;
+        if (n >= sc->sample_count)
+            n = sc->sample_count - 1;
+    }
+    if (!(flags & AVSEEK_FLAG_BACKWARD) && (n < 0 || mov_sample_dts(st, n) < timestamp))
+        n++;
+    if (n < 0 || n >= sc->sample_count)
+        return -1;
+
+    if (!(flags & AVSEEK_FLAG_ANY) && sc->keyframe_count) {
+        unsigned int key = n + sc->compact_key_off;
+        a = 0;
+        b = sc->keyframe_count;
+        while (a < b) {
+            m = (a + b) >> 1;
+            if ((unsigned)sc->keyframes[m] < key)
+                a = m + 1;
+            else
+                b = m;
+        }
+        /* a: first sync sample >= n */
+        if (flags & AVSEEK_FLAG_BACKWARD) {
+            if (a == sc->keyframe_count || (unsigned)sc->keyframes[a] != key) {
+                if (a == 0)
+                    return -1;
+                a--;
+            }
+        } else if (a == sc->keyframe_count) {
+            return -1;
+        }
+        n = (int64_t)sc->keyframes[a] - sc->compact_key_off;
+        if (n < 0 || n >= sc->sample_count)
+            return -1;
+    }
+    return n;
+}
+
+static int mov_use_compact_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    return sc->sample_count >= MOV_COMPACT_INDEX_MIN_SAMPLES &&
+           !mov->trex_count && sc->pseudo_stream_id == -1 && !sc->dv_audio_container &&
+           sc->chunk_count && sc->stsc_count && sc->stts_count &&
+           (sc->sample_size > 0 || sc->sample_sizes) &&
+           am_getconfig_bool_def("libplayer.mov.compactindex", 1);
+}
+
+static int mov_compact_index_init(MOVContext *mov, AVStream *st, int64_t first_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    unsigned int i, sample, sync_count, chunks;
+    uint64_t total = 0;
+    int64_t dts = first_dts;
+    uint64_t stream_size = 0;
+    int last = -1;
+
+    /* only well formed tables, anything odd takes the full index path */
+    if (sc->stsc_data[0].first != 1)
+        return -1;
+    for (i = 0; i < sc->stsc_count; i++) {
+        if (sc->stsc_data[i].count <= 0 ||
+            (i && sc->stsc_data[i].first <= sc->stsc_data[i - 1].first) ||
+            sc->stsc_data[i].first > sc->chunk_count)
+            return -1;
+    }
+    sc->stsc_first_sample = av_malloc(sc->stsc_count * sizeof(*sc->stsc_first_sample));
+    sc->stts_first_sample = av_malloc(sc->stts_count * sizeof(*sc->stts_first_sample));
+    sc->stts_first_dts = av_malloc(sc->stts_count * sizeof(*sc->stts_first_dts));
+    if (!sc->stsc_first_sample || !sc->stts_first_sample || !sc->stts_first_dts)
+        goto fail;
+    for (i = 0; i < sc->stsc_count; i++) {
+        sc->stsc_first_sample[i] = total;
+        chunks = (i + 1 < sc->stsc_count ? sc->stsc_data[i + 1].first : sc->chunk_count + 1) -
+                 sc->stsc_data[i].first;
+        total += (uint64_t)chunks * sc->stsc_data[i].count;
+        if (total > UINT_MAX)
+            goto fail;
+    }
+    if (total < sc->sample_count)
+        goto fail;
+    total = 0;
+    for (i = 0; i < sc->stts_count; i++) {
+        sc->stts_first_sample[i] = total;
+        sc->stts_first_dts[i] = dts;
+        total += sc->stts_data[i].count;
+        dts += (int64_t)sc->stts_data[i].count * sc->stts_data[i].duration;
+        if (total > UINT_MAX || sc->stts_data[i].count <= 0 ||
+            (i + 1 < sc->stts_count && sc->stts_data[i].duration < 0))
+            goto fail;
+    }
+
+    sc->compact_key_off = (sc->keyframe_count && sc->keyframes[0] > 0) ||
+                          (sc->stps_count && sc->stps_data[0] > 0);
+    sc->compact_first_dts = first_dts;
+    sc->compact_index = 1;
+    sc->cursor_valid = 0;
+
+    /* sync sample entries for generic index users */
+    sync_count = sc->keyframe_count ? sc->keyframe_count :
+                 (sc->sample_count + MOV_COMPACT_INDEX_STEP - 1) / MOV_COMPACT_INDEX_STEP;
+    st->index_entries = av_malloc(sync_count * sizeof(*st->index_entries));
+    if (!st->index_entries)
+        goto fail;
+    st->index_entries_allocated_size = sync_count * sizeof(*st->index_entries);
+    st->nb_index_entries = 0;
+    for (i = 0; i < sync_count; i++) {
+        sample = sc->keyframe_count ? sc->keyframes[i] - sc->compact_key_off : i * MOV_COMPACT_INDEX_STEP;
+        if ((int)sample <= last || sample >= sc->sample_count || mov_cursor_seek(sc, sample) < 0)
+            continue;
+        mov_cursor_fill(sc);
+        st->index_entries[st->nb_index_entries] = sc->cursor_entry;
+        st->index_entries[st->nb_index_entries].flags = AVINDEX_KEYFRAME;
+        st->nb_index_entries++;
+        last = sample;
+    }
+
+    if (sc->sample_size > 0) {
+        stream_size = (uint64_t)sc->sample_size * sc->sample_count;
+    } else {
+        for (i = 0; i < sc->sample_count; i++)
+            stream_size += sc->sample_sizes[i];
+    }
+    if (st->duration > 0)
+        st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+    av_log(mov->fc, AV_LOG_INFO, "stream %d, compact index of %u samples, %d sync entries\n",
+           st->index, sc->sample_count, st->nb_index_entries);
+    return 0;
+
+fail:
+    sc->compact_index = 0;
+    av_freep(&st->index_entries);
+    st->index_entries_allocated_size = 0;
+    st->nb_index_entries = 0;
+    av_freep(&sc->stsc_first_sample);
+    av_freep(&sc->stts_first_sample);
+    av_freep(&sc->stts_first_dts);
+    return -1;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -1697,6 +2041,9 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
 
         current_dts -= sc->dts_shift;
 
+        if (mov_use_compact_index(mov, st) && mov_compact_index_init(mov, st, current_dts) == 0)
+            return;
+
         if (sc->sample_count >= UINT_MAX / sizeof(*st->index_entries))
             return;
         st->index_entries = av_malloc(sc->sample_count*sizeof(*st->index_entries));
@@ -1979,13 +2326,15 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         break;
     }
 
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
+    /* Do not need those anymore, unless samples are resolved from them. */
+    if (!sc->compact_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+    }
 
     return 0;
 }
@@ -2209,6 +2558,11 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id)
         return 0;
+    if (sc->compact_index) {
+        /* samples of the moov tables are not in index_entries to append to */
+        av_log(c->fc, AV_LOG_WARNING, "stream %d, fragment ignored on compact index\n", st->index);
+        return 0;
+    }
     avio_r8(pb); /* version */
     flags = avio_rb24(pb);
     entries = avio_rb32(pb);
@@ -2655,9 +3009,12 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
             best_sc=(*st)->priv_data;
             beststream_readed_cnt=best_sc->readed_count;
         }
-        if (msc->pb && msc->current_sample < avst->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
-            int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
+        if (msc->pb && msc->current_sample < mov_nb_samples(avst)) {
+            AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
+            int64_t dts;
+            if (!current_sample)
+                continue;
+            dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos)){/*not seekable streaming,*/
                wantnew=1;
@@ -2773,8 +3130,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         if (sc->wrong_dts)
             pkt->dts = AV_NOPTS_VALUE;
     } else {
-        int64_t next_dts = (sc->current_sample < st->nb_index_entries) ?
-            st->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_nb_samples(st)) ?
+            mov_sample_dts(st, sc->current_sample) : st->duration;
         pkt->duration = next_dts - pkt->dts;
         pkt->pts = pkt->dts;
     }
@@ -2883,17 +3240,20 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     int sample, time_sample;
     int i;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->compact_index)
+        sample = mov_compact_search_timestamp(st, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
 
     // mov's stss is wrong sometimes, need to read seek
     // added by senbai.tao
-    if(st->codec->codec_type == AVMEDIA_TYPE_VIDEO && sample <=0 && st->nb_index_entries && sc->keyframe_count <= 1) {
+    if(!sc->compact_index && st->codec->codec_type == AVMEDIA_TYPE_VIDEO && sample <=0 && st->nb_index_entries && sc->keyframe_count <= 1) {
         int64_t sync_point = mov_read_seek2(s, st->index, timestamp, flags);
         sample = mov_index_search_pos(st->index_entries, st->nb_index_entries, sync_point, AVSEEK_FLAG_ANY);
     }
 
     av_dlog(s, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->nb_index_entries && timestamp < st->index_entries[0].timestamp)
+    if (sample < 0 && mov_nb_samples(st) && timestamp < mov_sample_dts(st, 0))
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return -1;
@@ -2933,7 +3293,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return -1;
 
     /* adjust seek timestamp to found sample timestamp */
-    seek_timestamp = st->index_entries[sample].timestamp;
+    seek_timestamp = mov_sample_dts(st, sample);
 
     for (i = 0; i < s->nb_streams; i++) {
         st = s->streams[i];
@@ -2956,6 +3316,15 @@ static int mov_read_close(AVFormatContext *s)
         MOVStreamContext *sc = st->priv_data;
 
         av_freep(&sc->ctts_data);
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->stsc_data);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+        av_freep(&sc->stps_data);
+        av_freep(&sc->stsc_first_sample);
+        av_freep(&sc->stts_first_sample);
+        av_freep(&sc->stts_first_dts);
         for (j = 0; j < sc->drefs_count; j++) {
             av_freep(&sc->drefs[j].path);
             av_freep(&sc->drefs[j].dir);
@@ -389,10 +389,22 @@ RTPDemuxContext *rtp_parse_open(AVFormatContext *s1, AVStream *st, URLContext *r
     s->ic = s1;
     s->st = st;
     s->queue_size = queue_size;
+    if (queue_size > 1) {
+        /* room for the gaps between the queued packets too */
+        s->queue_slots = 32;
+        while (s->queue_slots < 4 * queue_size && s->queue_slots < 32768)
+            s->queue_slots <<= 1;
+        s->queue = av_mallocz(s->queue_slots * sizeof(RTPPacket));
+        if (!s->queue) {
+            av_free(s);
+            return NULL;
+        }
+    }
     rtp_init_statistics(&s->statistics, 0); // do we know the initial sequence from sdp?
     if (!strcmp(ff_rtp_enc_name(payload_type), "MP2T")) {
         s->ts = ff_mpegts_parse_open(s->ic);
         if (s->ts == NULL) {
+            av_free(s->queue);
             av_free(s);
             return NULL;
         }
@@ -582,75 +594,84 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
-    while (s->queue) {
-        RTPPacket *next = s->queue->next;
-        av_free(s->queue->buf);
-        av_free(s->queue);
-        s->queue = next;
+    int i;
+
+    for (i = 0; s->queue_len > 0 && i < s->queue_slots; i++) {
+        if (s->queue[i].buf) {
+            av_freep(&s->queue[i].buf);
+            s->queue_len--;
+        }
     }
     s->seq       = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
 }
 
-static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
+static RTPPacket *queue_slot(RTPDemuxContext *s, uint16_t seq)
+{
+    return &s->queue[seq & (s->queue_slots - 1)];
+}
+
+/**
+ * Queue a packet ahead of s->seq + 1. Takes ownership of buf.
+ * @return 0 if queued, <0 if the packet is too far ahead of the ring
+ */
+static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 {
     uint16_t seq = AV_RB16(buf + 2);
-    RTPPacket *cur = s->queue, *prev = NULL, *packet;
+    RTPPacket *packet;
 
-    /* Find the correct place in the queue to insert the packet */
-    while (cur) {
-        int16_t diff = seq - cur->seq;
-        if (diff < 0)
-            break;
-        prev = cur;
-        cur = cur->next;
+    if ((uint16_t)(seq - s->seq) >= s->queue_slots)
+        return -1;
+    packet = queue_slot(s, seq);
+    if (packet->buf) {
+        /* the slots only hold packets after s->seq, this is a duplicate */
+        av_free(buf);
+        return 0;
     }
-
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
-        return;
     packet->recvtime = av_gettime();
     packet->seq = seq;
     packet->len = len;
     packet->buf = buf;
-    packet->next = cur;
-    if (prev)
-        prev->next = packet;
-    else
-        s->queue = packet;
+    if (!s->queue_len || (int16_t)(seq - s->queue_head) < 0)
+        s->queue_head = seq;
     s->queue_len++;
+    return 0;
 }
 
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    return s->queue_len > 0 && s->queue_head == (uint16_t) (s->seq + 1);
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    return s->queue_len > 0 ? queue_slot(s, s->queue_head)->recvtime : 0;
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
 {
     int rv;
-    RTPPacket *next;
+    RTPPacket *packet;
 
     if (s->queue_len <= 0)
         return -1;
 
     if (!has_next_packet(s))
         av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+               "RTP: missed %d packets\n", (uint16_t)(s->queue_head - s->seq - 1));
 
     /* Parse the first packet in the queue, and dequeue it */
-    rv = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
-    next = s->queue->next;
-    av_free(s->queue->buf);
-    av_free(s->queue);
-    s->queue = next;
+    packet = queue_slot(s, s->queue_head);
+    rv = rtp_parse_packet_internal(s, pkt, packet->buf, packet->len);
+    av_freep(&packet->buf);
     s->queue_len--;
+    /* the next queued packet is the next used slot */
+    if (s->queue_len > 0) {
+        do {
+            s->queue_head++;
+        } while (!queue_slot(s, s->queue_head)->buf);
+    }
     return rv;
 }
 
@@ -702,7 +723,7 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         return rtcp_parse_packet(s, buf, len);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    if ((s->seq == 0 && !s->queue_len) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
@@ -719,7 +740,15 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
             return rv;
         } else {
             /* Still missing some packet, enqueue this one. */
-            enqueue_packet(s, buf, len);
+            if (enqueue_packet(s, buf, len) < 0) {
+                /* Too far ahead for the ring, the sender jumped: drop
+                 * what is queued and restart from this packet */
+                av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
+                       "RTP: sequence jump %d -> %d, dropping %d queued packets\n",
+                       s->seq, seq, s->queue_len);
+                ff_rtp_reset_packet_queue(s);
+                return rtp_parse_packet_internal(s, pkt, buf, len);
+            }
             *bufptr = NULL;
             /* Return the first enqueued packet if the queue is full,
              * even if we're missing something */
@@ -752,6 +781,7 @@ int rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 void rtp_parse_close(RTPDemuxContext *s)
 {
     ff_rtp_reset_packet_queue(s);
+    av_free(s->queue);
     if (!strcmp(ff_rtp_enc_name(s->payload_type), "MP2T")) {
         ff_mpegts_parse_close(s->ts);
     }
@@ -26,6 +26,7 @@
 #include "avformat.h"
 #include "rtp.h"
 #include "url.h"
+#include "rtpfec.h"
 #include <itemlist.h>
 
 typedef struct PayloadContext PayloadContext;
@@ -142,7 +143,6 @@ typedef struct RTPPacket {
     int valid_data_offset;
     
     int64_t recvtime;
-    struct RTPPacket *next;
 } RTPPacket;
 
 typedef struct RTPContext {
@@ -154,6 +154,11 @@ typedef struct RTPContext {
     pthread_t recv_thread;
     struct itemlist recvlist;
     int last_seq;
+    int cache_min;          ///< packets held back before reading, room for FEC to fill the holes
+
+    URLContext *fec_hd[2];  ///< column and row FEC streams, SMPTE 2022-1
+    int fec_fd[2];
+    RTPFECContext *fec;
 } RTPContext;
 
 // moved out of rtp.c, because the h264 decoder needs to know about this structure..
@@ -179,7 +184,9 @@ struct RTPDemuxContext {
 
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
-    RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket* queue; ///< Ring of buffered packets not yet returned, indexed by seq & (queue_slots - 1)
+    int queue_slots;  ///< The number of entries of the ring, a power of two >= queue_size
+    uint16_t queue_head; ///< The sequence number of the oldest packet in queue
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
     /*@}*/
@@ -0,0 +1,312 @@
+/*
+ * SMPTE 2022-1 (Pro-MPEG COP3) FEC for RTP
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * SMPTE 2022-1 FEC receiver
+ *
+ * The sender arranges the media packets in a matrix of L columns and D
+ * rows and sends, on their own ports, one XOR packet per column (every
+ * L-th packet, D of them) and optionally one per row (L consecutive
+ * packets). Each FEC packet carries the XOR of the protected packets'
+ * payloads and of their length, payload type, timestamp and P/X/CC/M
+ * bits (RFC 2733), so one missing packet of a column or row is rebuilt
+ * by XORing the FEC packet with the packets received. With both streams
+ * a rebuilt packet can complete the other dimension, which is why the
+ * FEC packets that still miss two packets are kept and tried again.
+ *
+ * FEC header, after the RTP header of the FEC packet:
+ *  0: SNBase low bits (16) | Length recovery (16)
+ *  4: E (1) | PT recovery (7) | Mask (24)
+ *  8: TS recovery (32)
+ * 12: X (1) | D (1) | type (3) | index (3) | Offset (8) | NA (8) | SNBase ext bits (8)
+ */
+
+#include "libavutil/intreadwrite.h"
+#include "avformat.h"
+#include "rtp.h"
+#include "rtpdec.h"
+#include "rtpfec.h"
+
+#define FEC_WINDOW_MASK (RTP_FEC_WINDOW - 1)
+/** enough for the L + D FEC packets of two 2022-1 matrices */
+#define FEC_PENDING     80
+
+typedef struct FECMedia {
+    uint8_t *buf;
+    int len;
+    uint16_t seq;
+    int valid;
+} FECMedia;
+
+typedef struct FECPending {
+    uint8_t *buf;
+    int len;
+    int used;
+    uint16_t base;      ///< first protected sequence number
+    int offset;         ///< distance between protected packets: L for columns, 1 for rows
+    int na;             ///< number of protected packets
+} FECPending;
+
+struct RTPFECContext {
+    FECMedia media[RTP_FEC_WINDOW];
+    FECPending pending[FEC_PENDING];
+    uint16_t newest;    ///< newest media sequence number seen
+    int have_newest;
+    uint32_t ssrc;
+    RTPFECRecovered recovered;
+    void *opaque;
+    RTPFECStats stats;
+    uint8_t out[RTP_MAX_PACKET_LENGTH];
+};
+
+RTPFECContext *ff_rtp_fec_open(RTPFECRecovered recovered, void *opaque)
+{
+    RTPFECContext *f = av_mallocz(sizeof(RTPFECContext));
+
+    if (!f)
+        return NULL;
+    f->recovered = recovered;
+    f->opaque = opaque;
+    return f;
+}
+
+void ff_rtp_fec_close(RTPFECContext *f)
+{
+    int i;
+
+    if (!f)
+        return;
+    av_log(NULL, AV_LOG_INFO, "[%s]media %u, fec %u, recovered %u, expired %u\n", __FUNCTION__,
+           f->stats.media, f->stats.fec, f->stats.recovered, f->stats.expired);
+    for (i = 0; i < RTP_FEC_WINDOW; i++)
+        av_free(f->media[i].buf);
+    for (i = 0; i < FEC_PENDING; i++)
+        av_free(f->pending[i].buf);
+    av_free(f);
+}
+
+void ff_rtp_fec_reset(RTPFECContext *f)
+{
+    int i;
+
+    for (i = 0; i < RTP_FEC_WINDOW; i++)
+        f->media[i].valid = 0;
+    for (i = 0; i < FEC_PENDING; i++)
+        f->pending[i].used = 0;
+    f->have_newest = 0;
+}
+
+void ff_rtp_fec_get_stats(RTPFECContext *f, RTPFECStats *stats)
+{
+    *stats = f->stats;
+}
+
+static FECMedia *fec_media(RTPFECContext *f, uint16_t seq)
+{
+    FECMedia *m = &f->media[seq & FEC_WINDOW_MASK];
+
+    return m->valid && m->seq == seq ? m : NULL;
+}
+
+static void fec_store_media(RTPFECContext *f, const uint8_t *buf, int len)
+{
+    uint16_t seq = AV_RB16(buf + 2);
+    FECMedia *m = &f->media[seq & FEC_WINDOW_MASK];
+
+    if (!m->buf) {
+        m->buf = av_malloc(RTP_MAX_PACKET_LENGTH);
+        if (!m->buf)
+            return;
+    }
+    memcpy(m->buf, buf, len);
+    m->len = len;
+    m->seq = seq;
+    m->valid = 1;
+    if (!f->have_newest || (int16_t)(seq - f->newest) > 0) {
+        f->newest = seq;
+        f->have_newest = 1;
+    }
+    f->ssrc = AV_RB32(buf + 8);
+}
+
+void ff_rtp_fec_add_media(RTPFECContext *f, const uint8_t *buf, int len)
+{
+    if (len < RTP_MIN_PACKET_LENGTH || len > RTP_MAX_PACKET_LENGTH)
+        return;
+    f->stats.media++;
+    fec_store_media(f, buf, len);
+}
+
+static void fec_xor(uint8_t *dst, const uint8_t *src, int len)
+{
+    int i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++)
+        dst[i] ^= src[i];
+}
+
+static int fec_header_offset(const uint8_t *buf)
+{
+    return RTP_MIN_PACKET_LENGTH + (buf[0] & 0x0f) * 4;
+}
+
+/**
+ * @return 1 if a packet was rebuilt, 0 if the FEC packet is done with
+ *         (nothing missing, or out of the window), -1 to keep it
+ */
+static int fec_try(RTPFECContext *f, FECPending *p)
+{
+    const uint8_t *h = p->buf + fec_header_offset(p->buf);
+    const uint8_t *payload = h + RTP_FEC_HEADER_SIZE;
+    int payload_len = p->len - (payload - p->buf);
+    uint16_t last = p->base + (p->na - 1) * p->offset, seq, missing = 0;
+    int len_rec, pt, b0, mk, nmissing = 0, i;
+    uint32_t ts;
+    FECMedia *m;
+
+    /* media slots older than the window may have been reused */
+    if (f->have_newest && (int16_t)(f->newest - p->base) >= RTP_FEC_WINDOW) {
+        f->stats.expired++;
+        return 0;
+    }
+    for (i = 0, seq = p->base; i < p->na; i++, seq += p->offset) {
+        if (!fec_media(f, seq)) {
+            missing = seq;
+            if (++nmissing > 1)
+                break;
+        }
+    }
+    if (!nmissing)
+        return 0;
+    /* wait for the rest of the matrix, unless it can't come any more */
+    if (nmissing > 1) {
+        if (f->have_newest && (int16_t)(f->newest - last) >= RTP_FEC_WINDOW / 2) {
+            f->stats.expired++;
+            return 0;
+        }
+        return -1;
+    }
+
+    len_rec = AV_RB16(h + 2);
+    pt = h[4] & 0x7f;
+    ts = AV_RB32(h + 8);
+    b0 = p->buf[0] & 0x3f;
+    mk = p->buf[1] & 0x80;
+    memset(f->out, 0, sizeof(f->out));
+    memcpy(f->out + RTP_MIN_PACKET_LENGTH, payload, payload_len);
+    for (i = 0, seq = p->base; i < p->na; i++, seq += p->offset) {
+        if (seq == missing)
+            continue;
+        m = fec_media(f, seq);
+        len_rec ^= m->len - RTP_MIN_PACKET_LENGTH;
+        pt ^= m->buf[1] & 0x7f;
+        ts ^= AV_RB32(m->buf + 4);
+        b0 ^= m->buf[0] & 0x3f;
+        mk ^= m->buf[1] & 0x80;
+        fec_xor(f->out + RTP_MIN_PACKET_LENGTH, m->buf + RTP_MIN_PACKET_LENGTH,
+                FFMIN(m->len - RTP_MIN_PACKET_LENGTH, payload_len));
+    }
+    if (len_rec > payload_len) {
+        /* FEC payload shorter than a protected packet, not a 2022-1 sender */
+        f->stats.expired++;
+        return 0;
+    }
+    f->out[0] = (RTP_VERSION << 6) | b0;
+    f->out[1] = mk | pt;
+    AV_WB16(f->out + 2, missing);
+    AV_WB32(f->out + 4, ts);
+    AV_WB32(f->out + 8, f->ssrc);
+    fec_store_media(f, f->out, RTP_MIN_PACKET_LENGTH + len_rec);
+    f->stats.recovered++;
+    if (f->recovered)
+        f->recovered(f->opaque, f->out, RTP_MIN_PACKET_LENGTH + len_rec);
+    return 1;
+}
+
+int ff_rtp_fec_add_fec(RTPFECContext *f, const uint8_t *buf, int len)
+{
+    const uint8_t *h;
+    FECPending *p = NULL;
+    int i, n = 0, progress, offset, na;
+
+    if (len < RTP_MIN_PACKET_LENGTH || len > RTP_MAX_PACKET_LENGTH ||
+        (buf[0] & 0xc0) != (RTP_VERSION << 6) ||
+        len < fec_header_offset(buf) + RTP_FEC_HEADER_SIZE)
+        return -1;
+    h = buf + fec_header_offset(buf);
+    offset = h[13];
+    na = h[14];
+    /* only the XOR type, without the 2022-5 extension */
+    if ((h[12] & 0x80) || ((h[12] >> 3) & 0x7) || !offset || !na)
+        return -1;
+    f->stats.fec++;
+    if (offset * na > f->stats.depth)
+        f->stats.depth = offset * na;
+
+    /* a free slot, or the one protecting the oldest packets */
+    for (i = 0; i < FEC_PENDING; i++) {
+        FECPending *q = &f->pending[i];
+        if (!q->used) {
+            p = q;
+            break;
+        }
+        if (!p || (int16_t)(q->base - p->base) < 0)
+            p = q;
+    }
+    if (p->used)
+        f->stats.expired++;
+    if (!p->buf) {
+        p->buf = av_malloc(RTP_MAX_PACKET_LENGTH);
+        if (!p->buf)
+            return -1;
+    }
+    memcpy(p->buf, buf, len);
+    p->len = len;
+    p->base = AV_RB16(h);
+    p->offset = offset;
+    p->na = na;
+    p->used = 1;
+
+    /* a rebuilt packet can complete FEC packets of the other dimension */
+    do {
+        progress = 0;
+        for (i = 0; i < FEC_PENDING; i++) {
+            int ret;
+            if (!f->pending[i].used)
+                continue;
+            ret = fec_try(f, &f->pending[i]);
+            if (ret >= 0)
+                f->pending[i].used = 0;
+            if (ret > 0) {
+                n++;
+                progress = 1;
+            }
+        }
+    } while (progress);
+    return n;
+}
@@ -0,0 +1,81 @@
+/*
+ * SMPTE 2022-1 (Pro-MPEG COP3) FEC for RTP
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_RTPFEC_H
+#define AVFORMAT_RTPFEC_H
+
+#include <stdint.h>
+
+/** FEC streams are sent to the media port + 2 (columns) and + 4 (rows) */
+#define RTP_FEC_COLUMN_PORT_OFFSET 2
+#define RTP_FEC_ROW_PORT_OFFSET    4
+
+#define RTP_FEC_HEADER_SIZE 16
+
+/**
+ * Media packets kept for recovery, a power of two. 2022-1 limits the
+ * matrix to L * D <= 100, the window also covers the FEC packets of a
+ * matrix arriving up to a matrix late.
+ */
+#define RTP_FEC_WINDOW 256
+
+typedef struct RTPFECContext RTPFECContext;
+
+/**
+ * Called with every recovered media packet (a complete RTP packet).
+ * The buffer is only valid during the call.
+ */
+typedef void (*RTPFECRecovered)(void *opaque, const uint8_t *buf, int len);
+
+typedef struct RTPFECStats {
+    unsigned int media;         ///< media packets seen
+    unsigned int fec;           ///< FEC packets seen
+    unsigned int recovered;     ///< media packets rebuilt
+    unsigned int expired;       ///< FEC packets dropped with two or more packets missing
+    unsigned int depth;         ///< packets protected by the largest row or column seen, L * D for columns
+} RTPFECStats;
+
+RTPFECContext *ff_rtp_fec_open(RTPFECRecovered recovered, void *opaque);
+void ff_rtp_fec_close(RTPFECContext *f);
+
+/**
+ * Keep a received media packet for recovery.
+ * @param buf complete RTP packet, header included
+ */
+void ff_rtp_fec_add_media(RTPFECContext *f, const uint8_t *buf, int len);
+
+/**
+ * Handle a column or row FEC packet, rebuilding what it and the FEC
+ * packets still pending can recover.
+ * @param buf complete RTP packet of the FEC stream
+ * @return the number of media packets recovered, <0 if the packet is not
+ *         a 2022-1 FEC packet
+ */
+int ff_rtp_fec_add_fec(RTPFECContext *f, const uint8_t *buf, int len);
+
+/**
+ * Forget the media packets and the pending FEC packets, after a seek or
+ * a discontinuity of the stream.
+ */
+void ff_rtp_fec_reset(RTPFECContext *f);
+
+void ff_rtp_fec_get_stats(RTPFECContext *f, RTPFECStats *stats);
+
+#endif /* AVFORMAT_RTPFEC_H */
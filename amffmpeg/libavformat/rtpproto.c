@@ -29,6 +29,7 @@
 #include "avformat.h"
 #include "avio_internal.h"
 #include "rtpdec.h"
+#include "rtpfec.h"
 #include "url.h"
 
 #include <unistd.h>
@@ -248,19 +249,46 @@ static int inner_rtp_read(RTPContext *s, uint8_t *buf, int size)
     return len;
 }
 
-static int inner_rtp_read1(RTPContext *s, uint8_t *buf, int size)
+/**
+ * Read from the RTP socket and, when FEC is on, the FEC sockets.
+ * @param fec_stream set to the FEC stream the packet came from, -1 for media
+ */
+static int inner_rtp_read1(RTPContext *s, uint8_t *buf, int size, int *fec_stream)
 {
     struct sockaddr_storage from;
     socklen_t from_len;
-    int len, n;
-    struct pollfd p[1] = {{s->rtp_fd, POLLIN, 0}};
-
+    int len, n, i, np = 1;
+    struct pollfd p[3] = {{s->rtp_fd, POLLIN, 0}};
+
+    for (i = 0; i < 2; i++) {
+        if (s->fec_hd[i]) {
+            p[np].fd = s->fec_fd[i];
+            p[np].events = POLLIN;
+            p[np].revents = 0;
+            np++;
+        }
+    }
+    *fec_stream = -1;
     for(;;) {
         if (url_interrupt_cb())
             return AVERROR_EXIT;
         /* build fdset to listen to only RTP packets */
-        n = poll(p, 1, 100);
+        n = poll(p, np, 100);
         if (n > 0) {
+            /* FEC first, it may complete packets already queued */
+            for (i = 1; i < np; i++) {
+                if (p[i].revents & POLLIN) {
+                    len = recv(p[i].fd, buf, size, 0);
+                    if (len < 0) {
+                        if (ff_neterrno() == AVERROR(EAGAIN) ||
+                            ff_neterrno() == AVERROR(EINTR))
+                            continue;
+                        return AVERROR(EIO);
+                    }
+                    *fec_stream = p[i].fd == s->fec_fd[0] ? 0 : 1;
+                    return len;
+                }
+            }
             /* then RTP */
             if (p[0].revents & POLLIN) {
                 from_len = sizeof(from);
@@ -383,6 +411,72 @@ static void dump(char *lpkt_buf,int len){
 }
 */
 
+/**
+ * Locate the MPEG-TS payload of an RTP packet.
+ * @return 0 and valid_data_offset/len set, <0 if the packet is too short
+ */
+static int rtp_set_payload(RTPPacket *lpkt)
+{
+    uint8_t *lpkt_buf = lpkt->buf;
+    int len = lpkt->len;
+    int offset, ext;
+
+    if (lpkt_buf[0] & 0x20){					// remove the padding data
+        int padding = lpkt_buf[len - 1];
+        if (len >= 12 + padding)
+            len -= padding;
+    }
+
+    if(len<=12){
+        av_log(NULL, AV_LOG_ERROR, "[%s:%d]len<=12,len=%d\n",__FUNCTION__,__LINE__,len);
+        return -1;
+    }
+
+    // output the playload data
+    offset = 12 ;
+    ext = lpkt_buf[0] & 0x10;
+    if(ext > 0){
+        if(len < offset + 4){
+            av_log(NULL, AV_LOG_ERROR, "[%s:%d]len < offset + 4\n",__FUNCTION__,__LINE__);
+            return -1;
+        }
+
+        ext = (AV_RB16(lpkt_buf + offset + 2) + 1) << 2;
+        if(len < ext + offset){
+            av_log(NULL, AV_LOG_ERROR, "[%s:%d]len < ext + offset\n",__FUNCTION__,__LINE__);
+            return -1;
+        }
+        offset+=ext ;
+    }
+    lpkt->valid_data_offset=offset;
+    lpkt->len=len;
+    return 0;
+}
+
+/* ff_rtp_fec_add_fec() callback, queue the rebuilt packet like a received one */
+static void rtp_fec_recovered(void *opaque, const uint8_t *buf, int len)
+{
+    RTPContext *s = opaque;
+    RTPPacket *lpkt;
+    uint16_t seq = AV_RB16(buf + 2);
+
+    if ((buf[1] & 0x7f) != 33 || seq_less_and_equal(seq, s->last_seq))
+        return;     /* already read past it */
+    lpkt = av_mallocz(sizeof(RTPPacket));
+    if (!lpkt)
+        return;
+    lpkt->buf = av_malloc(RTPPROTO_RECVBUF_SIZE);
+    if (!lpkt->buf) {
+        av_free(lpkt);
+        return;
+    }
+    memcpy(lpkt->buf, buf, len);
+    lpkt->len = len;
+    lpkt->seq = seq;
+    if (rtp_set_payload(lpkt) < 0 || rtp_enqueue_packet(&(s->recvlist), lpkt) < 0)
+        rtp_free_packet((void *)lpkt);
+}
+
 static void *rtp_recv_task( void *_RTPContext)
 {
     av_log(NULL, AV_LOG_INFO, "[%s:%d]rtp recv_buffer_task start running!!!\n", __FUNCTION__, __LINE__);
@@ -393,14 +487,8 @@ static void *rtp_recv_task( void *_RTPContext)
     }
 
     RTPPacket * lpkt = NULL;
-    int datalen=0 ;
     int payload_type=0; 
-
-    uint8_t * lpoffset=NULL;
-    int offset=0;
-    uint8_t * lpkt_buf=NULL;
-    int len=0;
-    int ext=0;
+    int fec_stream;
     
     while(s->brunning > 0) {
 	if (url_interrupt_cb()) {
@@ -421,7 +509,16 @@ static void *rtp_recv_task( void *_RTPContext)
        	goto rtp_thread_end;
 
        // recv data
-	lpkt->len = inner_rtp_read1(s, lpkt->buf, RTPPROTO_RECVBUF_SIZE);
+	lpkt->len = inner_rtp_read1(s, lpkt->buf, RTPPROTO_RECVBUF_SIZE, &fec_stream);
+	if(fec_stream >= 0){
+		RTPFECStats stats;
+		ff_rtp_fec_add_fec(s->fec, lpkt->buf, lpkt->len);
+		// hold back a whole matrix so the column FEC comes before the read
+		ff_rtp_fec_get_stats(s->fec, &stats);
+		if(MIN_CACHE_PACKET_SIZE + (int)stats.depth > s->cache_min)
+			s->cache_min = MIN_CACHE_PACKET_SIZE + stats.depth;
+		continue;
+	}
 	if(lpkt->len <=12){
 		av_log(NULL, AV_LOG_INFO, "[%s:%d]receive wrong packet len=%d \n", __FUNCTION__, __LINE__,lpkt->len);
 		amthreadpool_thread_usleep(10);
@@ -437,42 +534,11 @@ static void *rtp_recv_task( void *_RTPContext)
 
        if(payload_type == 33){		// mpegts packet
 		//av_log(NULL, AV_LOG_ERROR, "[%s:%d]mpegts packet req = %d\n", __FUNCTION__, __LINE__, lpkt->seq);	
-		// parse the rtp playload data  
-		lpkt_buf=lpkt->buf;
-		len=lpkt->len;
-	
-		if (lpkt_buf[0] & 0x20){					// remove the padding data
-			int padding = lpkt_buf[len - 1];
-			if (len >= 12 + padding)
-			    len -= padding;
-		}
-
-		if(len<=12){
-			av_log(NULL, AV_LOG_ERROR, "[%s:%d]len<=12,len=%d\n",__FUNCTION__,__LINE__,len);
+		if(s->fec)
+			ff_rtp_fec_add_media(s->fec, lpkt->buf, lpkt->len);
+		if(rtp_set_payload(lpkt) < 0)
 			continue;
-		}
 
-		// output the playload data
-		offset = 12 ;
-		lpoffset = lpkt_buf + 12;
-
-		ext = lpkt_buf[0] & 0x10;
-		if(ext > 0){
-			if(len < offset + 4){
-				av_log(NULL, AV_LOG_ERROR, "[%s:%d]len < offset + 4\n",__FUNCTION__,__LINE__);
-				continue;
-			}	
-
-			ext = (AV_RB16(lpoffset + 2) + 1) << 2;
-			if(len < ext + offset){
-				av_log(NULL, AV_LOG_ERROR, "[%s:%d]len < ext + offset\n",__FUNCTION__,__LINE__);
-				continue;
-			}	
-			offset+=ext ;
-			lpoffset+=ext ;
-		}
-		lpkt->valid_data_offset=offset;
-		
 		if(rtp_enqueue_packet(&(s->recvlist), lpkt)<0)
 			goto rtp_thread_end;
 	}
@@ -498,6 +564,9 @@ rtp_thread_end:
  *         'localrtcpport=n'  : set the local rtcp port to n
  *         'pkt_size=n'       : set max packet size
  *         'connect=0/1'      : do a connect() on the UDP socket
+ *         'fec=0/1'          : receive the SMPTE 2022-1 FEC streams on port + 2
+ *                              and port + 4 (cache mode only, default from
+ *                              media.libplayer.rtpfec)
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -512,7 +581,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     RTPContext *s;
     int rtp_port, rtcp_port,
         ttl, connect,
-        local_rtp_port, local_rtcp_port, max_packet_size; 
+        local_rtp_port, local_rtcp_port, max_packet_size, fec, i; 
     char hostname[256];
     char buf[1024];
     char path[1024];
@@ -532,6 +601,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     local_rtcp_port = -1;
     max_packet_size = -1;
     connect = 0;
+    fec = am_getconfig_bool_def("media.libplayer.rtpfec", 0);
 
     p = strchr(uri, '?');
     if (p) {
@@ -555,6 +625,9 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
         if (av_find_info_tag(buf, sizeof(buf), "connect", p)) {
             connect = strtol(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "fec", p)) {
+            fec = strtol(buf, NULL, 10);
         }/*
         if (av_find_info_tag(buf, sizeof(buf), "use_cache", p)) {
             s->use_cache = strtol(buf, NULL, 10);
@@ -587,6 +660,27 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
 	s->rtcp_fd = ffurl_get_file_handle(s->rtcp_hd);
     }
     
+    if(s->use_cache && fec){
+	static const int fec_port[2] = {RTP_FEC_COLUMN_PORT_OFFSET, RTP_FEC_ROW_PORT_OFFSET};
+	s->fec = ff_rtp_fec_open(rtp_fec_recovered, s);
+	if (!s->fec)
+	    goto fail;
+	for (i = 0; i < 2; i++) {
+	    build_udp_url(buf, sizeof(buf),
+	                  hostname, rtp_port + fec_port[i],
+	                  local_rtp_port >= 0 ? local_rtp_port + fec_port[i] : -1,
+	                  ttl, max_packet_size, connect, 1);
+	    av_log(NULL, AV_LOG_INFO, "[%s:%d]Setup fec session:%s\n",__FUNCTION__,__LINE__,buf);
+	    /* the row stream is optional, columns alone fix isolated losses */
+	    if (ffurl_open(&s->fec_hd[i], buf, flags) < 0) {
+	        s->fec_hd[i] = NULL;
+	        continue;
+	    }
+	    s->fec_fd[i] = ffurl_get_file_handle(s->fec_hd[i]);
+	}
+    }
+    s->cache_min = MIN_CACHE_PACKET_SIZE;
+
     if(s->use_cache){
 	s->recvlist.max_items = 0;
 	s->recvlist.item_ext_buf_size = 0;   
@@ -612,6 +706,11 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         ffurl_close(s->rtp_hd);
     if (s->rtcp_hd)
         ffurl_close(s->rtcp_hd);
+    for (i = 0; i < 2; i++) {
+        if (s->fec_hd[i])
+            ffurl_close(s->fec_hd[i]);
+    }
+    ff_rtp_fec_close(s->fec);
     av_free(s);
     return AVERROR(EIO);
 }
@@ -641,7 +740,7 @@ static int rtp_read(URLContext *h, uint8_t *buf, int size)
 			return AVERROR(EIO);
 
 
-		if(s->recvlist.item_count<=MIN_CACHE_PACKET_SIZE){
+		if(s->recvlist.item_count<=s->cache_min){
 			amthreadpool_thread_usleep(10);
 			continue;
 		}
@@ -799,6 +898,7 @@ static int rtp_write(URLContext *h, const uint8_t *buf, int size)
 static int rtp_close(URLContext *h)
 {
     RTPContext *s = h->priv_data;
+    int i;
 
     if(s->use_cache){
 	s->brunning = 0;
@@ -812,6 +912,11 @@ static int rtp_close(URLContext *h)
     	ffurl_close(s->rtp_hd);
     if (s->rtcp_hd)
     	ffurl_close(s->rtcp_hd);
+    for (i = 0; i < 2; i++) {
+        if (s->fec_hd[i])
+            ffurl_close(s->fec_hd[i]);
+    }
+    ff_rtp_fec_close(s->fec);
     av_free(s);
     return 0;
 }
@@ -130,6 +130,9 @@ static void av_frac_add(AVFrac *f, int64_t incr)
 static AVInputFormat *first_iformat = NULL;
 /** head of registered output format linked list */
 static AVOutputFormat *first_oformat = NULL;
+/** next pointers of the last registered formats,registering is O(1) */
+static AVInputFormat **last_iformat = &first_iformat;
+static AVOutputFormat **last_oformat = &first_oformat;
 
 AVInputFormat  *av_iformat_next(AVInputFormat  *f)
 {
@@ -146,19 +149,21 @@ AVOutputFormat *av_oformat_next(AVOutputFormat *f)
 void av_register_input_format(AVInputFormat *format)
 {
     AVInputFormat **p;
-    p = &first_iformat;
+    p = last_iformat;
     while (*p != NULL) p = &(*p)->next;
     *p = format;
     format->next = NULL;
+    last_iformat = &format->next;
 }
 
 void av_register_output_format(AVOutputFormat *format)
 {
     AVOutputFormat **p;
-    p = &first_oformat;
+    p = last_oformat;
     while (*p != NULL) p = &(*p)->next;
     *p = format;
     format->next = NULL;
+    last_oformat = &format->next;
 }
 
 int av_match_ext(const char *filename, const char *extensions)
@@ -313,6 +318,60 @@ int av_filename_number_test(const char *filename)
     return filename && (av_get_frame_filename(buf, sizeof(buf), filename, 1)>=0);
 }
 
+/**
+ * Common containers by file extension. The demuxer found here is probed
+ * first and taken if it is sure of the data, without calling the probe
+ * of every registered demuxer on the buffer.
+ */
+static const struct {
+    const char *extensions;
+    const char *name;
+} probe_hint_table[] = {
+    { "mp4,m4v,m4a,mov,3gp,3g2", "mov" },
+    { "ts,m2ts,mts,trp,tp",      "mpegts" },
+    { "mkv,mka,webm",            "matroska" },
+    { "avi,divx",                "avi" },
+    { "flv,f4v",                 "flv" },
+    { "mpg,mpeg,vob,dat",        "mpeg" },
+    { "mp3",                     "mp3" },
+    { "aac",                     "aac" },
+    { "rm,rmvb",                 "rm" },
+    { "asf,wmv,wma",             "asf" },
+    { "wav",                     "wav" },
+};
+
+static AVInputFormat *probe_hint_fmt[FF_ARRAY_ELEMS(probe_hint_table)];
+
+static AVInputFormat *probe_hint(AVProbeData *pd, int is_opened, int *score_ret)
+{
+    static AVInputFormat *cmf_fmt;
+    AVInputFormat *fmt = NULL;
+    int i, score;
+
+    if (!pd->filename || !pd->filename[0] || !am_getconfig_bool_def("media.libplayer.probehint", 1))
+        return NULL;
+    for (i = 0; i < FF_ARRAY_ELEMS(probe_hint_table); i++) {
+        if (av_match_ext(pd->filename, probe_hint_table[i].extensions)) {
+            if (!probe_hint_fmt[i])
+                probe_hint_fmt[i] = av_find_input_format(probe_hint_table[i].name);
+            fmt = probe_hint_fmt[i];
+            break;
+        }
+    }
+    if (!fmt || !fmt->read_probe || !is_opened == !(fmt->flags & AVFMT_NOFILE))
+        return NULL;
+    score = fmt->read_probe(pd);
+    if (score < AVPROBE_SCORE_MAX)
+        return NULL;
+    /* cmf overrides the other demuxers,leave it to the full probe */
+    if (!cmf_fmt)
+        cmf_fmt = av_find_input_format("cmf");
+    if (cmf_fmt && cmf_fmt->read_probe && cmf_fmt->read_probe(pd) > 0)
+        return NULL;
+    *score_ret = score;
+    return fmt;
+}
+
 AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score_ret)
 {
     AVProbeData lpd = *pd;
@@ -327,7 +386,9 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score
         }
     }
 
-    fmt = NULL;
+    fmt = probe_hint(&lpd, is_opened, &score_max);
+    if (fmt)
+        goto found;
     while ((fmt1 = av_iformat_next(fmt1))) {
         if (!is_opened == !(fmt1->flags & AVFMT_NOFILE))
             continue;
@@ -361,6 +422,7 @@ AVInputFormat *av_probe_input_format3(AVProbeData *pd, int is_opened, int *score
             fmt = NULL;
         }
     }
+found:
     *score_ret= score_max;
      if(lpd.pads[0] != 0) 
         memcpy(pd->pads, lpd.pads, sizeof(lpd.pads));
@@ -1,17 +1,8 @@
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
 #include "h263vld.h"
 
-static unsigned int msk[33] = {
-    0x00000000, 0x00000001, 0x00000003, 0x00000007,
-    0x0000000f, 0x0000001f, 0x0000003f, 0x0000007f,
-    0x000000ff, 0x000001ff, 0x000003ff, 0x000007ff,
-    0x00000fff, 0x00001fff, 0x00003fff, 0x00007fff,
-    0x0000ffff, 0x0001ffff, 0x0003ffff, 0x0007ffff,
-    0x000fffff, 0x001fffff, 0x003fffff, 0x007fffff,
-    0x00ffffff, 0x01ffffff, 0x03ffffff, 0x07ffffff,
-    0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff,
-    0xffffffff
-};
-
 static VLCtab MCBPCtabintra[] = {
     { -1, 0},
     {20, 6}, {36, 6}, {52, 6}, { 4, 4}, { 4, 4}, { 4, 4},
@@ -68,7 +59,7 @@ static VLCtab CBPYtab[48] = {
     { 4, 4}, { 4, 4}, { 4, 4}, { 4, 4}, { 8, 4}, { 8, 4}, { 8, 4}, { 8, 4},
 };
 
-int DQ_tab[4] = { -1, -2, 1, 2};
+static const int DQ_tab[4] = { -1, -2, 1, 2};
 
 static VLCtab TMNMVtab0[] = {
     { 3, 4}, {61, 4}, { 2, 3}, { 2, 3}, {62, 3}, {62, 3},
@@ -118,7 +109,7 @@ static VLCtab TMNMVtab2[] = {
     {51, 10}, {51, 10}, {51, 10}
 };
 
-VLCtab DCT3Dtab0[] = {
+static VLCtab DCT3Dtab0[] = {
     {4225, 7}, {4209, 7}, {4193, 7}, {4177, 7}, { 193, 7}, { 177, 7},
     { 161, 7}, {   4, 7}, {4161, 6}, {4161, 6}, {4145, 6}, {4145, 6},
     {4129, 6}, {4129, 6}, {4113, 6}, {4113, 6}, { 145, 6}, { 145, 6},
@@ -141,7 +132,7 @@ VLCtab DCT3Dtab0[] = {
 };
 
 
-VLCtab DCT3Dtab1[] = {
+static VLCtab DCT3Dtab1[] = {
     {   9, 10}, {   8, 10}, {4481, 9}, {4481, 9}, {4465, 9}, {4465, 9},
     {4449, 9}, {4449, 9}, {4433, 9}, {4433, 9}, {4417, 9}, {4417, 9},
     {4401, 9}, {4401, 9}, {4385, 9}, {4385, 9}, {4369, 9}, {4369, 9},
@@ -161,7 +152,7 @@ VLCtab DCT3Dtab1[] = {
 };
 
 
-VLCtab DCT3Dtab2[] = {
+static VLCtab DCT3Dtab2[] = {
     {4114, 11}, {4114, 11}, {4099, 11}, {4099, 11}, {  11, 11}, {  11, 11},
     {  10, 11}, {  10, 11}, {4545, 10}, {4545, 10}, {4545, 10}, {4545, 10},
     {4529, 10}, {4529, 10}, {4529, 10}, {4529, 10}, {4513, 10}, {4513, 10},
@@ -184,98 +175,309 @@ VLCtab DCT3Dtab2[] = {
     {7167, 7}, {7167, 7}, {7167, 7}, {7167, 7}, {7167, 7}, {7167, 7},
 };
 
-int roundtab[16] = {0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2};
+static const int roundtab[16] = {0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2};
+
+/*
+ * bit reader with the next bits of the stream cached msb first in 64 bits,
+ * refilled 32 bits at a time. Past the end of the buffer it reads zeros.
+ */
+typedef struct {
+    const unsigned char *start;
+    const unsigned char *ptr;
+    const unsigned char *end;
+    uint64_t cache;
+    int left;           /* valid bits in cache */
+    int padded;         /* zero bytes loaded past the end */
+} h263_bits_t;
+
+static inline void bits_refill(h263_bits_t *bs)
+{
+    if (bs->left > 32) {
+        return;
+    }
+    if (bs->end - bs->ptr >= 4) {
+        uint32_t v = ((uint32_t)bs->ptr[0] << 24) | (bs->ptr[1] << 16) | (bs->ptr[2] << 8) | bs->ptr[3];
+        bs->cache |= (uint64_t)v << (32 - bs->left);
+        bs->ptr += 4;
+        bs->left += 32;
+    } else {
+        while (bs->left <= 56) {
+            if (bs->ptr < bs->end) {
+                bs->cache |= (uint64_t)(*bs->ptr++) << (56 - bs->left);
+            } else {
+                bs->padded++;
+            }
+            bs->left += 8;
+        }
+    }
+}
+
+static inline void bits_init(h263_bits_t *bs, const unsigned char *buf, int len)
+{
+    bs->start = bs->ptr = buf;
+    bs->end = buf + len;
+    bs->cache = 0;
+    bs->left = 0;
+    bs->padded = 0;
+    bits_refill(bs);
+}
 
-int top_mv[90][2], left_mv[2][2], mv[4][2];
+/* n <= 32 */
+static inline unsigned int bits_show(h263_bits_t *bs, int n)
+{
+    bits_refill(bs);
+    return (unsigned int)(bs->cache >> (64 - n));
+}
 
-unsigned int showbits(int n, int byte_index, int bit_index, unsigned char *buf)
+static inline void bits_skip(h263_bits_t *bs, int n)
 {
-    unsigned int data;
+    bs->cache <<= n;
+    bs->left -= n;
+}
 
-    data = (buf[byte_index] << 24) | (buf[byte_index + 1] << 16) | (buf[byte_index + 2] << 8) | buf[byte_index + 3];
-    return (data >> (25 + bit_index - n)) & msk[n];
+static inline unsigned int bits_get(h263_bits_t *bs, int n)
+{
+    unsigned int v = bits_show(bs, n);
+    bits_skip(bs, n);
+    return v;
 }
 
-void flushbits(int n, int *byte_index, int *bit_index)
+/* bits read so far */
+static inline int bits_pos(const h263_bits_t *bs)
 {
-    *byte_index += n / 8;
-    *bit_index -= n % 8;
+    return (int)(bs->ptr - bs->start + bs->padded) * 8 - bs->left;
+}
 
-    if (*bit_index < 0) {
-        *bit_index += 8;
-        (*byte_index) ++;
+static int startcode(h263_bits_t *bs, int len)
+{
+    while (bits_show(bs, 17) != 1) {
+        bits_skip(bs, 1);
+
+        if (bits_pos(bs) > len * 8) {
+            return -1;
+        }
     }
+
+    return 0;
 }
 
-unsigned int getbits(int n, int *byte_index, int *bit_index, unsigned char *buf)
+/*
+ * Two level lookup tables built from the tables above: the first bits1
+ * bits of the code index the first level, codes longer than that go on
+ * in a subtable indexed by the next bits2 bits. An entry with len 0 is
+ * no code when val < 0, else val is the offset of its subtable.
+ */
+typedef struct {
+    short val;
+    unsigned char len;
+} VLClut;
+
+#define VLC_ERROR       (-1)
+
+#define MCBPC_I_BITS    9
+#define MCBPC_P_BITS1   9
+#define MCBPC_P_BITS2   4
+#define CBPY_BITS       6
+#define MV_BITS1        9
+#define MV_BITS2        4
+#define DCT_BITS1       9
+#define DCT_BITS2       4
+#define DCT_SIGN        0x2000
+
+static VLClut mcbpc_i_lut[1 << MCBPC_I_BITS];
+static VLClut mcbpc_p_lut[(1 << MCBPC_P_BITS1) + (1 << MCBPC_P_BITS2)];
+static VLClut cbpy_lut[1 << CBPY_BITS];
+static VLClut mv_lut[(1 << MV_BITS1) + 32 * (1 << MV_BITS2)];
+static VLClut dct_lut[(1 << DCT_BITS1) + 64 * (1 << DCT_BITS2)];
+static pthread_once_t lut_once = PTHREAD_ONCE_INIT;
+
+/* the range based decode of the tables above,on a bits1 + bits2 window */
+static VLCtab mcbpc_i_ref(int w)
 {
-    unsigned int l;
+    VLCtab t = { -1, 0};
+
+    if (w == 1) {
+        t.val = 255;    /* stuffing */
+        t.len = 9;
+    } else if (w >= 256) {
+        t.val = 3;
+        t.len = 1;
+    } else if (w >= 8) {
+        t = MCBPCtabintra[w >> 3];
+    }
+    return t;
+}
 
-    l = showbits(n, *byte_index, *bit_index, buf);
-    flushbits(n, byte_index, bit_index);
-    return l;
+static VLCtab mcbpc_p_ref(int w)
+{
+    VLCtab t = { -1, 0};
+
+    if (w >= 4096) {
+        t.val = 0;
+        t.len = 1;
+    } else if (w >= 16) {
+        t = MCBPCtab0[w >> 4];
+    } else if (w >= 8) {
+        t = MCBPCtab1[w - 8];
+    }
+    return t;
 }
 
-int startcode(int *byte_index, int *bit_index, unsigned char *buf, int len)
+static VLCtab cbpy_ref(int w)
 {
-#if 0
-    int i;
-    unsigned int start_code;
+    VLCtab t = { -1, 0};
 
-    if (*bit_index != 7) {
-        *bit_index = 7;
-        (*byte_index) ++;
+    if (w >= 48) {
+        t.val = 0;
+        t.len = 2;
+    } else if (w >= 2) {
+        t = CBPYtab[w];
     }
+    return t;
+}
 
-    start_code = buf[(*byte_index)];
-    start_code = (start_code << 8) | buf[(*byte_index) + 1];
+/* the 1 bit flag of a zero vector and the vector code */
+static VLCtab mv_ref(int w)
+{
+    VLCtab t = { -1, 0};
 
-    for (i = (*byte_index) ; i < len - 2 ; i++) {
-        start_code = (start_code << 8) | buf[i + 2];
+    if (w & 0x1000) {
+        t.val = 0;
+        t.len = 1;
+        return t;
+    }
+    if (w >= 512) {
+        t = TMNMVtab0[(w >> 8) - 2];
+    } else if (w >= 128) {
+        t = TMNMVtab1[(w >> 2) - 32];
+    } else if (w >= 5) {
+        t = TMNMVtab2[w - 5];
+    } else {
+        return t;
+    }
+    t.len++;
+    return t;
+}
 
-        if ((start_code & 0xffff80) == 0x000080) {
-            break;
+/* the coefficient code and, but for escapes, the sign bit after it */
+static VLCtab dct_ref(int w)
+{
+    VLCtab t = { -1, 0};
+    int code = w >> 1;
+
+    if (code >= 512) {
+        t = DCT3Dtab0[(code >> 5) - 16];
+    } else if (code >= 128) {
+        t = DCT3Dtab1[(code >> 2) - 32];
+    } else if (code >= 8) {
+        t = DCT3Dtab2[code - 8];
+    } else {
+        return t;
+    }
+    if (t.val != ESCAPE) {
+        if ((w >> (12 - t.len)) & 1) {
+            t.val |= DCT_SIGN;
         }
+        t.len++;
     }
+    return t;
+}
 
-    if (i == len - 2) {
-        return -1;
+static int build_lut(VLClut *lut, int size, int bits1, int bits2, VLCtab(*ref)(int w))
+{
+    int n1 = 1 << bits1, n2 = 1 << bits2, next = n1, i, k;
+    VLCtab t, u;
+
+    for (i = 0; i < n1; i++) {
+        t = ref(i << bits2);
+        for (k = 1; k < n2; k++) {
+            u = ref((i << bits2) | k);
+            if (u.val != t.val || u.len != t.len) {
+                break;
+            }
+        }
+        if (k == n2 && t.len <= bits1) {
+            lut[i].val = t.len ? t.val : VLC_ERROR;
+            lut[i].len = t.len;
+            continue;
+        }
+        if (next + n2 > size) {
+            return -1;
+        }
+        lut[i].val = next;
+        lut[i].len = 0;
+        for (k = 0; k < n2; k++) {
+            u = ref((i << bits2) | k);
+            lut[next + k].val = u.len ? u.val : VLC_ERROR;
+            lut[next + k].len = u.len;
+        }
+        next += n2;
     }
+    return 0;
+}
 
-    *byte_index = i;
-#else
-    while (showbits(17, *byte_index, *bit_index, buf) != 1) {
-        flushbits(1, byte_index, bit_index);
+static void build_luts(void)
+{
+    build_lut(mcbpc_i_lut, sizeof(mcbpc_i_lut) / sizeof(VLClut), MCBPC_I_BITS, 0, mcbpc_i_ref);
+    build_lut(mcbpc_p_lut, sizeof(mcbpc_p_lut) / sizeof(VLClut), MCBPC_P_BITS1, MCBPC_P_BITS2, mcbpc_p_ref);
+    build_lut(cbpy_lut, sizeof(cbpy_lut) / sizeof(VLClut), CBPY_BITS, 0, cbpy_ref);
+    build_lut(mv_lut, sizeof(mv_lut) / sizeof(VLClut), MV_BITS1, MV_BITS2, mv_ref);
+    build_lut(dct_lut, sizeof(dct_lut) / sizeof(VLClut), DCT_BITS1, DCT_BITS2, dct_ref);
+}
 
-        if ((*byte_index) > len || ((*byte_index) == len && (*bit_index) < 7)) {
-            return -1;
+static inline int vlc_get(h263_bits_t *bs, const VLClut *lut, int bits1, int bits2)
+{
+    unsigned int w = bits_show(bs, bits1 + bits2);
+    const VLClut *e = &lut[w >> bits2];
+
+    if (!e->len) {
+        if (e->val < 0) {
+            return VLC_ERROR;
+        }
+        e = &lut[e->val + (w & ((1 << bits2) - 1))];
+        if (!e->len) {
+            return VLC_ERROR;
         }
     }
+    bits_skip(bs, e->len);
+    return e->val;
+}
+
+/* widest picture, top_mv keeps two vectors per macroblock plus one pair */
+#define MAX_MB_WIDTH    256
+/* most bytes written for a macroblock: mode, 4 vectors and their sum,
+   and for 6 blocks the dc, 64 escaped coefficients and the end mark */
+#define MAX_MB_OUT      (1 + 4 * 4 + 4 + 6 * (2 + 64 * 4 + 2))
+#if MAX_MB_OUT > H263VLD_MB_MAX_OUT
+#error H263VLD_MB_MAX_OUT too small
 #endif
 
-    return 0;
-}
+typedef struct {
+    int top_mv[MAX_MB_WIDTH * 2 + 2][2];
+    int left_mv[2][2];
+    int mv[4][2];
+} h263_mv_t;
 
-int get_pred_mv(int x, int k, int comp)
+static int get_pred_mv(h263_mv_t *m, int x, int k, int comp)
 {
     int mv1, mv2, mv3;
 
     if (k == 0) {
-        mv1 = left_mv[0][comp];
-        mv2 = top_mv[x * 2][comp];
-        mv3 = top_mv[(x + 1) * 2][comp];
+        mv1 = m->left_mv[0][comp];
+        mv2 = m->top_mv[x * 2][comp];
+        mv3 = m->top_mv[(x + 1) * 2][comp];
     } else if (k == 1) {
-        mv1 = mv[0][comp];
-        mv2 = top_mv[x * 2 + 1][comp];
-        mv3 = top_mv[(x + 1) * 2][comp];
+        mv1 = m->mv[0][comp];
+        mv2 = m->top_mv[x * 2 + 1][comp];
+        mv3 = m->top_mv[(x + 1) * 2][comp];
     } else if (k == 2) {
-        mv1 = left_mv[1][comp];
-        mv2 = mv[0][comp];
-        mv3 = mv[1][comp];
+        mv1 = m->left_mv[1][comp];
+        mv2 = m->mv[0][comp];
+        mv3 = m->mv[1][comp];
     } else {
-        mv1 = mv[2][comp];
-        mv2 = mv[0][comp];
-        mv3 = mv[1][comp];
+        mv1 = m->mv[2][comp];
+        mv2 = m->mv[0][comp];
+        mv3 = m->mv[1][comp];
     }
 
     if (mv2 == NO_VEC) {
@@ -285,7 +487,7 @@ int get_pred_mv(int x, int k, int comp)
     return mv1 + mv2 + mv3 - mmax(mv1, mmax(mv2, mv3)) - mmin(mv1, mmin(mv2, mv3));
 }
 
-int motion_decode(int vec, int pmv)
+static int motion_decode(int vec, int pmv)
 {
     if (vec > 31) {
         vec -= 64;
@@ -304,66 +506,105 @@ int motion_decode(int vec, int pmv)
     return vec;
 }
 
-int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263)
+static void reset_top_mv(h263_mv_t *m, int mb_width)
+{
+    int k;
+
+    for (k = 0 ; k < mb_width * 2 ; k++) {
+        m->top_mv[k][0] = m->top_mv[k][1] = NO_VEC;
+    }
+
+    for (k = mb_width * 2 ; k < mb_width * 2 + 2 ; k++) {
+        m->top_mv[k][0] = m->top_mv[k][1] = 0;
+    }
+}
+
+/* one vector component,with its prediction */
+static inline int decode_mv(h263_bits_t *bs, h263_mv_t *m, int j, int k, int comp, unsigned char **out)
+{
+    int pred = get_pred_mv(m, j, k, comp);
+    int vec = vlc_get(bs, mv_lut, MV_BITS1, MV_BITS2);
+
+    if (vec == VLC_ERROR) {
+        return -1;
+    }
+
+    vec = motion_decode(vec, pred);
+    m->mv[k][comp] = vec;
+
+    *(*out)++ = (vec >> 7) & 0x3f;
+    *(*out)++ = vec << 1;
+    return 0;
+}
+
+int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int outbuf_size, int s263)
 {
-    int outbuf_len = 0, byte_index = 0, bit_index = 7;
+    unsigned char *out = outbuf, *out_end = outbuf + outbuf_size;
     int i, j, k, comp, temp, h263_version, pict_type, quant, mb_width, mb_height;
-    int MCBPC, Mode, CBPY, CBP, DQUANT, pred, run, last, level, val, sign, format_bit, coeff_count;
+    int MCBPC, Mode, CBPY, CBP, DQUANT, run, last, level, val, sign, format_bit, coeff_count;
     static int width = 0, height = 0, source_format = 0, optional_custom_PCF = 0;
-    VLCtab *tab;
+    h263_bits_t bits, *bs = &bits;
+    h263_mv_t mvs, *m = &mvs;
+
+    if (outbuf_size < 16) {
+        return 0;
+    }
 
-    outbuf[outbuf_len++] = 0;
-    outbuf[outbuf_len++] = 0;
-    outbuf[outbuf_len++] = 1;
-    outbuf[outbuf_len++] = 0xb6;
+    pthread_once(&lut_once, build_luts);
+    bits_init(bs, inbuf, inbuf_len);
 
-    getbits(17, &byte_index, &bit_index, inbuf);
-    h263_version = getbits(5, &byte_index, &bit_index, inbuf);
-    outbuf[outbuf_len++] = getbits(8, &byte_index, &bit_index, inbuf);
+    *out++ = 0;
+    *out++ = 0;
+    *out++ = 1;
+    *out++ = 0xb6;
+
+    bits_get(bs, 17);
+    h263_version = bits_get(bs, 5);
+    *out++ = bits_get(bs, 8);
 
     if (s263 == 0) {
-        temp = getbits(5, &byte_index, &bit_index, inbuf);
+        temp = bits_get(bs, 5);
         if (temp != 16) {
             return 0;
         }
 
-        temp = getbits(3, &byte_index, &bit_index, inbuf);
+        temp = bits_get(bs, 3);
 
         if (temp == 7) {
             int UFEP, rounding_type;
 
-            UFEP = getbits(3, &byte_index, &bit_index, inbuf);
+            UFEP = bits_get(bs, 3);
             if (UFEP >= 2) {
                 return 0;
             }
 
             if (UFEP == 1) {
-                source_format = getbits(3, &byte_index, &bit_index, inbuf);
-                optional_custom_PCF = getbits(1, &byte_index, &bit_index, inbuf);
-                temp = getbits(14, &byte_index, &bit_index, inbuf);
+                source_format = bits_get(bs, 3);
+                optional_custom_PCF = bits_get(bs, 1);
+                temp = bits_get(bs, 14);
                 if (temp != 8) {
                     return 0;
                 }
             }
 
-            pict_type = getbits(3, &byte_index, &bit_index, inbuf);
+            pict_type = bits_get(bs, 3);
             if (pict_type >= 2) {
                 return 0;
             }
 
-            temp = getbits(2, &byte_index, &bit_index, inbuf);
+            temp = bits_get(bs, 2);
             if (temp != 0) {
                 return 0;
             }
 
-            rounding_type = getbits(1, &byte_index, &bit_index, inbuf);
+            rounding_type = bits_get(bs, 1);
 
-            temp = getbits(3, &byte_index, &bit_index, inbuf);
+            temp = bits_get(bs, 3);
             if (temp != 1) {
                 return 0;
             }
 
-            temp = getbits(1, &byte_index, &bit_index, inbuf);
+            temp = bits_get(bs, 1);
             if (temp != 0) {
                 return 0;
             }
@@ -391,15 +632,15 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                     height = 1152;
                     break;
                 case 6:
-                    temp = getbits(4, &byte_index, &bit_index, inbuf);
-                    width = getbits(9, &byte_index, &bit_index, inbuf);
+                    temp = bits_get(bs, 4);
+                    width = bits_get(bs, 9);
                     width = (width + 1) * 4;
-                    getbits(1, &byte_index, &bit_index, inbuf);
-                    height = getbits(9, &byte_index, &bit_index, inbuf);
+                    bits_get(bs, 1);
+                    height = bits_get(bs, 9);
                     height = height * 4;
 
                     if (temp == 15) {
-                        getbits(16, &byte_index, &bit_index, inbuf);
+                        bits_get(bs, 16);
                     }
 
                     break;
@@ -408,18 +649,18 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                 }
             }
 
-            outbuf[outbuf_len++] = width >> 8;
-            outbuf[outbuf_len++] = width;
-            outbuf[outbuf_len++] = height >> 8;
-            outbuf[outbuf_len++] = height;
-            outbuf[outbuf_len++] = pict_type;
-            outbuf[outbuf_len++] = rounding_type;
+            *out++ = width >> 8;
+            *out++ = width;
+            *out++ = height >> 8;
+            *out++ = height;
+            *out++ = pict_type;
+            *out++ = rounding_type;
 
             if (optional_custom_PCF) {
-                getbits(10, &byte_index, &bit_index, inbuf);
+                bits_get(bs, 10);
             }
 
-            quant = getbits(5, &byte_index, &bit_index, inbuf);
+            quant = bits_get(bs, 5);
         } else {
             switch (temp) {
             case 1:
@@ -446,38 +687,38 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                 return 0;
             }
 
-            outbuf[outbuf_len++] = width >> 8;
-            outbuf[outbuf_len++] = width;
-            outbuf[outbuf_len++] = height >> 8;
-            outbuf[outbuf_len++] = height;
+            *out++ = width >> 8;
+            *out++ = width;
+            *out++ = height >> 8;
+            *out++ = height;
 
-            pict_type = getbits(1, &byte_index, &bit_index, inbuf);
-            outbuf[outbuf_len++] = pict_type;
-            outbuf[outbuf_len++] = 0;
+            pict_type = bits_get(bs, 1);
+            *out++ = pict_type;
+            *out++ = 0;
 
-            temp = getbits(4, &byte_index, &bit_index, inbuf);
+            temp = bits_get(bs, 4);
             if (temp != 0) {
                 return 0;
             }
 
-            quant = getbits(5, &byte_index, &bit_index, inbuf);
+            quant = bits_get(bs, 5);
 
-            temp = getbits(1, &byte_index, &bit_index, inbuf);
+            temp = bits_get(bs, 1);
             if (temp != 0) {
                 return 0;
             }
         }
     } else {
-        temp = getbits(3, &byte_index, &bit_index, inbuf);
+        temp = bits_get(bs, 3);
 
         switch (temp) {
         case 0:
-            width = getbits(8, &byte_index, &bit_index, inbuf);
-            height = getbits(8, &byte_index, &bit_index, inbuf);
+            width = bits_get(bs, 8);
+            height = bits_get(bs, 8);
             break;
         case 1:
-            width = getbits(16, &byte_index, &bit_index, inbuf);
-            height = getbits(16, &byte_index, &bit_index, inbuf);
+            width = bits_get(bs, 16);
+            height = bits_get(bs, 16);
             break;
         case 2:
             width = 352;
@@ -503,135 +744,81 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
             return 0;
         }
 
-        outbuf[outbuf_len++] = width >> 8;
-        outbuf[outbuf_len++] = width;
-        outbuf[outbuf_len++] = height >> 8;
-        outbuf[outbuf_len++] = height;
+        *out++ = width >> 8;
+        *out++ = width;
+        *out++ = height >> 8;
+        *out++ = height;
 
-        pict_type = getbits(2, &byte_index, &bit_index, inbuf);
+        pict_type = bits_get(bs, 2);
         if (pict_type == 3) {
             return 0;
         }
 
-        outbuf[outbuf_len++] = pict_type;
-        outbuf[outbuf_len++] = 0;
+        *out++ = pict_type;
+        *out++ = 0;
 
         if (pict_type == 2) {
             pict_type = 1;
         }
 
-        getbits(1, &byte_index, &bit_index, inbuf);
-        quant = getbits(5, &byte_index, &bit_index, inbuf);
+        bits_get(bs, 1);
+        quant = bits_get(bs, 5);
     }
 
-    temp = getbits(1, &byte_index, &bit_index, inbuf);
+    temp = bits_get(bs, 1);
     while (temp == 1) {
-        getbits(8, &byte_index, &bit_index, inbuf);
-        temp = getbits(1, &byte_index, &bit_index, inbuf);
+        bits_get(bs, 8);
+        temp = bits_get(bs, 1);
     }
 
     mb_width = (width + 15) / 16;
     mb_height = (height + 15) / 16;
+    if (mb_width > MAX_MB_WIDTH) {
+        return 0;
+    }
 
-    for (k = 0 ; k < mb_width * 2 ; k++)
-        for (comp = 0 ; comp < 2 ; comp++) {
-            top_mv[k][comp] = NO_VEC;
-        }
-
-    for (k = mb_width * 2 ; k < mb_width * 2 + 2 ; k++)
-        for (comp = 0 ; comp < 2 ; comp++) {
-            top_mv[k][comp] = 0;
-        }
+    reset_top_mv(m, mb_width);
 
     for (i = 0 ; i < mb_height ; i++) {
-        for (k = 0 ; k < 2 ; k++)
-            for (comp = 0 ; comp < 2 ; comp++) {
-                left_mv[k][comp] = 0;
-            }
+        memset(m->left_mv, 0, sizeof(m->left_mv));
 
         for (j = 0 ; j < mb_width ; j++) {
-            if (showbits(16, byte_index, bit_index, inbuf) == 0) {
-                if (startcode(&byte_index, &bit_index, inbuf, inbuf_len) < 0) {
+            if (bits_show(bs, 16) == 0) {
+                if (startcode(bs, inbuf_len) < 0) {
                     return 0;
                 }
 
-                getbits(17, &byte_index, &bit_index, inbuf);
-                getbits(5, &byte_index, &bit_index, inbuf);
-                getbits(2, &byte_index, &bit_index, inbuf);
-                quant = getbits(5, &byte_index, &bit_index, inbuf);
+                bits_get(bs, 17);
+                bits_get(bs, 5);
+                bits_get(bs, 2);
+                quant = bits_get(bs, 5);
 
-                for (k = 0 ; k < mb_width * 2 ; k++)
-                    for (comp = 0 ; comp < 2 ; comp++) {
-                        top_mv[k][comp] = NO_VEC;
-                    }
-
-                for (k = mb_width * 2 ; k < mb_width * 2 + 2 ; k++)
-                    for (comp = 0 ; comp < 2 ; comp++) {
-                        top_mv[k][comp] = 0;
-                    }
+                reset_top_mv(m, mb_width);
+                memset(m->left_mv, 0, sizeof(m->left_mv));
+            }
 
-                for (k = 0 ; k < 2 ; k++)
-                    for (comp = 0 ; comp < 2 ; comp++) {
-                        left_mv[k][comp] = 0;
-                    }
+            if (bits_pos(bs) > inbuf_len * 8) {
+                return 0;
             }
 
-            if (byte_index > inbuf_len || (byte_index == inbuf_len && bit_index < 7)) {
+            if (out_end - out < MAX_MB_OUT) {
                 return 0;
             }
 
             if (pict_type == H263_P_PICTURE) {
-                if (getbits(1, &byte_index, &bit_index, inbuf) == 1) {
-                    outbuf[outbuf_len++] = 0;
-                    top_mv[j * 2][0] = top_mv[j * 2][1] = top_mv[j * 2 + 1][0] = top_mv[j * 2 + 1][1] = 0;
-                    left_mv[0][0] = left_mv[0][1] = left_mv[1][0] = left_mv[1][1] = 0;
+                if (bits_get(bs, 1) == 1) {
+                    *out++ = 0;
+                    m->top_mv[j * 2][0] = m->top_mv[j * 2][1] = m->top_mv[j * 2 + 1][0] = m->top_mv[j * 2 + 1][1] = 0;
+                    memset(m->left_mv, 0, sizeof(m->left_mv));
                     continue;
                 }
-            }
-
-            if (pict_type == H263_I_PICTURE) {
-                temp = showbits(9, byte_index, bit_index, inbuf);
-
-                if (temp == 1) {
-                    flushbits(9, &byte_index, &bit_index);
-                    MCBPC = 255;
-                }
-
-                if (temp < 8) {
-                    return 0;
-                }
-
-                temp >>= 3;
-
-                if (temp >= 32) {
-                    flushbits(1, &byte_index, &bit_index);
-                    MCBPC = 3;
-                } else {
-                    flushbits(MCBPCtabintra[temp].len, &byte_index, &bit_index);
-                    MCBPC = MCBPCtabintra[temp].val;
-                }
+                MCBPC = vlc_get(bs, mcbpc_p_lut, MCBPC_P_BITS1, MCBPC_P_BITS2);
             } else {
-                temp = showbits(13, byte_index, bit_index, inbuf);
-
-                if (temp >> 4 == 1) {
-                    flushbits(9, &byte_index, &bit_index);
-                    MCBPC = 255;
-                }
-
-                if (temp == 0) {
-                    return 0;
-                }
+                MCBPC = vlc_get(bs, mcbpc_i_lut, MCBPC_I_BITS, 0);
+            }
 
-                if (temp >= 4096) {
-                    flushbits(1, &byte_index, &bit_index);
-                    MCBPC = 0;
-                } else if (temp >= 16) {
-                    flushbits(MCBPCtab0[temp >> 4].len, &byte_index, &bit_index);
-                    MCBPC = MCBPCtab0[temp >> 4].val;
-                } else {
-                    flushbits(MCBPCtab1[temp - 8].len, &byte_index, &bit_index);
-                    MCBPC = MCBPCtab1[temp - 8].val;
-                }
+            if (MCBPC == VLC_ERROR) {
+                return 0;
             }
 
             if (MCBPC == 255) {
@@ -640,20 +827,12 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
             }
 
             Mode = MCBPC & 7;
-            temp = showbits(6, byte_index, bit_index, inbuf);
+            CBPY = vlc_get(bs, cbpy_lut, CBPY_BITS, 0);
 
-            if (temp < 2) {
+            if (CBPY == VLC_ERROR) {
                 return 0;
             }
 
-            if (temp >= 48) {
-                flushbits(2, &byte_index, &bit_index);
-                CBPY = 0;
-            } else {
-                flushbits(CBPYtab[temp].len, &byte_index, &bit_index);
-                CBPY = CBPYtab[temp].val;
-            }
-
             if (Mode == MODE_INTRA || Mode == MODE_INTRA_Q) {
                 CBPY = CBPY ^ 15;
             }
@@ -661,7 +840,7 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
             CBP = (CBPY << 2) | (MCBPC >> 4);
 
             if (Mode == MODE_INTER_Q || Mode == MODE_INTRA_Q || Mode == MODE_INTER4V_Q) {
-                DQUANT = getbits(2, &byte_index, &bit_index, inbuf);
+                DQUANT = bits_get(bs, 2);
                 quant += DQ_tab[DQUANT];
             }
 
@@ -670,108 +849,52 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
             }
 
             if (Mode == MODE_INTRA || Mode == MODE_INTRA_Q) {
-                outbuf[outbuf_len++] = 1;
-                top_mv[j * 2][0] = top_mv[j * 2][1] = top_mv[j * 2 + 1][0] = top_mv[j * 2 + 1][1] = 0;
-                left_mv[0][0] = left_mv[0][1] = left_mv[1][0] = left_mv[1][1] = 0;
+                *out++ = 1;
+                m->top_mv[j * 2][0] = m->top_mv[j * 2][1] = m->top_mv[j * 2 + 1][0] = m->top_mv[j * 2 + 1][1] = 0;
+                memset(m->left_mv, 0, sizeof(m->left_mv));
             } else if (Mode == MODE_INTER || Mode == MODE_INTER_Q) {
-                outbuf[outbuf_len++] = 2;
+                *out++ = 2;
 
                 for (comp = 0 ; comp < 2 ; comp++) {
-                    pred = get_pred_mv(j, 0, comp);
-
-                    if (getbits(1, &byte_index, &bit_index, inbuf)) {
-                        mv[0][comp] = 0;
-                    } else {
-                        temp = showbits(12, byte_index, bit_index, inbuf);
-
-                        if (temp >= 512) {
-                            temp = (temp >> 8) - 2;
-                            flushbits(TMNMVtab0[temp].len, &byte_index, &bit_index);
-                            mv[0][comp] = TMNMVtab0[temp].val;
-                        } else if (temp >= 128) {
-                            temp = (temp >> 2) - 32;
-                            flushbits(TMNMVtab1[temp].len, &byte_index, &bit_index);
-                            mv[0][comp] = TMNMVtab1[temp].val;
-                        } else {
-                            temp -= 5;
-
-                            if (temp < 0) {
-                                return 0;
-                            }
-
-                            flushbits(TMNMVtab2[temp].len, &byte_index, &bit_index);
-                            mv[0][comp] = TMNMVtab2[temp].val;
-                        }
+                    if (decode_mv(bs, m, j, 0, comp, &out) < 0) {
+                        return 0;
                     }
-
-                    mv[0][comp] = motion_decode(mv[0][comp], pred);
-
-                    outbuf[outbuf_len++] = (mv[0][comp] >> 7) & 0x3f;
-                    outbuf[outbuf_len++] = mv[0][comp] << 1;
                 }
 
-                top_mv[j * 2][0] = top_mv[j * 2 + 1][0] = mv[0][0];
-                top_mv[j * 2][1] = top_mv[j * 2 + 1][1] = mv[0][1];
-                left_mv[0][0] = left_mv[1][0] = mv[0][0];
-                left_mv[0][1] = left_mv[1][1] = mv[0][1];
+                m->top_mv[j * 2][0] = m->top_mv[j * 2 + 1][0] = m->mv[0][0];
+                m->top_mv[j * 2][1] = m->top_mv[j * 2 + 1][1] = m->mv[0][1];
+                m->left_mv[0][0] = m->left_mv[1][0] = m->mv[0][0];
+                m->left_mv[0][1] = m->left_mv[1][1] = m->mv[0][1];
             } else {
                 int sum, dx, dy;
 
-                outbuf[outbuf_len++] = 3;
+                *out++ = 3;
 
                 for (k = 0 ; k < 4 ; k++) {
                     for (comp = 0 ; comp < 2 ; comp++) {
-                        pred = get_pred_mv(j, k, comp);
-
-                        if (getbits(1, &byte_index, &bit_index, inbuf)) {
-                            mv[k][comp] = 0;
-                        } else {
-                            temp = showbits(12, byte_index, bit_index, inbuf);
-
-                            if (temp >= 512) {
-                                temp = (temp >> 8) - 2;
-                                flushbits(TMNMVtab0[temp].len, &byte_index, &bit_index);
-                                mv[k][comp] = TMNMVtab0[temp].val;
-                            } else if (temp >= 128) {
-                                temp = (temp >> 2) - 32;
-                                flushbits(TMNMVtab1[temp].len, &byte_index, &bit_index);
-                                mv[k][comp] = TMNMVtab1[temp].val;
-                            } else {
-                                temp -= 5;
-
-                                if (temp < 0) {
-                                    return 0;
-                                }
-
-                                flushbits(TMNMVtab2[temp].len, &byte_index, &bit_index);
-                                mv[k][comp] = TMNMVtab2[temp].val;
-                            }
+                        if (decode_mv(bs, m, j, k, comp, &out) < 0) {
+                            return 0;
                         }
-
-                        mv[k][comp] = motion_decode(mv[k][comp], pred);
-
-                        outbuf[outbuf_len++] = (mv[k][comp] >> 7) & 0x3f;
-                        outbuf[outbuf_len++] = mv[k][comp] << 1;
                     }
                 }
 
-                sum = mv[0][0] + mv[1][0] + mv[2][0] + mv[3][0];
+                sum = m->mv[0][0] + m->mv[1][0] + m->mv[2][0] + m->mv[3][0];
                 dx = msign(sum) * (roundtab[mabs(sum) % 16] + (mabs(sum) / 16) * 2);
-                sum = mv[0][1] + mv[1][1] + mv[2][1] + mv[3][1];
+                sum = m->mv[0][1] + m->mv[1][1] + m->mv[2][1] + m->mv[3][1];
                 dy = msign(sum) * (roundtab[mabs(sum) % 16] + (mabs(sum) / 16) * 2);
-                outbuf[outbuf_len++] = (dx >> 7) & 0x3f;
-                outbuf[outbuf_len++] = dx << 1;
-                outbuf[outbuf_len++] = (dy >> 7) & 0x3f;
-                outbuf[outbuf_len++] = dy << 1;
-
-                top_mv[j * 2][0] = mv[2][0];
-                top_mv[j * 2][1] = mv[2][1];
-                top_mv[j * 2 + 1][0] = mv[3][0];
-                top_mv[j * 2 + 1][1] = mv[3][1];
-                left_mv[0][0] = mv[1][0];
-                left_mv[0][1] = mv[1][1];
-                left_mv[1][0] = mv[3][0];
-                left_mv[1][1] = mv[3][1];
+                *out++ = (dx >> 7) & 0x3f;
+                *out++ = dx << 1;
+                *out++ = (dy >> 7) & 0x3f;
+                *out++ = dy << 1;
+
+                m->top_mv[j * 2][0] = m->mv[2][0];
+                m->top_mv[j * 2][1] = m->mv[2][1];
+                m->top_mv[j * 2 + 1][0] = m->mv[3][0];
+                m->top_mv[j * 2 + 1][1] = m->mv[3][1];
+                m->left_mv[0][0] = m->mv[1][0];
+                m->left_mv[0][1] = m->mv[1][1];
+                m->left_mv[1][0] = m->mv[3][0];
+                m->left_mv[1][1] = m->mv[3][1];
             }
 
             for (comp = 0 ; comp < 6 ; comp++) {
@@ -780,7 +903,7 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
 
                 if (Mode == MODE_INTRA || Mode == MODE_INTRA_Q) {
                     coeff_count = 1;
-                    temp = getbits(8, &byte_index, &bit_index, inbuf);
+                    temp = bits_get(bs, 8);
 
                     if (temp == 128) {
                         return 0;
@@ -792,34 +915,26 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
 
                     temp *= 8;
 
-                    outbuf[outbuf_len++] = (temp >> 8) & 0xf;
-                    outbuf[outbuf_len++] = temp;
+                    *out++ = (temp >> 8) & 0xf;
+                    *out++ = temp;
                 }
 
                 if ((CBP & (1 << (5 - comp)))) {
                     while (last == 0) {
-                        temp = showbits(12, byte_index, bit_index, inbuf);
-
-                        if (temp >= 512) {
-                            tab = &DCT3Dtab0[(temp >> 5) - 16];
-                        } else if (temp >= 128) {
-                            tab = &DCT3Dtab1[(temp >> 2) - 32];
-                        } else if (temp >= 8) {
-                            tab = &DCT3Dtab2[(temp >> 0) - 8];
-                        } else {
+                        val = vlc_get(bs, dct_lut, DCT_BITS1, DCT_BITS2);
+
+                        if (val == VLC_ERROR) {
                             return 0;
                         }
 
-                        flushbits(tab->len, &byte_index, &bit_index);
-
-                        if (tab->val == ESCAPE) {
+                        if (val == ESCAPE) {
                             if (s263 == 1 && h263_version == 1) {
-                                format_bit = getbits(1, &byte_index, &bit_index, inbuf);
-                                last = getbits(1, &byte_index, &bit_index, inbuf);
-                                run = getbits(6, &byte_index, &bit_index, inbuf);
+                                format_bit = bits_get(bs, 1);
+                                last = bits_get(bs, 1);
+                                run = bits_get(bs, 6);
 
                                 if (format_bit) {
-                                    level = getbits(11, &byte_index, &bit_index, inbuf);
+                                    level = bits_get(bs, 11);
                                     sign = (level >= 1024);
 
                                     if (sign) {
@@ -828,7 +943,7 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                                         val = level;
                                     }
                                 } else {
-                                    level = getbits(7, &byte_index, &bit_index, inbuf);
+                                    level = bits_get(bs, 7);
                                     sign = (level >= 64);
 
                                     if (sign) {
@@ -838,9 +953,9 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                                     }
                                 }
                             } else {
-                                last = getbits(1, &byte_index, &bit_index, inbuf);
-                                run = getbits(6, &byte_index, &bit_index, inbuf);
-                                level = getbits(8, &byte_index, &bit_index, inbuf);
+                                last = bits_get(bs, 1);
+                                run = bits_get(bs, 6);
+                                level = bits_get(bs, 8);
                                 sign = (level >= 128);
 
                                 if (sign) {
@@ -850,12 +965,10 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                                 }
                             }
                         } else {
-                            run = (tab->val >> 4) & 255;
-                            level = tab->val & 15;
-                            last = (tab->val >> 12) & 1;
-
-                            val = level;
-                            sign = getbits(1, &byte_index, &bit_index, inbuf);
+                            run = (val >> 4) & 255;
+                            last = (val >> 12) & 1;
+                            sign = (val & DCT_SIGN) != 0;
+                            val = val & 15;
                         }
 
                         coeff_count += run + 1;
@@ -870,29 +983,29 @@ int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263
                         }
 
                         if (run < 15) {
-                            outbuf[outbuf_len++] = (run << 4) | ((temp >> 8) & 0xf);
-                            outbuf[outbuf_len++] = temp;
+                            *out++ = (run << 4) | ((temp >> 8) & 0xf);
+                            *out++ = temp;
                         } else {
-                            outbuf[outbuf_len++] = 0xf0;
-                            outbuf[outbuf_len++] = run;
-                            outbuf[outbuf_len++] = (temp >> 8) & 0xf;
-                            outbuf[outbuf_len++] = temp;
+                            *out++ = 0xf0;
+                            *out++ = run;
+                            *out++ = (temp >> 8) & 0xf;
+                            *out++ = temp;
                         }
 
                         if (last) {
-                            outbuf[outbuf_len++] = 0xf0;
-                            outbuf[outbuf_len++] = 0;
+                            *out++ = 0xf0;
+                            *out++ = 0;
                         }
                     }
                 } else {
-                    outbuf[outbuf_len++] = 0xf0;
-                    outbuf[outbuf_len++] = 0;
+                    *out++ = 0xf0;
+                    *out++ = 0;
                 }
             }
         }
     }
 
-    return outbuf_len;
+    return out - outbuf;
 }
 
 int decodeble_h263(unsigned char *buf)
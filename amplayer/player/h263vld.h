@@ -23,10 +23,10 @@ typedef struct {
     int val, len;
 } VLCtab;
 
-unsigned int showbits(int n, int byte_index, int bit_index, unsigned char *buf);
-void flushbits(int n, int *byte_index, int *bit_index);
-unsigned int getbits(int n, int *byte_index, int *bit_index, unsigned char *buf);
-int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int s263);
+/* room kept free in outbuf before each macroblock,add it to the buffer size */
+#define H263VLD_MB_MAX_OUT  1600
+
+int h263vld(unsigned char *inbuf, unsigned char *outbuf, int inbuf_len, int outbuf_size, int s263);
 int decodeble_h263(unsigned char *buf);
 
 
@@ -37,4 +37,13 @@ if the level<global_level print out
 void log_close(void);
 int log_open(const char *name);
 int update_loglevel_setting(void);
+
+/*
+ * async mode, formatting and output on a flush thread (log_print.c).
+ * ring_size: bytes per logging thread, 0 for the default 32k.
+ */
+int log_async_start(int ring_size);
+void log_async_stop(void);
+void log_flush(void);
+void log_async_get_stats(unsigned int *logged, unsigned int *dropped);
 #endif
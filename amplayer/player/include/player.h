@@ -29,6 +29,7 @@ int     player_list_allpid(pid_info_t *pid);
 int     check_pid_valid(int pid);
 int 	player_get_play_info(int pid,player_info_t *info);
 int 	player_get_media_info(int pid,media_info_t *minfo);
+int 	player_get_trace_info(int pid,int phase,player_trace_info_t *info);
 int 	player_video_overlay_en(unsigned enable);
 int 	player_start_play(int pid);
 int 	player_send_message(int pid, player_cmd_t *cmd);
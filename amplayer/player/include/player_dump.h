@@ -7,6 +7,7 @@ extern "C" {
 int player_dump_playinfo(int pid, int fd);
 int player_dump_bufferinfo(int pid, int fd);
 int player_dump_tsyncinfo(int pid, int fd);
+int player_dump_trace(int pid, int fd);
 #ifdef  __cplusplus
 }
 #endif
@@ -0,0 +1,54 @@
+#ifndef PLAYER_MEDIASCAN_H
+#define PLAYER_MEDIASCAN_H
+
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#define MEDIASCAN_TAG_LEN   128
+
+typedef struct {
+    const char *path;
+    int64_t size;
+    int64_t mtime;
+    int error;              ///< 0, or < 0 when the file could not be parsed
+    int cached;             ///< 1 when the file is unchanged and the result came from the cache
+    int64_t duration;       ///< AV_TIME_BASE units
+    int vtracks;
+    int atracks;
+    int stracks;
+    int width;
+    int height;
+    int rotation;
+    char title[MEDIASCAN_TAG_LEN];
+    char artist[MEDIASCAN_TAG_LEN];
+    char album[MEDIASCAN_TAG_LEN];
+} mediascan_result_t;
+
+/* called for every file, one call at a time, from the scanning threads */
+typedef void (*mediascan_cb)(void *opaque, const mediascan_result_t *result);
+
+typedef struct {
+    int threads;            ///< parsing threads, 0 for the default
+    int probesize;          ///< bytes av_find_stream_info may read, 0 for the default
+    int analyze_ms;         ///< stream time it may analyze, 0 for the default
+    int recursive;          ///< descend into sub directories
+    const char *exts;       ///< comma separated extensions to scan, NULL for the media defaults, "" for all
+    const char *cache_path; ///< (path, size, mtime) result cache, NULL for none
+} mediascan_para_t;
+
+/*
+ * scan a directory or a list of files. unchanged files are answered from
+ * the cache, the others are parsed on a bounded pool of threads with a
+ * reduced probe budget. returns the number of files reported, < 0 on error.
+ */
+int mediascan_dir(const char *dir, const mediascan_para_t *para, mediascan_cb cb, void *opaque);
+int mediascan_files(const char **files, int count, const mediascan_para_t *para, mediascan_cb cb, void *opaque);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
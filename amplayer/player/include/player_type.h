@@ -217,6 +217,16 @@ typedef struct pid_info
     int pid[MAX_PLAYER_THREADS];
 }pid_info_t;
 
+typedef struct player_trace_info
+{
+	int phase;								//amtrace_phase_t, see amtrace.h
+	int count;								//completed phases in history
+	int64_t p50_us;
+	int64_t p95_us;
+	int64_t p99_us;
+	int64_t max_us;
+}player_trace_info_t;
+
 typedef struct player_file_type
 {
 	const char *fmt_string;
@@ -1,3 +1,10 @@
+#include <stdarg.h>
+
+/*async mode, log_async_start() at the end of the file*/
+static volatile int log_async_on;
+static int log_async_vput(int level, const char *fmt, va_list ap);
+static void log_output(int level, long long ts_us, const char *buf);
+
 #ifdef ANDROID
 
 #include <android/log.h>
@@ -10,10 +17,16 @@
 #define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
 
 #define LEVEL_SETING_PATH "media.amplayer.loglevel"
+#define ASYNC_SETING_PATH "media.amplayer.asynclog"
 #include  <libavutil/log.h>
 
 static int global_level = 35;
 
+static void log_output(int level, long long ts_us, const char *buf)
+{
+    LOGI("%s", buf);
+}
+
 int log_open(const char *name)
 {
     return 0;
@@ -31,12 +44,21 @@ void log_lprint(const int level, const char *fmt, ...)
     if (level > global_level) {
         return;
     }
+    if (log_async_on) {
+        int ret;
+        va_start(ap, fmt);
+        ret = log_async_vput(level, fmt, ap);
+        va_end(ap);
+        if (ret == 0) {
+            return;
+        }
+    }
     va_start(ap, fmt);
     vasprintf(&buf, fmt, ap);
     va_end(ap);
 
     if (buf) {
-        LOGI("%s", buf);
+        log_output(level, 0, buf);
         free(buf);
     }
 }
@@ -52,6 +74,12 @@ int update_loglevel_setting(void)
     }
 	log_error("loglevel changed to %d\n", global_level);
     av_log_set_level(global_level);//for ffmpeg//
+    if (GetSystemSettingString(ASYNC_SETING_PATH, value, NULL) > 0 &&
+        (!strcmp(value, "1") || !strcmp(value, "true"))) {
+        log_async_start(0);
+    } else {
+        log_async_stop();
+    }
     return 0;
 }
 
@@ -73,6 +101,7 @@ int update_loglevel_setting(void)
 #include <log_print.h>
 
 static int log_fd = -1;
+static int log_index = 0;
 static int global_level = 5;
 
 int update_loglevel_setting(void)
@@ -80,12 +109,10 @@ int update_loglevel_setting(void)
     return 0;
 }
 
-static int get_system_time(char *timebuf)
+static int get_system_time(char *timebuf, time_t cur_time)
 {
-    time_t cur_time;
     struct tm * timeinfo;
 
-    time(&cur_time);
     timeinfo = localtime(&cur_time);
     strftime(timebuf, 20, "%H:%M:%S ", timeinfo);
 
@@ -125,24 +152,15 @@ static void check_file_size(void)
     }
 }
 
-__attribute__((format(printf, 2, 3)))
-void log_lprint(const int level, const char *fmt, ...)
+/*ts_us 0: now*/
+static void log_output(int level, long long ts_us, const char *buf)
 {
-    char *buf = NULL;
-    static int log_index = 0;
-    va_list ap;
     char systime[32];
-    if (level > global_level) {
-        return;
-    }
-    va_start(ap, fmt);
-    vasprintf(&buf, fmt, ap);
-    va_end(ap);
 
     if (log_fd > 0) {
         char sbuf[16];
         check_file_size();
-        get_system_time(systime);
+        get_system_time(systime, ts_us ? (time_t)(ts_us / 1000000) : time(NULL));
         sprintf(sbuf, "[%d]: ", log_index++);
         write(log_fd, sbuf, strlen(sbuf));
         write(log_fd, systime, strlen(systime));
@@ -153,9 +171,591 @@ void log_lprint(const int level, const char *fmt, ...)
         fprintf(stdout, "%s", buf);
         fflush(stdout);
     }
+}
+
+__attribute__((format(printf, 2, 3)))
+void log_lprint(const int level, const char *fmt, ...)
+{
+    char *buf = NULL;
+    va_list ap;
+    if (level > global_level) {
+        return;
+    }
+    if (log_async_on) {
+        int ret;
+        va_start(ap, fmt);
+        ret = log_async_vput(level, fmt, ap);
+        va_end(ap);
+        if (ret == 0) {
+            return;
+        }
+    }
+    va_start(ap, fmt);
+    vasprintf(&buf, fmt, ap);
+    va_end(ap);
+
     if (buf) {
+        log_output(level, 0, buf);
         free(buf);
     }
 }
 
 #endif
+
+/*
+ * async mode: log_lprint() stores the format pointer, a timestamp and the
+ * raw arguments in a ring of the calling thread, without locks or
+ * allocations; formatting and output happen on a flush thread. The
+ * format must stay valid, which the string literals of log_print() do;
+ * %s arguments are copied (truncated to LOG_STR_MAX). A full ring drops
+ * the message and counts it, the flush thread reports the count.
+ * A format the capture does not understand is printed at once, as in
+ * sync mode.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define LOG_RING_DEF_SIZE   (32 * 1024)
+#define LOG_REC_MAX         1024
+#define LOG_STR_MAX         256
+#define LOG_LINE_MAX        1024
+#define LOG_FLUSH_MS        20
+#define LOG_ALIGN(x)        (((x) + 7) & ~7)
+
+enum {
+    LOG_ARG_INT = 0,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR,
+    LOG_ARG_COUNT,          /*%n, nothing printed*/
+};
+
+typedef struct log_rec {
+    unsigned int size;      /*whole record, 0 marks a pad to the ring end*/
+    int level;
+    const char *fmt;
+    long long ts_us;
+} log_rec_t;
+#define LOG_REC_HEAD        LOG_ALIGN(sizeof(log_rec_t))
+
+typedef struct log_ring {
+    struct log_ring *next;
+    char *buf;
+    unsigned int size;
+    volatile unsigned int head;     /*flush thread*/
+    volatile unsigned int tail;     /*owner thread*/
+    volatile unsigned int logged;
+    volatile unsigned int dropped;
+    unsigned int dropped_reported;
+    volatile int orphan;            /*owner exited*/
+} log_ring_t;
+
+static pthread_mutex_t log_async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_async_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t log_flushed_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t log_ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t log_ring_key;
+static log_ring_t *log_rings;
+static pthread_mutex_t log_new_lock = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t *log_new_rings;       /*not yet seen by the flush thread*/
+static unsigned int log_freed_logged;     /*counts of the rings of exited threads*/
+static unsigned int log_freed_dropped;
+static unsigned int log_ring_size = LOG_RING_DEF_SIZE;
+static pthread_t log_flush_tid;
+static int log_flush_running;
+static int log_flush_stop;
+static unsigned int log_flush_req;
+static unsigned int log_flush_done;
+
+static long long log_now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void log_ring_orphan(void *arg)
+{
+    ((log_ring_t *)arg)->orphan = 1;
+}
+
+static void log_ring_key_init(void)
+{
+    pthread_key_create(&log_ring_key, log_ring_orphan);
+}
+
+static log_ring_t *log_ring_get(void)
+{
+    log_ring_t *r;
+
+    pthread_once(&log_ring_once, log_ring_key_init);
+    r = (log_ring_t *)pthread_getspecific(log_ring_key);
+    if (r) {
+        return r;
+    }
+    r = malloc(sizeof(log_ring_t));
+    if (!r) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(log_ring_t));
+    r->size = log_ring_size;
+    r->buf = malloc(r->size);
+    if (!r->buf) {
+        free(r);
+        return NULL;
+    }
+    pthread_setspecific(log_ring_key, r);
+    /*not log_async_lock, the flush thread holds it while writing*/
+    pthread_mutex_lock(&log_new_lock);
+    r->next = log_new_rings;
+    log_new_rings = r;
+    pthread_mutex_unlock(&log_new_lock);
+    return r;
+}
+
+/*
+ * parses the conversion after a '%': returns its length, the argument
+ * type and the number of '*' width/precision arguments before it, -1 if
+ * not supported
+ */
+static int log_spec_parse(const char *p, int *type, int *stars)
+{
+    const char *s = p;
+    int l = 0, h = 0, big_l = 0;
+
+    *stars = 0;
+    while (*s && strchr("-+ #0'", *s)) {
+        s++;
+    }
+    if (*s == '*') {
+        (*stars)++;
+        s++;
+    }
+    while (*s >= '0' && *s <= '9') {
+        s++;
+    }
+    if (*s == '.') {
+        s++;
+        if (*s == '*') {
+            (*stars)++;
+            s++;
+        }
+        while (*s >= '0' && *s <= '9') {
+            s++;
+        }
+    }
+    for (;; s++) {
+        if (*s == 'l') {
+            l++;
+        } else if (*s == 'h') {
+            h++;
+        } else if (*s == 'q' || *s == 'j') {
+            l = 2;
+        } else if (*s == 'z' || *s == 't') {
+            l = 1;
+        } else if (*s == 'L') {
+            big_l = 1;
+        } else {
+            break;
+        }
+    }
+    switch (*s) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        *type = l >= 2 ? LOG_ARG_LLONG : l == 1 ? LOG_ARG_LONG : LOG_ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        *type = big_l ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+        break;
+    case 'p':
+        *type = LOG_ARG_PTR;
+        break;
+    case 's':
+        if (l) {
+            return -1;      /*wide strings*/
+        }
+        *type = LOG_ARG_STR;
+        break;
+    case 'n':
+        *type = LOG_ARG_COUNT;
+        break;
+    default:
+        return -1;
+    }
+    return s - p + 1;
+}
+
+/*stores the arguments of fmt in out, 8 bytes each; strings as length and bytes*/
+static int log_args_capture(const char *fmt, va_list ap, char *out, int max)
+{
+    const char *p = fmt;
+    int len = 0, n, type, stars, i;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        n = log_spec_parse(p, &type, &stars);
+        if (n < 0) {
+            return -1;
+        }
+        p += n;
+        for (i = 0; i < stars; i++) {
+            if (len + 8 > max) {
+                return -1;
+            }
+            *(long long *)(out + len) = va_arg(ap, int);
+            len += 8;
+        }
+        if (len + 8 > max) {
+            return -1;
+        }
+        switch (type) {
+        case LOG_ARG_INT:
+            *(long long *)(out + len) = va_arg(ap, int);
+            break;
+        case LOG_ARG_LONG:
+            *(long long *)(out + len) = va_arg(ap, long);
+            break;
+        case LOG_ARG_LLONG:
+            *(long long *)(out + len) = va_arg(ap, long long);
+            break;
+        case LOG_ARG_DOUBLE:
+            *(double *)(out + len) = va_arg(ap, double);
+            break;
+        case LOG_ARG_LDOUBLE:
+            *(double *)(out + len) = (double)va_arg(ap, long double);
+            break;
+        case LOG_ARG_PTR:
+        case LOG_ARG_COUNT:
+            *(void **)(out + len) = va_arg(ap, void *);
+            break;
+        case LOG_ARG_STR: {
+            const char *str = va_arg(ap, const char *);
+            int slen;
+            if (!str) {
+                str = "(null)";
+            }
+            slen = strnlen(str, LOG_STR_MAX - 1);
+            if (len + 8 + slen + 1 > max) {
+                slen = max - len - 8 - 1;
+                if (slen < 0) {
+                    return -1;
+                }
+            }
+            *(long long *)(out + len) = slen + 1;
+            memcpy(out + len + 8, str, slen);
+            out[len + 8 + slen] = '\0';
+            len += LOG_ALIGN(slen + 1);
+            break;
+        }
+        }
+        len += 8;
+    }
+    return len;
+}
+
+/*formats a captured record, the inverse of log_args_capture()*/
+static void log_args_format(const char *fmt, const char *args, char *out, int max)
+{
+    const char *p = fmt, *q;
+    char spec[64];
+    int len = 0, n, type, stars, star[2], i, ret;
+
+    out[0] = '\0';
+    while (*p && len < max - 1) {
+        q = strchr(p, '%');
+        if (!q) {
+            q = p + strlen(p);
+        }
+        n = q - p;
+        if (n > max - 1 - len) {
+            n = max - 1 - len;
+        }
+        memcpy(out + len, p, n);
+        len += n;
+        out[len] = '\0';
+        if (!*q) {
+            break;
+        }
+        p = q + 1;
+        if (*p == '%') {
+            out[len++] = '%';
+            out[len] = '\0';
+            p++;
+            continue;
+        }
+        n = log_spec_parse(p, &type, &stars);
+        if (n < 0 || n + 2 > (int)sizeof(spec)) {
+            break;
+        }
+        spec[0] = '%';
+        for (i = 0, ret = 1; i < n; i++) {
+            if (p[i] != 'L') {
+                spec[ret++] = p[i];     /*long double was stored as double*/
+            }
+        }
+        spec[ret] = '\0';
+        p += n;
+        for (i = 0; i < stars; i++) {
+            star[i] = (int) * (const long long *)args;
+            args += 8;
+        }
+#define LOG_FMT_ARG(v)\
+        (stars == 2 ? snprintf(out + len, max - len, spec, star[0], star[1], v) :\
+         stars == 1 ? snprintf(out + len, max - len, spec, star[0], v) :\
+         snprintf(out + len, max - len, spec, v))
+        switch (type) {
+        case LOG_ARG_INT:
+            ret = LOG_FMT_ARG((int) * (const long long *)args);
+            break;
+        case LOG_ARG_LONG:
+            ret = LOG_FMT_ARG((long) * (const long long *)args);
+            break;
+        case LOG_ARG_LLONG:
+            ret = LOG_FMT_ARG(*(const long long *)args);
+            break;
+        case LOG_ARG_DOUBLE:
+        case LOG_ARG_LDOUBLE:
+            ret = LOG_FMT_ARG(*(const double *)args);
+            break;
+        case LOG_ARG_PTR:
+            ret = LOG_FMT_ARG(*(void * const *)args);
+            break;
+        case LOG_ARG_STR:
+            ret = LOG_FMT_ARG(args + 8);
+            args += LOG_ALIGN((int) * (const long long *)args);
+            break;
+        default:
+            ret = 0;
+            break;
+        }
+#undef LOG_FMT_ARG
+        args += 8;
+        if (ret > 0) {
+            len += ret < max - len ? ret : max - 1 - len;
+        }
+    }
+}
+
+static int log_async_vput(int level, const char *fmt, va_list ap)
+{
+    char args[LOG_REC_MAX - LOG_REC_HEAD];
+    log_ring_t *r = log_ring_get();
+    log_rec_t *rec;
+    unsigned int need, pos, room;
+    int len;
+
+    if (!r) {
+        return -1;
+    }
+    len = log_args_capture(fmt, ap, args, sizeof(args));
+    if (len < 0) {
+        return -1;
+    }
+    need = LOG_REC_HEAD + len;
+    pos = r->tail & (r->size - 1);
+    room = r->size - pos;
+    if (r->size - (r->tail - r->head) < need + (room < need ? room : 0)) {
+        r->dropped++;
+        return 0;
+    }
+    if (room < need) {
+        /*no wrapped records, pad to the end*/
+        ((log_rec_t *)(r->buf + pos))->size = 0;
+        pos = 0;
+        need += room;
+    }
+    rec = (log_rec_t *)(r->buf + pos);
+    rec->size = LOG_REC_HEAD + len;
+    rec->level = level;
+    rec->fmt = fmt;
+    rec->ts_us = log_now_us();
+    memcpy(r->buf + pos + LOG_REC_HEAD, args, len);
+    __sync_synchronize();
+    r->tail += need;
+    r->logged++;
+    if (level <= AM_LOG_ERROR) {
+        pthread_cond_signal(&log_async_cond);
+    }
+    return 0;
+}
+
+/*next record of r, NULL if empty; skips the pad at the ring end*/
+static log_rec_t *log_ring_peek(log_ring_t *r)
+{
+    unsigned int pos, room;
+    log_rec_t *rec;
+
+    if (r->head == r->tail) {
+        return NULL;
+    }
+    __sync_synchronize();
+    pos = r->head & (r->size - 1);
+    room = r->size - pos;
+    rec = (log_rec_t *)(r->buf + pos);
+    if (room < LOG_REC_HEAD || rec->size == 0) {
+        r->head += room;
+        if (r->head == r->tail) {
+            return NULL;
+        }
+        rec = (log_rec_t *)r->buf;
+    }
+    return rec;
+}
+
+/*outputs everything queued, oldest first across the threads; called with log_async_lock*/
+static void log_async_drain(void)
+{
+    char line[LOG_LINE_MAX];
+    log_ring_t *r, *oldest, **pp;
+    log_rec_t *rec, *first;
+
+    pthread_mutex_lock(&log_new_lock);
+    while ((r = log_new_rings) != NULL) {
+        log_new_rings = r->next;
+        r->next = log_rings;
+        log_rings = r;
+    }
+    pthread_mutex_unlock(&log_new_lock);
+    for (;;) {
+        oldest = NULL;
+        first = NULL;
+        for (r = log_rings; r; r = r->next) {
+            rec = log_ring_peek(r);
+            if (rec && (!first || rec->ts_us < first->ts_us)) {
+                first = rec;
+                oldest = r;
+            }
+        }
+        if (!first) {
+            break;
+        }
+        log_args_format(first->fmt, (const char *)first + LOG_REC_HEAD, line, sizeof(line));
+        log_output(first->level, first->ts_us, line);
+        __sync_synchronize();
+        oldest->head += first->size;
+    }
+    for (pp = &log_rings; (r = *pp) != NULL;) {
+        if (r->dropped != r->dropped_reported) {
+            snprintf(line, sizeof(line), "[log]%u messages dropped\n", r->dropped - r->dropped_reported);
+            r->dropped_reported = r->dropped;
+            log_output(AM_LOG_WARNING, 0, line);
+        }
+        if (r->orphan && r->head == r->tail) {
+            *pp = r->next;
+            log_freed_logged += r->logged;
+            log_freed_dropped += r->dropped;
+            free(r->buf);
+            free(r);
+        } else {
+            pp = &r->next;
+        }
+    }
+}
+
+static void *log_flush_thread(void *arg)
+{
+    struct timespec ts;
+    struct timeval now;
+    unsigned int req;
+
+    pthread_mutex_lock(&log_async_lock);
+    while (!log_flush_stop) {
+        gettimeofday(&now, NULL);
+        ts.tv_sec = now.tv_sec;
+        ts.tv_nsec = (now.tv_usec + LOG_FLUSH_MS * 1000) * 1000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&log_async_cond, &log_async_lock, &ts);
+        req = log_flush_req;
+        log_async_drain();
+        log_flush_done = req;
+        pthread_cond_broadcast(&log_flushed_cond);
+    }
+    log_async_drain();
+    log_flush_done = log_flush_req;
+    pthread_cond_broadcast(&log_flushed_cond);
+    pthread_mutex_unlock(&log_async_lock);
+    return NULL;
+}
+
+int log_async_start(int ring_size)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&log_async_lock);
+    if (!log_flush_running) {
+        if (ring_size >= 4096) {
+            /*power of two for the index masks*/
+            for (log_ring_size = 4096; log_ring_size * 2 <= (unsigned int)ring_size; log_ring_size *= 2) {
+                ;
+            }
+        }
+        log_flush_stop = 0;
+        ret = pthread_create(&log_flush_tid, NULL, log_flush_thread, NULL);
+        log_flush_running = ret == 0;
+    }
+    log_async_on = log_flush_running;
+    pthread_mutex_unlock(&log_async_lock);
+    return ret ? -1 : 0;
+}
+
+void log_async_stop(void)
+{
+    pthread_mutex_lock(&log_async_lock);
+    log_async_on = 0;
+    if (!log_flush_running) {
+        pthread_mutex_unlock(&log_async_lock);
+        return;
+    }
+    log_flush_stop = 1;
+    log_flush_running = 0;
+    pthread_cond_signal(&log_async_cond);
+    pthread_mutex_unlock(&log_async_lock);
+    pthread_join(log_flush_tid, NULL);
+}
+
+void log_flush(void)
+{
+    unsigned int req;
+
+    pthread_mutex_lock(&log_async_lock);
+    if (log_flush_running) {
+        req = ++log_flush_req;
+        pthread_cond_signal(&log_async_cond);
+        while ((int)(log_flush_done - req) < 0 && log_flush_running) {
+            pthread_cond_wait(&log_flushed_cond, &log_async_lock);
+        }
+    }
+    pthread_mutex_unlock(&log_async_lock);
+}
+
+void log_async_get_stats(unsigned int *logged, unsigned int *dropped)
+{
+    log_ring_t *r;
+
+    pthread_mutex_lock(&log_async_lock);
+    pthread_mutex_lock(&log_new_lock);
+    *logged = log_freed_logged;
+    *dropped = log_freed_dropped;
+    for (r = log_rings; r; r = r->next) {
+        *logged += r->logged;
+        *dropped += r->dropped;
+    }
+    for (r = log_new_rings; r; r = r->next) {
+        *logged += r->logged;
+        *dropped += r->dropped;
+    }
+    pthread_mutex_unlock(&log_new_lock);
+    pthread_mutex_unlock(&log_async_lock);
+}
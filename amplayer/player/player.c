@@ -23,6 +23,7 @@
 #include "stream_decoder.h"
 #include "player_ffmpeg_ctrl.h"
 #include <amconfigutils.h>
+#include <amtrace.h>
 
 
 /******************************
@@ -96,6 +97,9 @@ static int player_para_release(play_para_t *para)
 
 
 
+    player_kfindex_stop(para);
+    player_jitterbuf_stop(para);
+
     if (para->file_name) {
         FREE(para->file_name);
         para->file_name = NULL;
@@ -335,6 +339,8 @@ void check_msg(play_para_t *para, player_cmd_t *msg)
             para->playctrl_info.seek_keyframe = 1;
             para->state.seek_point = msg->f_param;
             para->state.seek_delay = 1000;
+            amtrace_begin(AMTRACE_SEEK);
+            para->trace_wait_pts |= 1 << AMTRACE_SEEK;
         } else if(msg->f_param < 0){
             log_print("pid[%d]::seek reset\n", para->player_id);
             para->playctrl_info.reset_flag= 1;
@@ -759,6 +765,7 @@ void update_player_start_paras(play_para_t *p_para, play_control_t *c_para)
         }
     }
     player_get_vdec_profile(&p_para->vdec_profile, 0);
+    player_status_snap_init(p_para);
     log_print("pid[%d]::Init State: mute_on=%d black=%d t_pos:%ds read_max_cnt=%d\n",
               p_para->player_id,
               p_para->playctrl_info.audio_mute,
@@ -843,6 +850,34 @@ static void player_para_init(play_para_t *para)
     para->state.seek_delay = 0;
 }
 
+/* end the startup/seek phase once the decoder outputs its first pts */
+static void trace_check_first_pts(play_para_t *player)
+{
+    unsigned int pts;
+
+    if (!player->trace_wait_pts) {
+        return;
+    }
+    if (player->vstream_info.has_video) {
+        pts = get_pts_video(player);
+    } else if (player->astream_info.has_audio) {
+        pts = get_pts_audio(player);
+    } else {
+        return;
+    }
+    if (pts == 0 || pts == (unsigned int)-1 || pts == player->trace_pts_ref) {
+        return;
+    }
+    if (player->trace_wait_pts & (1 << AMTRACE_STARTUP)) {
+        amtrace_mark_once(AMTRACE_FIRST_PTS);
+        amtrace_end(AMTRACE_STARTUP);
+        player->trace_wait_pts &= ~(1 << AMTRACE_STARTUP);
+    } else {
+        amtrace_end(AMTRACE_SEEK);
+        player->trace_wait_pts &= ~(1 << AMTRACE_SEEK);
+    }
+}
+
 ///////////////////*main function *//////////////////////////////////////
 void *player_thread(play_para_t *player)
 {
@@ -852,6 +887,7 @@ void *player_thread(play_para_t *player)
     int ret;
     unsigned int exit_flag = 0;
     pkt = &am_pkt;
+    memset(&am_pkt, 0, sizeof(am_pkt));
     player_file_type_t filetype;
 
     //#define SAVE_YUV_FILE
@@ -868,6 +904,9 @@ void *player_thread(play_para_t *player)
     char *audio_out_buf=NULL;
     int  audio_out_size=0;
     log_print("\npid[%d]::enter into player_thread\n", player->player_id);
+    amtrace_session_open(player->player_id);
+    amtrace_begin(AMTRACE_STARTUP);
+    player->trace_wait_pts = 1 << AMTRACE_STARTUP;
 
     update_player_start_paras(player, player->start_param);
     player_para_init(player);
@@ -883,7 +922,9 @@ void *player_thread(play_para_t *player)
     update_player_states(player, 1);
 
     /*start open file and get file type*/
+    amtrace_begin(AMTRACE_OPEN);
     ret = ffmpeg_open_file(player);
+    amtrace_end(AMTRACE_OPEN);
     if (ret != FFMPEG_SUCCESS) {
         set_player_state(player, PLAYER_ERROR);
         send_event(player, PLAYER_EVENTS_ERROR, ret, "Open File failed");
@@ -905,7 +946,9 @@ void *player_thread(play_para_t *player)
         }
     }
     log_print("pid[%d]::parse ok , prepare parameters\n", player->player_id);
+    amtrace_begin(AMTRACE_DEC_INIT);
     ret = player_dec_init(player);
+    amtrace_end(AMTRACE_DEC_INIT);
     if (ret != PLAYER_SUCCESS) {
         if (check_stop_cmd(player) == 1) {
             set_player_state(player, PLAYER_STOPED);
@@ -921,6 +964,7 @@ void *player_thread(play_para_t *player)
         set_player_state(player, PLAYER_ERROR);
         goto release0;
     }
+    player_kfindex_start(player);
 
     float config_value = 0.0;
     int maxbufsize = 2*1024*1024;
@@ -1035,7 +1079,9 @@ void *player_thread(play_para_t *player)
     }
     
     log_print("pid[%d]::decoder prepare\n", player->player_id);
+    amtrace_begin(AMTRACE_DECODER_INIT);
     ret = player_decoder_init(player);
+    amtrace_end(AMTRACE_DECODER_INIT);
     if (ret != PLAYER_SUCCESS) {
         log_error("pid[%d]::player_decoder_init failed!\n", player->player_id);
         set_player_state(player, PLAYER_ERROR);
@@ -1126,7 +1172,9 @@ void *player_thread(play_para_t *player)
              && !(player->vstream_info.video_format == VFORMAT_VC1 && player->vstream_info.video_codec_type == VIDEO_DEC_FORMAT_WMV3)) || \
             (IS_AUIDO_NEED_PREFEED_HEADER(player->astream_info.audio_format) && player->astream_info.has_audio) ||
             (IS_SUB_NEED_PREFEED_HEADER(player->sstream_info.sub_type) && player->sstream_info.has_sub)) {
+            amtrace_begin(AMTRACE_HEADER_FEED);
             pre_header_feeding(player);
+            amtrace_end(AMTRACE_HEADER_FEED);
         }
         do {
             /* if is karaok play, we slow down the player thread*/
@@ -1262,6 +1310,7 @@ write_packet:
             }
             update_playing_info(player);
             update_player_states(player, 0);
+            trace_check_first_pts(player);
             if (check_decoder_worksta(player) != PLAYER_SUCCESS) {
                 log_error("pid[%d]::check decoder work status error!\n", player->player_id);
                 set_player_state(player, PLAYER_ERROR);
@@ -1356,7 +1405,16 @@ write_packet:
                 update_player_states(player, 1);
             }
 
+            if (player->playctrl_info.search_flag) {
+                amtrace_begin(AMTRACE_SEEK_RESET);
+            }
             ret = player_reset(player);
+            amtrace_end(AMTRACE_SEEK_RESET);
+            if (player->vstream_info.has_video) {
+                player->trace_pts_ref = get_pts_video(player);
+            } else if (player->astream_info.has_audio) {
+                player->trace_pts_ref = get_pts_audio(player);
+            }
             if (ret != PLAYER_SUCCESS) {
                 log_error("pid[%d]::player reset failed(-0x%x)!", player->player_id, -ret);
                 set_player_state(player, PLAYER_ERROR);
@@ -1435,6 +1493,7 @@ release0:
     player_para_release(player);
     set_player_state(player, PLAYER_EXIT);
     update_player_states(player, 1);
+    amtrace_session_close(player->player_id);
     log_print("\npid[%d]::stop play, exit player thead!(sta:0x%x)\n", player->player_id, get_player_state(player));
     pthread_exit(NULL);
 
@@ -17,8 +17,12 @@
 #include "h263vld.h"
 #include "thread_mgt.h"
 #include "player_update.h"
+#include "player_kfindex.h"
+#include "player_jitterbuf.h"
+#include "player_cache_mgt.h"
 #include <cutils/properties.h>
 #include <amconfigutils.h>
+#include <amtrace.h>
 
 #define DUMP_READ_RAW_DATA     (1<<0)
 #define DUMP_WRITE_RAW_DATA   (1<<1)
@@ -28,6 +32,7 @@
 #define DUMP_WRITE_ES_AUDIO       (1<<5)
 
 #include <fcntl.h>
+#include <sys/stat.h>
 int fdr_raw = -1, fdr_video = -1, fdr_audio = -1;
 int fdw_raw = -1, fdw_video = -1, fdw_audio = -1;
 static char dump_dir[64]="/data/tmp/";
@@ -685,7 +690,20 @@ static int raw_read(play_para_t *para)
             }
         }
 		
-        rev_byte = get_buffer(pb, pbuf, tryread_size);
+        if (para->playctrl_info.lowbuffermode_flag && !para->jitterbuf) {
+            player_jitterbuf_start(para);
+        }
+        if (para->jitterbuf) {
+            int wait_us = 0;
+            rev_byte = jitterbuf_get(para->jitterbuf, pbuf, tryread_size, jitterbuf_now_us(), &wait_us);
+            if (rev_byte == 0) {
+                /*data not due yet or still on the way, not a read failure*/
+                player_thread_wait(para, wait_us);
+                return PLAYER_RD_AGAIN;
+            }
+        } else {
+            rev_byte = get_buffer(pb, pbuf, tryread_size);
+        }
         log_debug1("get_buffer,%d,cur_offset=%lld,para->pFormatCtx->valid_offset==%lld\n", rev_byte , cur_offset, para->pFormatCtx->valid_offset);
         if (AVERROR(ETIMEDOUT) == rev_byte && para->state.current_time >= para->state.full_time) {
             //read timeout ,if playing current time reached end time,we think it is eof
@@ -1367,7 +1385,160 @@ int update_variable_info(play_para_t *para)
 }
 #endif
 
+/*
+ * local ts/ps/es files have no index, start a background keyframe scan
+ * so seek and ff/fb can jump straight to I-frames once it covers them.
+ */
+int player_kfindex_start(play_para_t *para)
+{
+    const char *name = para->file_name;
+    char dir[256 + 16];
+    int container, codec, frame_dur;
+
+    if (para->kfindex || !name || !para->vstream_info.has_video ||
+        !am_getconfig_bool_def("media.libplayer.kfindex", 1)) {
+        return -1;
+    }
+    if (!strncmp(name, "file://", 7)) {
+        name += 7;
+    }
+    if (name[0] != '/') {
+        return -1;
+    }
+    if (para->file_type == MPEG_FILE || para->file_type == STREAM_FILE) {
+        if (para->stream_type == STREAM_TS || !strcmp(para->pFormatCtx->iformat->name, "mpegts")) {
+            container = KFINDEX_CONTAINER_TS;
+        } else if (para->stream_type == STREAM_PS || !strcmp(para->pFormatCtx->iformat->name, "mpeg")) {
+            container = KFINDEX_CONTAINER_PS;
+        } else {
+            return -1;
+        }
+    } else if (para->file_type == H264_FILE || para->file_type == M2V_FILE) {
+        container = KFINDEX_CONTAINER_ES;
+    } else {
+        return -1;
+    }
+    if (para->vstream_info.video_format == VFORMAT_H264) {
+        codec = KFINDEX_CODEC_H264;
+    } else if (para->vstream_info.video_format == VFORMAT_MPEG12) {
+        codec = KFINDEX_CODEC_MPEG2;
+    } else if (para->vstream_info.video_format == VFORMAT_HEVC) {
+        codec = KFINDEX_CODEC_HEVC;
+    } else {
+        return -1;
+    }
+    /* video_rate is in 96KHz units per frame */
+    frame_dur = para->vstream_info.video_rate * 15 / 16;
+    /* cache_system_init clears the files of the cache dir, keep a sub dir;
+     * without a cache dir the index is only kept for this play */
+    dir[0] = '\0';
+    if (cache_system_get_dir() && cache_system_get_dir()[0]) {
+        snprintf(dir, sizeof(dir), "%s/kfindex", cache_system_get_dir());
+        if (access(dir, F_OK) != 0 && mkdir(dir, 0770) != 0) {
+            dir[0] = '\0';
+        }
+    }
+    para->kfindex = kfindex_open(name, container, codec, para->vstream_info.video_pid,
+                                 frame_dur, dir);
+    log_print("[%s]%s container %d codec %d index %p\n", __FUNCTION__, name, container, codec, para->kfindex);
+    return para->kfindex ? 0 : -1;
+}
+
+void player_kfindex_stop(play_para_t *para)
+{
+    if (para->kfindex) {
+        kfindex_close(para->kfindex);
+        para->kfindex = NULL;
+    }
+}
+
+static int player_jitterbuf_read(void *opaque, uint8_t *buf, int size)
+{
+    ByteIOContext *pb = (ByteIOContext *)opaque;
+    int ret = get_buffer(pb, buf, size);
+
+    if (ret == AVERROR(EAGAIN) || (ret < 0 && url_interrupt_cb())) {
+        /*nothing yet, or interrupted: player_jitterbuf_stop ends the thread*/
+        return 0;
+    }
+    return ret;
+}
+
+/*
+ * live ts in low buffer mode: read the input from its own thread into a
+ * PCR paced jitter buffer, raw_read then takes data as it becomes due.
+ * target latency is media.libplayer.jitterbuf_ms over the fastest path.
+ */
+int player_jitterbuf_start(play_para_t *para)
+{
+    ByteIOContext *pb = para->pFormatCtx ? para->pFormatCtx->pb : NULL;
+    int target_ms;
+
+    if (para->jitterbuf || !pb || !pb->is_streamed || para->stream_type != STREAM_TS ||
+        !am_getconfig_bool_def("media.libplayer.jitterbuf", 1)) {
+        return -1;
+    }
+    target_ms = (int)am_getconfig_float_def("media.libplayer.jitterbuf_ms", 200);
+    if (target_ms <= 0) {
+        return -1;
+    }
+    para->jitterbuf = jitterbuf_open(target_ms, 0);
+    if (para->jitterbuf && jitterbuf_start_input(para->jitterbuf, player_jitterbuf_read, pb) != 0) {
+        jitterbuf_close(para->jitterbuf);
+        para->jitterbuf = NULL;
+    }
+    log_print("[%s]target %dms jitterbuf %p\n", __FUNCTION__, target_ms, para->jitterbuf);
+    return para->jitterbuf ? 0 : -1;
+}
+
+void player_jitterbuf_stop(play_para_t *para)
+{
+    if (para->jitterbuf) {
+        jitterbuf_close(para->jitterbuf);
+        para->jitterbuf = NULL;
+    }
+}
+
+static int64_t player_kfindex_pts(play_para_t *para, float time_point)
+{
+    int64_t pts = (int64_t)(time_point * 90000);
+    if (para->file_type != H264_FILE && para->file_type != M2V_FILE &&
+        para->pFormatCtx->start_time != (int64_t)AV_NOPTS_VALUE) {
+        pts += para->pFormatCtx->start_time * 9 / 100;
+    }
+    return pts;
+}
+
+/*
+ * keyframe time at or before (dir <= 0) or after (dir > 0) time_point,
+ * used to step ff/fb on real I-frames. -1 when not indexed yet.
+ */
+int player_kfindex_snap(play_para_t *para, float time_point, int dir, float *key_time)
+{
+    kfindex_entry_t e;
+    int64_t pts = player_kfindex_pts(para, time_point);
+
+    if (!para->kfindex || kfindex_lookup(para->kfindex, pts, dir, &e) != 0) {
+        return -1;
+    }
+    *key_time = time_point + (float)(e.pts - pts) / 90000;
+    return 0;
+}
+
+static int time_search_in(play_para_t *am_p,int flags);
+
 int time_search(play_para_t *am_p,int flags)
+{
+    int ret;
+    amtrace_begin(AMTRACE_SEEK_STREAM);
+    /*the jitter buffer owns pb, stop it before seeking, raw_read restarts it*/
+    player_jitterbuf_stop(am_p);
+    ret = time_search_in(am_p, flags);
+    amtrace_end(AMTRACE_SEEK_STREAM);
+    return ret;
+}
+
+static int time_search_in(play_para_t *am_p,int flags)
 {
     AVFormatContext *s = am_p->pFormatCtx;
     float time_point = am_p->playctrl_info.time_point;
@@ -1428,6 +1599,22 @@ int time_search(play_para_t *am_p,int flags)
         temp = (unsigned int)(s->duration / AV_TIME_BASE);
         log_info("[time_search:%d]time_point =%f temp=%d duration= %lld\n", __LINE__, time_point, temp, s->duration);
     }
+    if (am_p->kfindex && stream_index < 0 && time_point >= 0 && !url_support_time_seek(s->pb)) {
+        kfindex_entry_t key;
+        int64_t pts = player_kfindex_pts(am_p, time_point);
+        if (kfindex_lookup(am_p->kfindex, pts, (seek_flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1, &key) == 0 ||
+            kfindex_lookup(am_p->kfindex, pts, -1, &key) == 0) {
+            ret = url_fseek(s->pb, key.offset, SEEK_SET);
+            if (ret >= 0) {
+                av_read_frame_flush(s);
+                log_info("[time_search:%d]indexed seek time_point=%f to keyframe pts 0x%llx offset 0x%llx\n",
+                         __LINE__, time_point, key.pts, key.offset);
+                ret = PLAYER_SUCCESS;
+                goto searchexit;
+            }
+            log_info("[time_search:%d]indexed seek to 0x%llx failed, searching\n", __LINE__, key.offset);
+        }
+    }
     /* if seeking requested, we execute it */
     if (url_support_time_seek(s->pb) && time_point >= 0) {
         log_info("[time_search:%d] direct seek to time_point =%f,seek_flags=%d\n", __LINE__, time_point,seek_flags);
@@ -2017,6 +2204,7 @@ int write_av_packet(play_para_t *para)
                 }
             } else  {
                 int dsize;
+                amtrace_mark_once(AMTRACE_FIRST_WRITE);
                 if (fdw_raw >= 0 && pkt->type == CODEC_COMPLEX) {
                     dsize = write(fdw_raw, buf, write_bytes);
                 } else {
@@ -2200,6 +2388,18 @@ int check_in_pts(play_para_t *para)
     return PLAYER_SUCCESS;
 }
 
+/* the demuxer may replace the video extradata mid stream, e.g. on a variant switch */
+static void nalpz_check_config(play_para_t *para, am_packet_t *pkt)
+{
+    AVCodecContext *avcodec;
+
+    if (para->vstream_info.video_index < 0) {
+        return;
+    }
+    avcodec = para->pFormatCtx->streams[para->vstream_info.video_index]->codec;
+    nal_packetizer_check_config(&pkt->nalpz, avcodec->extradata, avcodec->extradata_size);
+}
+
 int set_header_info(play_para_t *para)
 {
     int ret;
@@ -2221,6 +2421,7 @@ int set_header_info(play_para_t *para)
                 }	
 
                 if (!(para->p_pkt->avpkt->flags & AV_PKT_FLAG_ISDECRYPTINFO)){
+                    nalpz_check_config(para, pkt);
                     ret = h264_update_frame_header(pkt);
                     if (ret != PLAYER_SUCCESS) {
                         return ret;
@@ -2230,6 +2431,7 @@ int set_header_info(play_para_t *para)
             } else if(para->vstream_info.video_format == VFORMAT_HEVC
                  && para->file_type != STREAM_FILE) {
                 if (!(para->p_pkt->avpkt->flags & AV_PKT_FLAG_ISDECRYPTINFO)){
+                    nalpz_check_config(para, pkt);
                     ret = hevc_update_frame_header(pkt);
                     if (ret != PLAYER_SUCCESS) {
                         return ret;
@@ -2240,7 +2442,7 @@ int set_header_info(play_para_t *para)
                     return divx3_prefix(pkt);
                 } else if (para->vstream_info.video_codec_type == VIDEO_DEC_FORMAT_H263) {
                     unsigned char *vld_buf;
-                    int vld_len, vld_buf_size = para->vstream_info.video_width * para->vstream_info.video_height * 2;
+                    int vld_len, vld_buf_size = para->vstream_info.video_width * para->vstream_info.video_height * 2 + H263VLD_MB_MAX_OUT;
 
                     if (!pkt->data_size) {
                         return PLAYER_SUCCESS;
@@ -2250,13 +2452,20 @@ int set_header_info(play_para_t *para)
                         return PLAYER_SUCCESS;
                     }
 
-                    vld_buf = (unsigned char *)MALLOC(vld_buf_size);
-                    if (!vld_buf) {
-                        return PLAYER_NOMEM;
+                    /*reuse the buffer of the last rewritten frame,it has been written out*/
+                    if (pkt->buf && pkt->buf_size >= vld_buf_size &&
+                        (pkt->data < pkt->buf || pkt->data >= pkt->buf + pkt->buf_size)) {
+                        vld_buf = pkt->buf;
+                        vld_buf_size = pkt->buf_size;
+                    } else {
+                        vld_buf = (unsigned char *)MALLOC(vld_buf_size);
+                        if (!vld_buf) {
+                            return PLAYER_NOMEM;
+                        }
                     }
 
                     if (para->vstream_info.flv_flag) {
-                        vld_len = h263vld(pkt->data, vld_buf, pkt->data_size, 1);
+                        vld_len = h263vld(pkt->data, vld_buf, pkt->data_size, vld_buf_size, 1);
                     } else {
                         if (0 == para->vstream_info.h263_decodable) {
                             para->vstream_info.h263_decodable = decodeble_h263(pkt->data);
@@ -2274,21 +2483,25 @@ int set_header_info(play_para_t *para)
                                 }
                             }
                         }
-                        vld_len = h263vld(pkt->data, vld_buf, pkt->data_size, 0);
+                        vld_len = h263vld(pkt->data, vld_buf, pkt->data_size, vld_buf_size, 0);
                     }
                     //printf("###%02x %02x %02x %02x %02x %02x %02x %02x###\n", pkt->data[0], pkt->data[1], pkt->data[2], pkt->data[3], pkt->data[4], pkt->data[5], pkt->data[6], pkt->data[7]);
                     //printf("###pkt->data_size = %d, vld_buf_size = %d, vld_len = %d###\n", pkt->data_size, vld_buf_size, vld_len);
 
                     if (vld_len > 0) {
-                        if (pkt->buf) {
-                            FREE(pkt->buf);
+                        if (pkt->buf != vld_buf) {
+                            if (pkt->buf) {
+                                FREE(pkt->buf);
+                            }
+                            pkt->buf = vld_buf;
+                            pkt->buf_size = vld_buf_size;
                         }
-                        pkt->buf = vld_buf;
-                        pkt->buf_size = vld_buf_size;
                         pkt->data = pkt->buf;
                         pkt->data_size = vld_len;
                     } else {
-                        FREE(vld_buf);
+                        if (pkt->buf != vld_buf) {
+                            FREE(vld_buf);
+                        }
                         pkt->data_size = 0;
                     }
                 }else if (para->vstream_info.video_codec_type == VIDEO_DEC_FORMAT_MPEG4_4) {
@@ -2620,6 +2833,7 @@ void av_packet_release(am_packet_t *pkt)
         FREE(pkt->bak_spkt.data);
         pkt->bak_spkt.data = NULL;
     }
+    nal_packetizer_release(&pkt->nalpz);
     pkt->codec = NULL;
 }
 
@@ -3392,6 +3606,8 @@ void av_packet_init(am_packet_t *pkt)
     pkt->data_size  = 0;
     MEMSET(&pkt->bak_avpkt, 0, sizeof(AVPacket));
     MEMSET(&pkt->bak_spkt, 0, sizeof(AVPacket));
+    /* frees the buffers of a previous init, then resets */
+    nal_packetizer_release(&pkt->nalpz);
 }
 
 static void av_packet_reset(am_packet_t *pkt)
@@ -3448,6 +3664,7 @@ int check_avbuffer_enough(play_para_t *para)
             if(pkt->type == CODEC_AUDIO)
             log_print("[%s]type:%d data=%x size=%x total=%x\n", __FUNCTION__, pkt->type, para->abuffer.data_level,pkt->data_size,para->abuffer.buffer_size);
         */
+        player_status_snap_refresh_level(para, pkt->type);
         if (para->vstream_info.has_video && (pkt->type == CODEC_VIDEO) &&
             ((para->vbuffer.data_level + pkt->data_size) >= (para->vbuffer.buffer_size - VIDEO_RESERVED_SPACE))) {
             vbuf_enough = 0;
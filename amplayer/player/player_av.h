@@ -3,6 +3,7 @@
 
 #include "player_priv.h"
 #include "player_para.h"
+#include "player_nalpack.h"
 struct play_para;
 
 typedef int CODEC_TYPE;
@@ -43,6 +44,7 @@ typedef struct am_packet {
     codec_para_t *codec;
     AVPacket bak_avpkt;
     AVPacket bak_spkt;
+    nal_packetizer_t nalpz;
 } am_packet_t;
 
 
@@ -70,6 +72,11 @@ void player_switch_audio(play_para_t *para);
 void player_switch_sub(play_para_t *para);
 int get_cntl_state(am_packet_t *pkt);
 int time_search(struct play_para *para,int flags);
+int player_kfindex_start(play_para_t *para);
+void player_kfindex_stop(play_para_t *para);
+int player_kfindex_snap(play_para_t *para, float time_point, int dir, float *key_time);
+int player_jitterbuf_start(play_para_t *para);
+void player_jitterbuf_stop(play_para_t *para);
 int player_reset(play_para_t *p_para);
 int	check_avbuffer_enough(play_para_t *para);
 
@@ -222,6 +222,10 @@ int cache_system_init(int enable, const char*dir, int max_size, int block_size)
     return 0;
 }
 
+const char *cache_system_get_dir(void)
+{
+    return cache_setting.cache_dir;
+}
 
 int mgt_dir_cache_files(const char * dirpath, int del_flags)
 {
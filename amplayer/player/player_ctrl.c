@@ -28,6 +28,7 @@
 #include "player_cache_mgt.h"
 #include "player_priv.h"
 #include <amthreadpool.h>
+#include <amtrace.h>
 
 #ifndef FBIOPUT_OSD_SRCCOLORKEY
 #define  FBIOPUT_OSD_SRCCOLORKEY    0x46fb
@@ -906,6 +907,40 @@ int player_get_play_info(int pid, player_info_t *info)
     return PLAYER_SUCCESS;
 }
 /* --------------------------------------------------------------------------*/
+/**
+ * @function    player_get_trace_info
+ *
+ * @brief       get startup/seek phase latency percentiles
+ *
+ * @param[in]   pid     player tag which get from player_start return value,
+ *                      -1 for all players
+ * @param[in]   phase   phase to query, one of amtrace_phase_t
+ * @param[out]  info    trace info structure pointer
+ *
+ * @return      PLAYER_SUCCESS          success
+ *              PLAYER_FAILED           error,invalid phase
+ *
+ * @details     the last completed phases are kept after the player exits,
+ *              so the pid of a stopped player can still be queried.
+ */
+/* --------------------------------------------------------------------------*/
+int player_get_trace_info(int pid, int phase, player_trace_info_t *info)
+{
+    amtrace_stat_t stat;
+
+    if (info == NULL || amtrace_get_stat(pid, phase, &stat) < 0) {
+        return PLAYER_FAILED;
+    }
+    MEMSET(info, 0, sizeof(player_trace_info_t));
+    info->phase = phase;
+    info->count = stat.count;
+    info->p50_us = stat.p50_us;
+    info->p95_us = stat.p95_us;
+    info->p99_us = stat.p99_us;
+    info->max_us = stat.max_us;
+    return PLAYER_SUCCESS;
+}
+/* --------------------------------------------------------------------------*/
 /**
  * @function    player_get_lpbufbuffedsize
  *
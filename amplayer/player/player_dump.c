@@ -1,5 +1,6 @@
 #include "player_priv.h"
 #include "log_print.h"
+#include <amtrace.h>
 
 int player_dump_playinfo(int pid, int fd)
 {
@@ -78,3 +79,18 @@ int player_dump_tsyncinfo(int pid, int fd)
     player_close_pid_data(pid);
     return 0;
 }
+
+int player_dump_trace(int pid, int fd)
+{
+    log_print("player_dump_trace pid=%d fd=%d\n", pid, fd);
+    if(fd < 0){
+        log_error("[%s]Invalid handle fd\n", __FUNCTION__);
+        return -1;
+    }
+    /* chrome://tracing JSON of the startup/seek events of pid */
+    if (amtrace_dump_chrome(pid, fd) < 0) {
+        log_error("player_dump_trace error: no trace for pid[%d]\n", pid);
+        return PLAYER_NOT_VALID_PID;
+    }
+    return 0;
+}
@@ -17,6 +17,8 @@ static char format_string[128] = {0};
 static char vpx_string[8] = {0};
 static int ffmpeg_load_external_module();
 static int max_lock_time_s=30;
+static pthread_once_t external_module_once = PTHREAD_ONCE_INIT;
+static int external_module_loaded = 0;
 int ffmpeg_lock(void **pmutex, enum AVLockOp op)
 {
     int r = 0;
@@ -114,6 +116,26 @@ void ffmpeg_uninterrupt_light(pthread_t thread_id)
     amthreadpool_pool_thread_uncancel(thread_id);
 }
 
+static void ffmpeg_load_external_module_once(void)
+{
+    long start_ms = player_get_systemtime_ms();
+    external_module_loaded = (ffmpeg_load_external_module() == 0);
+    log_print("external modules %s,used %ld ms\n", external_module_loaded ? "loaded" : "not loaded",
+              player_get_systemtime_ms() - start_ms);
+}
+
+/*
+the external modules only register protocols (vhls:,mmsx:,curl:),
+so they are dlopened when an url asks for a protocol ffmpeg does not
+have instead of at init,which keeps their cost off the cold start.
+*/
+static int ffmpeg_protocol_loader(const char *name)
+{
+    log_print("no protocol %s,loading external modules\n", name);
+    pthread_once(&external_module_once, ffmpeg_load_external_module_once);
+    return external_module_loaded;
+}
+
 int ffmpeg_init(void)
 {
     if (basic_init > 0) {
@@ -121,7 +143,11 @@ int ffmpeg_init(void)
     }
     basic_init++;
     av_register_all();
-    ffmpeg_load_external_module();
+    if (am_getconfig_bool_def("media.libplayer.modules.lazy", 1)) {
+        avio_set_protocol_loader_cb(ffmpeg_protocol_loader);
+    } else {
+        pthread_once(&external_module_once, ffmpeg_load_external_module_once);
+    }
     av_lockmgr_register(ffmpeg_lock);
     url_set_interrupt_cb(ffmpeg_interrupt_callback);
     max_lock_time_s = (int)am_getconfig_float_def("media.amplayer.maxlocktime.s",30.0);
@@ -131,6 +157,10 @@ int ffmpeg_init(void)
 int ffmpeg_buffering_data(play_para_t *para)
 {
     int ret = -1;
+    if (para && para->jitterbuf) {
+        /*pb is read by the jitter buffer thread, it buffers on its own*/
+        return -1;
+    }
     if (para && para->pFormatCtx) {
         player_mate_wake(para, 100 * 1000);
         if (para->pFormatCtx->pb) { /*lpbuf buffering*/
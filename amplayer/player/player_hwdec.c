@@ -8,57 +8,6 @@
 #include "player_priv.h"
 #include "player_hwdec.h"
 
-static int check_size_in_buffer(unsigned char *p, int len)
-{
-    unsigned int size;
-    unsigned char *q = p;
-    while ((q + 4) < (p + len)) {
-        size = (*q << 24) | (*(q + 1) << 16) | (*(q + 2) << 8) | (*(q + 3));
-        if (size & 0xff000000) {
-            return 0;
-        }
-
-        if (q + size + 4 == p + len) {
-            return 1;
-        }
-
-        q += size + 4;
-    }
-    return 0;
-}
-
-static int check_size_in_buffer3(unsigned char *p, int len)
-{
-    unsigned int size;
-    unsigned char *q = p;
-    while ((q + 3) < (p + len)) {
-        size = (*q << 16) | (*(q + 1) << 8) | (*(q + 2));
-
-        if (q + size + 3 == p + len) {
-            return 1;
-        }
-
-        q += size + 3;
-    }
-    return 0;
-}
-
-static int check_size_in_buffer2(unsigned char *p, int len)
-{
-    unsigned int size;
-    unsigned char *q = p;
-    while ((q + 2) < (p + len)) {
-        size = (*q << 8) | (*(q + 1));
-
-        if (q + size + 2 == p + len) {
-            return 1;
-        }
-
-        q += size + 2;
-    }
-    return 0;
-}
-
 static const uint32_t sample_rates[] = {
     96000, 88200, 64000, 48000, 44100, 32000,
     24000, 22050, 16000, 12000, 11025, 8000
@@ -408,6 +357,8 @@ static int h264_write_header(play_para_t *para)
         ret = h264_add_header(avcodec->extradata, avcodec->extradata_size, pkt);
     }
     if (ret == PLAYER_SUCCESS) {
+        nal_packetizer_set_config(&pkt->nalpz, 0, avcodec->extradata, avcodec->extradata_size,
+                                  (unsigned char *)pkt->hdr->data, pkt->hdr->size);
         if (para->vcodec) {
             pkt->codec = para->vcodec;
         } else {
@@ -463,7 +414,7 @@ static int hevc_add_header(unsigned char *buf, int size,  am_packet_t *pkt)
          * can recognize hvcC by checking if extradata[0]==1 or not. */
         int i, j, num_arrays, nal_len_size;
         p += 21;  // skip 21 bytes
-        nal_len_size = *(p++) & 3 + 1;
+        nal_len_size = (*(p++) & 3) + 1;
         num_arrays   = *(p++);
         for (i = 0; i < num_arrays; i++) {
             int type = *(p++) & 0x3f;
@@ -511,6 +462,8 @@ static int hevc_write_header(play_para_t *para)
         ret = hevc_add_header(avcodec->extradata, avcodec->extradata_size, pkt);
     }
     if (ret == PLAYER_SUCCESS) {
+        nal_packetizer_set_config(&pkt->nalpz, 1, avcodec->extradata, avcodec->extradata_size,
+                                  (unsigned char *)pkt->hdr->data, pkt->hdr->size);
         if (para->vcodec) {
             pkt->codec = para->vcodec;
         } else {
@@ -1324,72 +1277,16 @@ int pre_header_feeding(play_para_t *para)
 
 int hevc_update_frame_header(am_packet_t * pkt)
 {
-    unsigned char *p = pkt->data;
-    // NAL has been formatted already, no need to update
-    if (p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1) {
-        return PLAYER_SUCCESS;
-    }
-    // process like h264 for now.
-    return h264_update_frame_header(pkt);
+    return nal_packetizer_convert(&pkt->nalpz, &pkt->data, &pkt->data_size);
 }
 
 int h264_update_frame_header(am_packet_t *pkt)
 {
-    int nalsize, size = pkt->data_size;
-    unsigned char *data = pkt->data;
-    unsigned char *p = data;
-    if (p != NULL) {
-        if (check_size_in_buffer(p, size)) {
-            while ((p + 4) < (data + size)) {
-                nalsize = (*p << 24) | (*(p + 1) << 16) | (*(p + 2) << 8) | (*(p + 3));
-                *p = 0;
-                *(p + 1) = 0;
-                *(p + 2) = 0;
-                *(p + 3) = 1;
-                p += (nalsize + 4);
-            }
-            return PLAYER_SUCCESS;
-        } else if (check_size_in_buffer3(p, size)) {
-            while ((p + 3) < (data + size)) {
-                nalsize = (*p << 16) | (*(p + 1) << 8) | (*(p + 2));
-                *p = 0;
-                *(p + 1) = 0;
-                *(p + 2) = 1;
-                p += (nalsize + 3);
-            }
-            return PLAYER_SUCCESS;
-        } else if (check_size_in_buffer2(p, size)) {
-            unsigned char *new_data;
-            int new_len = 0;
-
-            new_data = (unsigned char *)MALLOC(size + 2 * 1024);
-            if (!new_data) {
-                return PLAYER_NOMEM;
-            }
-
-            while ((p + 2) < (data + size)) {
-                nalsize = (*p << 8) | (*(p + 1));
-                *(new_data + new_len) = 0;
-                *(new_data + new_len + 1) = 0;
-                *(new_data + new_len + 2) = 0;
-                *(new_data + new_len + 3) = 1;
-                memcpy(new_data + new_len + 4, p + 2, nalsize);
-                p += (nalsize + 2);
-                new_len += nalsize + 4;
-            }
-
-            FREE(pkt->buf);
-
-            pkt->buf = new_data;
-            pkt->buf_size = size + 2 * 1024;
-            pkt->data = pkt->buf;
-            pkt->data_size = new_len;
-        }
-    } else {
+    if (pkt->data == NULL) {
         log_error("[%s]invalid pointer!\n", __FUNCTION__);
         return PLAYER_FAILED;
     }
-    return PLAYER_SUCCESS;
+    return nal_packetizer_convert(&pkt->nalpz, &pkt->data, &pkt->data_size);
 }
 
 int divx3_prefix(am_packet_t *pkt)
@@ -0,0 +1,437 @@
+/************************************************
+ * name :player_jitterbuf.c
+ * function :PCR paced input jitter buffer for live TS
+ * date     :2013.8.6
+ *************************************************/
+/*
+ * IPTV multicast reaches us with network jitter and bursts. Feeding it to
+ * the demux as it arrives either underflows the decoder on every gap or
+ * needs a big static buffer. jitterbuf stamps every chunk on arrival,
+ * recovers the sender clock from PCR (offset = sliding minimum of arrival
+ * time - PCR time, so only the fastest path counts) and hands data out at
+ * PCR time + offset + target. The output then follows the sender clock,
+ * including its drift, with a fixed latency of target over the fastest
+ * path.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <log_print.h>
+#include <amthreadpool.h>
+#include "player_jitterbuf.h"
+
+#define JB_DEF_SIZE         (4 * 1024 * 1024)
+#define JB_MAX_CHUNKS       8192
+#define JB_READ_SIZE        (188 * 7 * 4)
+#define JB_TS_PACKET        188
+#define JB_PCR_WRAP         ((1LL << 33) * 300)
+#define JB_PCR_JUMP_US      1000000     /* PCRs come at least every 100ms, 1s leaves slack for loose muxers */
+#define JB_WIN_BUCKETS      8
+#define JB_WIN_BUCKET_US    250000      /* 2s window for the minimum transit */
+#define JB_OFFSET_SHIFT     5           /* offset IIR, ~1s at 25 PCR/s */
+#define JB_MIN_WAIT_US      1000
+#define JB_MAX_WAIT_US      10000
+#define JB_IDLE_WAIT_US     2000
+#define JB_FULL_WAIT_US     5000
+#define JB_STATS_PERIOD_US  10000000
+
+typedef struct {
+    int64_t release;    ///< local time the chunk is due
+    int size;           ///< bytes left to hand out
+} jb_chunk_t;
+
+struct jitterbuf {
+    pthread_mutex_t lock;
+    uint8_t *buf;
+    int size;
+    int64_t wpos;       ///< total bytes taken in, ring index is pos % size
+    int64_t rpos;       ///< total bytes handed out
+    jb_chunk_t *chunks;
+    int chunk_head;
+    int chunk_count;
+    int target_us;
+    int64_t last_release;
+
+    /* ts parser */
+    int skip;           ///< bytes of a packet split over the previous chunk
+
+    /* sender clock */
+    int pcr_pid;
+    int pcr_seen;
+    int64_t pcr_raw;    ///< last PCR, 27MHz
+    int64_t pcr_us;     ///< last PCR on the unwrapped stream timeline
+    int64_t pcr_pos;
+    int64_t rate;       ///< bytes/s between PCRs, 0 until known
+    int64_t offset;     ///< smoothed local - stream time, us
+    int offset_valid;
+    int64_t win_min[JB_WIN_BUCKETS];
+    int win_idx;
+    int win_used;
+    int64_t win_start;
+    int64_t last_transit;
+    int64_t jitter;     ///< RFC 3550 estimate scaled by 16
+
+    /* statistics */
+    int max_delay_var;
+    int underruns;
+    int overruns;
+    int late_chunks;
+    int discontinuities;
+    int in_underrun;
+    int in_overrun;
+    int delivered;
+
+    /* input thread */
+    jitterbuf_read_fn read;
+    void *opaque;
+    pthread_t thread;
+    int thread_started;
+    volatile int abort;
+    int input_error;
+};
+
+int64_t jitterbuf_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+jitterbuf_t *jitterbuf_open(int target_ms, int size)
+{
+    jitterbuf_t *jb = calloc(1, sizeof(jitterbuf_t));
+
+    if (!jb) {
+        return NULL;
+    }
+    jb->size = size > 0 ? size : JB_DEF_SIZE;
+    jb->buf = malloc(jb->size);
+    jb->chunks = malloc(JB_MAX_CHUNKS * sizeof(jb_chunk_t));
+    if (!jb->buf || !jb->chunks) {
+        free(jb->buf);
+        free(jb->chunks);
+        free(jb);
+        return NULL;
+    }
+    jb->target_us = target_ms * 1000;
+    jb->pcr_pid = -1;
+    pthread_mutex_init(&jb->lock, NULL);
+    return jb;
+}
+
+void jitterbuf_close(jitterbuf_t *jb)
+{
+    if (!jb) {
+        return;
+    }
+    if (jb->thread_started) {
+        jb->abort = 1;
+        amthreadpool_thread_cancel(jb->thread);
+        amthreadpool_pthread_join(jb->thread, NULL);
+    }
+    pthread_mutex_destroy(&jb->lock);
+    free(jb->buf);
+    free(jb->chunks);
+    free(jb);
+}
+
+/* stream time of byte pos, extrapolated from the last PCR */
+static int64_t jb_stream_time(jitterbuf_t *jb, int64_t pos)
+{
+    return jb->pcr_us + (pos - jb->pcr_pos) * 1000000 / jb->rate;
+}
+
+static int64_t jb_window_min(jitterbuf_t *jb)
+{
+    int64_t m = jb->win_min[0];
+    int i;
+
+    for (i = 1; i < jb->win_used; i++) {
+        if (jb->win_min[i] < m) {
+            m = jb->win_min[i];
+        }
+    }
+    return m;
+}
+
+static void jb_clock_update(jitterbuf_t *jb, int64_t pcr, int disc, int64_t pos, int64_t arrival)
+{
+    int64_t delta, stream, transit, min;
+
+    if (!jb->pcr_seen) {
+        /* first PCR anchors the stream timeline */
+        jb->pcr_seen = 1;
+        jb->pcr_raw = pcr;
+        jb->pcr_us = 0;
+        jb->pcr_pos = pos;
+        return;
+    }
+    delta = pcr - jb->pcr_raw;
+    if (delta < -JB_PCR_WRAP / 2) {
+        delta += JB_PCR_WRAP;
+    }
+    delta /= 27;
+    if (disc || delta <= 0 || delta > JB_PCR_JUMP_US) {
+        /* keep the timeline continuous over the jump, the next PCR measures the rate again */
+        jb->discontinuities++;
+        jb->pcr_raw = pcr;
+        if (jb->rate > 0) {
+            jb->pcr_us = jb_stream_time(jb, pos);
+        }
+        jb->pcr_pos = pos;
+        return;
+    }
+    stream = jb->pcr_us + delta;
+    if (pos > jb->pcr_pos) {
+        int64_t inst = (pos - jb->pcr_pos) * 1000000 / delta;
+        jb->rate = jb->rate ? jb->rate + (inst - jb->rate) / 8 : inst;
+    }
+    jb->pcr_raw = pcr;
+    jb->pcr_us = stream;
+    jb->pcr_pos = pos;
+    if (jb->rate <= 0) {
+        return;
+    }
+
+    transit = arrival - stream;
+    if (!jb->win_used || arrival - jb->win_start >= JB_WIN_BUCKET_US) {
+        jb->win_idx = (jb->win_idx + 1) % JB_WIN_BUCKETS;
+        jb->win_min[jb->win_idx] = transit;
+        jb->win_start = arrival;
+        if (jb->win_used < JB_WIN_BUCKETS) {
+            jb->win_used++;
+        }
+    } else if (transit < jb->win_min[jb->win_idx]) {
+        jb->win_min[jb->win_idx] = transit;
+    }
+    min = jb_window_min(jb);
+    if (!jb->offset_valid) {
+        jb->offset = transit;
+        jb->offset_valid = 1;
+    } else {
+        jb->offset += (min - jb->offset) >> JB_OFFSET_SHIFT;
+        delta = transit - jb->last_transit;
+        jb->jitter += (delta < 0 ? -delta : delta) - (jb->jitter >> 4);
+    }
+    jb->last_transit = transit;
+    if (transit - min > jb->max_delay_var) {
+        jb->max_delay_var = (int)(transit - min);
+    }
+}
+
+/* find the PCRs of the chunk, pos is the stream position of data[0] */
+static void jb_parse_ts(jitterbuf_t *jb, const uint8_t *data, int size, int64_t pos, int64_t arrival)
+{
+    int i = jb->skip;
+
+    while (i < size) {
+        const uint8_t *p = data + i;
+        int pid;
+
+        if (p[0] != 0x47) {
+            i++;
+            continue;
+        }
+        if (i + 12 <= size && (p[3] & 0x20) && p[4] >= 7 && (p[5] & 0x10)) {
+            pid = ((p[1] & 0x1f) << 8) | p[2];
+            if (jb->pcr_pid < 0 || jb->pcr_pid == pid) {
+                int64_t base = ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1) | (p[10] >> 7);
+                int64_t pcr = base * 300 + (((p[10] & 1) << 8) | p[11]);
+                jb_clock_update(jb, pcr, p[5] & 0x80, pos + i, arrival);
+                jb->pcr_pid = pid;
+            }
+        }
+        i += JB_TS_PACKET;
+    }
+    jb->skip = i - size;
+}
+
+int jitterbuf_put(jitterbuf_t *jb, const uint8_t *data, int size, int64_t arrival_us)
+{
+    jb_chunk_t *c;
+    int64_t release;
+    int off, n;
+
+    pthread_mutex_lock(&jb->lock);
+    if (jb->wpos - jb->rpos + size > jb->size || jb->chunk_count >= JB_MAX_CHUNKS) {
+        if (!jb->in_overrun) {
+            jb->overruns++;
+            jb->in_overrun = 1;
+        }
+        pthread_mutex_unlock(&jb->lock);
+        return 0;
+    }
+    jb->in_overrun = 0;
+
+    jb_parse_ts(jb, data, size, jb->wpos, arrival_us);
+    if (jb->offset_valid) {
+        release = jb_stream_time(jb, jb->wpos) + jb->offset + jb->target_us;
+        /* a bad estimate must not hold data much longer than configured */
+        if (release > arrival_us + 2 * jb->target_us) {
+            release = arrival_us + 2 * jb->target_us;
+        }
+        if (release < arrival_us) {
+            jb->late_chunks++;
+        }
+    } else {
+        release = arrival_us + jb->target_us;
+    }
+    if (release < jb->last_release) {
+        release = jb->last_release;
+    }
+    jb->last_release = release;
+
+    c = &jb->chunks[(jb->chunk_head + jb->chunk_count) % JB_MAX_CHUNKS];
+    c->release = release;
+    c->size = size;
+    jb->chunk_count++;
+
+    off = (int)(jb->wpos % jb->size);
+    n = size < jb->size - off ? size : jb->size - off;
+    memcpy(jb->buf + off, data, n);
+    memcpy(jb->buf, data + n, size - n);
+    jb->wpos += size;
+    pthread_mutex_unlock(&jb->lock);
+    return size;
+}
+
+int jitterbuf_get(jitterbuf_t *jb, uint8_t *buf, int size, int64_t now_us, int *wait_us)
+{
+    int got = 0, wait = JB_MAX_WAIT_US;
+
+    pthread_mutex_lock(&jb->lock);
+    while (jb->chunk_count > 0 && got < size) {
+        jb_chunk_t *c = &jb->chunks[jb->chunk_head];
+        int off = (int)(jb->rpos % jb->size);
+        int n = c->size < size - got ? c->size : size - got;
+
+        if (c->release > now_us) {
+            wait = (int)(c->release - now_us);
+            break;
+        }
+        if (n > jb->size - off) {
+            n = jb->size - off;
+        }
+        memcpy(buf + got, jb->buf + off, n);
+        got += n;
+        jb->rpos += n;
+        c->size -= n;
+        if (c->size == 0) {
+            jb->chunk_head = (jb->chunk_head + 1) % JB_MAX_CHUNKS;
+            jb->chunk_count--;
+        }
+    }
+    if (got > 0) {
+        jb->delivered = 1;
+        jb->in_underrun = 0;
+    } else if (jb->chunk_count == 0) {
+        if (jb->input_error) {
+            got = jb->input_error;
+        } else if (jb->delivered && !jb->in_underrun) {
+            jb->underruns++;
+            jb->in_underrun = 1;
+        }
+    }
+    pthread_mutex_unlock(&jb->lock);
+    if (wait_us) {
+        *wait_us = wait < JB_MIN_WAIT_US ? JB_MIN_WAIT_US : (wait > JB_MAX_WAIT_US ? JB_MAX_WAIT_US : wait);
+    }
+    return got;
+}
+
+void jitterbuf_get_stats(jitterbuf_t *jb, jitterbuf_stats_t *st)
+{
+    pthread_mutex_lock(&jb->lock);
+    memset(st, 0, sizeof(*st));
+    st->target_ms = jb->target_us / 1000;
+    st->level_bytes = (int)(jb->wpos - jb->rpos);
+    st->clock_locked = jb->offset_valid;
+    if (jb->rate > 0) {
+        st->level_ms = (int)(st->level_bytes * 1000LL / jb->rate);
+        st->bitrate = (int)(jb->rate * 8);
+    }
+    st->jitter_us = (int)(jb->jitter >> 4);
+    st->max_delay_var_us = jb->max_delay_var;
+    st->underruns = jb->underruns;
+    st->overruns = jb->overruns;
+    st->late_chunks = jb->late_chunks;
+    st->discontinuities = jb->discontinuities;
+    st->bytes_in = jb->wpos;
+    st->bytes_out = jb->rpos;
+    pthread_mutex_unlock(&jb->lock);
+}
+
+static void jb_log_stats(jitterbuf_t *jb)
+{
+    jitterbuf_stats_t st;
+
+    jitterbuf_get_stats(jb, &st);
+    log_print("[jitterbuf]target %dms level %dms/%d bytes %dkbps lock %d jitter %dus max delay var %dus under %d over %d late %d disc %d\n",
+              st.target_ms, st.level_ms, st.level_bytes, st.bitrate / 1000, st.clock_locked, st.jitter_us,
+              st.max_delay_var_us, st.underruns, st.overruns, st.late_chunks, st.discontinuities);
+}
+
+static void *jitterbuf_thread(void *arg)
+{
+    jitterbuf_t *jb = (jitterbuf_t *)arg;
+    uint8_t *buf = malloc(JB_READ_SIZE);
+    int64_t arrival = 0, last_log = jitterbuf_now_us();
+    int pending = 0, ret;
+
+    if (!buf) {
+        jb->input_error = -ENOMEM;
+        return NULL;
+    }
+    while (!jb->abort) {
+        if (!pending) {
+            ret = jb->read(jb->opaque, buf, JB_READ_SIZE);
+            if (ret < 0) {
+                pthread_mutex_lock(&jb->lock);
+                jb->input_error = ret;
+                pthread_mutex_unlock(&jb->lock);
+                log_print("[jitterbuf]input ended %d\n", ret);
+                break;
+            }
+            if (ret == 0) {
+                usleep(JB_IDLE_WAIT_US);
+                continue;
+            }
+            arrival = jitterbuf_now_us();
+            pending = ret;
+        }
+        /* full: keep the chunk with its real arrival time until the player drains */
+        if (jitterbuf_put(jb, buf, pending, arrival) == 0) {
+            usleep(JB_FULL_WAIT_US);
+            continue;
+        }
+        pending = 0;
+        if (arrival - last_log >= JB_STATS_PERIOD_US) {
+            jb_log_stats(jb);
+            last_log = arrival;
+        }
+    }
+    jb_log_stats(jb);
+    free(buf);
+    return NULL;
+}
+
+int jitterbuf_start_input(jitterbuf_t *jb, jitterbuf_read_fn read, void *opaque)
+{
+    if (jb->thread_started) {
+        return -1;
+    }
+    jb->read = read;
+    jb->opaque = opaque;
+    /* a sub thread of the caller, so player interrupts reach its blocking reads */
+    if (amthreadpool_pthread_create(&jb->thread, NULL, jitterbuf_thread, jb) != 0) {
+        log_print("[%s]create input thread failed\n", __FUNCTION__);
+        return -1;
+    }
+    pthread_setname_np(jb->thread, "AmplayerJitter");
+    jb->thread_started = 1;
+    return 0;
+}
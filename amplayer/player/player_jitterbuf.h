@@ -0,0 +1,55 @@
+#ifndef _PLAYER_JITTERBUF_H_
+#define _PLAYER_JITTERBUF_H_
+
+#include <stdint.h>
+
+typedef struct {
+    int target_ms;          ///< configured latency over the fastest network path
+    int level_ms;           ///< buffered data at the recovered stream rate
+    int level_bytes;
+    int clock_locked;       ///< 1 once the sender clock is recovered from PCR
+    int bitrate;            ///< bits/s between PCRs
+    int jitter_us;          ///< RFC 3550 interarrival jitter of the PCR packets
+    int max_delay_var_us;   ///< worst arrival delay over the fastest path seen
+    int underruns;          ///< times the buffer ran dry while playing
+    int overruns;           ///< times input was held back because the buffer was full
+    int late_chunks;        ///< chunks that arrived after their release time
+    int discontinuities;    ///< PCR jumps
+    int64_t bytes_in;
+    int64_t bytes_out;
+} jitterbuf_stats_t;
+
+typedef struct jitterbuf jitterbuf_t;
+
+/* returns bytes read, 0 when nothing is available yet, <0 at end or error */
+typedef int (*jitterbuf_read_fn)(void *opaque, uint8_t *buf, int size);
+
+/*
+ * input jitter buffer for live TS. every chunk is stamped on arrival, the
+ * sender clock is recovered from the PCR of the first PCR pid and chunks
+ * are released at (PCR time + minimum transit + target), so the output
+ * follows the sender rate and absorbs up to target_ms of network jitter.
+ * size is the ring size in bytes, 0 for the default.
+ */
+jitterbuf_t *jitterbuf_open(int target_ms, int size);
+void jitterbuf_close(jitterbuf_t *jb);
+
+/*
+ * feed one chunk that arrived at arrival_us (jitterbuf_now_us() clock).
+ * returns size, or 0 when the ring is full and the chunk was not taken.
+ */
+int jitterbuf_put(jitterbuf_t *jb, const uint8_t *data, int size, int64_t arrival_us);
+/*
+ * copy up to size bytes that are due at now_us. returns 0 and the time to
+ * the next release in *wait_us when nothing is due, <0 when the input has
+ * ended and everything was delivered.
+ */
+int jitterbuf_get(jitterbuf_t *jb, uint8_t *buf, int size, int64_t now_us, int *wait_us);
+
+/* read the input from a thread of its own, stamping chunks on arrival */
+int jitterbuf_start_input(jitterbuf_t *jb, jitterbuf_read_fn read, void *opaque);
+
+void jitterbuf_get_stats(jitterbuf_t *jb, jitterbuf_stats_t *st);
+int64_t jitterbuf_now_us(void);
+
+#endif
@@ -0,0 +1,697 @@
+/************************************************
+ * name :player_kfindex.c
+ * function :background keyframe index for ts/ps/es files
+ * date     :2013.7.2
+ *************************************************/
+/*
+ * TS, PS and raw ES files carry no container index, seeking them falls
+ * back to bitrate estimates and pts bisection. kfindex scans the file once
+ * in a low priority thread, records every IDR/I-frame as (pts, offset,
+ * size) and saves the result in the player cache dir, so the next play of
+ * the same file can seek and do trick play by direct jumps.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <log_print.h>
+#include "player_kfindex.h"
+
+#define KFINDEX_MAGIC           0x5846494b  /* "KIFX" */
+#define KFINDEX_VERSION         2
+#define KFINDEX_BUF_SIZE        (188 * 192 * 8)
+#define KFINDEX_PES_HEAD        2048
+#define KFINDEX_IDLE_PRIORITY   19
+#define KFINDEX_PTS_WRAP        (1LL << 33)
+#define KFINDEX_MAX_GAP         (30 * 90000)    /* larger keyframe pts steps are discontinuities */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t file_size;
+    int64_t mtime;
+    int32_t container;
+    int32_t codec;
+    int32_t count;
+    int32_t reserved;
+} kfindex_file_header_t;
+
+struct kfindex {
+    pthread_t thread;
+    int thread_started;
+    volatile int abort;
+    pthread_mutex_t lock;
+
+    kfindex_entry_t *entries;
+    int count;
+    int capacity;
+    int complete;
+    int64_t scan_pos;
+
+    char path[1024];
+    char cache_path[1024];
+    int container;
+    int codec;
+    int video_pid;
+    int frame_dur;
+    int64_t file_size;
+    int64_t mtime;
+
+    /* scanner state */
+    int fd;
+    uint8_t *buf;
+    int64_t buf_base;
+    int buf_len;
+    int64_t last_pts;       /* raw pts of the last entry */
+    int64_t last_step;      /* timeline step between the last two entries */
+    int64_t timeline;       /* time of the last entry */
+    int64_t pend_pts;
+    int64_t pend_off;
+    int pend_valid;
+};
+
+static uint32_t kfindex_hash(const char *s)
+{
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/* make [pos, pos + n) readable, returns NULL at end of file */
+static const uint8_t *kfindex_peek(kfindex_t *idx, int64_t pos, int n)
+{
+    int ret;
+
+    if (pos >= idx->buf_base && pos + n <= idx->buf_base + idx->buf_len) {
+        return idx->buf + (pos - idx->buf_base);
+    }
+    if (pos + n > idx->file_size) {
+        return NULL;
+    }
+    ret = pread(idx->fd, idx->buf, KFINDEX_BUF_SIZE, pos);
+    if (ret < n) {
+        idx->buf_len = 0;
+        return NULL;
+    }
+    idx->buf_base = pos;
+    idx->buf_len = ret;
+    return idx->buf;
+}
+
+static int kfindex_find_startcode(const uint8_t *p, int n)
+{
+    const uint8_t *s = p, *end = p + n;
+
+    while (s + 2 < end) {
+        s = memchr(s + 2, 1, end - s - 2);
+        if (!s) {
+            return -1;
+        }
+        if (s[-1] == 0 && s[-2] == 0) {
+            return s - 2 - p;
+        }
+        s -= 1;
+    }
+    return -1;
+}
+
+/* p points to the byte after 00 00 01, n bytes readable */
+static int kfindex_is_key_code(int codec, const uint8_t *p, int n)
+{
+    int type;
+
+    if (n < 1) {
+        return 0;
+    }
+    switch (codec) {
+    case KFINDEX_CODEC_H264:
+        type = p[0] & 0x1f;
+        return type == 5 || type == 7;
+    case KFINDEX_CODEC_HEVC:
+        type = (p[0] >> 1) & 0x3f;
+        return (type >= 16 && type <= 21) || type == 32;
+    case KFINDEX_CODEC_MPEG2:
+        if (p[0] == 0xb3 || p[0] == 0xb8) {
+            return 1;
+        }
+        return p[0] == 0x00 && n >= 3 && ((p[2] >> 3) & 7) == 1;
+    }
+    return 0;
+}
+
+static int kfindex_scan_key(int codec, const uint8_t *p, int n)
+{
+    int i;
+
+    while ((i = kfindex_find_startcode(p, n)) >= 0) {
+        if (kfindex_is_key_code(codec, p + i + 3, n - i - 3)) {
+            return 1;
+        }
+        p += i + 3;
+        n -= i + 3;
+    }
+    return 0;
+}
+
+/*
+ * map a keyframe pts to a timeline that only grows in file order, so the
+ * entries stay sorted for kfindex_lookup: wraps are carried on and a
+ * discontinuity (pts jumping back, or forward by more than KFINDEX_MAX_GAP)
+ * advances the timeline by the previous keyframe interval.
+ */
+static int64_t kfindex_timeline(kfindex_t *idx, int64_t pts)
+{
+    int64_t delta;
+
+    if (idx->count == 0) {
+        idx->timeline = pts;
+    } else {
+        delta = (pts - idx->last_pts) & (KFINDEX_PTS_WRAP - 1);
+        if (delta > KFINDEX_MAX_GAP) {
+            delta = idx->last_step > 0 ? idx->last_step : (idx->frame_dur > 0 ? idx->frame_dur : 3003);
+            log_print("[%s]pts discontinuity 0x%llx -> 0x%llx\n", __FUNCTION__,
+                      (long long)idx->last_pts, (long long)pts);
+        }
+        idx->timeline += delta;
+        idx->last_step = delta;
+    }
+    idx->last_pts = pts;
+    return idx->timeline;
+}
+
+static void kfindex_add(kfindex_t *idx, int64_t pts, int64_t offset, int64_t size)
+{
+    kfindex_entry_t *e;
+
+    /* only the scanner writes count, reading it unlocked here is fine */
+    pts = kfindex_timeline(idx, pts);
+
+    pthread_mutex_lock(&idx->lock);
+    if (idx->count >= idx->capacity) {
+        int cap = idx->capacity ? idx->capacity * 2 : 1024;
+        e = realloc(idx->entries, cap * sizeof(kfindex_entry_t));
+        if (!e) {
+            pthread_mutex_unlock(&idx->lock);
+            return;
+        }
+        idx->entries = e;
+        idx->capacity = cap;
+    }
+    e = &idx->entries[idx->count++];
+    e->pts = pts;
+    e->offset = offset;
+    e->size = size > 0x7fffffff ? 0x7fffffff : (int)size;
+    pthread_mutex_unlock(&idx->lock);
+}
+
+/* a new access unit starts at offset, close the pending keyframe */
+static void kfindex_unit_start(kfindex_t *idx, int64_t offset)
+{
+    if (idx->pend_valid) {
+        kfindex_add(idx, idx->pend_pts, idx->pend_off, offset - idx->pend_off);
+        idx->pend_valid = 0;
+    }
+}
+
+static void kfindex_set_pending(kfindex_t *idx, int64_t pts, int64_t offset)
+{
+    idx->pend_pts = pts;
+    idx->pend_off = offset;
+    idx->pend_valid = 1;
+}
+
+static void kfindex_update_pos(kfindex_t *idx, int64_t pos)
+{
+    pthread_mutex_lock(&idx->lock);
+    idx->scan_pos = pos;
+    pthread_mutex_unlock(&idx->lock);
+    sched_yield();
+}
+
+static int64_t kfindex_read_pts(const uint8_t *p)
+{
+    return ((int64_t)(p[0] & 0x0e) << 29) | (p[1] << 22) | ((p[2] & 0xfe) << 14) |
+           (p[3] << 7) | (p[4] >> 1);
+}
+
+static int kfindex_scan_ts(kfindex_t *idx)
+{
+    uint8_t head[KFINDEX_PES_HEAD];
+    int head_len = 0, pkt_size = 188, pkt_off = 0;
+    int64_t pos, pes_off = -1, pes_pts = -1;
+    const uint8_t *p;
+
+    p = kfindex_peek(idx, 0, 192 * 3);
+    if (p && p[0] != 0x47 && p[4] == 0x47 && p[196] == 0x47 && p[388] == 0x47) {
+        pkt_size = 192;     /* m2ts, 4 bytes timestamp before each packet */
+        pkt_off = 4;
+    }
+
+    for (pos = 0; !idx->abort; pos += pkt_size) {
+        int pid, afc, start;
+
+        p = kfindex_peek(idx, pos, pkt_size);
+        if (!p) {
+            break;
+        }
+        if (p[pkt_off] != 0x47) {
+            /* lost sync, look for the next sync byte */
+            const uint8_t *s = memchr(p + 1, 0x47, pkt_size - 1);
+            pos = s ? pos + (s - p) - pkt_off - pkt_size : pos;
+            continue;
+        }
+        if ((pos & 0xfffff) < pkt_size) {
+            kfindex_update_pos(idx, pos);
+        }
+        p += pkt_off;
+        pid = ((p[1] & 0x1f) << 8) | p[2];
+        afc = (p[3] >> 4) & 3;
+        if (pid != idx->video_pid || !(afc & 1)) {
+            continue;
+        }
+        start = 4;
+        if (afc & 2) {
+            start += 1 + p[4];
+        }
+        if (start >= 188) {
+            continue;
+        }
+        if (p[1] & 0x40) {
+            /* payload unit start, a new pes */
+            if (pes_off >= 0 && pes_pts >= 0 && kfindex_scan_key(idx->codec, head, head_len)) {
+                kfindex_add(idx, pes_pts, pes_off, pos - pes_off);
+            }
+            pes_off = pos;
+            pes_pts = -1;
+            head_len = 0;
+            if (start + 14 <= 188 && p[start] == 0 && p[start + 1] == 0 && p[start + 2] == 1) {
+                if (p[start + 7] & 0x80) {
+                    pes_pts = kfindex_read_pts(p + start + 9);
+                }
+                start += 9 + p[start + 8];
+            }
+        }
+        if (pes_off >= 0 && start < 188 && head_len < KFINDEX_PES_HEAD) {
+            int len = 188 - start;
+            if (len > KFINDEX_PES_HEAD - head_len) {
+                len = KFINDEX_PES_HEAD - head_len;
+            }
+            memcpy(head + head_len, p + start, len);
+            head_len += len;
+        }
+    }
+    if (!idx->abort && pes_off >= 0 && pes_pts >= 0 && kfindex_scan_key(idx->codec, head, head_len)) {
+        kfindex_add(idx, pes_pts, pes_off, idx->file_size - pes_off);
+    }
+    return idx->abort ? -1 : 0;
+}
+
+static int kfindex_scan_ps(kfindex_t *idx)
+{
+    int64_t pos = 0, pack_off = 0;
+    const uint8_t *p;
+
+    while (!idx->abort) {
+        int code, len;
+
+        p = kfindex_peek(idx, pos, 16);
+        if (!p) {
+            break;
+        }
+        if (p[0] != 0 || p[1] != 0 || p[2] != 1) {
+            int avail = idx->buf_len - (int)(pos - idx->buf_base);
+            int i = kfindex_find_startcode(p, avail);
+            pos += i > 0 ? i : (avail > 3 ? avail - 3 : 1);
+            continue;
+        }
+        if ((pos & 0xfffff) < 2048) {
+            kfindex_update_pos(idx, pos);
+        }
+        code = p[3];
+        if (code == 0xba) {
+            pack_off = pos;
+            pos += ((p[4] >> 6) == 1) ? 14 + (p[13] & 7) : 12;
+            continue;
+        }
+        if (code < 0xb9) {
+            pos += 3;
+            continue;
+        }
+        if (code == 0xb9) {
+            pos += 4;
+            continue;
+        }
+        len = (p[4] << 8) | p[5];
+        if (code >= 0xe0 && code <= 0xef) {
+            int hdr = 6, head_len;
+            int64_t pts = -1;
+
+            p = kfindex_peek(idx, pos, 6 + len);
+            if (!p) {
+                break;
+            }
+            if ((p[6] & 0xc0) == 0x80) {
+                /* mpeg2 pes header */
+                if (p[7] & 0x80) {
+                    pts = kfindex_read_pts(p + 9);
+                }
+                hdr = 9 + p[8];
+            } else {
+                /* mpeg1 pes header */
+                while (hdr < 6 + len && p[hdr] == 0xff) {
+                    hdr++;
+                }
+                if ((p[hdr] & 0xc0) == 0x40) {
+                    hdr += 2;
+                }
+                if ((p[hdr] & 0xe0) == 0x20) {
+                    pts = kfindex_read_pts(p + hdr);
+                    hdr += (p[hdr] & 0x10) ? 10 : 5;
+                } else {
+                    hdr++;
+                }
+            }
+            if (pts >= 0 && hdr < 6 + len) {
+                kfindex_unit_start(idx, pack_off);
+                head_len = 6 + len - hdr;
+                if (head_len > KFINDEX_PES_HEAD) {
+                    head_len = KFINDEX_PES_HEAD;
+                }
+                if (kfindex_scan_key(idx->codec, p + hdr, head_len)) {
+                    kfindex_set_pending(idx, pts, pack_off);
+                }
+            }
+        }
+        pos += 6 + len;
+    }
+    if (!idx->abort) {
+        kfindex_unit_start(idx, idx->file_size);
+    }
+    return idx->abort ? -1 : 0;
+}
+
+static int kfindex_scan_es(kfindex_t *idx)
+{
+    int64_t pos = 0, au_start = -1, frame = 0;
+    int frame_dur = idx->frame_dur > 0 ? idx->frame_dur : 3003;
+
+    while (!idx->abort && pos < idx->file_size) {
+        int64_t left = idx->file_size - pos;
+        int len = left > KFINDEX_BUF_SIZE ? KFINDEX_BUF_SIZE : (int)left;
+        int limit = (pos + len == idx->file_size) ? len - 3 : len - 6;
+        const uint8_t *p = kfindex_peek(idx, pos, len);
+        int i = 0, s;
+
+        if (!p || limit <= 0) {
+            break;
+        }
+        while (i < limit && (s = kfindex_find_startcode(p + i, limit + 3 - i)) >= 0 && i + s < limit) {
+            const uint8_t *c = p + i + s + 3;
+            int64_t off = pos + i + s;
+            int pic = 0, key = 0, type;
+
+            switch (idx->codec) {
+            case KFINDEX_CODEC_H264:
+                type = c[0] & 0x1f;
+                if (type == 7 || type == 9) {
+                    if (au_start < 0) {
+                        au_start = off;
+                    }
+                } else if ((type == 1 || type == 5) && (c[1] & 0x80)) {
+                    pic = 1;
+                    key = type == 5;
+                }
+                break;
+            case KFINDEX_CODEC_HEVC:
+                type = (c[0] >> 1) & 0x3f;
+                if (type == 32 || type == 33 || type == 35) {
+                    if (au_start < 0) {
+                        au_start = off;
+                    }
+                } else if (type < 32 && (c[2] & 0x80)) {
+                    pic = 1;
+                    key = type >= 16 && type <= 21;
+                }
+                break;
+            case KFINDEX_CODEC_MPEG2:
+                if (c[0] == 0xb3 || c[0] == 0xb8) {
+                    if (au_start < 0) {
+                        au_start = off;
+                    }
+                } else if (c[0] == 0x00) {
+                    pic = 1;
+                    key = ((c[2] >> 3) & 7) == 1;
+                }
+                break;
+            }
+            if (pic) {
+                int64_t unit = au_start >= 0 ? au_start : off;
+                kfindex_unit_start(idx, unit);
+                if (key) {
+                    kfindex_set_pending(idx, frame * frame_dur, unit);
+                }
+                frame++;
+                au_start = -1;
+            }
+            i += s + 3;
+        }
+        pos += limit;
+        kfindex_update_pos(idx, pos);
+    }
+    if (!idx->abort) {
+        kfindex_unit_start(idx, idx->file_size);
+    }
+    return idx->abort ? -1 : 0;
+}
+
+static int kfindex_load(kfindex_t *idx)
+{
+    kfindex_file_header_t hdr;
+    kfindex_entry_t *entries;
+    int fd, ret = -1;
+
+    fd = open(idx->cache_path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        hdr.magic == KFINDEX_MAGIC && hdr.version == KFINDEX_VERSION &&
+        hdr.file_size == idx->file_size && hdr.mtime == idx->mtime &&
+        hdr.container == idx->container && hdr.codec == idx->codec &&
+        hdr.count >= 0 && hdr.count < (1 << 24)) {
+        entries = malloc((hdr.count ? hdr.count : 1) * sizeof(kfindex_entry_t));
+        if (entries && read(fd, entries, hdr.count * sizeof(kfindex_entry_t)) == (ssize_t)(hdr.count * sizeof(kfindex_entry_t))) {
+            idx->entries = entries;
+            idx->count = idx->capacity = hdr.count;
+            idx->complete = 1;
+            idx->scan_pos = idx->file_size;
+            ret = 0;
+        } else if (entries) {
+            free(entries);
+        }
+    }
+    close(fd);
+    return ret;
+}
+
+static void kfindex_save(kfindex_t *idx)
+{
+    kfindex_file_header_t hdr;
+    char tmp[1040];
+    int fd, ok;
+
+    if (!idx->cache_path[0]) {
+        return;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", idx->cache_path);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        log_print("[%s]can't create %s, errno=%d\n", __FUNCTION__, tmp, errno);
+        return;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = KFINDEX_MAGIC;
+    hdr.version = KFINDEX_VERSION;
+    hdr.file_size = idx->file_size;
+    hdr.mtime = idx->mtime;
+    hdr.container = idx->container;
+    hdr.codec = idx->codec;
+    hdr.count = idx->count;
+    ok = write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+         write(fd, idx->entries, idx->count * sizeof(kfindex_entry_t)) == (ssize_t)(idx->count * sizeof(kfindex_entry_t));
+    close(fd);
+    if (!ok || rename(tmp, idx->cache_path) < 0) {
+        unlink(tmp);
+    }
+}
+
+static void *kfindex_thread(void *arg)
+{
+    kfindex_t *idx = (kfindex_t *)arg;
+    struct timeval t0, t1;
+    int ret = -1;
+
+    /* linux applies the nice value to the calling thread only */
+    setpriority(PRIO_PROCESS, 0, KFINDEX_IDLE_PRIORITY);
+    gettimeofday(&t0, NULL);
+    idx->fd = open(idx->path, O_RDONLY);
+    idx->buf = malloc(KFINDEX_BUF_SIZE);
+    if (idx->fd >= 0 && idx->buf) {
+        if (idx->container == KFINDEX_CONTAINER_TS) {
+            ret = kfindex_scan_ts(idx);
+        } else if (idx->container == KFINDEX_CONTAINER_PS) {
+            ret = kfindex_scan_ps(idx);
+        } else {
+            ret = kfindex_scan_es(idx);
+        }
+    }
+    if (idx->fd >= 0) {
+        close(idx->fd);
+        idx->fd = -1;
+    }
+    free(idx->buf);
+    idx->buf = NULL;
+    if (ret == 0) {
+        pthread_mutex_lock(&idx->lock);
+        idx->complete = 1;
+        idx->scan_pos = idx->file_size;
+        pthread_mutex_unlock(&idx->lock);
+        kfindex_save(idx);
+        gettimeofday(&t1, NULL);
+        log_print("[%s]%s indexed, %d keyframes in %ld ms\n", __FUNCTION__, idx->path, idx->count,
+                  (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_usec - t0.tv_usec) / 1000);
+    }
+    return NULL;
+}
+
+kfindex_t *kfindex_open(const char *path, int container, int codec,
+                        int video_pid, int frame_dur, const char *cache_dir)
+{
+    kfindex_t *idx;
+    struct stat st;
+
+    if (!path || stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return NULL;
+    }
+    idx = calloc(1, sizeof(kfindex_t));
+    if (!idx) {
+        return NULL;
+    }
+    pthread_mutex_init(&idx->lock, NULL);
+    strncpy(idx->path, path, sizeof(idx->path) - 1);
+    idx->container = container;
+    idx->codec = codec;
+    idx->video_pid = video_pid;
+    idx->frame_dur = frame_dur;
+    idx->file_size = st.st_size;
+    idx->mtime = st.st_mtime;
+    idx->fd = -1;
+    if (cache_dir && cache_dir[0]) {
+        snprintf(idx->cache_path, sizeof(idx->cache_path), "%s/kfindex_%08x_%llx.idx",
+                 cache_dir, kfindex_hash(path), (long long)idx->file_size);
+    }
+    if (idx->cache_path[0] && kfindex_load(idx) == 0) {
+        log_print("[%s]loaded %d keyframes from %s\n", __FUNCTION__, idx->count, idx->cache_path);
+        return idx;
+    }
+    if (pthread_create(&idx->thread, NULL, kfindex_thread, idx) != 0) {
+        log_print("[%s]create index thread failed\n", __FUNCTION__);
+        pthread_mutex_destroy(&idx->lock);
+        free(idx);
+        return NULL;
+    }
+    idx->thread_started = 1;
+    return idx;
+}
+
+void kfindex_close(kfindex_t *idx)
+{
+    if (!idx) {
+        return;
+    }
+    if (idx->thread_started) {
+        idx->abort = 1;
+        pthread_join(idx->thread, NULL);
+    }
+    pthread_mutex_destroy(&idx->lock);
+    free(idx->entries);
+    free(idx);
+}
+
+int kfindex_lookup(kfindex_t *idx, int64_t pts, int dir, kfindex_entry_t *entry)
+{
+    int lo, hi, mid, ret = -1;
+
+    if (!idx) {
+        return -1;
+    }
+    pthread_mutex_lock(&idx->lock);
+    if (idx->count == 0) {
+        goto out;
+    }
+    /* entries are sorted by timeline; past the last keyframe of an unfinished
+     * scan, the next one may be missing */
+    if (!idx->complete && pts > idx->entries[idx->count - 1].pts) {
+        goto out;
+    }
+    lo = 0;
+    hi = idx->count - 1;
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (idx->entries[mid].pts <= pts) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (dir > 0 && idx->entries[lo].pts < pts) {
+        lo++;
+    } else if (dir <= 0 && idx->entries[lo].pts > pts) {
+        goto out;
+    }
+    if (lo >= idx->count) {
+        goto out;
+    }
+    *entry = idx->entries[lo];
+    ret = 0;
+out:
+    pthread_mutex_unlock(&idx->lock);
+    return ret;
+}
+
+int kfindex_count(kfindex_t *idx)
+{
+    int count;
+    pthread_mutex_lock(&idx->lock);
+    count = idx->count;
+    pthread_mutex_unlock(&idx->lock);
+    return count;
+}
+
+int kfindex_is_complete(kfindex_t *idx)
+{
+    int complete;
+    pthread_mutex_lock(&idx->lock);
+    complete = idx->complete;
+    pthread_mutex_unlock(&idx->lock);
+    return complete;
+}
+
+int64_t kfindex_scan_pos(kfindex_t *idx)
+{
+    int64_t pos;
+    pthread_mutex_lock(&idx->lock);
+    pos = idx->scan_pos;
+    pthread_mutex_unlock(&idx->lock);
+    return pos;
+}
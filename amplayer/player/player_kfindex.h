@@ -0,0 +1,45 @@
+#ifndef _PLAYER_KFINDEX_H_
+#define _PLAYER_KFINDEX_H_
+
+#include <stdint.h>
+
+#define KFINDEX_CONTAINER_TS    1
+#define KFINDEX_CONTAINER_PS    2
+#define KFINDEX_CONTAINER_ES    3
+
+#define KFINDEX_CODEC_H264      1
+#define KFINDEX_CODEC_MPEG2     2
+#define KFINDEX_CODEC_HEVC      3
+
+typedef struct {
+    int64_t pts;        ///< 90KHz timeline: the stream pts of the first keyframe, then
+                        ///< growing in file order across wraps and discontinuities;
+                        ///< raw ES counts frame_dur from 0
+    int64_t offset;     ///< file offset of the ts packet/ps pack/nal holding the keyframe
+    int size;           ///< bytes up to the next video access unit
+} kfindex_entry_t;
+
+typedef struct kfindex kfindex_t;
+
+/*
+ * open the keyframe index of a local file: load it from cache_dir when a
+ * complete index of the same file was saved there, otherwise start a
+ * background scan at idle priority. frame_dur is the frame duration in
+ * 90KHz units, used for raw ES streams that carry no pts.
+ */
+kfindex_t *kfindex_open(const char *path, int container, int codec,
+                        int video_pid, int frame_dur, const char *cache_dir);
+void kfindex_close(kfindex_t *idx);
+
+/*
+ * find the keyframe at or before (dir <= 0) or at or after (dir > 0) pts.
+ * returns 0 when found inside the indexed range, -1 when the index does
+ * not cover pts yet.
+ */
+int kfindex_lookup(kfindex_t *idx, int64_t pts, int dir, kfindex_entry_t *entry);
+int kfindex_count(kfindex_t *idx);
+int kfindex_is_complete(kfindex_t *idx);
+/* bytes scanned so far */
+int64_t kfindex_scan_pos(kfindex_t *idx);
+
+#endif
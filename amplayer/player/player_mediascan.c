@@ -0,0 +1,627 @@
+/************************************************
+ * name : player_mediascan.c
+ * function: parallel media scanner with a persistent metadata cache
+ * date     : 2014.10.18
+ * author   :
+ ************************************************/
+/*
+ * The media library used to call the thumbnail path once per file from one
+ * thread, every file paying a full av_find_stream_info and most of them
+ * being unchanged since the last scan. Here the caller thread walks the
+ * directory and stats the files, unchanged (path, size, mtime) entries are
+ * answered from the cache and the rest go through a bounded queue to a few
+ * parsing threads that probe with a reduced budget. The cache is written
+ * back to cache_path (tmp + rename) at the end of the scan.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <log_print.h>
+#include <amthreadpool.h>
+#include <player_thumbnail.h>
+#include <player_mediascan.h>
+#include "player_ffmpeg_ctrl.h"
+
+#define MEDIASCAN_MAX_THREADS   8
+#define MEDIASCAN_DEF_PROBESIZE (256 * 1024)
+#define MEDIASCAN_DEF_ANALYZE   1000        /* ms */
+#define MEDIASCAN_QUEUE_SIZE    32
+#define MEDIASCAN_MAX_DEPTH     16
+#define MEDIASCAN_PATH_MAX      1024
+
+#define MEDIASCAN_CACHE_MAGIC   0x4e43534d  /* "MSCN" */
+#define MEDIASCAN_CACHE_VERSION 1
+
+static const char *mediascan_default_exts =
+    "mp4,m4v,m4a,mov,3gp,3g2,mkv,mka,webm,avi,divx,wmv,wma,asf,flv,f4v,rm,rmvb,ra,"
+    "ts,m2ts,mts,tp,trp,mpg,mpeg,vob,dat,m2v,h264,264,hevc,265,"
+    "mp3,mp2,aac,ac3,eac3,dts,flac,ogg,oga,ogv,wav,ape,amr,awb";
+
+typedef struct mediascan_entry {
+    struct mediascan_entry *next;
+    unsigned int hash;
+    int seen;                   ///< reported by this scan
+    mediascan_result_t res;     ///< res.path points to path[]
+    char path[1];
+} mediascan_entry_t;
+
+typedef struct {
+    int64_t size;
+    int64_t mtime;
+    int64_t duration;
+    int32_t error;
+    int32_t vtracks;
+    int32_t atracks;
+    int32_t stracks;
+    int32_t width;
+    int32_t height;
+    int32_t rotation;
+    uint16_t path_len;
+    uint8_t title_len;
+    uint8_t artist_len;
+    uint8_t album_len;
+    uint8_t reserved[3];
+} mediascan_cache_rec_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} mediascan_cache_hdr_t;
+
+typedef struct {
+    char *path;
+    int64_t size;
+    int64_t mtime;
+} mediascan_job_t;
+
+typedef struct {
+    mediascan_cb cb;
+    void *opaque;
+    int probesize;
+    int analyze_us;
+    const char *exts;
+    int recursive;
+
+    pthread_mutex_t lock;       ///< queue and cache table
+    pthread_cond_t cond;
+    mediascan_job_t queue[MEDIASCAN_QUEUE_SIZE];
+    int q_rd;
+    int q_count;
+    int eof;
+
+    pthread_mutex_t cb_lock;    ///< one callback at a time
+    int reported;
+
+    mediascan_entry_t **table;
+    unsigned int table_size;
+    unsigned int entries;
+    int dirty;
+    int workers;
+    const char *root;           ///< directory being scanned, its unseen entries are dropped
+} mediascan_t;
+
+static unsigned int mediascan_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static mediascan_entry_t *mediascan_lookup(mediascan_t *ms, const char *path, unsigned int hash)
+{
+    mediascan_entry_t *e;
+
+    for (e = ms->table[hash & (ms->table_size - 1)]; e; e = e->next) {
+        if (e->hash == hash && !strcmp(e->path, path)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void mediascan_table_grow(mediascan_t *ms)
+{
+    unsigned int size = ms->table_size * 2, i;
+    mediascan_entry_t **table = calloc(size, sizeof(mediascan_entry_t *));
+    mediascan_entry_t *e, *next;
+
+    if (!table) {
+        return;
+    }
+    for (i = 0; i < ms->table_size; i++) {
+        for (e = ms->table[i]; e; e = next) {
+            next = e->next;
+            e->next = table[e->hash & (size - 1)];
+            table[e->hash & (size - 1)] = e;
+        }
+    }
+    free(ms->table);
+    ms->table = table;
+    ms->table_size = size;
+}
+
+/* adds or replaces the entry of res->path, called with ms->lock held */
+static mediascan_entry_t *mediascan_insert(mediascan_t *ms, const mediascan_result_t *res)
+{
+    unsigned int hash = mediascan_hash(res->path);
+    mediascan_entry_t *e = mediascan_lookup(ms, res->path, hash);
+
+    if (!e) {
+        int len = strlen(res->path);
+        e = malloc(sizeof(mediascan_entry_t) + len);
+        if (!e) {
+            return NULL;
+        }
+        memcpy(e->path, res->path, len + 1);
+        e->hash = hash;
+        if (ms->entries >= ms->table_size) {
+            mediascan_table_grow(ms);
+        }
+        e->next = ms->table[hash & (ms->table_size - 1)];
+        ms->table[hash & (ms->table_size - 1)] = e;
+        ms->entries++;
+    }
+    e->res = *res;
+    e->res.path = e->path;
+    e->res.cached = 0;
+    e->seen = 1;
+    ms->dirty = 1;
+    return e;
+}
+
+static void mediascan_copy_tag(char *dst, const char *src, int len)
+{
+    len = len < MEDIASCAN_TAG_LEN - 1 ? len : MEDIASCAN_TAG_LEN - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static int mediascan_cache_load(mediascan_t *ms, const char *cache_path)
+{
+    mediascan_cache_hdr_t hdr;
+    mediascan_cache_rec_t rec;
+    mediascan_result_t res;
+    mediascan_entry_t *e;
+    char path[MEDIASCAN_PATH_MAX];
+    char tags[3][256];
+    unsigned int i;
+    FILE *fp = fopen(cache_path, "rb");
+
+    if (!fp) {
+        return 0;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != MEDIASCAN_CACHE_MAGIC ||
+        hdr.version != MEDIASCAN_CACHE_VERSION) {
+        log_print("[%s]%s is not a scan cache, rebuilding\n", __FUNCTION__, cache_path);
+        fclose(fp);
+        return 0;
+    }
+    for (i = 0; i < hdr.count; i++) {
+        if (fread(&rec, sizeof(rec), 1, fp) != 1 || rec.path_len >= MEDIASCAN_PATH_MAX ||
+            fread(path, 1, rec.path_len, fp) != rec.path_len ||
+            fread(tags[0], 1, rec.title_len, fp) != rec.title_len ||
+            fread(tags[1], 1, rec.artist_len, fp) != rec.artist_len ||
+            fread(tags[2], 1, rec.album_len, fp) != rec.album_len) {
+            log_print("[%s]%s truncated at entry %u/%u\n", __FUNCTION__, cache_path, i, hdr.count);
+            break;
+        }
+        path[rec.path_len] = '\0';
+        memset(&res, 0, sizeof(res));
+        res.path = path;
+        res.size = rec.size;
+        res.mtime = rec.mtime;
+        res.duration = rec.duration;
+        res.error = rec.error;
+        res.vtracks = rec.vtracks;
+        res.atracks = rec.atracks;
+        res.stracks = rec.stracks;
+        res.width = rec.width;
+        res.height = rec.height;
+        res.rotation = rec.rotation;
+        mediascan_copy_tag(res.title, tags[0], rec.title_len);
+        mediascan_copy_tag(res.artist, tags[1], rec.artist_len);
+        mediascan_copy_tag(res.album, tags[2], rec.album_len);
+        e = mediascan_insert(ms, &res);
+        if (!e) {
+            break;
+        }
+        e->seen = 0;
+    }
+    fclose(fp);
+    ms->dirty = 0;
+    return i;
+}
+
+/* a file under the scanned directory that the walk did not see is gone */
+static int mediascan_stale(mediascan_t *ms, const mediascan_entry_t *e)
+{
+    int len;
+
+    if (e->seen || !ms->root) {
+        return 0;
+    }
+    len = strlen(ms->root);
+    if (strncmp(e->path, ms->root, len) || e->path[len] != '/') {
+        return 0;
+    }
+    return ms->recursive || !strchr(e->path + len + 1, '/');
+}
+
+static int mediascan_cache_save(mediascan_t *ms, const char *cache_path)
+{
+    mediascan_cache_hdr_t hdr;
+    mediascan_cache_rec_t rec;
+    mediascan_entry_t *e;
+    char tmp[MEDIASCAN_PATH_MAX + 8];
+    unsigned int i;
+    FILE *fp;
+    int ok = 1;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cache_path);
+    fp = fopen(tmp, "wb");
+    if (!fp) {
+        log_print("[%s]can't create %s:%s\n", __FUNCTION__, tmp, strerror(errno));
+        return -1;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = MEDIASCAN_CACHE_MAGIC;
+    hdr.version = MEDIASCAN_CACHE_VERSION;
+    ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (i = 0; i < ms->table_size && ok; i++) {
+        for (e = ms->table[i]; e && ok; e = e->next) {
+            if (mediascan_stale(ms, e)) {
+                continue;
+            }
+            hdr.count++;
+            memset(&rec, 0, sizeof(rec));
+            rec.size = e->res.size;
+            rec.mtime = e->res.mtime;
+            rec.duration = e->res.duration;
+            rec.error = e->res.error;
+            rec.vtracks = e->res.vtracks;
+            rec.atracks = e->res.atracks;
+            rec.stracks = e->res.stracks;
+            rec.width = e->res.width;
+            rec.height = e->res.height;
+            rec.rotation = e->res.rotation;
+            rec.path_len = strlen(e->path);
+            rec.title_len = strlen(e->res.title);
+            rec.artist_len = strlen(e->res.artist);
+            rec.album_len = strlen(e->res.album);
+            ok = fwrite(&rec, sizeof(rec), 1, fp) == 1 &&
+                 fwrite(e->path, 1, rec.path_len, fp) == rec.path_len &&
+                 fwrite(e->res.title, 1, rec.title_len, fp) == rec.title_len &&
+                 fwrite(e->res.artist, 1, rec.artist_len, fp) == rec.artist_len &&
+                 fwrite(e->res.album, 1, rec.album_len, fp) == rec.album_len;
+        }
+    }
+    /* the count goes in last */
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    if (fclose(fp) != 0 || !ok || rename(tmp, cache_path) != 0) {
+        log_print("[%s]writing %s failed\n", __FUNCTION__, cache_path);
+        unlink(tmp);
+        return -1;
+    }
+    ms->dirty = 0;
+    return 0;
+}
+
+static void mediascan_report(mediascan_t *ms, const mediascan_result_t *res)
+{
+    pthread_mutex_lock(&ms->cb_lock);
+    ms->cb(ms->opaque, res);
+    ms->reported++;
+    pthread_mutex_unlock(&ms->cb_lock);
+}
+
+static void mediascan_get_tag(void *handle, const char *key, char *dst)
+{
+    const char *value = NULL;
+
+    if (thumbnail_get_key_metadata(handle, (char *)key, &value) > 0 && value) {
+        mediascan_copy_tag(dst, value, strlen(value));
+    }
+}
+
+static void mediascan_parse(mediascan_t *ms, mediascan_result_t *res)
+{
+    void *handle = thumbnail_res_alloc();
+
+    if (!handle) {
+        res->error = -ENOMEM;
+        return;
+    }
+    if (thumbnail_find_stream_info_probe(handle, res->path, ms->probesize, ms->analyze_us) < 0) {
+        res->error = -1;
+        thumbnail_res_free(handle);
+        return;
+    }
+    thumbnail_get_duration(handle, &res->duration);
+    if (res->duration < 0) {
+        res->duration = 0;
+    }
+    thumbnail_get_tracks_info(handle, &res->vtracks, &res->atracks, &res->stracks);
+    /* the size is only set when the video stream was found at open time */
+    thumbnail_get_video_size(handle, &res->width, &res->height);
+    if (res->width > 0) {
+        thumbnail_get_video_rotation(handle, &res->rotation);
+    }
+    mediascan_get_tag(handle, "title", res->title);
+    mediascan_get_tag(handle, "artist", res->artist);
+    mediascan_get_tag(handle, "album", res->album);
+    thumbnail_find_stream_info_end(handle);
+    thumbnail_res_free(handle);
+}
+
+static void mediascan_process(mediascan_t *ms, mediascan_job_t *job)
+{
+    mediascan_result_t res;
+
+    memset(&res, 0, sizeof(res));
+    res.path = job->path;
+    res.size = job->size;
+    res.mtime = job->mtime;
+    mediascan_parse(ms, &res);
+    pthread_mutex_lock(&ms->lock);
+    mediascan_insert(ms, &res);
+    pthread_mutex_unlock(&ms->lock);
+    mediascan_report(ms, &res);
+    free(job->path);
+}
+
+static void *mediascan_worker(void *arg)
+{
+    mediascan_t *ms = (mediascan_t *)arg;
+    mediascan_job_t job;
+
+    for (;;) {
+        pthread_mutex_lock(&ms->lock);
+        while (!ms->q_count && !ms->eof) {
+            pthread_cond_wait(&ms->cond, &ms->lock);
+        }
+        if (!ms->q_count) {
+            pthread_mutex_unlock(&ms->lock);
+            break;
+        }
+        job = ms->queue[ms->q_rd];
+        ms->q_rd = (ms->q_rd + 1) % MEDIASCAN_QUEUE_SIZE;
+        ms->q_count--;
+        pthread_cond_broadcast(&ms->cond);
+        pthread_mutex_unlock(&ms->lock);
+        mediascan_process(ms, &job);
+    }
+    return NULL;
+}
+
+static int mediascan_ext_match(const char *exts, const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    const char *p;
+    int len;
+
+    if (!exts[0]) {
+        return 1;
+    }
+    if (!ext || !ext[1]) {
+        return 0;
+    }
+    ext++;
+    len = strlen(ext);
+    for (p = exts; *p;) {
+        const char *end = strchr(p, ',');
+        int n = end ? end - p : (int)strlen(p);
+        if (n == len && !strncasecmp(p, ext, len)) {
+            return 1;
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    return 0;
+}
+
+/* called from the walking thread, blocks while the queue is full */
+static void mediascan_add(mediascan_t *ms, const char *path, const struct stat *st)
+{
+    unsigned int hash = mediascan_hash(path);
+    mediascan_entry_t *e;
+    mediascan_result_t res;
+    mediascan_job_t *job, one;
+
+    pthread_mutex_lock(&ms->lock);
+    e = mediascan_lookup(ms, path, hash);
+    if (e && e->res.size == st->st_size && e->res.mtime == st->st_mtime) {
+        e->seen = 1;
+        res = e->res;
+        pthread_mutex_unlock(&ms->lock);
+        res.cached = 1;
+        mediascan_report(ms, &res);
+        return;
+    }
+    if (!ms->workers) {
+        pthread_mutex_unlock(&ms->lock);
+        one.path = strdup(path);
+        one.size = st->st_size;
+        one.mtime = st->st_mtime;
+        if (one.path) {
+            mediascan_process(ms, &one);
+        }
+        return;
+    }
+    while (ms->q_count == MEDIASCAN_QUEUE_SIZE) {
+        pthread_cond_wait(&ms->cond, &ms->lock);
+    }
+    job = &ms->queue[(ms->q_rd + ms->q_count) % MEDIASCAN_QUEUE_SIZE];
+    job->path = strdup(path);
+    job->size = st->st_size;
+    job->mtime = st->st_mtime;
+    if (job->path) {
+        ms->q_count++;
+        pthread_cond_broadcast(&ms->cond);
+    }
+    pthread_mutex_unlock(&ms->lock);
+}
+
+static void mediascan_walk(mediascan_t *ms, char *path, int len, int depth)
+{
+    struct dirent *de;
+    struct stat st;
+    DIR *dir = opendir(path);
+
+    if (!dir) {
+        log_print("[%s]can't open %s:%s\n", __FUNCTION__, path, strerror(errno));
+        return;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        int n = strlen(de->d_name);
+        if (de->d_name[0] == '.' || len + 1 + n >= MEDIASCAN_PATH_MAX) {
+            continue;
+        }
+        path[len] = '/';
+        memcpy(path + len + 1, de->d_name, n + 1);
+        if (stat(path, &st) < 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (ms->recursive && depth < MEDIASCAN_MAX_DEPTH) {
+                mediascan_walk(ms, path, len + 1 + n, depth + 1);
+            }
+        } else if (S_ISREG(st.st_mode) && mediascan_ext_match(ms->exts, de->d_name)) {
+            mediascan_add(ms, path, &st);
+        }
+    }
+    path[len] = '\0';
+    closedir(dir);
+}
+
+static int mediascan_run(const char *dir, const char **files, int count,
+                         const mediascan_para_t *para, mediascan_cb cb, void *opaque)
+{
+    mediascan_t ms;
+    pthread_t tid[MEDIASCAN_MAX_THREADS];
+    char path[MEDIASCAN_PATH_MAX];
+    struct stat st;
+    int threads = para ? para->threads : 0;
+    int i;
+
+    if (!cb) {
+        return -EINVAL;
+    }
+    memset(&ms, 0, sizeof(ms));
+    ms.cb = cb;
+    ms.opaque = opaque;
+    ms.probesize = para && para->probesize > 0 ? para->probesize : MEDIASCAN_DEF_PROBESIZE;
+    ms.analyze_us = (para && para->analyze_ms > 0 ? para->analyze_ms : MEDIASCAN_DEF_ANALYZE) * 1000;
+    ms.exts = para && para->exts ? para->exts : mediascan_default_exts;
+    ms.recursive = para ? para->recursive : 0;
+    if (threads <= 0) {
+        /* at least two so that one file's I/O overlaps another's parsing */
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = threads < 2 ? 2 : threads > 4 ? 4 : threads;
+    }
+    threads = threads < 1 ? 1 : threads > MEDIASCAN_MAX_THREADS ? MEDIASCAN_MAX_THREADS : threads;
+    ms.table_size = 256;
+    ms.table = calloc(ms.table_size, sizeof(mediascan_entry_t *));
+    if (!ms.table) {
+        return -ENOMEM;
+    }
+    pthread_mutex_init(&ms.lock, NULL);
+    pthread_mutex_init(&ms.cb_lock, NULL);
+    pthread_cond_init(&ms.cond, NULL);
+    if (para && para->cache_path) {
+        mediascan_cache_load(&ms, para->cache_path);
+    }
+
+    /* lock manager for the concurrent avcodec_open in av_find_stream_info */
+    ffmpeg_init();
+    /*
+     * the consumers block for the whole scan, on the shared task pool they
+     * would hold its few workers from short jobs, so they get threads.
+     */
+    for (i = 0; i < threads; i++) {
+        if (amthreadpool_pthread_create(&tid[ms.workers], NULL, mediascan_worker, &ms) == 0) {
+            ms.workers++;
+        }
+    }
+
+    if (dir) {
+        int len = strlen(dir);
+        if (len >= MEDIASCAN_PATH_MAX) {
+            len = 0;
+        }
+        while (len > 1 && dir[len - 1] == '/') {
+            len--;
+        }
+        memcpy(path, dir, len);
+        path[len] = '\0';
+        if (len > 0) {
+            ms.root = path;
+            mediascan_walk(&ms, path, len, 0);
+        }
+    }
+    for (i = 0; files && i < count; i++) {
+        if (files[i] && stat(files[i], &st) == 0 && S_ISREG(st.st_mode)) {
+            mediascan_add(&ms, files[i], &st);
+        }
+    }
+
+    pthread_mutex_lock(&ms.lock);
+    ms.eof = 1;
+    pthread_cond_broadcast(&ms.cond);
+    pthread_mutex_unlock(&ms.lock);
+    for (i = 0; i < ms.workers; i++) {
+        amthreadpool_pthread_join(tid[i], NULL);
+    }
+
+    for (i = 0; i < (int)ms.table_size && !ms.dirty; i++) {
+        mediascan_entry_t *e;
+        for (e = ms.table[i]; e && !ms.dirty; e = e->next) {
+            ms.dirty = mediascan_stale(&ms, e);
+        }
+    }
+    if (para && para->cache_path && ms.dirty) {
+        mediascan_cache_save(&ms, para->cache_path);
+    }
+    log_print("[%s]%d files reported, %u cached entries, %d threads\n", __FUNCTION__,
+              ms.reported, ms.entries, ms.workers);
+    for (i = 0; i < (int)ms.table_size; i++) {
+        mediascan_entry_t *e, *next;
+        for (e = ms.table[i]; e; e = next) {
+            next = e->next;
+            free(e);
+        }
+    }
+    free(ms.table);
+    pthread_cond_destroy(&ms.cond);
+    pthread_mutex_destroy(&ms.cb_lock);
+    pthread_mutex_destroy(&ms.lock);
+    return ms.reported;
+}
+
+int mediascan_dir(const char *dir, const mediascan_para_t *para, mediascan_cb cb, void *opaque)
+{
+    if (!dir) {
+        return -EINVAL;
+    }
+    return mediascan_run(dir, NULL, 0, para, cb, opaque);
+}
+
+int mediascan_files(const char **files, int count, const mediascan_para_t *para, mediascan_cb cb, void *opaque)
+{
+    if (!files || count < 0) {
+        return -EINVAL;
+    }
+    return mediascan_run(NULL, files, count, para, cb, opaque);
+}
@@ -0,0 +1,231 @@
+/*****************************************
+ * name : player_nalpack.c
+ * function: avcC/hvcC to Annex-B packetizer for h264/hevc feeding
+ *****************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <log_print.h>
+#include <player_error.h>
+#include "player_nalpack.h"
+
+#define NAL_SCRATCH_MARGIN  (4 * 1024)
+
+static int nal_read_length(const unsigned char *p, int n)
+{
+    int len = 0;
+    while (n-- > 0) {
+        len = (len << 8) | *p++;
+    }
+    return len;
+}
+
+static int nal_has_startcode(const unsigned char *p, int size)
+{
+    return (size >= 3 && p[0] == 0 && p[1] == 0 && p[2] == 1) ||
+           (size >= 4 && p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1);
+}
+
+/* lengths of the packet add up with n bytes length fields */
+static int nal_check_length_size(const unsigned char *p, int size, int n)
+{
+    const unsigned char *end = p + size;
+    int len;
+
+    while (p + n < end) {
+        len = nal_read_length(p, n);
+        if (len <= 0 || len > end - p - n) {
+            return 0;
+        }
+        p += n + len;
+    }
+    return p == end;
+}
+
+/* streams without avcC/hvcC config: guess the length size once */
+static int nal_probe_length_size(const unsigned char *p, int size)
+{
+    static const int sizes[] = {4, 3, 2};
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (nal_check_length_size(p, size, sizes[i])) {
+            return sizes[i];
+        }
+    }
+    return 0;
+}
+
+/* length size of the avcC/hvcC record, 0 for Annex-B or unknown config */
+static int nal_config_length_size(int hevc, const unsigned char *extradata, int extradata_size)
+{
+    int n = 0;
+
+    if (extradata && !nal_has_startcode(extradata, extradata_size)) {
+        if (!hevc && extradata_size >= 7 && extradata[0] == 1) {
+            n = (extradata[4] & 3) + 1;
+        } else if (hevc && extradata_size >= 23) {
+            n = (extradata[21] & 3) + 1;
+        }
+        /* a 3 bytes length field is reserved in avcC */
+        if (n == 3 && !hevc) {
+            n = 0;
+        }
+    }
+    return n;
+}
+
+void nal_packetizer_init(nal_packetizer_t *pz)
+{
+    memset(pz, 0, sizeof(*pz));
+}
+
+int nal_packetizer_set_config(nal_packetizer_t *pz, int hevc,
+                              const unsigned char *extradata, int extradata_size,
+                              const unsigned char *param_sets, int param_sets_size)
+{
+    pz->hevc = hevc;
+    pz->nal_length_size = nal_config_length_size(hevc, extradata, extradata_size);
+    pz->length_probed = 0;
+    pz->config = extradata;
+    pz->config_size = extradata_size;
+
+    if (param_sets_size > pz->param_sets_size || !pz->param_sets) {
+        unsigned char *buf = realloc(pz->param_sets, param_sets_size > 0 ? param_sets_size : 1);
+        if (!buf) {
+            return PLAYER_NOMEM;
+        }
+        pz->param_sets = buf;
+    }
+    if (param_sets && param_sets_size > 0) {
+        memcpy(pz->param_sets, param_sets, param_sets_size);
+    }
+    pz->param_sets_size = param_sets ? param_sets_size : 0;
+    pz->param_sets_pending = pz->param_sets_size > 0;
+    pz->packets_since_config = 0;
+    log_print("[%s]%s nal length size %d, param sets %d bytes\n", __FUNCTION__,
+              hevc ? "hvcC" : "avcC", pz->nal_length_size, pz->param_sets_size);
+    return PLAYER_SUCCESS;
+}
+
+void nal_packetizer_check_config(nal_packetizer_t *pz, const unsigned char *extradata, int extradata_size)
+{
+    if (extradata == pz->config && extradata_size == pz->config_size) {
+        return;
+    }
+    pz->nal_length_size = nal_config_length_size(pz->hevc, extradata, extradata_size);
+    pz->length_probed = 0;
+    pz->config = extradata;
+    pz->config_size = extradata_size;
+    log_print("[%s]config changed, nal length size %d\n", __FUNCTION__, pz->nal_length_size);
+}
+
+int nal_packetizer_convert(nal_packetizer_t *pz, unsigned char **data, int *size)
+{
+    unsigned char *in = *data, *p, *end, *out;
+    int n = pz->nal_length_size, len, type, nals = 0;
+    int has_key = 0, has_sps = 0, insert, need, out_len;
+
+    if (in == NULL || *size <= 0) {
+        return PLAYER_SUCCESS;
+    }
+    if (n == 0) {
+        if (nal_has_startcode(in, *size)) {
+            return PLAYER_SUCCESS;
+        }
+        n = nal_probe_length_size(in, *size);
+        if (n == 0) {
+            return PLAYER_SUCCESS;
+        }
+        log_print("[%s]no config, nal length size probed as %d\n", __FUNCTION__, n);
+        pz->nal_length_size = n;
+        pz->length_probed = 1;
+    }
+
+    /* walk the length fields only, the payload is not touched here */
+    end = in + *size;
+    for (p = in; p + n < end; p += n + len) {
+        len = nal_read_length(p, n);
+        if (len <= 0 || len > end - p - n) {
+            break;
+        }
+        if (pz->hevc) {
+            type = (p[n] >> 1) & 0x3f;
+            has_key |= type >= 16 && type <= 21;
+            has_sps |= type == 33;
+        } else {
+            type = p[n] & 0x1f;
+            has_key |= type == 5;
+            has_sps |= type == 7;
+        }
+        nals++;
+    }
+    if (p != end) {
+        /* already Annex-B or broken, feed as it is; a guessed length
+         * size that stopped matching is probed again on the next packet */
+        if (pz->length_probed) {
+            pz->nal_length_size = 0;
+            pz->length_probed = 0;
+        }
+        return PLAYER_SUCCESS;
+    }
+
+    /* header feeding puts the sets right before the first packet, only
+     * repeat them when the decoder skipped non key packets up to this IDR */
+    insert = has_key && !has_sps && pz->param_sets_pending && pz->packets_since_config > 0;
+    if (has_key) {
+        pz->param_sets_pending = 0;
+    }
+    pz->packets_since_config++;
+
+    if (!insert && n >= 3) {
+        for (p = in; p < end; p += n + len) {
+            len = nal_read_length(p, n);
+            if (n == 4) {
+                p[0] = 0;
+                p[1] = 0;
+                p[2] = 0;
+                p[3] = 1;
+            } else {
+                p[0] = 0;
+                p[1] = 0;
+                p[2] = 1;
+            }
+        }
+        return PLAYER_SUCCESS;
+    }
+
+    need = *size + nals * (4 - n) + (insert ? pz->param_sets_size : 0);
+    if (need > pz->scratch_size) {
+        unsigned char *buf = realloc(pz->scratch, need + NAL_SCRATCH_MARGIN);
+        if (!buf) {
+            return PLAYER_NOMEM;
+        }
+        pz->scratch = buf;
+        pz->scratch_size = need + NAL_SCRATCH_MARGIN;
+    }
+    out = pz->scratch;
+    out_len = 0;
+    if (insert) {
+        memcpy(out, pz->param_sets, pz->param_sets_size);
+        out_len = pz->param_sets_size;
+    }
+    for (p = in; p < end; p += n + len) {
+        len = nal_read_length(p, n);
+        out[out_len] = 0;
+        out[out_len + 1] = 0;
+        out[out_len + 2] = 0;
+        out[out_len + 3] = 1;
+        memcpy(out + out_len + 4, p + n, len);
+        out_len += len + 4;
+    }
+    *data = out;
+    *size = out_len;
+    return PLAYER_SUCCESS;
+}
+
+void nal_packetizer_release(nal_packetizer_t *pz)
+{
+    free(pz->param_sets);
+    free(pz->scratch);
+    nal_packetizer_init(pz);
+}
@@ -0,0 +1,40 @@
+#ifndef _PLAYER_NALPACK_H_
+#define _PLAYER_NALPACK_H_
+
+/*
+ * avcC/hvcC (length prefixed) to Annex-B conversion of h264/hevc packets.
+ * the NAL length size is taken from the stream config and taken again when
+ * the config changes, packets are rewritten in place when the start code
+ * fits the length field, otherwise into a scratch buffer kept across packets.
+ */
+typedef struct nal_packetizer {
+    int hevc;
+    int nal_length_size;        ///< 1..4 from avcC/hvcC, 0 for unknown/Annex-B config
+    int length_probed;          ///< nal_length_size guessed from the packets, no config
+    const unsigned char *config;    ///< extradata the length size was taken from
+    int config_size;
+    int param_sets_pending;     ///< prepend param_sets to the next IDR without SPS
+    int packets_since_config;
+    unsigned char *param_sets;  ///< Annex-B SPS/PPS(/VPS) of the config
+    int param_sets_size;
+    unsigned char *scratch;
+    int scratch_size;
+} nal_packetizer_t;
+
+void nal_packetizer_init(nal_packetizer_t *pz);
+/*
+ * set the stream config: extradata is the avcC/hvcC record (or Annex-B
+ * data), param_sets its Annex-B conversion as fed to the decoder. called
+ * on every header feeding, so the parameter sets are inserted again in
+ * front of the first IDR after a seek.
+ */
+int nal_packetizer_set_config(nal_packetizer_t *pz, int hevc,
+                              const unsigned char *extradata, int extradata_size,
+                              const unsigned char *param_sets, int param_sets_size);
+/* take the length size again when the stream extradata was replaced */
+void nal_packetizer_check_config(nal_packetizer_t *pz, const unsigned char *extradata, int extradata_size);
+/* convert one packet, data and size are updated when the scratch buffer is used */
+int nal_packetizer_convert(nal_packetizer_t *pz, unsigned char **data, int *size);
+void nal_packetizer_release(nal_packetizer_t *pz);
+
+#endif
@@ -16,6 +16,7 @@
 #include "player_ffmpeg_ctrl.h"
 #include "system/systemsetting.h"
 #include <cutils/properties.h>
+#include <amtrace.h>
 
 extern es_sub_t es_sub_buf[SSTREAM_MAX_NUM];
 
@@ -1111,6 +1112,7 @@ int player_dec_reset(play_para_t *p_para)
     AVFormatContext *pFormatCtx = p_para->pFormatCtx;;
     float time_point = p_para->playctrl_info.time_point;
     int64_t timestamp = 0;
+    float key_time;
     int mute_flag = 0;
 
     timestamp = (int64_t)(time_point * AV_TIME_BASE);
@@ -1172,6 +1174,11 @@ int player_dec_reset(play_para_t *p_para)
 
         log_print("[player_dec_reset:%d]time_point=%f step=%d\n", __LINE__, p_para->playctrl_info.time_point, p_para->playctrl_info.f_step);
         p_para->playctrl_info.time_point += p_para->playctrl_info.f_step;
+        /* step on the indexed I-frame, but never past the next step */
+        if (player_kfindex_snap(p_para, p_para->playctrl_info.time_point, 1, &key_time) == 0 &&
+            key_time < p_para->playctrl_info.time_point + p_para->playctrl_info.f_step) {
+            p_para->playctrl_info.time_point = key_time;
+        }
         if (p_para->playctrl_info.time_point >= p_para->state.full_time &&
             p_para->state.full_time > 0) {
             ff_reach_end(p_para);
@@ -1185,6 +1192,10 @@ int player_dec_reset(play_para_t *p_para)
         if ((p_para->playctrl_info.time_point >= p_para->playctrl_info.f_step) &&
             (p_para->playctrl_info.time_point > 0)) {
             p_para->playctrl_info.time_point -= p_para->playctrl_info.f_step;
+            if (player_kfindex_snap(p_para, p_para->playctrl_info.time_point, -1, &key_time) == 0 &&
+                key_time >= 0) {
+                p_para->playctrl_info.time_point = key_time;
+            }
         } else {
             fb_reach_head(p_para);
             log_print("reach stream head,fast backward stop,play from start!\n");
@@ -1239,6 +1250,8 @@ int player_dec_reset(play_para_t *p_para)
 			int ret=S_ONCE_READ_L;
 			int maxneeddroped=S_TOPBUF_LEN;
 			int totaldroped=0;
+			/*the jitterbuf input thread reads pb too, stop it and drop what it holds*/
+			player_jitterbuf_stop(p_para);
 			avio_reset(p_para->pFormatCtx->pb,0);/*clear ffmpeg's  buffers data.*/
 			while(ret==S_ONCE_READ_L && maxneeddroped>0){/*do read till read max,or top buffer underflow to droped steamsource buffers data*/
 				ret = get_buffer(p_para->pFormatCtx->pb, readbuf,S_ONCE_READ_L);
@@ -1247,6 +1260,9 @@ int player_dec_reset(play_para_t *p_para)
 					totaldroped+=ret;
 			}
 			log_print("reset total droped data len=%d\n",totaldroped);
+			if (p_para->playctrl_info.lowbuffermode_flag) {
+				player_jitterbuf_start(p_para);
+			}
     	}
 		p_para->playctrl_info.reset_drop_buffered_data=0;
         ret = PLAYER_SUCCESS;/*do reset only*/	
@@ -1423,7 +1439,9 @@ int player_dec_init(play_para_t *p_para)
     AVStream *st;
 	int64_t streamtype=-1;
 	
+    amtrace_begin(AMTRACE_PROBE);
     ret = ffmpeg_parse_file(p_para);
+    amtrace_end(AMTRACE_PROBE);
     if (ret != FFMPEG_SUCCESS) {
         log_print("[player_dec_init]ffmpeg_parse_file failed(%s)*****ret=%x!\n", p_para->file_name, ret);
         return ret;
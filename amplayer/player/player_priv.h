@@ -130,6 +130,38 @@ typedef struct {
     int interval;
 } check_end_info_t;
 
+/* decoder status of the player thread's update passes, see player_update.c */
+typedef struct {
+    int refresh_ms;             // <0 off, 0 once per pass, >0 reused by the passes within that age
+    int valid;                  // SNAP_* parts fetched for the current snapshot
+    int fetched;                // SNAP_* parts fetched in the current pass
+    long stamp_ms;
+    int sta;                    // player state the snapshot was taken in
+    struct buf_status vbuf;
+    struct buf_status abuf;
+    struct vdec_status vdec;
+    struct adec_status adec;
+    int vbuf_ret;
+    int abuf_ret;
+    int vdec_ret;
+    int adec_ret;
+    unsigned int vpts;
+    unsigned int apts;
+    unsigned int pcrscr;
+    int vdelay_ms;
+    int adelay_ms;
+    int vdiscont;
+    int adiscont;
+    unsigned long vdiscont_diff;
+    unsigned long adiscont_diff;
+    int wfd;
+    long wfd_stamp_ms;
+    int stats;                  // log the kernel queries per second
+    unsigned int queries;
+    unsigned int passes;
+    long stats_stamp_ms;
+} player_status_snap_t;
+
 typedef struct play_para {
     play_control_t  *start_param;
     int player_id;
@@ -206,6 +238,11 @@ typedef struct play_para {
     int div_buf_time;
     int play_start_systemtime_us; //
     int play_last_reset_systemtime_us; //
+    unsigned int trace_pts_ref; // pts seen right after the last reset, for seek tracing
+    int trace_wait_pts;         // 1<<AMTRACE_STARTUP / 1<<AMTRACE_SEEK, phases waiting for the first pts
+    struct kfindex *kfindex;    // keyframe index of local ts/ps/es files, NULL if none
+    struct jitterbuf *jitterbuf;    // PCR paced input buffer of live ts in low buffer mode, NULL if none
+    player_status_snap_t status_snap;
     float buffering_force_delay_s; 
     long buffering_check_point;	
     int buffering_bitrate_finished;  
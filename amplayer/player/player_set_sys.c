@@ -15,6 +15,7 @@
 #include <sys/system_properties.h>
 #include <Amsysfsutils.h>
 #include <amthreadpool.h>
+#include <codec.h>
 
 
 static freescale_setting_t freescale_setting[] = {
@@ -60,21 +61,38 @@ static freescale_setting_t freescale_setting[] = {
     }
 };
 
+//the emulated codec devices (AMCODEC_EMU) keep their own nodes
 int set_sysfs_str(const char *path, const char *val)
 {
+    if (codec_emu_sysfs_set(path, val) == 0) {
+        return 0;
+    }
     return amsysfs_set_sysfs_str(path, val);
 }
 int  get_sysfs_str(const char *path, char *valstr, int size)
 {
+    if (codec_emu_sysfs_get(path, valstr, size) == 0) {
+        return 0;
+    }
     return amsysfs_get_sysfs_str(path, valstr, size);
 }
 
 int set_sysfs_int(const char *path, int val)
 {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", val);
+    if (codec_emu_sysfs_set(path, buf) == 0) {
+        return 0;
+    }
     return amsysfs_set_sysfs_int(path, val);
 }
 int get_sysfs_int(const char *path)
 {
+    char buf[16];
+    if (codec_emu_sysfs_get(path, buf, sizeof(buf)) == 0) {
+        /* the emulated nodes are decimal, only the pts ones say 0x */
+        return strtol(buf, NULL, strncmp(buf, "0x", 2) ? 10 : 16);
+    }
     return amsysfs_get_sysfs_int16(path);
 }
 
@@ -1063,7 +1081,7 @@ int wait_play_end()
     int ret = 0;
     int waitcount = 0;
     char buf[32]={0};
-    ret = amsysfs_get_sysfs_str("/sys/class/amstream/videobufused", buf, 32);
+    ret = get_sysfs_str("/sys/class/amstream/videobufused", buf, 32);
     log_print("[wait_Play_end] ret %d buf %s\n",ret,buf);
     while((ret>=0)&&(!strstr(buf, "0"))){
         
@@ -1076,7 +1094,7 @@ int wait_play_end()
         waitcount++;
         amthreadpool_thread_usleep(500);
         memset(buf,0,sizeof(buf));
-        ret = amsysfs_get_sysfs_str("/sys/class/amstream/videobufused", buf, 32);     	
+        ret = get_sysfs_str("/sys/class/amstream/videobufused", buf, 32);     	
     } 
     return 0;
 }
@@ -1086,7 +1104,7 @@ int wait_video_unreg()
     int ret = 0;
     int waitcount = 0;
     char buf[32]={0};
-	ret = amsysfs_get_sysfs_str("/sys/module/amvideo/parameters/new_frame_count", buf, 32);
+	ret = get_sysfs_str("/sys/module/amvideo/parameters/new_frame_count", buf, 32);
 	log_print("[wait_di_bypass] ret %d buf %s\n",ret,buf);
 	while((ret>=0)&&(!strstr(buf, "0")))
     {
@@ -1099,7 +1117,7 @@ int wait_video_unreg()
 		waitcount++;
         amthreadpool_thread_usleep(500);
         memset(buf,0,sizeof(buf));
-	    ret = amsysfs_get_sysfs_str("/sys/module/amvideo/parameters/new_frame_count", buf, 32);       
+	    ret = get_sysfs_str("/sys/module/amvideo/parameters/new_frame_count", buf, 32);       
 	}
 	return 0;
 
@@ -156,6 +156,12 @@ void * thumbnail_res_alloc(void)
 
 //#define DUMP_INDEX
 int thumbnail_find_stream_info(void *handle, const char* filename)
+{
+    return thumbnail_find_stream_info_probe(handle, filename, 0, 0);
+}
+
+/* probesize/analyze_us cap av_find_stream_info, 0 keeps the format defaults */
+int thumbnail_find_stream_info_probe(void *handle, const char* filename, int probesize, int analyze_us)
 {
     struct video_frame *frame = (struct video_frame *)handle;
     struct stream *stream = &frame->stream;
@@ -164,6 +170,12 @@ int thumbnail_find_stream_info(void *handle, const char* filename)
         log_print("Coundn't open file %s !\n", filename);
         goto err;
     }
+    if (probesize > 0) {
+        stream->pFormatCtx->probesize = probesize;
+    }
+    if (analyze_us > 0) {
+        stream->pFormatCtx->max_analyze_duration = analyze_us;
+    }
     for (i = 0; i < stream->pFormatCtx->nb_streams; i++) {        
         if (stream->pFormatCtx->streams[i]->codec->codec_type == CODEC_TYPE_VIDEO) {
                       stream->videoStream = i;
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <codec_type.h>
 #include <player_set_sys.h>
+#include <amconfigutils.h>
 
 #include "player_update.h"
 #include "player_av.h"
@@ -376,16 +377,137 @@ int set_ps_subtitle_info(play_para_t *p_para, subtitle_info_t *sub_info, int sub
 }
 
 
-static int check_vcodec_state(codec_para_t *codec, struct vdec_status *dec, struct buf_status *buf)
+/*
+ * decoder status snapshot: every buffer, decoder, pts and delay query of
+ * the player thread's update pass is an ioctl, and update_playing_info()
+ * runs after every written packet. The queries of a pass go through the
+ * snapshot, each part fetched on first use; with refresh_ms > 0 the
+ * snapshot also serves the following passes until it is that old or the
+ * player state changes. refresh_ms < 0 queries every time, as before.
+ * Only for the player thread, the mate thread queries directly.
+ */
+#define SNAP_VSTATE     (1 << 0)
+#define SNAP_ASTATE     (1 << 1)
+#define SNAP_VPTS       (1 << 2)
+#define SNAP_APTS       (1 << 3)
+#define SNAP_PCRSCR     (1 << 4)
+#define SNAP_VDELAY     (1 << 5)
+#define SNAP_ADELAY     (1 << 6)
+#define SNAP_DISCONT    (1 << 7)
+
+#define SNAP_DEF_REFRESH_MS     10
+#define SNAP_WFD_REFRESH_MS     1000
+#define SNAP_STATS_INTERVAL_MS  10000
+
+void player_status_snap_init(play_para_t *p_para)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+
+    MEMSET(snap, 0, sizeof(player_status_snap_t));
+    snap->refresh_ms = (int)am_getconfig_float_def("media.amplayer.status_refresh_ms", SNAP_DEF_REFRESH_MS);
+    snap->stats = am_getconfig_bool("media.amplayer.status_stats");
+    snap->sta = -1;
+    snap->wfd_stamp_ms = -SNAP_WFD_REFRESH_MS;
+    snap->stats_stamp_ms = player_get_systemtime_ms();
+}
+
+/*1 if the part has to be fetched now, counting its ioctls*/
+static int status_snap_need(player_status_snap_t *snap, int part, int ioctls)
+{
+    if (snap->refresh_ms >= 0 && (snap->valid & part)) {
+        return 0;
+    }
+    snap->valid |= part;
+    snap->fetched |= part;
+    snap->queries += ioctls;
+    return 1;
+}
+
+static void status_snap_begin(play_para_t *p_para, player_status sta)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+    long now = player_get_systemtime_ms();
+
+    snap->fetched = 0;
+    snap->passes++;
+    if (snap->refresh_ms <= 0 || (int)sta != snap->sta || now - snap->stamp_ms >= snap->refresh_ms) {
+        snap->valid = 0;
+        snap->stamp_ms = now;
+        snap->sta = sta;
+    }
+    if (snap->stats && now - snap->stats_stamp_ms >= SNAP_STATS_INTERVAL_MS) {
+        log_print("[%s]refresh %dms: %u status ioctls/s over %u passes/s\n", __FUNCTION__, snap->refresh_ms,
+                  (unsigned int)(snap->queries * 1000LL / (now - snap->stats_stamp_ms)),
+                  (unsigned int)(snap->passes * 1000LL / (now - snap->stats_stamp_ms)));
+        snap->queries = 0;
+        snap->passes = 0;
+        snap->stats_stamp_ms = now;
+    }
+}
+
+static int status_snap_wfd(play_para_t *p_para)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+    long now = player_get_systemtime_ms();
+
+    if (snap->refresh_ms < 0 || now - snap->wfd_stamp_ms >= SNAP_WFD_REFRESH_MS) {
+        snap->wfd = am_getconfig_bool("media.libplayer.wfd");
+        snap->wfd_stamp_ms = now;
+    }
+    return snap->wfd;
+}
+
+static unsigned int status_snap_vpts(play_para_t *p_para)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+
+    if (status_snap_need(snap, SNAP_VPTS, 1)) {
+        snap->vpts = get_pts_video(p_para);
+    }
+    return snap->vpts;
+}
+
+static unsigned int status_snap_apts(play_para_t *p_para)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+
+    if (status_snap_need(snap, SNAP_APTS, 1)) {
+        snap->apts = get_pts_audio(p_para);
+    }
+    return snap->apts;
+}
+
+static unsigned int status_snap_pcrscr(play_para_t *p_para)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+
+    if (status_snap_need(snap, SNAP_PCRSCR, 1)) {
+        snap->pcrscr = get_pts_pcrscr(p_para);
+    }
+    return snap->pcrscr;
+}
+
+static int check_vcodec_state(codec_para_t *codec, struct vdec_status *dec, struct buf_status *buf,
+                              player_status_snap_t *snap)
 {
     int ret = 0;
 
-    ret = codec_get_vbuf_state(codec,  buf);
+    if (snap) {
+        if (status_snap_need(snap, SNAP_VSTATE, 2)) {
+            snap->vbuf_ret = codec_get_vbuf_state(codec, &snap->vbuf);
+            snap->vdec_ret = codec_get_vdec_state(codec, &snap->vdec);
+        }
+        *buf = snap->vbuf;
+        *dec = snap->vdec;
+        ret = snap->vbuf_ret;
+    } else {
+        ret = codec_get_vbuf_state(codec,  buf);
+    }
     if (ret != 0) {
         log_error("codec_get_vbuf_state error: %x\n", -ret);
     }
 
-    ret = codec_get_vdec_state(codec, dec);
+    ret = snap ? snap->vdec_ret : codec_get_vdec_state(codec, dec);
     if (ret != 0) {
         log_error("codec_get_vdec_state error: %x\n", -ret);
         ret = PLAYER_CHECK_CODEC_ERROR;
@@ -394,16 +516,27 @@ static int check_vcodec_state(codec_para_t *codec, struct vdec_status *dec, stru
     return ret;
 }
 
-static int check_acodec_state(codec_para_t *codec, struct adec_status *dec, struct buf_status *buf)
+static int check_acodec_state(codec_para_t *codec, struct adec_status *dec, struct buf_status *buf,
+                              player_status_snap_t *snap)
 {
     int ret = PLAYER_SUCCESS;
 
-    ret = codec_get_abuf_state(codec,  buf);
+    if (snap) {
+        if (status_snap_need(snap, SNAP_ASTATE, 2)) {
+            snap->abuf_ret = codec_get_abuf_state(codec, &snap->abuf);
+            snap->adec_ret = codec_get_adec_state(codec, &snap->adec);
+        }
+        *buf = snap->abuf;
+        *dec = snap->adec;
+        ret = snap->abuf_ret;
+    } else {
+        ret = codec_get_abuf_state(codec,  buf);
+    }
     if (ret != 0) {
         log_error("codec_get_abuf_state error: %x\n", -ret);
     }
 
-    ret = codec_get_adec_state(codec, dec);
+    ret = snap ? snap->adec_ret : codec_get_adec_state(codec, dec);
     if (ret != 0) {
         log_error("codec_get_adec_state error: %x\n", -ret);
         ret = PLAYER_FAILED;
@@ -477,7 +610,8 @@ static int update_codec_info(play_para_t *p_para,
                              struct buf_status *vbuf,
                              struct buf_status *abuf,
                              struct vdec_status *vdec,
-                             struct adec_status *adec)
+                             struct adec_status *adec,
+                             player_status_snap_t *snap)
 {
     codec_para_t    *vcodec = NULL;
     codec_para_t    *acodec = NULL;
@@ -495,13 +629,13 @@ static int update_codec_info(play_para_t *p_para,
         acodec = p_para->codec;
     }
     if (vcodec && p_para->vstream_info.has_video) {
-        if (check_vcodec_state(vcodec, vdec, vbuf) != 0) {
+        if (check_vcodec_state(vcodec, vdec, vbuf, snap) != 0) {
             log_error("check_vcodec_state error!\n");
             return PLAYER_FAILED;
         }
     }
     if (acodec && p_para->astream_info.has_audio) {
-        if (check_acodec_state(acodec, adec, abuf) != 0) {
+        if (check_acodec_state(acodec, adec, abuf, snap) != 0) {
             log_error("check_acodec_state error!\n");
             return PLAYER_FAILED;
         }
@@ -743,10 +877,17 @@ static unsigned int get_current_time(play_para_t *p_para)
         }
     }
     if (codec) {
-        audio_pts_discontinue = codec_get_sync_audio_discont(codec);
-        video_pts_discontinue = codec_get_sync_video_discont(codec);
-		audio_pts_discontinue_diff = codec_get_sync_audio_discont_diff(codec);
-		video_pts_discontinue_diff = codec_get_sync_video_discont_diff(codec);
+        player_status_snap_t *snap = &p_para->status_snap;
+        if (status_snap_need(snap, SNAP_DISCONT, 4)) {
+            snap->adiscont = codec_get_sync_audio_discont(codec);
+            snap->vdiscont = codec_get_sync_video_discont(codec);
+            snap->adiscont_diff = codec_get_sync_audio_discont_diff(codec);
+            snap->vdiscont_diff = codec_get_sync_video_discont_diff(codec);
+        }
+        audio_pts_discontinue = snap->adiscont;
+        video_pts_discontinue = snap->vdiscont;
+		audio_pts_discontinue_diff = snap->adiscont_diff;
+		video_pts_discontinue_diff = snap->vdiscont_diff;
     }
     if (video_pts_discontinue > 0) {
 	//log_info("video pts discontinue!, adiff=%lu,vdiff=%lu,\n",audio_pts_discontinue_diff,video_pts_discontinue_diff);		
@@ -772,15 +913,17 @@ static unsigned int get_current_time(play_para_t *p_para)
                 {
                     codec_set_sync_audio_discont(codec, 0);
     		      codec_set_sync_audio_discont_diff(codec, 0);
+    		      p_para->status_snap.valid &= ~SNAP_DISCONT;
                 }
             }
             if (codec) {
                 codec_set_sync_video_discont(codec, 0);
     		codec_set_sync_video_discont_diff(codec, 0);
+    		p_para->status_snap.valid &= ~SNAP_DISCONT;
             }           
         }        
         log_info("vpts discontinue, vpts=0x%x scr=0x%x apts=0x%x vdiff=%lu\n", 
-                    get_pts_video(p_para), get_pts_pcrscr(p_para), get_pts_audio(p_para),video_pts_discontinue_diff);
+                    status_snap_vpts(p_para), status_snap_pcrscr(p_para), status_snap_apts(p_para),video_pts_discontinue_diff);
     }
     time_adjust_flag=0;
     if (audio_pts_discontinue > 0) {
@@ -806,21 +949,23 @@ static unsigned int get_current_time(play_para_t *p_para)
               if (p_para->vstream_info.has_video&&codec) {
                   codec_set_sync_video_discont(codec, 0);
     		      codec_set_sync_video_discont_diff(codec, 0);
+    		      p_para->status_snap.valid &= ~SNAP_DISCONT;
               }
           }
           if (codec) {
               codec_set_sync_audio_discont(codec, 0);
 			  codec_set_sync_audio_discont_diff(codec, 0);
+			  p_para->status_snap.valid &= ~SNAP_DISCONT;
           }
         }
         log_info("apts discontinue, vpts=0x%x scr=0x%x apts=0x%x adiff=%lu\n", 
-                    get_pts_video(p_para), get_pts_pcrscr(p_para), get_pts_audio(p_para),audio_pts_discontinue_diff);
+                    status_snap_vpts(p_para), status_snap_pcrscr(p_para), status_snap_apts(p_para),audio_pts_discontinue_diff);
     }
 
     if (p_para->vstream_info.has_video && p_para->astream_info.has_audio) {
-        pcr_scr = get_pts_pcrscr(p_para);
-        apts = get_pts_audio(p_para);
-        vpts = get_pts_video(p_para);
+        pcr_scr = status_snap_pcrscr(p_para);
+        apts = status_snap_apts(p_para);
+        vpts = status_snap_vpts(p_para);
         if(p_para->playctrl_info.pts_valid && use_apts_as_time == 1) {
             ctime = apts;
         } else {
@@ -830,11 +975,11 @@ static unsigned int get_current_time(play_para_t *p_para)
     } else if (p_para->astream_info.has_audio)/* &&
             (p_para->stream_type == STREAM_ES) &&
             (p_para->astream_info.audio_format != AFORMAT_WMA)) */{
-        apts = get_pts_audio(p_para);
+        apts = status_snap_apts(p_para);
         ctime = apts;
     } else {
-        pcr_scr = get_pts_pcrscr(p_para);
-        vpts = get_pts_video(p_para);
+        pcr_scr = status_snap_pcrscr(p_para);
+        vpts = status_snap_vpts(p_para);
         ctime = handle_current_time(p_para, pcr_scr, vpts);   
     }
     if (ctime == 0) {
@@ -1197,11 +1342,19 @@ static int  update_buffering_states(play_para_t *p_para,
     }
     ffmpeg_seturl_buffered_level(p_para,(int)(10000*avlevel));
     if(p_para->vstream_info.has_video && get_video_codec(p_para)){
-        codec_get_video_cur_delay_ms(get_video_codec(p_para),&vdelayms);
+        if (status_snap_need(&p_para->status_snap, SNAP_VDELAY, 1)) {
+            p_para->status_snap.vdelay_ms = -1;
+            codec_get_video_cur_delay_ms(get_video_codec(p_para),&p_para->status_snap.vdelay_ms);
+        }
+        vdelayms = p_para->status_snap.vdelay_ms;
         avdelayms = vdelayms;
     }
     if(p_para->astream_info.has_audio && get_audio_codec(p_para)){
-        codec_get_audio_cur_delay_ms(get_audio_codec(p_para),&adelayms);
+        if (status_snap_need(&p_para->status_snap, SNAP_ADELAY, 1)) {
+            p_para->status_snap.adelay_ms = -1;
+            codec_get_audio_cur_delay_ms(get_audio_codec(p_para),&p_para->status_snap.adelay_ms);
+        }
+        adelayms = p_para->status_snap.adelay_ms;
         avdelayms = adelayms;
     }
     if(vdelayms >=0 && adelayms >=0)
@@ -1373,6 +1526,38 @@ static void update_decbuf_states(play_para_t *p_para, struct buf_status *vbuf, s
     }
 }
 
+/*
+ * level check before an ES write: a pass that reused the status snapshot
+ * left vbuffer/abuffer at the level of the older fetch, without the data
+ * written since. read that buffer again instead of trusting it.
+ */
+void player_status_snap_refresh_level(play_para_t *p_para, int type)
+{
+    player_status_snap_t *snap = &p_para->status_snap;
+    codec_para_t *codec = p_para->codec;
+    struct buf_status buf;
+    int es = p_para->stream_type == STREAM_ES || p_para->stream_type == STREAM_AUDIO ||
+             p_para->stream_type == STREAM_VIDEO;
+
+    if (type == CODEC_VIDEO && p_para->vstream_info.has_video && !(snap->fetched & SNAP_VSTATE)) {
+        if (es) {
+            codec = p_para->vcodec;
+        }
+        if (codec && codec_get_vbuf_state(codec, &buf) == 0) {
+            p_para->vbuffer.data_level = buf.data_len;
+            snap->queries++;
+        }
+    } else if (type == CODEC_AUDIO && p_para->astream_info.has_audio && !(snap->fetched & SNAP_ASTATE)) {
+        if (es) {
+            codec = p_para->acodec;
+        }
+        if (codec && codec_get_abuf_state(codec, &buf) == 0) {
+            p_para->abuffer.data_level = buf.data_len;
+            snap->queries++;
+        }
+    }
+}
+
 static void update_av_sync_for_audio(play_para_t *p_para)
 {
     if (!p_para->abuffer.rp_is_changed && !check_time_interrupt(&p_para->playctrl_info.avsync_check_old_time, 60)) {
@@ -1423,8 +1608,8 @@ static int check_avdiff_time(play_para_t *p_para)
     AVFormatContext *pCtx = p_para->pFormatCtx;
     int64_t time_point;
 
-    apts = get_pts_audio(p_para);
-    vpts = get_pts_video(p_para);
+    apts = status_snap_apts(p_para);
+    vpts = status_snap_vpts(p_para);
 
     if ((((apts > vpts) && (apts - vpts > diff_threshold))
         || ((apts < vpts) && (vpts - apts > diff_threshold)))
@@ -1495,20 +1680,26 @@ int update_playing_info(play_para_t *p_para)
 
     sta = get_player_state(p_para);
     if (sta > PLAYER_INITOK) {
+        status_snap_begin(p_para, sta);
         if (sta != PLAYER_SEARCHING) {
-            ret = update_codec_info(p_para, &vbuf, &abuf, &vdec, &adec);
+            ret = update_codec_info(p_para, &vbuf, &abuf, &vdec, &adec, &p_para->status_snap);
             if (ret != 0) {
                 return PLAYER_FAILED;
             }
         }
         update_dec_info(p_para, &vdec, &adec, &vbuf, &abuf);
-        update_decbuf_states(p_para, &vbuf, &abuf);
+        /*a reused snapshot would read as a read pointer that stopped moving*/
+        if (sta == PLAYER_SEARCHING ||
+            (p_para->status_snap.fetched & (SNAP_VSTATE | SNAP_ASTATE)) ||
+            !(p_para->status_snap.valid & (SNAP_VSTATE | SNAP_ASTATE))) {
+            update_decbuf_states(p_para, &vbuf, &abuf);
+        }
         update_buffering_states(p_para, &vbuf, &abuf);
         update_av_sync_for_audio(p_para);
 
 #if 1
         /* set pcm resampling for wfd */
-        if (am_getconfig_bool("media.libplayer.wfd")) {
+        if (status_snap_wfd(p_para)) {
             codec_para_t *avcodec = NULL;
             int resample_enable;
             int pcm_len = 0, pcm_ms=0;
@@ -1611,7 +1802,7 @@ int update_playing_info(play_para_t *p_para)
             p_para->state.current_time = p_para->state.seek_point;
             p_para->state.current_ms = p_para->state.current_time * 1000;
         }
-        p_para->state.pts_video = get_pts_video(p_para);
+        p_para->state.pts_video = status_snap_vpts(p_para);
     }
 
     if (p_para->playctrl_info.read_end_flag && (get_player_state(p_para) != PLAYER_PAUSE)) {
@@ -1678,7 +1869,7 @@ int player_hwbuflevel_update(play_para_t *player)
     }
     MEMSET(&vbuf, 0, sizeof(struct buf_status));
     MEMSET(&abuf, 0, sizeof(struct buf_status));
-    ret = update_codec_info(player, &vbuf, &abuf, &vdec, &adec);
+    ret = update_codec_info(player, &vbuf, &abuf, &vdec, &adec, NULL);
     if (ret == 0) {
         hwbufs.vbufused = player->media_info.stream_info.has_video;
         hwbufs.abufused = player->media_info.stream_info.has_audio;
@@ -8,6 +8,8 @@ unsigned int get_pts_pcrscr(play_para_t *p_para);
 unsigned int get_pts_video(play_para_t *p_para);
 unsigned int get_pts_audio(play_para_t *p_para);
 int     update_playing_info(play_para_t *p_para);
+void    player_status_snap_init(play_para_t *p_para);
+void    player_status_snap_refresh_level(play_para_t *p_para, int type);
 int     set_media_info(play_para_t *p_para);
 int     check_time_interrupt(long *old_msecond, int interval_ms);
 int set_ps_subtitle_info(play_para_t *p_para, subtitle_info_t *sub_info, int sub_num);
@@ -2,7 +2,13 @@ LOCAL_PATH := $(call my-dir)
 
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libfaad
-LOCAL_SRC_FILES := $(notdir $(wildcard $(LOCAL_PATH)/*.c))
+LOCAL_SRC_FILES := $(filter-out faad_simd.c, $(notdir $(wildcard $(LOCAL_PATH)/*.c)))
+#vector kernels are picked at runtime, only this file may use NEON
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += faad_simd.c.neon
+else
+LOCAL_SRC_FILES += faad_simd.c
+endif
 
 #helix aac decoder enabled
 #ENABLE_HELIX_AAC_DECODER := true
@@ -52,7 +58,13 @@ include $(CLEAR_VARS)
 LOCAL_SHARED_LIBRARIES += libutils  libz libbinder libdl libcutils libc 
 
 LOCAL_MODULE    := libfaad
-LOCAL_SRC_FILES := $(notdir $(wildcard $(LOCAL_PATH)/*.c))
+LOCAL_SRC_FILES := $(filter-out faad_simd.c, $(notdir $(wildcard $(LOCAL_PATH)/*.c)))
+#vector kernels are picked at runtime, only this file may use NEON
+ifeq ($(ARCH_ARM_HAVE_NEON),true)
+LOCAL_SRC_FILES += faad_simd.c.neon
+else
+LOCAL_SRC_FILES += faad_simd.c
+endif
 ifdef ENABLE_HELIX_AAC_DECODER
 #helix aac files
 LOCAL_SRC_FILES +=   \
@@ -43,6 +43,7 @@
 
 #include "cfft.h"
 #include "cfft_tab.h"
+#include "faad_simd.h"
 
 
 /* static function declarations */
@@ -693,7 +694,7 @@ static void passf5(const uint16_t ido, const uint16_t l1, const complex_t *cc,
 
 static INLINE void cfftf1pos(uint16_t n, complex_t *c, complex_t *ch,
                              const uint16_t *ifac, const complex_t *wa,
-                             const int8_t isign)
+                             const int8_t isign, const faad_dsp_t *dsp)
 {
     uint16_t i;
     uint16_t k1, l1, l2;
@@ -717,7 +718,14 @@ static INLINE void cfftf1pos(uint16_t n, complex_t *c, complex_t *ch,
             ix2 = iw + ido;
             ix3 = ix2 + ido;
 
-            if (na == 0)
+            if (dsp)
+            {
+                if (na == 0)
+                    dsp->passf4((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)c, ch, &wa[iw], &wa[ix2], &wa[ix3], isign);
+                else
+                    dsp->passf4((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)ch, c, &wa[iw], &wa[ix2], &wa[ix3], isign);
+            }
+            else if (na == 0)
                 passf4pos((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)c, ch, &wa[iw], &wa[ix2], &wa[ix3]);
             else
                 passf4pos((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)ch, c, &wa[iw], &wa[ix2], &wa[ix3]);
@@ -772,7 +780,7 @@ static INLINE void cfftf1pos(uint16_t n, complex_t *c, complex_t *ch,
 
 static INLINE void cfftf1neg(uint16_t n, complex_t *c, complex_t *ch,
                              const uint16_t *ifac, const complex_t *wa,
-                             const int8_t isign)
+                             const int8_t isign, const faad_dsp_t *dsp)
 {
     uint16_t i;
     uint16_t k1, l1, l2;
@@ -796,7 +804,14 @@ static INLINE void cfftf1neg(uint16_t n, complex_t *c, complex_t *ch,
             ix2 = iw + ido;
             ix3 = ix2 + ido;
 
-            if (na == 0)
+            if (dsp)
+            {
+                if (na == 0)
+                    dsp->passf4((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)c, ch, &wa[iw], &wa[ix2], &wa[ix3], isign);
+                else
+                    dsp->passf4((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)ch, c, &wa[iw], &wa[ix2], &wa[ix3], isign);
+            }
+            else if (na == 0)
                 passf4neg((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)c, ch, &wa[iw], &wa[ix2], &wa[ix3]);
             else
                 passf4neg((const uint16_t)ido, (const uint16_t)l1, (const complex_t*)ch, c, &wa[iw], &wa[ix2], &wa[ix3]);
@@ -851,12 +866,28 @@ static INLINE void cfftf1neg(uint16_t n, complex_t *c, complex_t *ch,
 
 void cfftf(cfft_info *cfft, complex_t *c)
 {
-    cfftf1neg(cfft->n, c, cfft->work, (const uint16_t*)cfft->ifac, (const complex_t*)cfft->tab, -1);
+    const faad_dsp_t *dsp = faad_dsp;
+
+    if (cfft->simd && dsp->cfft)
+    {
+        dsp->cfft(cfft->simd, c, -1);
+        return;
+    }
+    cfftf1neg(cfft->n, c, cfft->work, (const uint16_t*)cfft->ifac, (const complex_t*)cfft->tab, -1,
+        (dsp->passf4 && faad_simd_cfft_size(cfft->n)) ? dsp : NULL);
 }
 
 void cfftb(cfft_info *cfft, complex_t *c)
 {
-    cfftf1pos(cfft->n, c, cfft->work, (const uint16_t*)cfft->ifac, (const complex_t*)cfft->tab, +1);
+    const faad_dsp_t *dsp = faad_dsp;
+
+    if (cfft->simd && dsp->cfft)
+    {
+        dsp->cfft(cfft->simd, c, +1);
+        return;
+    }
+    cfftf1pos(cfft->n, c, cfft->work, (const uint16_t*)cfft->ifac, (const complex_t*)cfft->tab, +1,
+        (dsp->passf4 && faad_simd_cfft_size(cfft->n)) ? dsp : NULL);
 }
 
 static void cffti1(uint16_t n, complex_t *wa, uint16_t *ifac)
@@ -967,7 +998,9 @@ cfft_info *cffti(uint16_t n)
     cfft->tab = (complex_t*)faad_malloc(n*sizeof(complex_t));
 
     cffti1(n, cfft->tab, cfft->ifac);
+    cfft->simd = faad_simd_cffti(n);
 #else
+    cfft->simd = NULL;
     cffti1(n, NULL, cfft->ifac);
 
     switch (n)
@@ -997,6 +1030,7 @@ void cfftu(cfft_info *cfft)
     if (cfft->work) faad_free(cfft->work);
 #ifndef FIXED_POINT
     if (cfft->tab) faad_free(cfft->tab);
+    faad_simd_cfftu(cfft->simd);
 #endif
 
     if (cfft) faad_free(cfft);
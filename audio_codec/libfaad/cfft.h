@@ -41,6 +41,7 @@ typedef struct
     uint16_t ifac[15];
     complex_t *work;
     complex_t *tab;
+    struct faad_simd_cfft *simd;    /* float vector plan, NULL if none */
 } cfft_info;
 
 
@@ -40,6 +40,7 @@
 #include "output.h"
 #include "filtbank.h"
 #include "drc.h"
+#include "faad_simd.h"
 #ifdef SBR_DEC
 #include "sbr_dec.h"
 #include "sbr_syntax.h"
@@ -677,6 +678,8 @@ NeAACDecHandle NEAACDECAPI NeAACDecOpen(void)
     if ((hDecoder = (NeAACDecStruct*)faad_malloc(sizeof(NeAACDecStruct))) == NULL)
         return NULL;
 
+    faad_simd_init();
+
     memset(hDecoder, 0, sizeof(NeAACDecStruct));
 
     hDecoder->cmes = mes;
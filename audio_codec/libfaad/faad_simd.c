@@ -0,0 +1,567 @@
+/*
+** FAAD2 - Freeware Advanced Audio (AAC) Decoder including SBR decoding
+** Copyright (C) 2003-2005 M. Bakker, Nero AG, http://www.nero.com
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+**
+** Any non-GPL usage of this software or parts of this software is strictly
+** forbidden.
+**
+** The "appropriate copyright message" mentioned in section 2c of the GPLv2
+** must read: "Code from FAAD2 is copyright (c) Nero AG, www.nero.com"
+**
+** Commercial non-GPL licensing of this software is possible.
+** For more info contact Nero AG through Mpeg4AAClicense@nero.com.
+**
+** $Id: faad_simd.c,v 1.0 2013/06/20 amlogic Exp $
+**/
+
+/*
+ * SSE/NEON versions of the SBR QMF windowing and of the cfft.
+ *
+ * The real_t kernels (QMF window, radix-4 pass of the 60/240/480 cfft)
+ * only use separate multiplies and adds in the same order as the C code,
+ * so results match the C path bit for bit unless the C build itself
+ * contracts to fused multiply-add.
+ *
+ * real_t is double with USE_DOUBLE_PRECISION; NEON has no double lanes on
+ * ARMv7, so the real_t kernels only exist on x86 and AArch64. The power
+ * of two cfft (64/256/512, the 2048/512/1024 point MDCTs) is done in float
+ * vectors on every target, converting at the boundary; it is within float
+ * rounding of the C path, like a build without USE_DOUBLE_PRECISION.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+#include "common.h"
+#include "structs.h"
+
+#include "faad_simd.h"
+
+#ifndef FIXED_POINT
+/* 4 float lanes, for the cfft whatever real_t is */
+# if defined(__SSE__)
+#  include <xmmintrin.h>
+#  define FAAD_SIMD_ARCH FAAD_SIMD_SSE
+   typedef __m128 vfloat_t;
+#  define FVLD(p)       _mm_loadu_ps(p)
+#  define FVST(p, a)    _mm_storeu_ps(p, a)
+#  define FVADD(a, b)   _mm_add_ps(a, b)
+#  define FVSUB(a, b)   _mm_sub_ps(a, b)
+#  define FVMUL(a, b)   _mm_mul_ps(a, b)
+#  define FVDUP(x)      _mm_set1_ps(x)
+#  define FVTRANSPOSE4(r0, r1, r2, r3) _MM_TRANSPOSE4_PS(r0, r1, r2, r3)
+# elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#  include <arm_neon.h>
+#  define FAAD_SIMD_ARCH FAAD_SIMD_NEON
+   typedef float32x4_t vfloat_t;
+#  define FVLD(p)       vld1q_f32(p)
+#  define FVST(p, a)    vst1q_f32(p, a)
+#  define FVADD(a, b)   vaddq_f32(a, b)
+#  define FVSUB(a, b)   vsubq_f32(a, b)
+#  define FVMUL(a, b)   vmulq_f32(a, b)
+#  define FVDUP(x)      vdupq_n_f32(x)
+#  define FVTRANSPOSE4(r0, r1, r2, r3) do { \
+        float32x4x2_t t01_ = vtrnq_f32(r0, r1); \
+        float32x4x2_t t23_ = vtrnq_f32(r2, r3); \
+        r0 = vcombine_f32(vget_low_f32(t01_.val[0]), vget_low_f32(t23_.val[0])); \
+        r1 = vcombine_f32(vget_low_f32(t01_.val[1]), vget_low_f32(t23_.val[1])); \
+        r2 = vcombine_f32(vget_high_f32(t01_.val[0]), vget_high_f32(t23_.val[0])); \
+        r3 = vcombine_f32(vget_high_f32(t01_.val[1]), vget_high_f32(t23_.val[1])); \
+    } while (0)
+# endif
+
+/* real_t lanes */
+# if defined(USE_DOUBLE_PRECISION)
+#  if defined(__SSE2__)
+#   include <emmintrin.h>
+#   define VLANES 2
+    typedef __m128d vreal_t;
+#   define VLD(p)        _mm_loadu_pd(p)
+#   define VST(p, a)     _mm_storeu_pd(p, a)
+#   define VADD(a, b)    _mm_add_pd(a, b)
+#   define VSUB(a, b)    _mm_sub_pd(a, b)
+#   define VMUL(a, b)    _mm_mul_pd(a, b)
+#   define VDUP(x)       _mm_set1_pd(x)
+#   define VSET2(lo, hi) _mm_set_pd(hi, lo)
+#   define VSWAP(a)      _mm_shuffle_pd(a, a, 1)
+#  elif defined(__aarch64__)
+#   define VLANES 2
+    typedef float64x2_t vreal_t;
+#   define VLD(p)        vld1q_f64(p)
+#   define VST(p, a)     vst1q_f64(p, a)
+#   define VADD(a, b)    vaddq_f64(a, b)
+#   define VSUB(a, b)    vsubq_f64(a, b)
+#   define VMUL(a, b)    vmulq_f64(a, b)
+#   define VDUP(x)       vdupq_n_f64(x)
+#   define VSET2(lo, hi) vcombine_f64(vdup_n_f64(lo), vdup_n_f64(hi))
+#   define VSWAP(a)      vextq_f64(a, a, 1)
+#  endif
+# elif defined(FAAD_SIMD_ARCH)
+#  define VLANES 4
+   typedef vfloat_t vreal_t;
+#  define VLD(p)        FVLD(p)
+#  define VST(p, a)     FVST(p, a)
+#  define VADD(a, b)    FVADD(a, b)
+#  define VMUL(a, b)    FVMUL(a, b)
+# endif
+#endif /* FIXED_POINT */
+
+#if defined(FAAD_SIMD_ARCH) && FAAD_SIMD_ARCH == FAAD_SIMD_SSE && !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+static int8_t simd_detected = -1;
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+#ifdef FAAD_SIMD_ARCH
+
+#ifdef VLANES
+/* lengths used by sbr_qmf.c are 32 and 64, always a multiple of VLANES */
+static void qmf_window_simd(real_t *out, const uint16_t len, const real_t *v,
+                            const uint16_t *voff, const uint8_t taps,
+                            const real_t *c, const uint16_t cstride)
+{
+    const real_t *pv[10], *pc[10];
+    uint16_t k;
+    uint8_t j;
+
+    for (j = 0; j < taps; j++)
+    {
+        pv[j] = v + voff[j];
+        pc[j] = c + j*cstride;
+    }
+
+    if (taps == 10)
+    {
+        for (k = 0; k < len; k += VLANES)
+        {
+            vreal_t acc = VMUL(VLD(pv[0] + k), VLD(pc[0] + k));
+            acc = VADD(acc, VMUL(VLD(pv[1] + k), VLD(pc[1] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[2] + k), VLD(pc[2] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[3] + k), VLD(pc[3] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[4] + k), VLD(pc[4] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[5] + k), VLD(pc[5] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[6] + k), VLD(pc[6] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[7] + k), VLD(pc[7] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[8] + k), VLD(pc[8] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[9] + k), VLD(pc[9] + k)));
+            VST(out + k, acc);
+        }
+    } else if (taps == 5) {
+        for (k = 0; k < len; k += VLANES)
+        {
+            vreal_t acc = VMUL(VLD(pv[0] + k), VLD(pc[0] + k));
+            acc = VADD(acc, VMUL(VLD(pv[1] + k), VLD(pc[1] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[2] + k), VLD(pc[2] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[3] + k), VLD(pc[3] + k)));
+            acc = VADD(acc, VMUL(VLD(pv[4] + k), VLD(pc[4] + k)));
+            VST(out + k, acc);
+        }
+    } else {
+        for (k = 0; k < len; k += VLANES)
+        {
+            vreal_t acc = VMUL(VLD(pv[0] + k), VLD(pc[0] + k));
+
+            for (j = 1; j < taps; j++)
+                acc = VADD(acc, VMUL(VLD(pv[j] + k), VLD(pc[j] + k)));
+
+            VST(out + k, acc);
+        }
+    }
+}
+
+#if VLANES == 2
+/* one complex_t per vector: { RE, IM } */
+static void passf4_simd(const uint16_t ido, const uint16_t l1, const complex_t *cc,
+                        complex_t *ch, const complex_t *wa1, const complex_t *wa2,
+                        const complex_t *wa3, const int8_t isign)
+{
+    /* t4 = { IM(a3) - IM(a1), RE(a1) - RE(a3) } = swap(a1 - a3) * { -1, 1 } */
+    const vreal_t rot = VSET2(-1.0, 1.0);
+    /* backward: c * w, forward: c * conj(w) */
+    const vreal_t wsign = (isign > 0) ? VSET2(-1.0, 1.0) : VSET2(1.0, -1.0);
+    uint16_t i, k, ac, ah;
+
+    for (k = 0; k < l1; k++)
+    {
+        ac = 4*k*ido;
+        ah = k*ido;
+
+        for (i = 0; i < ido; i++)
+        {
+            vreal_t a0 = VLD(cc[ac+i]);
+            vreal_t a1 = VLD(cc[ac+i+ido]);
+            vreal_t a2 = VLD(cc[ac+i+2*ido]);
+            vreal_t a3 = VLD(cc[ac+i+3*ido]);
+            vreal_t t1 = VSUB(a0, a2);
+            vreal_t t2 = VADD(a0, a2);
+            vreal_t t3 = VADD(a1, a3);
+            vreal_t t4 = VMUL(VSWAP(VSUB(a1, a3)), rot);
+            vreal_t c2, c3, c4;
+
+            if (isign > 0)
+            {
+                c2 = VADD(t1, t4);
+                c4 = VSUB(t1, t4);
+            } else {
+                c2 = VSUB(t1, t4);
+                c4 = VADD(t1, t4);
+            }
+            c3 = VSUB(t2, t3);
+
+            VST(ch[ah+i], VADD(t2, t3));
+
+            if (ido == 1)
+            {
+                VST(ch[ah+i+l1], c2);
+                VST(ch[ah+i+2*l1], c3);
+                VST(ch[ah+i+3*l1], c4);
+            } else {
+                VST(ch[ah+i+l1*ido], VADD(VMUL(c2, VDUP(RE(wa1[i]))),
+                    VMUL(VMUL(VSWAP(c2), VDUP(IM(wa1[i]))), wsign)));
+                VST(ch[ah+i+2*l1*ido], VADD(VMUL(c3, VDUP(RE(wa2[i]))),
+                    VMUL(VMUL(VSWAP(c3), VDUP(IM(wa2[i]))), wsign)));
+                VST(ch[ah+i+3*l1*ido], VADD(VMUL(c4, VDUP(RE(wa3[i]))),
+                    VMUL(VMUL(VSWAP(c4), VDUP(IM(wa3[i]))), wsign)));
+            }
+        }
+    }
+}
+#endif
+
+#endif /* VLANES */
+
+/*
+ * Stockham radix-4 cfft in float, split re/im, natural order in and out.
+ * Stage (ns, s): m = ns/4 butterflies of stride s, twiddle w^p with
+ * w = exp(-2*pi*i/ns), then ns/4 and 4*s; a last radix-2 stage when
+ * log2(n) is odd. The first stage (s == 1) runs 4 butterflies per vector
+ * and transposes the outputs, the others run 4 strides per vector.
+ */
+struct faad_simd_cfft
+{
+    uint16_t n;
+    float *xr, *xi, *yr, *yi;
+    float *tw;      /* per radix-4 stage: re w^p, im w^p, re w^2p, im w^2p, re w^3p, im w^3p, m each */
+};
+
+static void cfft_stage1(const uint16_t m, const float *xr, const float *xi,
+                        float *yr, float *yi, const float *tw, const vfloat_t sgn)
+{
+    uint16_t p;
+
+    for (p = 0; p < m; p += 4)
+    {
+        vfloat_t ar = FVLD(xr + p), ai = FVLD(xi + p);
+        vfloat_t br = FVLD(xr + p + m), bi = FVLD(xi + p + m);
+        vfloat_t cr = FVLD(xr + p + 2*m), ci = FVLD(xi + p + 2*m);
+        vfloat_t dr = FVLD(xr + p + 3*m), di = FVLD(xi + p + 3*m);
+        vfloat_t w1r = FVLD(tw + p), w1i = FVMUL(FVLD(tw + m + p), sgn);
+        vfloat_t w2r = FVLD(tw + 2*m + p), w2i = FVMUL(FVLD(tw + 3*m + p), sgn);
+        vfloat_t w3r = FVLD(tw + 4*m + p), w3i = FVMUL(FVLD(tw + 5*m + p), sgn);
+        vfloat_t t1r = FVADD(ar, cr), t1i = FVADD(ai, ci);
+        vfloat_t t2r = FVSUB(ar, cr), t2i = FVSUB(ai, ci);
+        vfloat_t t3r = FVADD(br, dr), t3i = FVADD(bi, di);
+        /* -i*(b - d) forward, +i*(b - d) backward */
+        vfloat_t t4r = FVMUL(FVSUB(bi, di), sgn), t4i = FVMUL(FVSUB(dr, br), sgn);
+        vfloat_t y0r = FVADD(t1r, t3r), y0i = FVADD(t1i, t3i);
+        vfloat_t ur = FVSUB(t1r, t3r), ui = FVSUB(t1i, t3i);
+        vfloat_t vr = FVADD(t2r, t4r), vi = FVADD(t2i, t4i);
+        vfloat_t zr = FVSUB(t2r, t4r), zi = FVSUB(t2i, t4i);
+        vfloat_t y1r = FVSUB(FVMUL(vr, w1r), FVMUL(vi, w1i)), y1i = FVADD(FVMUL(vr, w1i), FVMUL(vi, w1r));
+        vfloat_t y2r = FVSUB(FVMUL(ur, w2r), FVMUL(ui, w2i)), y2i = FVADD(FVMUL(ur, w2i), FVMUL(ui, w2r));
+        vfloat_t y3r = FVSUB(FVMUL(zr, w3r), FVMUL(zi, w3i)), y3i = FVADD(FVMUL(zr, w3i), FVMUL(zi, w3r));
+
+        /* y[4p + k]: lane l of yk goes to 4*(p + l) + k */
+        FVTRANSPOSE4(y0r, y1r, y2r, y3r);
+        FVTRANSPOSE4(y0i, y1i, y2i, y3i);
+        FVST(yr + 4*p, y0r);
+        FVST(yr + 4*p + 4, y1r);
+        FVST(yr + 4*p + 8, y2r);
+        FVST(yr + 4*p + 12, y3r);
+        FVST(yi + 4*p, y0i);
+        FVST(yi + 4*p + 4, y1i);
+        FVST(yi + 4*p + 8, y2i);
+        FVST(yi + 4*p + 12, y3i);
+    }
+}
+
+static void cfft_stage4(const uint16_t m, const uint16_t s, const float *xr, const float *xi,
+                        float *yr, float *yi, const float *tw, const float fsgn)
+{
+    const vfloat_t sgn = FVDUP(fsgn);
+    uint16_t p, q;
+
+    for (p = 0; p < m; p++)
+    {
+        const vfloat_t w1r = FVDUP(tw[p]), w1i = FVDUP(fsgn * tw[m + p]);
+        const vfloat_t w2r = FVDUP(tw[2*m + p]), w2i = FVDUP(fsgn * tw[3*m + p]);
+        const vfloat_t w3r = FVDUP(tw[4*m + p]), w3i = FVDUP(fsgn * tw[5*m + p]);
+        const float *ar_ = xr + s*p, *ai_ = xi + s*p;
+        float *yr_ = yr + 4*s*p, *yi_ = yi + 4*s*p;
+
+        for (q = 0; q < s; q += 4)
+        {
+            vfloat_t ar = FVLD(ar_ + q), ai = FVLD(ai_ + q);
+            vfloat_t br = FVLD(ar_ + s*m + q), bi = FVLD(ai_ + s*m + q);
+            vfloat_t cr = FVLD(ar_ + 2*s*m + q), ci = FVLD(ai_ + 2*s*m + q);
+            vfloat_t dr = FVLD(ar_ + 3*s*m + q), di = FVLD(ai_ + 3*s*m + q);
+            vfloat_t t1r = FVADD(ar, cr), t1i = FVADD(ai, ci);
+            vfloat_t t2r = FVSUB(ar, cr), t2i = FVSUB(ai, ci);
+            vfloat_t t3r = FVADD(br, dr), t3i = FVADD(bi, di);
+            vfloat_t t4r = FVMUL(FVSUB(bi, di), sgn), t4i = FVMUL(FVSUB(dr, br), sgn);
+            vfloat_t ur = FVSUB(t1r, t3r), ui = FVSUB(t1i, t3i);
+            vfloat_t vr = FVADD(t2r, t4r), vi = FVADD(t2i, t4i);
+            vfloat_t zr = FVSUB(t2r, t4r), zi = FVSUB(t2i, t4i);
+
+            FVST(yr_ + q, FVADD(t1r, t3r));
+            FVST(yi_ + q, FVADD(t1i, t3i));
+            FVST(yr_ + s + q, FVSUB(FVMUL(vr, w1r), FVMUL(vi, w1i)));
+            FVST(yi_ + s + q, FVADD(FVMUL(vr, w1i), FVMUL(vi, w1r)));
+            FVST(yr_ + 2*s + q, FVSUB(FVMUL(ur, w2r), FVMUL(ui, w2i)));
+            FVST(yi_ + 2*s + q, FVADD(FVMUL(ur, w2i), FVMUL(ui, w2r)));
+            FVST(yr_ + 3*s + q, FVSUB(FVMUL(zr, w3r), FVMUL(zi, w3i)));
+            FVST(yi_ + 3*s + q, FVADD(FVMUL(zr, w3i), FVMUL(zi, w3r)));
+        }
+    }
+}
+
+/* the last stage of an odd power of two, ns == 2 */
+static void cfft_stage2(const uint16_t s, const float *xr, const float *xi, float *yr, float *yi)
+{
+    uint16_t q;
+
+    for (q = 0; q < s; q += 4)
+    {
+        vfloat_t ar = FVLD(xr + q), ai = FVLD(xi + q);
+        vfloat_t br = FVLD(xr + s + q), bi = FVLD(xi + s + q);
+
+        FVST(yr + q, FVADD(ar, br));
+        FVST(yi + q, FVADD(ai, bi));
+        FVST(yr + s + q, FVSUB(ar, br));
+        FVST(yi + s + q, FVSUB(ai, bi));
+    }
+}
+
+/* isign is +1 for backward and -1 for forward, like cfftb/cfftf */
+static void cfft_simd(faad_simd_cfft_t *p, complex_t *c, const int8_t isign)
+{
+    const float fsgn = (isign > 0) ? -1.0f : 1.0f;
+    const float *tw = p->tw;
+    float *xr = p->xr, *xi = p->xi, *yr = p->yr, *yi = p->yi, *t;
+    uint16_t ns = p->n, s = 1, i;
+
+    for (i = 0; i < p->n; i++)
+    {
+        xr[i] = (float)RE(c[i]);
+        xi[i] = (float)IM(c[i]);
+    }
+    while (ns > 1)
+    {
+        if (ns & 3)
+        {
+            cfft_stage2(s, xr, xi, yr, yi);
+        } else {
+            if (s == 1)
+                cfft_stage1(ns/4, xr, xi, yr, yi, tw, FVDUP(fsgn));
+            else
+                cfft_stage4(ns/4, s, xr, xi, yr, yi, tw, fsgn);
+            tw += 6*(ns/4);
+        }
+        s *= (ns & 3) ? 2 : 4;
+        ns /= (ns & 3) ? 2 : 4;
+        t = xr; xr = yr; yr = t;
+        t = xi; xi = yi; yi = t;
+    }
+    for (i = 0; i < p->n; i++)
+    {
+        RE(c[i]) = (real_t)xr[i];
+        IM(c[i]) = (real_t)xi[i];
+    }
+}
+
+static uint8_t faad_simd_detect(void)
+{
+#if FAAD_SIMD_ARCH == FAAD_SIMD_SSE
+# if defined(__x86_64__)
+    return FAAD_SIMD_SSE;
+# else
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return FAAD_SIMD_NONE;
+#  if defined(VLANES) && VLANES == 2
+    return (edx & (1 << 26)) ? FAAD_SIMD_SSE : FAAD_SIMD_NONE;
+#  else
+    return (edx & (1 << 25)) ? FAAD_SIMD_SSE : FAAD_SIMD_NONE;
+#  endif
+# endif
+#else
+# if defined(__aarch64__)
+    return FAAD_SIMD_NEON;
+# else
+    char line[512];
+    uint8_t level = FAAD_SIMD_NONE;
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+
+    if (fp == NULL)
+        return FAAD_SIMD_NONE;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (!strncmp(line, "Features", 8) && strstr(line, " neon"))
+        {
+            level = FAAD_SIMD_NEON;
+            break;
+        }
+    }
+    fclose(fp);
+    return level;
+# endif
+#endif
+}
+
+#endif /* FAAD_SIMD_ARCH */
+
+/*
+ * the tables are constant, selecting a level only swaps the pointer, so
+ * decoders running on other threads see one table or the other
+ */
+static const faad_dsp_t faad_dsp_c = { FAAD_SIMD_NONE, NULL, NULL, NULL };
+#ifdef FAAD_SIMD_ARCH
+static const faad_dsp_t faad_dsp_vec =
+{
+    FAAD_SIMD_ARCH,
+#ifdef VLANES
+    qmf_window_simd,
+#else
+    NULL,
+#endif
+#if defined(VLANES) && VLANES == 2
+    passf4_simd,
+#else
+    NULL,
+#endif
+    cfft_simd
+};
+#endif
+
+const faad_dsp_t * volatile faad_dsp = &faad_dsp_c;
+
+static uint8_t simd_select(uint8_t level)
+{
+    const faad_dsp_t *dsp = &faad_dsp_c;
+
+#ifdef FAAD_SIMD_ARCH
+    if (level != FAAD_SIMD_NONE && level == simd_detected)
+        dsp = &faad_dsp_vec;
+#endif
+    __sync_synchronize();
+    faad_dsp = dsp;
+
+    return dsp->level;
+}
+
+static void simd_init_once(void)
+{
+    const char *env;
+
+#ifdef FAAD_SIMD_ARCH
+    simd_detected = faad_simd_detect();
+#else
+    simd_detected = FAAD_SIMD_NONE;
+#endif
+
+    env = getenv("FAAD_SIMD");
+    if (env && atoi(env) == 0)
+        simd_select(FAAD_SIMD_NONE);
+    else
+        simd_select(simd_detected);
+}
+
+uint8_t faad_simd_init(void)
+{
+    pthread_once(&simd_once, simd_init_once);
+    return faad_dsp->level;
+}
+
+uint8_t faad_simd_select(uint8_t level)
+{
+    faad_simd_init();
+    return simd_select(level);
+}
+
+/* the vector radix-4 pass only wins next to the radix-3/5 passes of the
+ * 60/240/480 transforms, the power of two ones go through faad_dsp->cfft */
+uint8_t faad_simd_cfft_size(uint16_t n)
+{
+    return (n == 60 || n == 240 || n == 480);
+}
+
+faad_simd_cfft_t *faad_simd_cffti(uint16_t n)
+{
+#ifdef FAAD_SIMD_ARCH
+    faad_simd_cfft_t *p;
+    uint16_t ns, m, k;
+    float *tw;
+
+    /* 4 butterflies per vector in the first stage */
+    if (n < 16 || (n & (n - 1)))
+        return NULL;
+    faad_simd_init();
+    if (simd_detected == FAAD_SIMD_NONE)
+        return NULL;
+
+    p = (faad_simd_cfft_t*)faad_malloc(sizeof(faad_simd_cfft_t));
+    p->n = n;
+    p->xr = (float*)faad_malloc(4*n*sizeof(float));
+    p->xi = p->xr + n;
+    p->yr = p->xi + n;
+    p->yi = p->yr + n;
+    /* 6*(n/4 + n/16 + ...) < 2*n */
+    p->tw = tw = (float*)faad_malloc(2*n*sizeof(float));
+    for (ns = n; ns >= 4 && !(ns & 3); ns /= 4)
+    {
+        m = ns/4;
+        for (k = 0; k < m; k++)
+        {
+            double a = 2.0*M_PI*k/ns;
+
+            tw[k] = (float)cos(a);
+            tw[m + k] = (float)-sin(a);
+            tw[2*m + k] = (float)cos(2*a);
+            tw[3*m + k] = (float)-sin(2*a);
+            tw[4*m + k] = (float)cos(3*a);
+            tw[5*m + k] = (float)-sin(3*a);
+        }
+        tw += 6*m;
+    }
+    return p;
+#else
+    (void)n;
+    return NULL;
+#endif
+}
+
+void faad_simd_cfftu(faad_simd_cfft_t *p)
+{
+    if (p == NULL)
+        return;
+    faad_free(p->xr);
+    faad_free(p->tw);
+    faad_free(p);
+}
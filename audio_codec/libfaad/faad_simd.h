@@ -0,0 +1,90 @@
+/*
+** FAAD2 - Freeware Advanced Audio (AAC) Decoder including SBR decoding
+** Copyright (C) 2003-2005 M. Bakker, Nero AG, http://www.nero.com
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+**
+** Any non-GPL usage of this software or parts of this software is strictly
+** forbidden.
+**
+** The "appropriate copyright message" mentioned in section 2c of the GPLv2
+** must read: "Code from FAAD2 is copyright (c) Nero AG, www.nero.com"
+**
+** Commercial non-GPL licensing of this software is possible.
+** For more info contact Nero AG through Mpeg4AAClicense@nero.com.
+**
+** $Id: faad_simd.h,v 1.0 2013/06/20 amlogic Exp $
+**/
+
+#ifndef __FAAD_SIMD_H__
+#define __FAAD_SIMD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FAAD_SIMD_NONE  0
+#define FAAD_SIMD_SSE   1
+#define FAAD_SIMD_NEON  2
+
+/* float plan of a power of two cfft, see faad_simd_cffti() */
+typedef struct faad_simd_cfft faad_simd_cfft_t;
+
+/*
+** Vector kernels selected at runtime by faad_simd_init().
+** A NULL entry means the plain C code path is used.
+*/
+typedef struct
+{
+    uint8_t level;
+
+    /* out[k] = sum(j < taps) v[voff[j] + k] * c[j*cstride + k], 0 <= k < len,
+     * accumulated in the same order as the C loops in sbr_qmf.c */
+    void (*qmf_window)(real_t *out, const uint16_t len, const real_t *v,
+                       const uint16_t *voff, const uint8_t taps,
+                       const real_t *c, const uint16_t cstride);
+
+    /* radix-4 butterfly of cfft.c, isign is +1 for backward and -1 for forward */
+    void (*passf4)(const uint16_t ido, const uint16_t l1, const complex_t *cc,
+                   complex_t *ch, const complex_t *wa1, const complex_t *wa2,
+                   const complex_t *wa3, const int8_t isign);
+
+    /* whole cfft of a plan from faad_simd_cffti(), in float vectors */
+    void (*cfft)(faad_simd_cfft_t *p, complex_t *c, const int8_t isign);
+} faad_dsp_t;
+
+/* one of two constant tables, read it once per call */
+extern const faad_dsp_t * volatile faad_dsp;
+
+/* detect cpu features and fill faad_dsp once, safe from several threads;
+ * FAAD_SIMD=0 in the environment keeps the C path for comparison runs */
+uint8_t faad_simd_init(void);
+
+/* non zero when faad_dsp->passf4, if any, is to be used for a cfft of size n */
+uint8_t faad_simd_cfft_size(uint16_t n);
+
+/* plan for faad_dsp->cfft, NULL when n is no power of two >= 16 or the
+ * cpu has no vector unit */
+faad_simd_cfft_t *faad_simd_cffti(uint16_t n);
+void faad_simd_cfftu(faad_simd_cfft_t *p);
+
+/* force a level not higher than the detected one, FAAD_SIMD_NONE selects C */
+uint8_t faad_simd_select(uint8_t level);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -35,10 +35,36 @@
 
 
 #include <string.h>
+#include <pthread.h>
 #include "sbr_dct.h"
 #include "sbr_qmf.h"
 #include "sbr_qmf_c.h"
 #include "sbr_syntax.h"
+#include "faad_simd.h"
+
+#ifndef FIXED_POINT
+/* qmf_c[2*n] deinterleaved, so the vector window kernels read it linearly */
+static real_t qmf_c_even[320];
+static pthread_once_t qmf_c_even_once = PTHREAD_ONCE_INIT;
+
+static const uint16_t qmfa_window_off[5] = { 0, 64, 128, 192, 256 };
+static const uint16_t qmfs32_window_off[10] = { 0, 96, 128, 224, 256, 352, 384, 480, 512, 608 };
+static const uint16_t qmfs64_window_off[10] = { 0, 192, 256, 448, 512, 704, 768, 960, 1024, 1216 };
+
+static void qmf_c_even_fill(void)
+{
+    uint16_t n;
+
+    for (n = 0; n < 320; n++)
+        qmf_c_even[n] = qmf_c[2*n];
+}
+
+/* decoders are opened from several threads */
+static void qmf_c_even_init(void)
+{
+    pthread_once(&qmf_c_even_once, qmf_c_even_fill);
+}
+#endif
 
 qmfa_info *qmfa_init(uint8_t channels)
 {
@@ -53,6 +79,10 @@ qmfa_info *qmfa_init(uint8_t channels)
 
     qmfa->channels = channels;
 
+#ifndef FIXED_POINT
+    qmf_c_even_init();
+#endif
+
     return qmfa;
 }
 
@@ -68,6 +98,9 @@ void qmfa_end(qmfa_info *qmfa)
 void sbr_qmf_analysis_32(sbr_info *sbr, qmfa_info *qmfa, const real_t *input,
                          qmf_t X[MAX_NTSRHFG][64], uint8_t offset, uint8_t kx)
 {
+#ifndef FIXED_POINT
+    const faad_dsp_t *dsp = faad_dsp;
+#endif
     ALIGN real_t u[64];
 #ifndef SBR_LOW_POWER
     ALIGN real_t in_real[32], in_imag[32], out_real[32], out_imag[32];
@@ -97,6 +130,12 @@ void sbr_qmf_analysis_32(sbr_info *sbr, qmfa_info *qmfa, const real_t *input,
         }
 
         /* window and summation to create array u */
+#ifndef FIXED_POINT
+        if (dsp->qmf_window)
+        {
+            dsp->qmf_window(u, 64, qmfa->x + qmfa->x_index, qmfa_window_off, 5, qmf_c_even, 64);
+        } else
+#endif
         for (n = 0; n < 64; n++)
         {
             u[n] = MUL_F(qmfa->x[qmfa->x_index + n], qmf_c[2*n]) +
@@ -234,6 +273,10 @@ qmfs_info *qmfs_init(uint8_t channels)
 
     qmfs->channels = channels;
 
+#ifndef FIXED_POINT
+    qmf_c_even_init();
+#endif
+
     return qmfs;
 }
 
@@ -390,6 +433,9 @@ void sbr_qmf_synthesis_64(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][6
 void sbr_qmf_synthesis_32(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][64],
                           real_t *output)
 {
+#ifndef FIXED_POINT
+    const faad_dsp_t *dsp = faad_dsp;
+#endif
     ALIGN real_t x1[32], x2[32];
 #ifndef FIXED_POINT
     real_t scale = 1.f/64.f;
@@ -432,6 +478,13 @@ void sbr_qmf_synthesis_32(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][6
         }
 
         /* calculate 32 output samples and window */
+#ifndef FIXED_POINT
+        if (dsp->qmf_window)
+        {
+            dsp->qmf_window(output + out, 32, qmfs->v + qmfs->v_index, qmfs32_window_off, 10, qmf_c_even, 32);
+            out += 32;
+        } else
+#endif
         for (k = 0; k < 32; k++)
         {
             output[out++] = MUL_F(qmfs->v[qmfs->v_index + k], qmf_c[2*k]) +
@@ -456,6 +509,9 @@ void sbr_qmf_synthesis_32(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][6
 void sbr_qmf_synthesis_64(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][64],
                           real_t *output)
 {
+#ifndef FIXED_POINT
+    const faad_dsp_t *dsp = faad_dsp;
+#endif
 //    ALIGN real_t x1[64], x2[64];
 #ifndef SBR_LOW_POWER
     ALIGN real_t in_real1[32], in_imag1[32], out_real1[32], out_imag1[32];
@@ -595,6 +651,13 @@ void sbr_qmf_synthesis_64(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSRHFG][6
 #endif // #ifdef PREFER_POINTERS
 
         /* calculate 64 output samples and window */
+#ifndef FIXED_POINT
+        if (dsp->qmf_window)
+        {
+            dsp->qmf_window(output + out, 64, pring_buffer_1, qmfs64_window_off, 10, qmf_c, 64);
+            out += 64;
+        } else
+#endif
         for (k = 0; k < 64; k++)
         {
 #ifdef PREFER_POINTERS
@@ -232,6 +232,60 @@ static void signal_handler(int signum)
 	raise (signum);
 }
 
+/*
+ * ms since the process was started,from its start time in /proc/self/stat
+ * (clock ticks since boot) and /proc/uptime,so the exec and the loading
+ * of the libraries are counted too.
+ */
+static long process_uptime_ms(void)
+{
+    char buf[512];
+    char *p;
+    unsigned long long start_ticks = 0;
+    double uptime = 0;
+    FILE *fp;
+    int i;
+
+    fp = fopen("/proc/self/stat", "r");
+    if (!fp) {
+        return -1;
+    }
+    p = fgets(buf, sizeof(buf), fp);
+    fclose(fp);
+    if (!p || !(p = strrchr(buf, ')'))) {
+        return -1;
+    }
+    /*starttime is the 22nd field,the 20th after the command name*/
+    for (i = 0; i < 20 && p; i++) {
+        p = strchr(p + 1, ' ');
+    }
+    if (!p || sscanf(p, "%llu", &start_ticks) != 1) {
+        return -1;
+    }
+    fp = fopen("/proc/uptime", "r");
+    if (!fp) {
+        return -1;
+    }
+    if (fscanf(fp, "%lf", &uptime) != 1) {
+        uptime = 0;
+    }
+    fclose(fp);
+    return (long)(uptime * 1000) - (long)(start_ticks * 1000 / sysconf(_SC_CLK_TCK));
+}
+
+static int video_frame_shown(void)
+{
+    char buf[32] = {0};
+    int fd = open("/sys/module/amvideo/parameters/new_frame_count", O_RDONLY);
+
+    if (fd < 0) {
+        return -1;
+    }
+    read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    return atoi(buf) > 0;
+}
+
 #define TMP_COMMAND_MAX 512
 
 int main(int argc,char *argv[])
@@ -245,6 +299,8 @@ int main(int argc,char *argv[])
 	media_info_t minfo;	
 	char tmpcommand[TMP_COMMAND_MAX];
 	EMU_STEP tmpstep = EMU_STEP_MENU; 
+	long init_ms, start_ms;
+	int first_frame = 0;
 	
 	pCtrl = (play_control_t*)malloc(sizeof(play_control_t));  
 	memset(pCtrl,0,sizeof(play_control_t)); 	
@@ -254,8 +310,11 @@ int main(int argc,char *argv[])
 		ALOGD("usage:player file\n");
 		return -1;
 	}
+	start_ms = process_uptime_ms();
 	player_init();
 	streamsource_init();
+	init_ms = process_uptime_ms();
+	ALOGD("player init done,%ld ms after process start (main at %ld ms)\n", init_ms, start_ms);
 	set_display_axis(0);		//move osd out of screen to set video layer out
 		
 	player_register_update_callback(&pCtrl->callback_fn,&update_player_info,1000);
@@ -355,7 +414,19 @@ int main(int argc,char *argv[])
 				break;
 		 	}
 				
-		usleep(100*1000);
+		if (!first_frame) {
+			/*poll finer until the first frame is out,for the start time*/
+			int shown = video_frame_shown();
+			if (shown > 0) {
+				long now_ms = process_uptime_ms();
+				ALOGD("first frame shown,%ld ms after process start,%ld ms after player init\n",
+					now_ms, now_ms - init_ms);
+			}
+			first_frame = (shown != 0);
+			usleep(first_frame ? 100*1000 : 5*1000);
+		} else {
+			usleep(100*1000);
+		}
         signal(SIGCHLD, SIG_IGN);        
 		signal(SIGTSTP, SIG_IGN);        
 		signal(SIGTTOU, SIG_IGN);        
@@ -5,6 +5,7 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES := dvb/dvb.c \
                    dvb_chmgr/am_chmgr.c \
                    dvb_chmgr/chmgr_file.c \
+                   dvb_chmgr/chmgr_db.c \
                    dvb_dmx/am_dmx.c \
                    dvb_dmx/linux_dvb/linux_dvb.c \
                    dvb_fe/am_fend.c \
@@ -1,5 +1,6 @@
 
 #include "dvb.h"
+#include "am_chmgr.h"
 #include "am_fend.h"
 #include "am_av.h"
 #include <log_print.h>
@@ -12,6 +13,8 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 
 #include <unistd.h>
@@ -31,6 +34,8 @@ enum dvb_status_code
 typedef struct dvb_section_struct
 {
   int freq;
+  int symbol_rate;
+  int qam;
 	int pmt_numbers;
 	int pmt_no;
 	pat_section_info_t *pat_info;
@@ -39,6 +44,33 @@ typedef struct dvb_section_struct
 	struct  dvb_section_struct *next;
 }dvb_section_struct_t;
 
+enum dvb_zap_state
+{
+  AM_DVB_ZAP_IDLE,
+  AM_DVB_ZAP_PAT,
+  AM_DVB_ZAP_PMT,
+  AM_DVB_ZAP_DONE
+};
+
+/*PAT/PMT acquisition of the service being zapped to, driven from the demux callback*/
+typedef struct dvb_zap_struct
+{
+  int  state;
+  int  fid;
+  int  fast;
+  int  found;
+  int  corrected;
+  int  av_started;
+  unsigned short service_id;
+  unsigned short pmt_pid;
+  aml_dvb_param_t parm;
+  pat_section_info_t *pat_info;
+  pmt_section_info_t *pmt_info;
+  int64_t start_us;
+  int64_t av_us;
+  int64_t table_us;
+}dvb_zap_struct_t;
+
 typedef struct dvb_struct
 {
 	char initd;
@@ -62,6 +94,7 @@ typedef struct dvb_struct
 	dvb_section_struct_t   *section;
 	dvb_section_struct_t   *current_section;
 	aml_dvb_channel_info_t *listChannels;
+	dvb_zap_struct_t        zap;
 }dvb_struct_t;
 
 static dvb_struct_t dvb;
@@ -72,6 +105,7 @@ static pthread_cond_t    cond;
 static dvb_section_struct_t *new_dvb_section_info(void);
 static void section_parser(int dev_no, int fid, const uint8_t *data, int len, void *user_data);
 static void aml_free_section(dvb_section_struct_t *tmp);
+static void aml_dvb_zap_stop(void);
 
 static dvb_section_struct_t *new_dvb_section_info(void)
 {
@@ -176,6 +210,7 @@ int aml_dvb_init(aml_dvb_init_param_t param_init)
 	dvb.v_type=0xff;
 	dvb.a_type=0xff;
 	dvb.fid = -1;
+	dvb.zap.fid = -1;
 
 	dvb.mode=param_init.dvb_mode;
   dvb.fe_id=param_init.fe_id;
@@ -317,6 +352,8 @@ int aml_dvb_start_section(aml_dvb_param_t parm)
 		goto SECTION_END;
   }
   tmp_section->freq = parm.freq;
+  tmp_section->symbol_rate = parm.symbol_rate;
+  tmp_section->qam = parm.qam;
   dvb.current_section = tmp_section;
 
 	if(AM_DMX_SetBufferSize(dvb.dmx_id, dvb.fid, 32*1024) != AM_SUCCESS) {
@@ -648,6 +685,7 @@ int aml_dvb_start_pes(int program_index)
 
 int aml_dvb_stop()
 {
+	aml_dvb_zap_stop();
 	switch(dvb.status) {
 		case AM_DVB_STATUS_PAT:
 		case AM_DVB_STATUS_PMT:
@@ -720,6 +758,7 @@ int aml_dvb_deinit()
   {
     aml_dvb_stop();
   }
+  aml_dvb_zap_stop();
 
 	//if(dvb.fid >= 0) {
 	//  if(AM_DMX_FreeFilter(dvb.dmx_id, dvb.fid) != AM_SUCCESS) {
@@ -783,4 +822,444 @@ int aml_dvb_store_sdt_info(int *numChannels, aml_dvb_channel_info_t **listChanne
 	return 0;
 }
 
+static int aml_dvb_find_channel_pes(aml_dvb_channel_info_t *channel, aml_dvb_db_channel_t *rec)
+{
+	dvb_section_struct_t *section = dvb.section;
+	aml_dvb_param_t parm;
+	unsigned short program_number;
+	unsigned short program_map_pid = 0;
+	int i;
+
+	while(section && section->freq != channel->freq) {
+		section = section->next;
+	}
+	if(!section || !section->pmt_info) {
+		return -1;
+	}
+	for(i=0; i<section->pmt_numbers; i++) {
+		dvb_psi_get_program_info(section->pat_info, i, &program_map_pid, &program_number);
+		if(program_number == channel->service_id) {
+			break;
+		}
+	}
+	if(i == section->pmt_numbers) {
+		return -1;
+	}
+
+	memset(&parm, 0, sizeof(parm));
+	parm.v_pid = 0x1fff;
+	parm.a_pid = 0x1fff;
+	parm.v_type = 0xff;
+	parm.a_type = 0xff;
+	if(dvb_psi_get_program_stream_info(section->pmt_info[i], &parm) == -1) {
+		return -1;
+	}
+
+	memset(rec, 0, sizeof(aml_dvb_db_channel_t));
+	rec->freq = channel->freq;
+	rec->symbol_rate = section->symbol_rate;
+	rec->qam = section->qam;
+	rec->service_id = channel->service_id;
+	rec->pmt_pid = program_map_pid;
+	rec->v_pid = parm.v_pid;
+	rec->a_pid = parm.a_pid;
+	rec->v_type = parm.v_type;
+	rec->a_type = parm.a_type;
+	if(channel->service_name) {
+		strncpy(rec->name, (const char *)channel->service_name, AML_DVB_DB_NAME_LEN - 1);
+	}
+	return 0;
+}
+
+int aml_dvb_store_channel_db(const char *filename)
+{
+	aml_dvb_channel_info_t *channel;
+	aml_dvb_db_channel_t *list;
+	int numChannels = 0;
+	int count = 0;
+	int i, ret;
+
+	aml_dvb_store_sdt_info(&numChannels, &channel);
+	list = malloc(sizeof(aml_dvb_db_channel_t) * (numChannels ? numChannels : 1));
+	if(!list) {
+		log_print("error: no mem for %d channels\n", numChannels);
+		return -1;
+	}
+
+	for(; channel; channel = channel->next) {
+		/*the sdt adds one entry per service descriptor*/
+		for(i=0; i<count; i++) {
+			if(list[i].freq == channel->freq && list[i].service_id == channel->service_id) {
+				break;
+			}
+		}
+		if(i == count && aml_dvb_find_channel_pes(channel, &list[count]) == 0) {
+			count++;
+		}
+	}
+
+	ret = aml_dvb_db_write(filename, list, count);
+	free(list);
+	return ret;
+}
+
+static int aml_dvb_lock_freq(int freq, int symbol_rate, int qam)
+{
+	struct dvb_frontend_parameters p;
+	fe_status_t status;
+
+	if(dvb.freq == freq) {
+		return 0;
+	}
+
+	memset(&p, 0, sizeof(p));
+	switch(dvb.mode) {
+		case 0: // DVB-C
+			p.frequency = freq;
+			p.u.qam.symbol_rate = symbol_rate;
+			p.u.qam.fec_inner = FEC_AUTO;
+			p.u.qam.modulation = qam;
+			break;
+		case 1: // DVB-T
+			p.frequency = freq;
+			p.u.ofdm.bandwidth = BANDWIDTH_8_MHZ;
+			p.u.ofdm.code_rate_HP = FEC_AUTO;
+			p.u.ofdm.code_rate_LP = FEC_AUTO;
+			p.u.ofdm.constellation = QAM_AUTO;
+			p.u.ofdm.guard_interval = GUARD_INTERVAL_AUTO;
+			p.u.ofdm.hierarchy_information = HIERARCHY_AUTO;
+			p.u.ofdm.transmission_mode = TRANSMISSION_MODE_AUTO;
+			break;
+		default:
+			log_print("dvb mode error %d\n", dvb.mode);
+			return -1;
+	}
+
+	log_print("*******___lock new freq %d \n", freq);
+	if(AM_FEND_Lock(dvb.fe_id, &p, &status) != AM_SUCCESS) {
+		log_print("AM_FEND_Lock failed\n");
+		dvb.freq = -1;
+		return -1;
+	}
+	dvb.freq = freq;
+	dvb.symbol_rate = symbol_rate;
+	dvb.qam = qam;
+	return 0;
+}
+
+static int aml_dvb_tune_channel(const aml_dvb_db_channel_t *channel)
+{
+	if(aml_dvb_lock_freq(channel->freq, channel->symbol_rate, channel->qam) < 0) {
+		return -1;
+	}
+	if(AM_DMX_SetSource(dvb.dmx_id, dvb.dmx_source) != AM_SUCCESS) {
+		log_print("AM_DMX_SetSource failed\n");
+		return -1;
+	}
+	if(AM_AV_SetTSSource(dvb.av_id, dvb.dmx_source) != AM_SUCCESS) {
+		log_print("AM_AV_SetTSSource failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int aml_dvb_start_av(int v_pid, int a_pid, int v_type, int a_type)
+{
+	dvb.v_pid = v_pid;
+	dvb.a_pid = a_pid;
+	dvb.v_type = v_type;
+	dvb.a_type = a_type;
+	if(AM_AV_StartTS(dvb.av_id, dvb.v_pid, dvb.a_pid, dvb.v_type, dvb.a_type) != AM_SUCCESS) {
+		log_print("AM_AV_StartTS failed\n");
+		return -1;
+	}
+	dvb.status = AM_DVB_STATUS_AV;
+	return 0;
+}
+
+int aml_dvb_start_channel(const aml_dvb_db_channel_t *channel)
+{
+	if(!dvb.initd) {
+		log_print("dvb not initialized\n");
+		return -1;
+	}
+	if(!channel) {
+		return -1;
+	}
+
+	log_print("aml_dvb_start_channel service_id 0x%x freq %d\n", channel->service_id, channel->freq);
+	aml_dvb_zap_stop();
+	if(aml_dvb_tune_channel(channel) < 0) {
+		return -1;
+	}
+	return aml_dvb_start_av(channel->v_pid, channel->a_pid, channel->v_type, channel->a_type);
+}
+
+static int64_t aml_dvb_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int aml_dvb_zap_set_filter(int pid, int table_id, int program_number)
+{
+	struct dmx_sct_filter_params param;
+	int i;
+
+	memset(&param, 0, sizeof(param));
+	for(i=0; i<DMX_FILTER_SIZE; i++) {
+		param.filter.mode[i] = 0xff;
+	}
+	param.pid = pid;
+	param.filter.filter[0] = table_id;
+	param.filter.mask[0] = 0xff;
+	param.filter.mode[0] = 0;
+	if(program_number >= 0) {
+		// the 2 bytes between table id and program number are always skipped by demux driver
+		param.filter.filter[1] = (program_number >> 8) & 0xff;
+		param.filter.mask[1] = 0xff;
+		param.filter.mode[1] = 0;
+		param.filter.filter[2] = program_number & 0xff;
+		param.filter.mask[2] = 0xff;
+		param.filter.mode[2] = 0;
+	}
+	param.flags = DMX_CHECK_CRC;
+
+	if(AM_DMX_SetSecFilter(dvb.dmx_id, dvb.zap.fid, &param) != AM_SUCCESS) {
+		log_print("AM_DMX_SetSecFilter 0x%x failed\n", pid);
+		return -1;
+	}
+	if(AM_DMX_StartFilter(dvb.dmx_id, dvb.zap.fid) != AM_SUCCESS) {
+		log_print("AM_DMX_StartFilter 0x%x failed\n", pid);
+		return -1;
+	}
+	return 0;
+}
+
+/*fast zap: check the fresh tables against the started pids, called with mutex held*/
+static void aml_dvb_zap_check(dvb_zap_struct_t *zap)
+{
+	aml_dvb_param_t *parm = &zap->parm;
+
+	if(parm->v_pid != dvb.v_pid || parm->a_pid != dvb.a_pid ||
+	   parm->v_type != dvb.v_type || parm->a_type != dvb.a_type) {
+		log_print("zap service 0x%x cached pids v 0x%x a 0x%x are stale, restarting\n",
+		          zap->service_id, dvb.v_pid, dvb.a_pid);
+		zap->corrected = 1;
+		aml_dvb_start_av(parm->v_pid, parm->a_pid, parm->v_type, parm->a_type);
+	}
+}
+
+static void zap_section_parser(int dev_no, int fid, const uint8_t *data, int len, void *user_data)
+{
+	dvb_zap_struct_t *zap = (dvb_zap_struct_t *)user_data;
+	unsigned short program_number;
+	unsigned short program_map_pid;
+	int i, n;
+
+	if(!data) {
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	switch(zap->state) {
+		case AM_DVB_ZAP_PAT:
+			if(dvb_psi_parse_pat(data, len, zap->pat_info) != AM_SUCCESS) {
+				break;
+			}
+			AM_DMX_StopFilter(dvb.dmx_id, zap->fid);
+			n = dvb_psi_get_pmt_numbers(zap->pat_info);
+			for(i=0; i<n; i++) {
+				dvb_psi_get_program_info(zap->pat_info, i, &program_map_pid, &program_number);
+				if(program_number == zap->service_id) {
+					break;
+				}
+			}
+			if(i == n) {
+				log_print("zap service 0x%x is not in the PAT\n", zap->service_id);
+				zap->state = AM_DVB_ZAP_DONE;
+				pthread_cond_signal(&cond);
+				break;
+			}
+			zap->pmt_pid = program_map_pid;
+			zap->state = AM_DVB_ZAP_PMT;
+			if(aml_dvb_zap_set_filter(program_map_pid, 0x02, program_number) < 0) {
+				zap->state = AM_DVB_ZAP_DONE;
+				pthread_cond_signal(&cond);
+			}
+			break;
+		case AM_DVB_ZAP_PMT:
+			if(dvb_psi_parse_pmt(data, len, zap->pmt_info) != AM_SUCCESS) {
+				break;
+			}
+			AM_DMX_StopFilter(dvb.dmx_id, zap->fid);
+			zap->found = dvb_psi_get_program_stream_info(zap->pmt_info, &zap->parm) != -1;
+			zap->state = AM_DVB_ZAP_DONE;
+			zap->table_us = aml_dvb_now_us() - zap->start_us;
+			log_print("zap service 0x%x tables in %lld ms: v_pid 0x%x a_pid 0x%x\n", zap->service_id,
+			          (long long)(zap->table_us / 1000), zap->parm.v_pid, zap->parm.a_pid);
+			if(zap->found && zap->fast && zap->av_started) {
+				aml_dvb_zap_check(zap);
+			}
+			pthread_cond_signal(&cond);
+			break;
+		default:
+			break;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+static void aml_dvb_zap_stop(void)
+{
+	dvb_zap_struct_t *zap = &dvb.zap;
+
+	if(zap->fid >= 0) {
+		AM_DMX_StopFilter(dvb.dmx_id, zap->fid);
+		AM_DMX_FreeFilter(dvb.dmx_id, zap->fid);
+		zap->fid = -1;
+	}
+	pthread_mutex_lock(&mutex);
+	zap->state = AM_DVB_ZAP_IDLE;
+	if(zap->pat_info) {
+		dvb_psi_free_pat_info(zap->pat_info);
+		zap->pat_info = NULL;
+	}
+	if(zap->pmt_info) {
+		dvb_psi_free_pmt_info(zap->pmt_info);
+		zap->pmt_info = NULL;
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+static int aml_dvb_zap_start(const aml_dvb_db_channel_t *channel, int fast)
+{
+	dvb_zap_struct_t *zap = &dvb.zap;
+
+	zap->fast = fast;
+	zap->found = 0;
+	zap->corrected = 0;
+	zap->av_started = 0;
+	zap->service_id = channel->service_id;
+	zap->pmt_pid = channel->pmt_pid;
+	zap->av_us = -1;
+	zap->table_us = -1;
+	memset(&zap->parm, 0, sizeof(zap->parm));
+	zap->parm.v_pid = 0x1fff;
+	zap->parm.a_pid = 0x1fff;
+	zap->parm.v_type = 0xff;
+	zap->parm.a_type = 0xff;
+	zap->pat_info = dvb_psi_new_pat_info();
+	zap->pmt_info = dvb_psi_new_pmt_info();
+	if(!zap->pat_info || !zap->pmt_info) {
+		return -1;
+	}
+	if(AM_DMX_AllocateFilter(dvb.dmx_id, &zap->fid) != AM_SUCCESS) {
+		log_print("AM_DMX_AllocateFilter failed\n");
+		zap->fid = -1;
+		return -1;
+	}
+	if(AM_DMX_SetBufferSize(dvb.dmx_id, zap->fid, 32*1024) != AM_SUCCESS ||
+	   AM_DMX_SetCallback(dvb.dmx_id, zap->fid, zap_section_parser, zap) != AM_SUCCESS) {
+		log_print("zap filter setup failed\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	zap->state = AM_DVB_ZAP_PAT;
+	pthread_mutex_unlock(&mutex);
+	return aml_dvb_zap_set_filter(0, 0, -1);
+}
+
+int aml_dvb_zap(const aml_dvb_db_channel_t *channel, int fast)
+{
+	dvb_zap_struct_t *zap = &dvb.zap;
+	struct timespec timeout;
+	aml_dvb_param_t parm;
+	int done, found;
+	int ret = 0;
+
+	if(!dvb.initd) {
+		log_print("dvb not initialized\n");
+		return -1;
+	}
+	if(!channel) {
+		return -1;
+	}
+
+	log_print("aml_dvb_zap service_id 0x%x freq %d%s\n", channel->service_id, channel->freq, fast ? " fast" : "");
+	aml_dvb_zap_stop();
+	zap->start_us = aml_dvb_now_us();
+	if(aml_dvb_tune_channel(channel) < 0) {
+		return -1;
+	}
+	/*the tables are acquired from the demux thread in both modes*/
+	if(aml_dvb_zap_start(channel, fast) < 0) {
+		aml_dvb_zap_stop();
+		if(!fast) {
+			return -1;
+		}
+	}
+
+	if(fast) {
+		/*decode the cached pids right away, the decoders start while the PAT/PMT come in*/
+		ret = aml_dvb_start_av(channel->v_pid, channel->a_pid, channel->v_type, channel->a_type);
+		pthread_mutex_lock(&mutex);
+		zap->av_us = aml_dvb_now_us() - zap->start_us;
+		zap->av_started = ret == 0;
+		if(zap->av_started && zap->state == AM_DVB_ZAP_DONE && zap->found) {
+			/*the tables won the race, check them against what was started*/
+			aml_dvb_zap_check(zap);
+		}
+		pthread_mutex_unlock(&mutex);
+		return ret;
+	}
+
+	timeout.tv_sec  = time(NULL)+5;
+	timeout.tv_nsec = 0;
+	pthread_mutex_lock(&mutex);
+	while(zap->state != AM_DVB_ZAP_DONE && ret != ETIMEDOUT) {
+		ret = pthread_cond_timedwait(&cond, &mutex, (const struct timespec *)&timeout);
+	}
+	/*the demux thread writes these, take them under the lock*/
+	done = zap->state == AM_DVB_ZAP_DONE;
+	found = zap->found;
+	parm = zap->parm;
+	pthread_mutex_unlock(&mutex);
+	if(!done) {
+		/*timed out, the filter is still set on the PAT or PMT*/
+		aml_dvb_zap_stop();
+	}
+	if(!found) {
+		log_print("zap service 0x%x: no tables, using the cached pids\n", channel->service_id);
+		parm.v_pid = channel->v_pid;
+		parm.a_pid = channel->a_pid;
+		parm.v_type = channel->v_type;
+		parm.a_type = channel->a_type;
+	}
+	ret = aml_dvb_start_av(parm.v_pid, parm.a_pid, parm.v_type, parm.a_type);
+	pthread_mutex_lock(&mutex);
+	zap->av_us = aml_dvb_now_us() - zap->start_us;
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+int aml_dvb_get_zap_info(aml_dvb_zap_info_t *info)
+{
+	dvb_zap_struct_t *zap = &dvb.zap;
+
+	if(!info) {
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	info->fast = zap->fast;
+	info->service_id = zap->service_id;
+	info->av_ms = zap->av_us < 0 ? -1 : (int)(zap->av_us / 1000);
+	info->table_ms = zap->table_us < 0 ? -1 : (int)(zap->table_us / 1000);
+	info->corrected = zap->corrected;
+	info->v_pid = dvb.v_pid;
+	info->a_pid = dvb.a_pid;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
 
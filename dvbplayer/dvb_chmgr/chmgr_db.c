@@ -0,0 +1,443 @@
+
+/*
+ * Binary channel database.
+ *
+ * The text channel files are re-read and scanned from the start for every
+ * key, which made each zap parse the file several times. The database is
+ * written once from the scan results (or imported from text) and then
+ * mmap'ed read only: a header, an open addressed service id hash, an open
+ * addressed frequency hash and the records sorted by frequency and service
+ * id, so a lookup is a couple of probes into the mapping.
+ */
+
+#include "am_chmgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "log_print.h"
+
+#define DB_MAGIC	0x42564441	/*"ADVB"*/
+#define DB_VERSION	1
+#define DB_LINE_SIZE	256
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rec_size;
+	uint32_t count;
+	uint32_t svc_slots;
+	uint32_t freq_slots;
+	uint32_t svc_off;
+	uint32_t freq_off;
+	uint32_t rec_off;
+	uint32_t size;
+	uint32_t reserved;
+}db_header_t;
+
+typedef struct
+{
+	int32_t  freq;
+	uint32_t first;
+	uint32_t count;		/*0 for an empty slot*/
+}db_freq_slot_t;
+
+struct aml_dvb_db
+{
+	void                       *map;
+	size_t                      size;
+	const db_header_t          *hdr;
+	const uint32_t             *svc;	/*record index + 1, 0 for an empty slot*/
+	const db_freq_slot_t       *freq;
+	const aml_dvb_db_channel_t *rec;
+};
+
+static uint32_t db_hash(uint32_t key, uint32_t slots)
+{
+	return (key * 2654435761u) & (slots - 1);
+}
+
+static uint32_t db_slots(uint32_t count)
+{
+	uint32_t slots = 16;
+
+	while(slots < count * 2)
+	{
+		slots <<= 1;
+	}
+	return slots;
+}
+
+static int db_rec_cmp(const void *a, const void *b)
+{
+	const aml_dvb_db_channel_t *x = a, *y = b;
+
+	if(x->freq != y->freq)
+	{
+		return x->freq < y->freq ? -1 : 1;
+	}
+	return (int)x->service_id - (int)y->service_id;
+}
+
+int aml_dvb_db_write(const char *filename, const aml_dvb_db_channel_t *channels, int count)
+{
+	db_header_t *hdr;
+	uint32_t *svc;
+	db_freq_slot_t *freq;
+	aml_dvb_db_channel_t *rec;
+	char tmp[256];
+	uint8_t *buf;
+	int fd, i, ret = -1;
+	uint32_t h;
+
+	if(!filename || count < 0 || (count && !channels))
+	{
+		return -1;
+	}
+
+	h = db_slots(count);
+	buf = calloc(1, sizeof(db_header_t) + h * sizeof(uint32_t) + h * sizeof(db_freq_slot_t) +
+	             count * sizeof(aml_dvb_db_channel_t));
+	if(!buf)
+	{
+		log_print("no mem for %d channels\n", count);
+		return -1;
+	}
+	hdr = (db_header_t *)buf;
+	hdr->magic = DB_MAGIC;
+	hdr->version = DB_VERSION;
+	hdr->rec_size = sizeof(aml_dvb_db_channel_t);
+	hdr->count = count;
+	hdr->svc_slots = h;
+	hdr->freq_slots = h;
+	hdr->svc_off = sizeof(db_header_t);
+	hdr->freq_off = hdr->svc_off + h * sizeof(uint32_t);
+	hdr->rec_off = hdr->freq_off + h * sizeof(db_freq_slot_t);
+	hdr->size = hdr->rec_off + count * sizeof(aml_dvb_db_channel_t);
+	svc = (uint32_t *)(buf + hdr->svc_off);
+	freq = (db_freq_slot_t *)(buf + hdr->freq_off);
+	rec = (aml_dvb_db_channel_t *)(buf + hdr->rec_off);
+
+	memcpy(rec, channels, count * sizeof(aml_dvb_db_channel_t));
+	qsort(rec, count, sizeof(aml_dvb_db_channel_t), db_rec_cmp);
+	for(i = 0; i < count; i++)
+	{
+		rec[i].name[AML_DVB_DB_NAME_LEN - 1] = 0;
+
+		for(h = db_hash(rec[i].service_id, hdr->svc_slots); svc[h]; h = (h + 1) & (hdr->svc_slots - 1));
+		svc[h] = i + 1;
+
+		if(i && rec[i].freq == rec[i - 1].freq)
+		{
+			continue;
+		}
+		for(h = db_hash(rec[i].freq, hdr->freq_slots); freq[h].count; h = (h + 1) & (hdr->freq_slots - 1));
+		freq[h].freq = rec[i].freq;
+		freq[h].first = i;
+		freq[h].count = 1;
+		while(i + freq[h].count < (uint32_t)count && rec[i + freq[h].count].freq == rec[i].freq)
+		{
+			freq[h].count++;
+		}
+	}
+
+	/*readers keep the old file mapped, replace it instead of rewriting it*/
+	snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+	{
+		log_print("can't create %s\n", tmp);
+		free(buf);
+		return -1;
+	}
+	if(write(fd, buf, hdr->size) == (ssize_t)hdr->size && fsync(fd) == 0)
+	{
+		ret = 0;
+	}
+	close(fd);
+	if(ret == 0 && rename(tmp, filename) != 0)
+	{
+		ret = -1;
+	}
+	if(ret)
+	{
+		log_print("writing channel db %s failed\n", filename);
+		unlink(tmp);
+	}
+	else
+	{
+		log_print("channel db %s: %d channels\n", filename, count);
+	}
+	free(buf);
+	return ret;
+}
+
+aml_dvb_db_t *aml_dvb_db_open(const char *filename)
+{
+	aml_dvb_db_t *db;
+	const db_header_t *hdr;
+	struct stat st;
+	void *map;
+	int fd;
+
+	if(!filename)
+	{
+		return NULL;
+	}
+	fd = open(filename, O_RDONLY);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+	if(fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(db_header_t))
+	{
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+	{
+		log_print("can't map channel db %s\n", filename);
+		return NULL;
+	}
+
+	hdr = map;
+	if(hdr->magic != DB_MAGIC || hdr->version != DB_VERSION ||
+	   hdr->rec_size != sizeof(aml_dvb_db_channel_t) || hdr->size != (uint32_t)st.st_size ||
+	   !hdr->svc_slots || (hdr->svc_slots & (hdr->svc_slots - 1)) || hdr->svc_slots <= hdr->count ||
+	   !hdr->freq_slots || (hdr->freq_slots & (hdr->freq_slots - 1)) || hdr->freq_slots <= hdr->count ||
+	   hdr->svc_off != sizeof(db_header_t) ||
+	   hdr->freq_off != hdr->svc_off + hdr->svc_slots * sizeof(uint32_t) ||
+	   hdr->rec_off != hdr->freq_off + hdr->freq_slots * sizeof(db_freq_slot_t) ||
+	   hdr->size != hdr->rec_off + hdr->count * sizeof(aml_dvb_db_channel_t))
+	{
+		log_print("%s is not a channel db\n", filename);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	db = malloc(sizeof(aml_dvb_db_t));
+	if(!db)
+	{
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	db->map = map;
+	db->size = st.st_size;
+	db->hdr = hdr;
+	db->svc = (const uint32_t *)((const uint8_t *)map + hdr->svc_off);
+	db->freq = (const db_freq_slot_t *)((const uint8_t *)map + hdr->freq_off);
+	db->rec = (const aml_dvb_db_channel_t *)((const uint8_t *)map + hdr->rec_off);
+	return db;
+}
+
+void aml_dvb_db_close(aml_dvb_db_t *db)
+{
+	if(db)
+	{
+		munmap(db->map, db->size);
+		free(db);
+	}
+}
+
+int aml_dvb_db_count(aml_dvb_db_t *db)
+{
+	return db ? (int)db->hdr->count : 0;
+}
+
+const aml_dvb_db_channel_t *aml_dvb_db_get(aml_dvb_db_t *db, int index)
+{
+	if(!db || index < 0 || index >= (int)db->hdr->count)
+	{
+		return NULL;
+	}
+	return &db->rec[index];
+}
+
+const aml_dvb_db_channel_t *aml_dvb_db_find_service(aml_dvb_db_t *db, int freq, int service_id)
+{
+	uint32_t h, mask;
+	const aml_dvb_db_channel_t *rec;
+
+	if(!db)
+	{
+		return NULL;
+	}
+	mask = db->hdr->svc_slots - 1;
+	for(h = db_hash(service_id, db->hdr->svc_slots); db->svc[h]; h = (h + 1) & mask)
+	{
+		if(db->svc[h] > db->hdr->count)
+		{
+			break;
+		}
+		rec = &db->rec[db->svc[h] - 1];
+		if(rec->service_id == service_id && (freq < 0 || rec->freq == freq))
+		{
+			return rec;
+		}
+	}
+	return NULL;
+}
+
+int aml_dvb_db_find_freq(aml_dvb_db_t *db, int freq, int *first)
+{
+	uint32_t h, mask;
+
+	if(!db)
+	{
+		return 0;
+	}
+	mask = db->hdr->freq_slots - 1;
+	for(h = db_hash(freq, db->hdr->freq_slots); db->freq[h].count; h = (h + 1) & mask)
+	{
+		if(db->freq[h].freq == freq)
+		{
+			if(db->freq[h].first + db->freq[h].count > db->hdr->count)
+			{
+				break;
+			}
+			if(first)
+			{
+				*first = db->freq[h].first;
+			}
+			return db->freq[h].count;
+		}
+	}
+	return 0;
+}
+
+int aml_dvb_db_import(const char *textfile, const char *filename)
+{
+	aml_dvb_db_channel_t *list = NULL, *tmp, *cur = NULL;
+	char line[DB_LINE_SIZE];
+	char *value;
+	int count = 0, size = 0, len, ret;
+	FILE *fp;
+
+	fp = fopen(textfile, "r");
+	if(!fp)
+	{
+		log_print("can't open file %s\n", textfile);
+		return -1;
+	}
+	while(fgets(line, sizeof(line), fp))
+	{
+		len = strlen(line);
+		while(len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+		{
+			line[--len] = 0;
+		}
+		value = strchr(line, '=');
+		if(!value)
+		{
+			continue;
+		}
+		*value++ = 0;
+		if(!strcmp(line, "freq"))
+		{
+			if(count == size)
+			{
+				size = size ? size * 2 : 64;
+				tmp = realloc(list, size * sizeof(aml_dvb_db_channel_t));
+				if(!tmp)
+				{
+					log_print("no mem for %d channels\n", size);
+					free(list);
+					fclose(fp);
+					return -1;
+				}
+				list = tmp;
+			}
+			cur = &list[count++];
+			memset(cur, 0, sizeof(aml_dvb_db_channel_t));
+			cur->freq = atoi(value);
+			cur->v_pid = 0x1fff;
+			cur->a_pid = 0x1fff;
+			cur->v_type = 0xff;
+			cur->a_type = 0xff;
+		}
+		else if(!cur)
+		{
+			continue;
+		}
+		else if(!strcmp(line, "symbol_rate"))
+		{
+			cur->symbol_rate = atoi(value);
+		}
+		else if(!strcmp(line, "qam"))
+		{
+			cur->qam = atoi(value);
+		}
+		else if(!strcmp(line, "service_id"))
+		{
+			cur->service_id = atoi(value);
+		}
+		else if(!strcmp(line, "pmt_pid"))
+		{
+			cur->pmt_pid = atoi(value);
+		}
+		else if(!strcmp(line, "v_pid"))
+		{
+			cur->v_pid = atoi(value);
+		}
+		else if(!strcmp(line, "a_pid"))
+		{
+			cur->a_pid = atoi(value);
+		}
+		else if(!strcmp(line, "v_type"))
+		{
+			cur->v_type = atoi(value);
+		}
+		else if(!strcmp(line, "a_type"))
+		{
+			cur->a_type = atoi(value);
+		}
+		else if(!strcmp(line, "name"))
+		{
+			strncpy(cur->name, value, AML_DVB_DB_NAME_LEN - 1);
+		}
+	}
+	fclose(fp);
+
+	log_print("aml_dvb_db_import %s: %d channels\n", textfile, count);
+	ret = aml_dvb_db_write(filename, list, count);
+	free(list);
+	return ret;
+}
+
+int aml_dvb_db_export(aml_dvb_db_t *db, const char *textfile)
+{
+	const aml_dvb_db_channel_t *rec;
+	FILE *fp;
+	int i;
+
+	if(!db || !textfile)
+	{
+		return -1;
+	}
+	fp = fopen(textfile, "w");
+	if(!fp)
+	{
+		log_print("can't create file %s\n", textfile);
+		return -1;
+	}
+	for(i = 0; i < (int)db->hdr->count; i++)
+	{
+		rec = &db->rec[i];
+		fprintf(fp, "freq=%d\nsymbol_rate=%d\nqam=%d\nservice_id=%d\npmt_pid=%d\n"
+		        "v_pid=%d\na_pid=%d\nv_type=%d\na_type=%d\nname=%s\n\n",
+		        rec->freq, rec->symbol_rate, rec->qam, rec->service_id, rec->pmt_pid,
+		        rec->v_pid, rec->a_pid, rec->v_type, rec->a_type, rec->name);
+	}
+	if(fclose(fp) != 0)
+	{
+		return -1;
+	}
+	return 0;
+}
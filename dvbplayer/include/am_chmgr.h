@@ -2,8 +2,28 @@
 #ifndef __AM_CHMGR_H
 #define __AM_CHMGR_H
 
+#include <stdint.h>
 #include "dvb.h"
 
+#define AML_DVB_DB_NAME_LEN 32
+
+/*one service of the binary channel database, read straight from the mapping*/
+typedef struct aml_dvb_db_channel
+{
+	int32_t  freq;
+	int32_t  symbol_rate;
+	int32_t  qam;
+	uint16_t service_id;
+	uint16_t pmt_pid;
+	uint16_t v_pid;
+	uint16_t a_pid;
+	uint8_t  v_type;
+	uint8_t  a_type;
+	uint8_t  reserved[2];
+	char     name[AML_DVB_DB_NAME_LEN];
+}aml_dvb_db_channel_t;
+
+typedef struct aml_dvb_db aml_dvb_db_t;
 
 #ifdef __CPLUSPLUS
 extern "C"
@@ -17,6 +37,29 @@ int aml_load_dvb_param(const char *filename,aml_dvb_init_param_t *param);
 
 int aml_check_is_channel_info_file(const char *filename);
 
+/*binary channel database: records sorted by frequency and service id,
+ *hashed by service id and by frequency, mmap'ed read only*/
+int aml_dvb_db_write(const char *filename, const aml_dvb_db_channel_t *channels, int count);
+
+aml_dvb_db_t *aml_dvb_db_open(const char *filename);
+
+void aml_dvb_db_close(aml_dvb_db_t *db);
+
+int aml_dvb_db_count(aml_dvb_db_t *db);
+
+const aml_dvb_db_channel_t *aml_dvb_db_get(aml_dvb_db_t *db, int index);
+
+/*freq < 0 matches the service on any frequency*/
+const aml_dvb_db_channel_t *aml_dvb_db_find_service(aml_dvb_db_t *db, int freq, int service_id);
+
+/*returns the number of services on freq, *first the index of the first one*/
+int aml_dvb_db_find_freq(aml_dvb_db_t *db, int freq, int *first);
+
+/*text import/export, one "freq=" started block of key=value lines per service*/
+int aml_dvb_db_import(const char *textfile, const char *filename);
+
+int aml_dvb_db_export(aml_dvb_db_t *db, const char *textfile);
+
 
 #ifdef __CPLUSPLUS
 }
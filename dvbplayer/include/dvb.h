@@ -68,6 +68,49 @@ int aml_dvb_set_volm(int vol);
 
 int aml_dvb_store_sdt_info(int *numChannels, aml_dvb_channel_info_t **listChannels);
 
+struct aml_dvb_db_channel;
+
+/**\brief Write the scanned services to a binary channel database (see am_chmgr.h)
+ * \param[in] filename Database file, replaced atomically.
+ * \return
+ *   - 0  Success.
+ *   - -1 Error.
+ */
+int aml_dvb_store_channel_db(const char *filename);
+
+/**\brief Tune and start a service straight from its channel database record,
+ * without acquiring the PAT/PMT
+ * \param[in] channel Record returned by aml_dvb_db_find_service()/aml_dvb_db_get().
+ * \return
+ *   - 0  Success.
+ *   - -1 Error.
+ */
+int aml_dvb_start_channel(const struct aml_dvb_db_channel *channel);
+
+typedef struct aml_dvb_zap_info
+{
+    int fast;
+    int service_id;
+    int av_ms;          /* zap request to decoders started, -1 if not yet */
+    int table_ms;       /* zap request to fresh PAT/PMT, -1 if not yet */
+    int corrected;      /* fast zap started stale pids and was restarted */
+    int v_pid;
+    int a_pid;
+}aml_dvb_zap_info_t;
+
+/**\brief Zap to a channel database service
+ * \param[in] channel Record of the service.
+ * \param[in] fast 0: acquire PAT/PMT, then start the decoders on the fresh pids.
+ *   1: start the decoders on the cached pids right away while the PAT/PMT are
+ *   acquired in parallel, restarting them if the fresh tables differ.
+ * \return
+ *   - 0  Success.
+ *   - -1 Error.
+ */
+int aml_dvb_zap(const struct aml_dvb_db_channel *channel, int fast);
+
+int aml_dvb_get_zap_info(aml_dvb_zap_info_t *info);
+
 
 
 
@@ -3,7 +3,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
 	  
+#define TIMESHIFT_FEED_SIZE	(64*1024)
+#define TIMESHIFT_FEED_WAIT	(10*1000)
 
 #ifndef FBIOPUT_OSD_SRCCOLORKEY
 #define  FBIOPUT_OSD_SRCCOLORKEY    0x46fb
@@ -25,12 +28,24 @@ CTsPlayer::CTsPlayer()
 	memset(&codec,0,sizeof(codec));
 	player_pid=-1;
 	pcodec=&codec;
+	timeshift=NULL;
+	feed_running=0;
+	feed_quit=0;
+	feed_paused=0;
+	feed_buf=NULL;
+	feed_len=0;
+	feed_off=0;
+	pthread_mutex_init(&feed_lock,NULL);
 	codec_audio_basic_init();
 }
 
 CTsPlayer::~CTsPlayer()
 {
-
+	StopFeed();
+	if(timeshift)
+		ts_timeshift_close(timeshift);
+	free(feed_buf);
+	pthread_mutex_destroy(&feed_lock);
 }
 static int set_sys_int(const char *path,int val)
 {
@@ -119,28 +134,127 @@ bool CTsPlayer::StartPlay()
         pcodec->am_sysinfo.param = (void *)(0);
     }
 	printf("set %d,%d,%d,%d\n",vPara.vFmt,aPara.aFmt,vPara.pid,aPara.pid);
-	pcodec->noblock = 0;
+	/*the feed thread must not block in codec_write while paused or seeking*/
+	pcodec->noblock = timeshift ? 1 : 0;
 	/*other setting*/
 	ret=codec_init(pcodec);
+	if(!ret && timeshift && !feed_running){
+		feed_quit=0;
+		if(pthread_create(&feed_tid,NULL,FeedThread,this)==0)
+			feed_running=1;
+	}
 	return !ret;
 }
 int CTsPlayer::WriteData(unsigned char* pBuffer, unsigned int nSize)
 {
+	if(timeshift)
+		return ts_timeshift_write(timeshift,pBuffer,nSize);
 	return codec_write(pcodec,pBuffer,nSize);
 }
 
 bool CTsPlayer::Pause()
 {
+	feed_paused=1;
 	codec_pause(pcodec);
 	return true;
 }
 
 bool CTsPlayer::Resume()
 {
+	feed_paused=0;
 	codec_resume(pcodec);
 	return true;
 }
 
+int CTsPlayer::EnableTimeshift(const char *path, long long size)
+{
+	if(timeshift)
+		return 0;
+	feed_buf=(unsigned char *)malloc(TIMESHIFT_FEED_SIZE);
+	if(!feed_buf)
+		return -1;
+	timeshift=ts_timeshift_open(path,size,vPara.pid,vPara.vFmt);
+	if(!timeshift){
+		free(feed_buf);
+		feed_buf=NULL;
+		return -1;
+	}
+	return 0;
+}
+
+bool CTsPlayer::TimeshiftSeek(int ms_behind_live)
+{
+	int ret;
+
+	if(!timeshift)
+		return false;
+	pthread_mutex_lock(&feed_lock);
+	ret=ts_timeshift_seek(timeshift,ms_behind_live);
+	if(!ret){
+		/*drop what the decoder holds from the old position*/
+		feed_len=0;
+		feed_off=0;
+		ret=codec_reset(pcodec);
+		/*a seek while paused starts playing, like Resume()*/
+		if(feed_paused){
+			feed_paused=0;
+			codec_resume(pcodec);
+		}
+	}
+	pthread_mutex_unlock(&feed_lock);
+	return !ret;
+}
+
+int CTsPlayer::GetTimeshiftDelay()
+{
+	if(!timeshift)
+		return 0;
+	return ts_timeshift_get_delay(timeshift);
+}
+
+void *CTsPlayer::FeedThread(void *arg)
+{
+	((CTsPlayer *)arg)->FeedLoop();
+	return NULL;
+}
+
+/*moves the ring to the decoder at the playback position, ingest goes on in WriteData*/
+void CTsPlayer::FeedLoop()
+{
+	int ret;
+
+	while(!feed_quit){
+		if(feed_paused){
+			usleep(TIMESHIFT_FEED_WAIT);
+			continue;
+		}
+		pthread_mutex_lock(&feed_lock);
+		if(feed_off>=feed_len){
+			feed_len=ts_timeshift_read(timeshift,feed_buf,TIMESHIFT_FEED_SIZE);
+			feed_off=0;
+		}
+		ret=0;
+		if(feed_len>0){
+			ret=codec_write(pcodec,feed_buf+feed_off,feed_len-feed_off);
+			if(ret>0)
+				feed_off+=ret;
+		}
+		pthread_mutex_unlock(&feed_lock);
+		/*at the live edge or decoder buffer full*/
+		if(ret<=0)
+			usleep(TIMESHIFT_FEED_WAIT);
+	}
+}
+
+void CTsPlayer::StopFeed()
+{
+	if(!feed_running)
+		return;
+	feed_quit=1;
+	pthread_join(feed_tid,NULL);
+	feed_running=0;
+}
+
 bool CTsPlayer::Fast()
 {
 	int ret;
@@ -173,6 +287,8 @@ bool CTsPlayer::StopFast()
 }
 bool CTsPlayer::Stop()
 {
+	/*the feed thread writes to pcodec, StartPlay starts it again*/
+	StopFeed();
 	codec_close(pcodec);
 	return true;
 }
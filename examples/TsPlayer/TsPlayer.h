@@ -8,7 +8,9 @@ extern "C" {
 #include <amports/vformat.h>
 #include <amports/aformat.h>
 #include <codec.h>
+#include "ts_timeshift.h"
 }
+#include <pthread.h>
 using namespace android;
 
 #define TRICKMODE_NONE       0x00
@@ -68,11 +70,29 @@ public:
     bool SetVolume(float volume);
     //ȡ
     float GetVolume();
+	//timeshift: record live TS to a ring file, after InitVideo and before StartPlay
+	int  EnableTimeshift(const char *path, long long size);
+	//play from the keyframe ms behind live, 0 to catch up with live
+	bool TimeshiftSeek(int ms_behind_live);
+	//how far playback is behind live, ms
+	int  GetTimeshiftDelay();
 private:
+	static void *FeedThread(void *arg);
+	void FeedLoop();
+	void StopFeed();
 	AUDIO_PARA_T aPara;
 	VIDEO_PARA_T vPara;	
 	int player_pid;
 	codec_para_t codec;
 	codec_para_t *pcodec;
+	ts_timeshift_t *timeshift;
+	pthread_t feed_tid;
+	pthread_mutex_t feed_lock;
+	int feed_running;
+	volatile int feed_quit;
+	volatile int feed_paused;
+	unsigned char *feed_buf;
+	int feed_len;
+	int feed_off;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,482 @@
+/*****************************************
+ * name : ts_timeshift.c
+ * function: disk backed timeshift ring with PCR/keyframe index for live TS
+ *****************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <amports/vformat.h>
+#include "ts_timeshift.h"
+
+#ifndef O_DIRECT
+#define O_DIRECT    0
+#endif
+
+#define TS_PACKET_SIZE          188
+#define TS_SYNC_BYTE            0x47
+#define TIMESHIFT_BLOCK         (1024 * 1024)               ///< write unit, 4K aligned for O_DIRECT
+#define TIMESHIFT_ALIGN         4096
+#define TIMESHIFT_DEFAULT_SIZE  (512LL * 1024 * 1024)
+#define TIMESHIFT_INDEX_MAX     (64 * 1024)
+#define TIMESHIFT_PCR_STEP      90000                       ///< non key entry every second without keyframes
+#define TIMESHIFT_PCR_MAX_GAP   (10 * 90000)                ///< larger jumps are discontinuities
+#define TIMESHIFT_PCR_MASK      ((1LL << 33) - 1)
+
+typedef struct {
+    int64_t offset;     ///< absolute byte position in the live stream
+    int64_t time;       ///< 90KHz, continuous across PCR wrap/discontinuity
+    int key;
+} ts_index_entry_t;
+
+struct ts_timeshift {
+    pthread_mutex_t lock;
+    int wfd;
+    int rfd;
+    int direct;
+    int64_t size;           ///< ring file size, multiple of TIMESHIFT_BLOCK
+    unsigned char *block;   ///< staging block, ring data [flushed, wpos)
+    int block_len;
+    int64_t flushed;
+    int64_t wpos;
+    int64_t rpos;
+    int seek_gen;
+
+    int video_pid;
+    int vformat;
+    int pmt_pid;            ///< from the PAT, -1 until seen
+    int pcr_pid;            ///< from the PMT, the video pid until seen
+    unsigned char carry[TS_PACKET_SIZE];
+    int carry_len;
+    int have_pcr;
+    int64_t last_pcr;
+    int64_t timeline;
+    int64_t last_entry_time;
+
+    ts_index_entry_t *index;
+    int index_first;
+    int index_count;
+};
+
+static ts_index_entry_t *ts_index_at(ts_timeshift_t *ts, int i)
+{
+    return &ts->index[(ts->index_first + i) % TIMESHIFT_INDEX_MAX];
+}
+
+/* lowest position a reader may use, the next flush overwrites the block below */
+static int64_t ts_timeshift_oldest(ts_timeshift_t *ts)
+{
+    int64_t oldest = ts->flushed - ts->size + TIMESHIFT_BLOCK;
+    return oldest > 0 ? oldest : 0;
+}
+
+static void ts_index_expire(ts_timeshift_t *ts)
+{
+    int64_t oldest = ts_timeshift_oldest(ts);
+    while (ts->index_count > 0 && ts_index_at(ts, 0)->offset < oldest) {
+        ts->index_first = (ts->index_first + 1) % TIMESHIFT_INDEX_MAX;
+        ts->index_count--;
+    }
+}
+
+static void ts_index_add(ts_timeshift_t *ts, int64_t offset, int key)
+{
+    ts_index_entry_t *e;
+    if (ts->index_count == TIMESHIFT_INDEX_MAX) {
+        ts->index_first = (ts->index_first + 1) % TIMESHIFT_INDEX_MAX;
+        ts->index_count--;
+    }
+    e = ts_index_at(ts, ts->index_count++);
+    e->offset = offset;
+    e->time = ts->timeline;
+    e->key = key;
+    ts->last_entry_time = ts->timeline;
+}
+
+/* last entry (key only if key) with field <= value, -1 if none */
+static int ts_index_find(ts_timeshift_t *ts, int by_time, int64_t value, int key)
+{
+    int lo = 0, hi = ts->index_count - 1, mid, found = -1;
+    ts_index_entry_t *e;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        e = ts_index_at(ts, mid);
+        if ((by_time ? e->time : e->offset) <= value) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    while (key && found >= 0 && !ts_index_at(ts, found)->key) {
+        found--;
+    }
+    return found;
+}
+
+static int ts_is_key_payload(int vformat, const unsigned char *p, int size)
+{
+    const unsigned char *end;
+    int type;
+
+    /* PES header, then look for the first start codes of the access unit */
+    if (size < 9 || p[0] != 0 || p[1] != 0 || p[2] != 1) {
+        return 0;
+    }
+    end = p + size;
+    p += 9 + p[8];
+    for (; p + 4 <= end; p++) {
+        if (p[0] != 0 || p[1] != 0 || p[2] != 1) {
+            continue;
+        }
+        if (vformat == VFORMAT_H264 || vformat == VFORMAT_H264_4K2K) {
+            type = p[3] & 0x1f;
+            if (type == 5 || type == 7) {
+                return 1;
+            }
+            if (type == 1) {
+                return 0;
+            }
+        } else if (vformat == VFORMAT_HEVC) {
+            type = (p[3] >> 1) & 0x3f;
+            if ((type >= 16 && type <= 21) || type == 32 || type == 33) {
+                return 1;
+            }
+            if (type < 16) {
+                return 0;
+            }
+        } else if (vformat == VFORMAT_MPEG12) {
+            if (p[3] == 0xb3 || p[3] == 0xb8) {
+                return 1;
+            }
+            if (p[3] == 0x00) {
+                return 0;
+            }
+        } else {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/* PAT/PMT section starting in this packet, NULL if none */
+static const unsigned char *ts_section(const unsigned char *p, const unsigned char *payload, int table_id)
+{
+    const unsigned char *end = p + TS_PACKET_SIZE;
+
+    if (!(p[1] & 0x40) || payload >= end) {
+        return NULL;
+    }
+    payload += 1 + payload[0];
+    if (payload + 12 > end || payload[0] != table_id) {
+        return NULL;
+    }
+    return payload;
+}
+
+static void ts_parse_psi(ts_timeshift_t *ts, int pid, const unsigned char *p, const unsigned char *payload)
+{
+    const unsigned char *sec, *end;
+
+    if (pid == 0 && (sec = ts_section(p, payload, 0x00)) != NULL) {
+        /* first program of the PAT, the stream is single program */
+        end = sec + 3 + (((sec[1] & 0x0f) << 8) | sec[2]) - 4;
+        for (sec += 8; sec + 4 <= end && sec + 4 <= p + TS_PACKET_SIZE; sec += 4) {
+            if ((sec[0] << 8 | sec[1]) != 0) {
+                ts->pmt_pid = ((sec[2] & 0x1f) << 8) | sec[3];
+                break;
+            }
+        }
+    } else if (pid == ts->pmt_pid && (sec = ts_section(p, payload, 0x02)) != NULL) {
+        pid = ((sec[8] & 0x1f) << 8) | sec[9];
+        if (pid != 0x1fff && pid != ts->pcr_pid) {
+            printf("[%s]pcr pid %d\n", __FUNCTION__, pid);
+            ts->pcr_pid = pid;
+        }
+    }
+}
+
+static void ts_parse_packet(ts_timeshift_t *ts, const unsigned char *p, int64_t offset)
+{
+    int pid = ((p[1] & 0x1f) << 8) | p[2];
+    int afc = (p[3] >> 4) & 3;
+    int key = 0, len;
+    const unsigned char *payload = p + 4;
+
+    if (afc & 2) {
+        len = p[4];
+        if (len > 0 && len <= TS_PACKET_SIZE - 5) {
+            if ((p[5] & 0x10) && len >= 7 && pid == ts->pcr_pid) {
+                int64_t pcr = ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1) | (p[10] >> 7);
+                int64_t delta = (pcr - ts->last_pcr) & TIMESHIFT_PCR_MASK;
+                if (ts->have_pcr && delta <= TIMESHIFT_PCR_MAX_GAP) {
+                    ts->timeline += delta;
+                }
+                ts->have_pcr = 1;
+                ts->last_pcr = pcr;
+            }
+            if ((p[5] & 0x40) && pid == ts->video_pid) {
+                key = 1;
+            }
+        }
+        payload = p + 5 + len;
+    }
+    if (pid == 0 || pid == ts->pmt_pid) {
+        ts_parse_psi(ts, pid, p, payload);
+        return;
+    }
+    if (pid == ts->video_pid && (p[1] & 0x40) && (afc & 1) && payload < p + TS_PACKET_SIZE) {
+        key |= ts_is_key_payload(ts->vformat, payload, p + TS_PACKET_SIZE - payload);
+    }
+    if (!ts->have_pcr) {
+        return;
+    }
+    if (key || ts->index_count == 0 || ts->timeline - ts->last_entry_time >= TIMESHIFT_PCR_STEP) {
+        ts_index_add(ts, offset, key);
+    }
+}
+
+/* walk the packets of buf, offset is the live stream position of buf[0] */
+static void ts_parse(ts_timeshift_t *ts, const unsigned char *buf, int size, int64_t offset)
+{
+    const unsigned char *p = buf, *end = buf + size;
+    int need;
+
+    if (ts->carry_len > 0) {
+        need = TS_PACKET_SIZE - ts->carry_len;
+        if (size < need) {
+            memcpy(ts->carry + ts->carry_len, buf, size);
+            ts->carry_len += size;
+            return;
+        }
+        memcpy(ts->carry + ts->carry_len, buf, need);
+        ts_parse_packet(ts, ts->carry, offset - ts->carry_len);
+        ts->carry_len = 0;
+        p += need;
+    }
+    while (p < end) {
+        if (*p != TS_SYNC_BYTE) {
+            p++;
+            continue;
+        }
+        if (end - p < TS_PACKET_SIZE) {
+            ts->carry_len = end - p;
+            memcpy(ts->carry, p, ts->carry_len);
+            break;
+        }
+        ts_parse_packet(ts, p, offset + (p - buf));
+        p += TS_PACKET_SIZE;
+    }
+}
+
+static int ts_timeshift_flush(ts_timeshift_t *ts)
+{
+    int64_t pos = ts->flushed % ts->size;
+    int ret = pwrite(ts->wfd, ts->block, TIMESHIFT_BLOCK, pos);
+
+    if (ret != TIMESHIFT_BLOCK && ts->direct && errno == EINVAL) {
+        /* the file system refused O_DIRECT late, stay with buffered writes */
+        fcntl(ts->wfd, F_SETFL, fcntl(ts->wfd, F_GETFL) & ~O_DIRECT);
+        ts->direct = 0;
+        ret = pwrite(ts->wfd, ts->block, TIMESHIFT_BLOCK, pos);
+    }
+    if (ret != TIMESHIFT_BLOCK) {
+        printf("[%s]write ring block at %lld failed, ret %d errno %d\n", __FUNCTION__,
+               (long long)pos, ret, errno);
+    }
+    pthread_mutex_lock(&ts->lock);
+    ts->flushed += TIMESHIFT_BLOCK;
+    ts->block_len = 0;
+    ts_index_expire(ts);
+    pthread_mutex_unlock(&ts->lock);
+    return ret == TIMESHIFT_BLOCK ? 0 : -1;
+}
+
+ts_timeshift_t *ts_timeshift_open(const char *path, int64_t size, int video_pid, int vformat)
+{
+    ts_timeshift_t *ts;
+    void *block = NULL;
+
+    if (size <= 0) {
+        size = TIMESHIFT_DEFAULT_SIZE;
+    }
+    size -= size % TIMESHIFT_BLOCK;
+    if (size < 2 * TIMESHIFT_BLOCK) {
+        printf("[%s]ring size %lld too small\n", __FUNCTION__, (long long)size);
+        return NULL;
+    }
+    ts = calloc(1, sizeof(*ts));
+    if (!ts) {
+        return NULL;
+    }
+    ts->index = malloc(TIMESHIFT_INDEX_MAX * sizeof(ts_index_entry_t));
+    if (posix_memalign(&block, TIMESHIFT_ALIGN, TIMESHIFT_BLOCK) != 0 || !ts->index) {
+        free(ts->index);
+        free(ts);
+        return NULL;
+    }
+    ts->block = block;
+    ts->size = size;
+    ts->video_pid = video_pid;
+    ts->vformat = vformat;
+    ts->pmt_pid = -1;
+    ts->pcr_pid = video_pid;
+    pthread_mutex_init(&ts->lock, NULL);
+
+    ts->wfd = open(path, O_RDWR | O_CREAT | O_DIRECT, 0644);
+    ts->direct = ts->wfd >= 0 && O_DIRECT != 0;
+    if (ts->wfd < 0) {
+        ts->wfd = open(path, O_RDWR | O_CREAT, 0644);
+    }
+    ts->rfd = open(path, O_RDONLY);
+    if (ts->wfd < 0 || ts->rfd < 0 || ftruncate(ts->wfd, size) < 0) {
+        printf("[%s]can't create ring file %s, errno %d\n", __FUNCTION__, path, errno);
+        ts_timeshift_close(ts);
+        return NULL;
+    }
+    printf("[%s]%s %lld MB ring%s, video pid %d\n", __FUNCTION__, path,
+           (long long)(size >> 20), ts->direct ? " O_DIRECT" : "", video_pid);
+    return ts;
+}
+
+void ts_timeshift_close(ts_timeshift_t *ts)
+{
+    if (!ts) {
+        return;
+    }
+    if (ts->wfd >= 0) {
+        close(ts->wfd);
+    }
+    if (ts->rfd >= 0) {
+        close(ts->rfd);
+    }
+    pthread_mutex_destroy(&ts->lock);
+    free(ts->block);
+    free(ts->index);
+    free(ts);
+}
+
+int ts_timeshift_write(ts_timeshift_t *ts, const unsigned char *buf, int size)
+{
+    int64_t offset = ts->wpos;
+    int left = size, n;
+
+    while (left > 0) {
+        /* the reader only copies [0, block_len) of the staging block */
+        n = TIMESHIFT_BLOCK - ts->block_len;
+        n = n < left ? n : left;
+        memcpy(ts->block + ts->block_len, buf + (size - left), n);
+        pthread_mutex_lock(&ts->lock);
+        ts->block_len += n;
+        ts->wpos += n;
+        pthread_mutex_unlock(&ts->lock);
+        left -= n;
+        if (ts->block_len == TIMESHIFT_BLOCK) {
+            ts_timeshift_flush(ts);
+        }
+    }
+    pthread_mutex_lock(&ts->lock);
+    ts_parse(ts, buf, size, offset);
+    pthread_mutex_unlock(&ts->lock);
+    return size;
+}
+
+int ts_timeshift_read(ts_timeshift_t *ts, unsigned char *buf, int size)
+{
+    int64_t rpos, pos, oldest;
+    int n, gen, i, ret;
+
+    pthread_mutex_lock(&ts->lock);
+    oldest = ts_timeshift_oldest(ts);
+    if (ts->rpos < oldest) {
+        /* paused longer than the ring holds, continue at the oldest keyframe */
+        for (i = 0; i < ts->index_count && !ts_index_at(ts, i)->key; i++);
+        ts->rpos = i < ts->index_count ? ts_index_at(ts, i)->offset : oldest;
+        ts->seek_gen++;
+        printf("[%s]playback overrun by ingest, skip to %lld\n", __FUNCTION__, (long long)ts->rpos);
+    }
+    rpos = ts->rpos;
+    if (rpos >= ts->flushed) {
+        n = ts->wpos - rpos < size ? (int)(ts->wpos - rpos) : size;
+        memcpy(buf, ts->block + (rpos - ts->flushed), n);
+        ts->rpos += n;
+        pthread_mutex_unlock(&ts->lock);
+        return n;
+    }
+    n = ts->flushed - rpos < size ? (int)(ts->flushed - rpos) : size;
+    pos = rpos % ts->size;
+    if (pos + n > ts->size) {
+        n = ts->size - pos;
+    }
+    gen = ts->seek_gen;
+    pthread_mutex_unlock(&ts->lock);
+
+    ret = pread(ts->rfd, buf, n, pos);
+
+    pthread_mutex_lock(&ts->lock);
+    if (ret <= 0 || gen != ts->seek_gen || rpos < ts_timeshift_oldest(ts)) {
+        /* seeked or overwritten meanwhile, the caller reads again */
+        ret = 0;
+    } else {
+        ts->rpos += ret;
+    }
+    pthread_mutex_unlock(&ts->lock);
+    return ret;
+}
+
+int ts_timeshift_seek(ts_timeshift_t *ts, int ms_behind_live)
+{
+    int i, ret = 0;
+    int64_t target;
+
+    pthread_mutex_lock(&ts->lock);
+    ts_index_expire(ts);
+    target = ts->timeline - (int64_t)(ms_behind_live > 0 ? ms_behind_live : 0) * 90;
+    i = ts_index_find(ts, 1, target, 1);
+    if (i < 0) {
+        /* older than the ring, start at the oldest keyframe */
+        for (i = 0; i < ts->index_count && !ts_index_at(ts, i)->key; i++);
+    }
+    if (i < ts->index_count) {
+        ts->rpos = ts_index_at(ts, i)->offset;
+    } else if (ms_behind_live <= 0) {
+        ts->rpos = ts->wpos;
+    } else {
+        ret = -1;
+    }
+    ts->seek_gen++;
+    pthread_mutex_unlock(&ts->lock);
+    return ret;
+}
+
+int ts_timeshift_get_delay(ts_timeshift_t *ts)
+{
+    int i, delay = 0;
+
+    pthread_mutex_lock(&ts->lock);
+    i = ts_index_find(ts, 0, ts->rpos, 0);
+    if (i >= 0) {
+        delay = (ts->timeline - ts_index_at(ts, i)->time) / 90;
+    }
+    pthread_mutex_unlock(&ts->lock);
+    return delay;
+}
+
+int ts_timeshift_get_depth(ts_timeshift_t *ts)
+{
+    int depth = 0;
+
+    pthread_mutex_lock(&ts->lock);
+    ts_index_expire(ts);
+    if (ts->index_count > 0) {
+        depth = (ts->timeline - ts_index_at(ts, 0)->time) / 90;
+    }
+    pthread_mutex_unlock(&ts->lock);
+    return depth;
+}
@@ -0,0 +1,39 @@
+#ifndef _TS_TIMESHIFT_H_
+#define _TS_TIMESHIFT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * disk backed timeshift ring for live TS. ingest is appended to a
+ * preallocated ring file in large aligned blocks (O_DIRECT when the file
+ * system allows it) while a PCR/keyframe index of the ring is kept in
+ * memory. playback reads from its own position, which can lag behind the
+ * live edge by up to the ring size and be moved to any indexed keyframe.
+ */
+typedef struct ts_timeshift ts_timeshift_t;
+
+/* size is rounded down to the block size, 0 for the default */
+ts_timeshift_t *ts_timeshift_open(const char *path, int64_t size, int video_pid, int vformat);
+void ts_timeshift_close(ts_timeshift_t *ts);
+
+/* ingest side, any split of the TS byte stream */
+int ts_timeshift_write(ts_timeshift_t *ts, const unsigned char *buf, int size);
+
+/* playback side, returns 0 at the live edge */
+int ts_timeshift_read(ts_timeshift_t *ts, unsigned char *buf, int size);
+/* move playback to the keyframe ms behind the live edge, 0 for live */
+int ts_timeshift_seek(ts_timeshift_t *ts, int ms_behind_live);
+/* how far playback is behind the live edge, ms */
+int ts_timeshift_get_delay(ts_timeshift_t *ts);
+/* oldest position still in the ring, ms behind live */
+int ts_timeshift_get_depth(ts_timeshift_t *ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -136,12 +136,11 @@ static void signal_handler(int signum)
 int main(int argc,char *argv[])
 {
     int ret = CODEC_ERROR_NONE;
-    char buffer[READ_SIZE];
+    codec_buf_pool_t *pool = NULL;
+    codec_buf_t *buf;
 
     int len = 0;
     int size = READ_SIZE;
-    uint32_t Readlen;
-    uint32_t isize;
     struct buf_status vbuf;
 
     if (argc < 6) {
@@ -236,33 +235,35 @@ int main(int argc,char *argv[])
     set_tsync_enable(0);
 
     pcodec = vpcodec;
+    /* read the file straight into codec buffers, no staging copy */
+    pool = codec_buf_pool_create(pcodec, 4, READ_SIZE);
+    if (!pool) {
+        printf("no memory for codec buffers\n");
+        goto error;
+    }
+    codec_buf_pool_set_batch(pool, 1, 0);
     while(!feof(fp))
     {
-        Readlen = fread(buffer, 1, READ_SIZE,fp);
-        //printf("Readlen %d\n", Readlen);
-        if(Readlen <= 0)
+        buf = codec_buf_get(pool);
+        if (!buf) {
+            codec_buf_flush(pool);
+            continue;
+        }
+        buf->len = fread(buf->data, 1, buf->size, fp);
+        //printf("Readlen %d\n", buf->len);
+        if(buf->len <= 0)
         {
             printf("read file error!\n");
+            codec_buf_put(pool, buf);
             rewind(fp);
+            continue;
         }
 
-        isize = 0;
-        do{
-            ret = codec_write(pcodec, buffer+isize, Readlen);
-            if (ret < 0) {
-                if (errno != EAGAIN) {
-                    printf("write data failed, errno %d\n", errno);
-                    goto error;
-                }
-                else {
-                    continue;
-                }
-            }
-            else {
-                isize += ret;
-            }
-            //printf("ret %d, isize %d\n", ret, isize);
-        }while(isize < Readlen);	 
+        ret = codec_buf_submit(pool, buf);
+        if (ret < 0) {
+            printf("write data failed, errno %d\n", errno);
+            goto error;
+        }
 
         signal(SIGCHLD, SIG_IGN);
         signal(SIGTSTP, SIG_IGN);
@@ -274,6 +275,12 @@ int main(int argc,char *argv[])
         signal(SIGINT, signal_handler);
         signal(SIGQUIT, signal_handler);
     }	
+    while (codec_buf_pending(pool) > 0) {
+        if (codec_buf_flush(pool) < 0 && errno != EAGAIN) {
+            printf("write data failed, errno %d\n", errno);
+            goto error;
+        }
+    }
 
     do {
         ret = codec_get_vbuf_state(pcodec, &vbuf);
@@ -284,6 +291,7 @@ int main(int argc,char *argv[])
     } while (vbuf.data_len > 0x100);
     
 error:
+    codec_buf_pool_destroy(pool);
 #ifdef AUDIO_ES
     codec_close(apcodec);
 #endif
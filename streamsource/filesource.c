@@ -0,0 +1,318 @@
+/********************************************
+ * name             : filesource.c
+ * function     : local file source,mmap'ed or pread with readahead hints,
+ *                   without the URLProtocol stack.
+ * initialize date     : 2014.9.2
+ ********************************************/
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/mman.h>
+#include <amconfigutils.h>
+#include "source.h"
+#include "slog.h"
+
+#define FILESOURCE_BLOCK        (256 * 1024)
+#define FILESOURCE_MAP_MAX_MB   256     /*bigger files are read with pread,keep the address space*/
+#define FILESOURCE_WRITING_S    5       /*modified this recently counts as being written*/
+
+struct filesource {
+    int fd;
+    int64_t size;
+    char *map;          /*the whole file,NULL on the pread path*/
+    int64_t advised;    /*end of the range given to the kernel readahead*/
+};
+
+static int filesource_enable = -1;
+static int filesource_map_max_mb = -1;
+
+/*
+ * enable < 0 and map_max_mb < 0 keep the media.libplayer.filesource and
+ * media.libplayer.filesource.mapmb settings,map_max_mb 0 never maps.
+ */
+void filesource_config(int enable, int map_max_mb)
+{
+    filesource_enable = enable;
+    filesource_map_max_mb = map_max_mb;
+}
+
+static const char *filesource_path(const char *url)
+{
+    if (!strncmp(url, "file:", 5)) {
+        url += 5;
+    }
+    return url[0] == '/' ? url : NULL;
+}
+
+static int filesource_supporturl(source_t *as, const char * url, const char *header, int flags)
+{
+    const char *path = filesource_path(url);
+    struct stat st;
+    int enable = filesource_enable;
+
+    if (enable < 0) {
+        enable = am_getconfig_bool_def("media.libplayer.filesource", 1);
+    }
+    if (!enable || !path || stat(path, &st) != 0) {
+        return 0;
+    }
+    return S_ISREG(st.st_mode) ? 100 : 0;
+}
+
+/*
+ * a read error on a mapped page is a SIGBUS instead of an EIO,map only
+ * files on a block device that can not be pulled out:no usb,no removable
+ * flag on the disk.what can not be told,fuse and the like,is read with pread.
+ */
+static int filesource_map_safe(dev_t dev)
+{
+    char path[64], real[PATH_MAX], attr[PATH_MAX + 16];
+    FILE *fp;
+    int c = EOF;
+
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u", major(dev), minor(dev));
+    if (!realpath(path, real) || strstr(real, "/usb")) {
+        return 0;
+    }
+    /*a partition has the flag on its disk*/
+    snprintf(attr, sizeof(attr), "%s/removable", real);
+    fp = fopen(attr, "r");
+    if (!fp) {
+        snprintf(attr, sizeof(attr), "%s/../removable", real);
+        fp = fopen(attr, "r");
+    }
+    if (fp) {
+        c = fgetc(fp);
+        fclose(fp);
+    }
+    return c == '0';
+}
+
+/*
+ * a file still being written,a recording or a timeshift file,grows past
+ * the size seen at open:read it with pread,which follows the growth.
+ * a read lease is refused while a writer has the file open;where leases
+ * are not allowed,a file modified in the last seconds counts as written.
+ */
+static int filesource_writing(int fd, const struct stat *st)
+{
+#ifdef F_SETLEASE
+    if (fcntl(fd, F_SETLEASE, F_RDLCK) == 0) {
+        fcntl(fd, F_SETLEASE, F_UNLCK);
+        return 0;
+    }
+    if (errno == EAGAIN) {
+        return 1;
+    }
+#endif
+    return time(NULL) - st->st_mtime < FILESOURCE_WRITING_S;
+}
+
+/*pread path at the end of the known size:take the size again*/
+static int filesource_update_size(source_t *as, struct filesource *fs)
+{
+    struct stat st;
+
+    if (fs->map || fstat(fs->fd, &st) != 0 || st.st_size == fs->size) {
+        return 0;
+    }
+    fs->size = st.st_size;
+    as->options.filesize = fs->size;
+    return 1;
+}
+
+static int filesource_open(source_t *as, const char * url, const char *header, int flags)
+{
+    struct filesource *fs;
+    struct stat st;
+    int map_max_mb = filesource_map_max_mb;
+
+    fs = malloc(sizeof(struct filesource));
+    if (!fs) {
+        return SOURCE_ERROR_NOMEN;
+    }
+    memset(fs, 0, sizeof(*fs));
+    fs->fd = open(filesource_path(url), O_RDONLY);
+    if (fs->fd < 0 || fstat(fs->fd, &st) != 0) {
+        LOGE("filesource open %s failed %d\n", url, errno);
+        if (fs->fd >= 0) {
+            close(fs->fd);
+        }
+        free(fs);
+        return SOURCE_ERROR_OPENFAILED;
+    }
+    fs->size = st.st_size;
+    if (map_max_mb < 0) {
+        map_max_mb = (int)am_getconfig_float_def("media.libplayer.filesource.mapmb", FILESOURCE_MAP_MAX_MB);
+    }
+    if (fs->size > 0 && fs->size <= (int64_t)map_max_mb * 1024 * 1024 && filesource_map_safe(st.st_dev) &&
+        !filesource_writing(fs->fd, &st)) {
+        fs->map = mmap(NULL, fs->size, PROT_READ, MAP_SHARED, fs->fd, 0);
+        if (fs->map == MAP_FAILED) {
+            LOGI("filesource mmap %lld bytes failed %d,use pread\n", fs->size, errno);
+            fs->map = NULL;
+        } else {
+            madvise(fs->map, fs->size, MADV_SEQUENTIAL);
+        }
+    }
+    posix_fadvise(fs->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    as->priv[0] = (unsigned long)fs;
+    as->options.filesize = fs->size;
+    as->options.is_streaming = 0;
+    as->options.duration_ms = 0;
+    as->options.support_seek_by_time = 0;
+    as->options.blocksize = FILESOURCE_BLOCK;
+    as->options.is_local = 1;
+    as->options.mapped = fs->map != NULL;
+    if (url != as->location) {
+        as->firstread = 1;
+        strncpy(as->location, url, MAX_URL_SIZE - 1);
+    }
+    LOGI("filesource opened %s,size=%lld,%s\n", url, fs->size, fs->map ? "mmap" : "pread");
+    return 0;
+}
+
+/*
+ * ask the kernel for the data up to readahead bytes after what is being
+ * read,in steps of at least one block so that it reads big chunks.
+ */
+static void filesource_advise(source_t *as, struct filesource *fs, int64_t pos, int len)
+{
+    int64_t end = pos + len + as->readahead;
+    int64_t start;
+
+    if (end > fs->size) {
+        end = fs->size;
+    }
+    if (fs->advised < pos || fs->advised > end) {
+        fs->advised = pos;  /*seeked*/
+    }
+    if (end - fs->advised < FILESOURCE_BLOCK && end < fs->size) {
+        return;
+    }
+    if (end <= fs->advised) {
+        return;
+    }
+    if (fs->map) {
+        start = fs->advised & ~((int64_t)getpagesize() - 1);
+        madvise(fs->map + start, end - start, MADV_WILLNEED);
+    } else {
+        posix_fadvise(fs->fd, fs->advised, end - fs->advised, POSIX_FADV_WILLNEED);
+    }
+    fs->advised = end;
+}
+
+static int filesource_read(source_t *as, char *buf, int size)
+{
+    struct filesource *fs = (struct filesource *)as->priv[0];
+    int ret;
+
+    if (!fs) {
+        return SOURCE_ERROR_NOT_OPENED;
+    }
+    if (as->s_off >= fs->size && !filesource_update_size(as, fs)) {
+        return SOURCE_ERROR_EOF;
+    }
+    do {
+        ret = pread(fs->fd, buf, size, as->s_off);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        LOGE("filesource read at %lld failed %d\n", as->s_off, errno);
+        return SOURCE_ERROR_IO;
+    }
+    if (ret == 0) {
+        /*truncated under us*/
+        filesource_update_size(as, fs);
+        return SOURCE_ERROR_EOF;
+    }
+    filesource_advise(as, fs, as->s_off, ret);
+    return ret;
+}
+
+static int filesource_map(source_t *as, char **data, int size)
+{
+    struct filesource *fs = (struct filesource *)as->priv[0];
+    int64_t left;
+
+    if (!fs || !fs->map) {
+        return SOURCE_ERROR_NOT_OPENED;
+    }
+    left = fs->size - as->s_off;
+    if (left <= 0) {
+        return SOURCE_ERROR_EOF;
+    }
+    if (size > left) {
+        size = (int)left;
+    }
+    *data = fs->map + as->s_off;
+    filesource_advise(as, fs, as->s_off, size);
+    return size;
+}
+
+static int64_t filesource_seek(source_t *as, int64_t off, int whence)
+{
+    struct filesource *fs = (struct filesource *)as->priv[0];
+    int64_t pos;
+
+    if (!fs) {
+        return SOURCE_ERROR_NOT_OPENED;
+    }
+    switch (whence) {
+    case SEEK_SET:
+        pos = off;
+        break;
+    case SEEK_CUR:
+        pos = as->s_off + off;
+        break;
+    case SEEK_END:
+        filesource_update_size(as, fs);
+        pos = fs->size + off;
+        break;
+    case SOURCE_SEEK_SIZE:
+        filesource_update_size(as, fs);
+        return fs->size;
+    default:
+        return -1;
+    }
+    if (pos > fs->size) {
+        filesource_update_size(as, fs);
+    }
+    if (pos < 0 || pos > fs->size) {
+        return SOURCE_ERROR_SEEK_FAILED;
+    }
+    LOGI("filesource_seek off=%lld,whence=%d\n", off, whence);
+    return pos;
+}
+
+static int filesource_close(source_t *as)
+{
+    struct filesource *fs = (struct filesource *)as->priv[0];
+
+    if (fs) {
+        if (fs->map) {
+            munmap(fs->map, fs->size);
+        }
+        close(fs->fd);
+        free(fs);
+    }
+    as->priv[0] = 0;
+    return 0;
+}
+
+sourceprot_t file_source = {
+    .name                = "filesource",
+    .open            = filesource_open,
+    .read            = filesource_read,
+    .seek            = filesource_seek,
+    .close           = filesource_close,
+    .supporturl    = filesource_supporturl,
+    .map             = filesource_map,
+};
@@ -68,14 +68,19 @@ int queue_bufrealloc(bufheader_t *buf, int datasize)
         buf->pbuf = oldbuf;
         return -1;
     }
-    free((void *)oldbuf);	
+    if (!(buf->flags & BUF_FLAG_MAPPED)) {
+        free((void *)oldbuf);
+    }
+    buf->flags &= ~BUF_FLAG_MAPPED;
     buf->bufsize = datasize;
     return 0;
 }
 
 int queue_buffree(bufheader_t*buf)
 {
-    free(buf->pbuf);
+    if (!(buf->flags & BUF_FLAG_MAPPED)) {
+        free(buf->pbuf);
+    }
     free(buf);
     return 0;
 }
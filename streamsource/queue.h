@@ -3,6 +3,9 @@
 #define  AMLOGIC_QUEUE_HEADER_H
 #include <stdlib.h>
 #include <list.h>
+
+#define BUF_FLAG_MAPPED 1   /*pbuf points into the pages mapped by the source, not owned*/
+
 typedef struct bufheader {
     int flags;
     int64_t timestampe;//us.
@@ -38,6 +38,7 @@ int source_open(source_t *as)
     int ret;
     for (i = 0; i < source_max; i++) {
         prot = gsource_list[i];
+        ret = -1;
         if (prot != NULL) {
             if (prot->supporturl(as, as->url, as->header, as->flags)) {
                 LOGI("source_open try opened by,url=%s\n", prot->name);
@@ -69,7 +70,24 @@ int source_read(source_t *as, char * buf, int size)
     int ret = -1;
     if (as->prot != NULL) {
         ret = as->prot->read(as, buf, size);
-        as->s_off += ret;
+        if (ret > 0) {
+            as->s_off += ret;
+        }
+    }
+    return ret;
+}
+/*
+ * point *data at the next size bytes at most,without a copy.
+ * only for sources with options.mapped set.
+ */
+int source_map(source_t *as, char **data, int size)
+{
+    int ret = SOURCE_ERROR_NOT_OPENED;
+    if (as->prot != NULL && as->prot->map != NULL) {
+        ret = as->prot->map(as, data, size);
+        if (ret > 0) {
+            as->s_off += ret;
+        }
     }
     return ret;
 }
@@ -119,7 +137,9 @@ int register_source(sourceprot_t *source)
 
 int source_init_all(void)
 {
+    extern sourceprot_t file_source;
     extern sourceprot_t ffmpeg_source;
+    register_source(&file_source);/*local files first,ffmpeg takes everything*/
     register_source(&ffmpeg_source);
     return 0;
 }
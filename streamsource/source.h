@@ -8,6 +8,9 @@ struct  source_options {
     int      is_streaming;
     int64_t  duration_ms;
     int      support_seek_by_time;
+    int      blocksize;     /*preferred read size,0 for the default*/
+    int      is_local;      /*seeks are cheap,read ahead no more than source_t.readahead*/
+    int      mapped;        /*data is read by source_map(),no copy*/
 };
 
 
@@ -19,6 +22,7 @@ typedef struct sourceprot {
     int64_t (*seek)(struct source *s, int64_t pos, int whence);
     int (*supporturl)(struct source *s, const char *url, const char *header, int flags);
     int (*close)(struct source *s);
+    int (*map)(struct source *s, char **data, int size);
 } sourceprot_t;
 #define MAX_URL_SIZE 4096
 typedef struct source {
@@ -29,6 +33,7 @@ typedef struct source {
     int64_t s_off;/*don't changed it on lowlevel */
     sourceprot_t *prot;
     int firstread;
+    int readahead;/*bytes wanted ahead of s_off,from the playback rate*/
     struct  source_options options;
     unsigned long priv[64];
 } source_t;
@@ -53,11 +58,13 @@ source_t *new_source(const char * url, const char *header, int flags);
 int source_open(source_t *as);
 int source_close(source_t *as);
 int source_read(source_t *as, char * buf, int size);
+int source_map(source_t *as, char **data, int size);
 int64_t source_seek(source_t *as, int64_t off, int whence);
 int release_source(source_t *as);
 int register_source(sourceprot_t *source);
 int source_init_all(void);
 int64_t source_size(source_t *as);
 int source_getoptions(source_t *as, struct source_options *op);
+void filesource_config(int enable, int map_max_mb);
 #endif
 
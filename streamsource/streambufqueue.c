@@ -96,8 +96,12 @@ bufheader_t *streambuf_getbuf(streambufqueue_t *s, int size)
         buf = queue_bufget(&s->oldqueue);/*if we have enough old data,try get from old buf*/
     }
     if (buf) {
-        if (buf->bufsize < size) {
-            queue_bufrealloc(buf, size);
+        if (buf->bufsize < size || (buf->flags & BUF_FLAG_MAPPED)) {
+            if (queue_bufrealloc(buf, size) < 0) {
+                queue_bufpush(&s->freequeue, buf);
+                buf = NULL;
+                goto endout;
+            }
         }
     } else {
         if (queue_bufdatasize(&s->newdata) > NEWDATA_MAX) {
@@ -120,6 +124,46 @@ endout:
     lp_unlock(&s->lock);
     return buf;
 }
+/*
+ * a buf referencing data mapped by the source instead of a copy of it,
+ * the mapping must live until streambuf_release().
+ */
+bufheader_t *streambuf_getmapbuf(streambufqueue_t *s, char *data, int len)
+{
+    bufheader_t *buf;
+    lp_lock(&s->lock);
+    buf = queue_bufget(&s->freequeue);
+    if (buf == NULL && queue_bufdatasize(&s->oldqueue) > OLDDATA_MAX) {
+        buf = queue_bufget(&s->oldqueue);
+    }
+    if (buf) {
+        if (!(buf->flags & BUF_FLAG_MAPPED)) {
+            free(buf->pbuf);
+        }
+    } else {
+        if (queue_bufdatasize(&s->newdata) > NEWDATA_MAX) {
+            LOGE("too many bufs used =%d,wait buf free.\n", queue_bufdatasize(&s->newdata));
+            goto endout;
+        }
+        buf = malloc(sizeof(bufheader_t));
+        if (!buf) {
+            LOGE("streambuf_getmapbuf alloc failed\n");
+            goto endout;
+        }
+    }
+    memset(buf, 0, sizeof(bufheader_t));
+    buf->pbuf = data;
+    buf->data_start = data;
+    buf->bufsize = len;
+    buf->bufdatalen = len;
+    buf->timestampe = -1;
+    buf->pos = -1;
+    buf->flags = BUF_FLAG_MAPPED;
+    INIT_LIST_HEAD(&buf->list);
+endout:
+    lp_unlock(&s->lock);
+    return buf;
+}
 int streambuf_buf_write(streambufqueue_t *s, bufheader_t *buf)
 {
     lp_lock(&s->lock);
@@ -27,6 +27,7 @@ int streambuf_release(streambufqueue_t *s);
 int streambuf_once_read(streambufqueue_t *s, char *buffer, int size);
 int streambuf_read(streambufqueue_t *s, char *buffer, int size);
 bufheader_t *streambuf_getbuf(streambufqueue_t *s, int size);
+bufheader_t *streambuf_getmapbuf(streambufqueue_t *s, char *data, int len);
 int streambuf_buf_write(streambufqueue_t *s, bufheader_t *buf);
 int streambuf_write(streambufqueue_t *s, char *buffer, int size, int timestamps);
 int64_t streambuf_seek(streambufqueue_t *s, int64_t off, int whence);
@@ -11,12 +11,16 @@
 #include "thread_read.h"
 #include <sys/types.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include "source.h"
 #include "slog.h"
 #include <errno.h>
 int ffmpeg_interrupt_callback(void);
 #define ISTRYBECLOSED() (ffmpeg_interrupt_callback())
 #define MAX_READ_SEEK (2*1024*1024)
+#define READAHEAD_SECONDS   4
+#define READAHEAD_MIN   (1*1024*1024)
+#define READAHEAD_MAX   (32*1024*1024)
 int thread_read_thread_run(unsigned long arg);
 struct  thread_read *new_thread_read(const char *url, const char *headers, int flags) {
     pthread_t       tid;
@@ -107,11 +111,51 @@ int thread_read_release(struct  thread_read *thread)
     if (thread->streambuf != NULL) {
         streambuf_release(thread->streambuf);
     }
+    if (thread->source != NULL) {/*after the bufs,they may point into its mapping*/
+        release_source(thread->source);
+    }
     free(thread);
     LOGI("thread_read_release thread exited all\n");
     return 0;
 }
 
+static int64_t thread_read_now_us(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static void thread_read_update_rate(struct  thread_read *thread, int len)
+{
+    int64_t now = thread_read_now_us();
+    int64_t elapsed = now - thread->rate_start_us;
+
+    if (thread->rate_start_us == 0) {
+        thread->rate_start_us = now;
+        return;
+    }
+    thread->rate_bytes += len;
+    if (elapsed >= 1000000) {
+        int rate = (int)(thread->rate_bytes * 1000000 / elapsed);
+        thread->bitrate = thread->bitrate ? (thread->bitrate * 3 + rate) / 4 : rate;
+        thread->rate_start_us = now;
+        thread->rate_bytes = 0;
+    }
+}
+
+/*how far a local source reads ahead of the player*/
+static int thread_read_readahead(struct  thread_read *thread)
+{
+    int64_t len = (int64_t)thread->bitrate * READAHEAD_SECONDS;
+    if (len < READAHEAD_MIN) {
+        len = READAHEAD_MIN;
+    } else if (len > READAHEAD_MAX) {
+        len = READAHEAD_MAX;
+    }
+    return (int)len;
+}
+
 int thread_read_read(struct  thread_read *thread, char * buf, int size)
 {
     int ret = -1;
@@ -143,6 +187,9 @@ int thread_read_read(struct  thread_read *thread, char * buf, int size)
             break;
         }
     }
+    if (readlen > 0) {
+        thread_read_update_rate(thread, readlen);
+    }
     return readlen > 0 ? readlen : ret;
 
 }
@@ -247,6 +294,12 @@ int thread_read_openstream(struct  thread_read *thread)
             return ret;
         }
         source_getoptions(thread->source, &thread->options);
+        if (thread->options.blocksize > 0) {
+            thread->toreadblocksize = thread->options.blocksize;
+        }
+        if (thread->options.is_local) {
+            thread->max_read_seek_len = 0;/*seeking the source is cheaper than reading to it*/
+        }
         thread_read_wakewait(thread);
         thread->opened = 1;
     }
@@ -270,11 +323,56 @@ int thread_read_seekstream(struct  thread_read *thread)
     /*don't care seek error*/
     return 0;
 }
+static int thread_read_download_error(struct  thread_read *thread, int ret)
+{
+    LOGI("thread_read_download ERROR=%d\n", ret);
+    thread->error = ret;
+    if (ret != EAGAIN && thread->error != SOURCE_ERROR_EOF) {
+        thread->fatal_error = ret;
+    }
+    return ret;
+}
+
+/*queue the mapped pages of the source,no copy*/
+static int thread_read_download_mapped(struct  thread_read *thread)
+{
+    bufheader_t *buf;
+    char *data;
+    int64_t pos = source_seek(thread->source, 0, SEEK_CUR);
+    int ret = source_map(thread->source, &data, thread->toreadblocksize);
+
+    if (ret <= 0) {
+        return thread_read_download_error(thread, ret);
+    }
+    buf = streambuf_getmapbuf(thread->streambuf, data, ret);
+    if (!buf) {
+        source_seek(thread->source, pos, SEEK_SET);
+        usleep(10 * 1000);
+        return 0;
+    }
+    buf->pos = pos;
+    streambuf_buf_write(thread->streambuf, buf);
+    thread_read_wakewait(thread);
+    return 0;
+}
+
 int thread_read_download(struct  thread_read *thread)
 {
     int ret;
     bufheader_t *buf;
     int readsize = thread->toreadblocksize;
+    if (thread->options.is_local) {
+        thread->source->readahead = thread_read_readahead(thread);
+        if (streambuf_bufdatasize(thread->streambuf) >= thread->source->readahead) {
+            /*far enough ahead of the player,wait about the time it reads one block*/
+            int64_t wait_us = thread->bitrate > 0 ? (int64_t)readsize * 1000000 / thread->bitrate : 1000;
+            usleep(wait_us < 1000 ? 1000 : (wait_us > 10000 ? 10000 : (int)wait_us));
+            return 0;
+        }
+        if (thread->options.mapped) {
+            return thread_read_download_mapped(thread);
+        }
+    }
     buf = streambuf_getbuf(thread->streambuf, readsize);
     if (!buf) {
 	  streambuf_dumpstates(thread->streambuf);	
@@ -305,13 +403,8 @@ int thread_read_download(struct  thread_read *thread)
         //streambuf_dumpstates(thread->streambuf);
         thread_read_wakewait(thread);
     } else {
-        LOGI("thread_read_download ERROR=%d\n", ret);
-        thread->error = ret;
-        if (ret != EAGAIN && thread->error != SOURCE_ERROR_EOF) {
-            thread->fatal_error = ret;
-        }
         streambuf_buf_free(thread->streambuf, buf);
-        return ret;
+        return thread_read_download_error(thread, ret);
     }
     return 0;
 }
@@ -38,6 +38,11 @@ struct  thread_read {
     int toreadblocksize;
     int64_t readtotalsize;
     int readcnt;	
+
+    /*player read rate,sizes the read ahead of local sources*/
+    int64_t rate_start_us;
+    int64_t rate_bytes;
+    int bitrate;/*bytes per second*/
 };
 
 
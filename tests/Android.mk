@@ -17,3 +17,209 @@ LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils
 
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE    := adecbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := adecbench.c ../amadec/adec-frame-skip.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amadec \
+    $(LOCAL_PATH)/../amadec/include \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_SHARED_LIBRARIES += libdl libcutils
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := faadsimdtest
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := faadsimdtest.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../audio_codec/libfaad
+LOCAL_STATIC_LIBRARIES := libfaad
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := codecemubench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := codecemubench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amcodec/include \
+    $(LOCAL_PATH)/../amcodec/codec \
+    $(LOCAL_PATH)/../amadec/include \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamcodec libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := kfindexbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := kfindexbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player \
+    $(LOCAL_PATH)/../amplayer/player/include \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamplayer libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := nalpackbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := nalpackbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player \
+    $(LOCAL_PATH)/../amplayer/player/include
+LOCAL_STATIC_LIBRARIES := libamplayer
+LOCAL_SHARED_LIBRARIES += libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := movopenbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := movopenbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amffmpeg \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libavformat libavcodec libavutil libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := curlenginebench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := curlenginebench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(TOP)/external/curl/include \
+    $(LOCAL_PATH)/../third_parts/libcurl-ffmpeg/include
+LOCAL_STATIC_LIBRARIES := libcurl_base libcurl_common libavutil
+LOCAL_SHARED_LIBRARIES += libcurl libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := tstimeshiftbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := tstimeshiftbench.c ../examples/TsPlayer/ts_timeshift.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../examples/TsPlayer \
+    $(LOCAL_PATH)/../amcodec/include
+LOCAL_SHARED_LIBRARIES += libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := jitterbufbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := jitterbufbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player \
+    $(LOCAL_PATH)/../amplayer/player/include
+LOCAL_STATIC_LIBRARIES := libamplayer libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := esinjectbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := esinjectbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amcodec/include \
+    $(LOCAL_PATH)/../amcodec/codec \
+    $(LOCAL_PATH)/../amadec/include \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamcodec libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := mediascanbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := mediascanbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player/include \
+    $(LOCAL_PATH)/../amcodec/include \
+    $(LOCAL_PATH)/../amadec/include \
+    $(LOCAL_PATH)/../amffmpeg \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamplayer libamcodec libavformat libavcodec libavutil libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := chdbbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := chdbbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../dvbplayer/include \
+    $(LOCAL_PATH)/../amplayer/player/include
+LOCAL_STATIC_LIBRARIES := libamdvb libamplayer libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := zapbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := zapbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../dvbplayer/include \
+    $(LOCAL_PATH)/../amplayer/player/include \
+    $(LOCAL_PATH)/../amcodec/include \
+    $(LOCAL_PATH)/../amadec/include \
+    $(LOCAL_PATH)/../amffmpeg \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamdvb libamplayer libamcodec libavformat libavcodec libavutil libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := threadpoolbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := threadpoolbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := logbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := logbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player/include
+LOCAL_STATIC_LIBRARIES := libamplayer libamcodec libavformat libavcodec libavutil libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := rtpfecbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := rtpfecbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amffmpeg \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libavformat libavcodec libavutil libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := filesourcebench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := filesourcebench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../streamsource \
+    $(LOCAL_PATH)/../amffmpeg \
+    $(LOCAL_PATH)/../amavutils/include
+LOCAL_STATIC_LIBRARIES := libamstreaming libamplayer libamcodec libavformat libavcodec libavutil libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE    := h263vldbench
+LOCAL_MODULE_TAGS := tests
+LOCAL_SRC_FILES := h263vldbench.c
+LOCAL_ARM_MODE := arm
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../amplayer/player \
+    $(LOCAL_PATH)/../amplayer/player/include
+LOCAL_STATIC_LIBRARIES := libamplayer libamcodec libavformat libavcodec libavutil libamadec libamavutils
+LOCAL_SHARED_LIBRARIES += libutils libmedia libbinder libz libdl libcutils liblog
+include $(BUILD_EXECUTABLE)
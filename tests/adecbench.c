@@ -0,0 +1,681 @@
+/**
+ * \file adecbench.c
+ * \brief  Standalone benchmark/conformance runner for audio_codec plugins
+ *
+ * Loads a decoder plugin (libfaad.so, libmad.so, ...) the same way
+ * find_audio_lib() does, feeds an elementary stream file through
+ * audio_dec_decode() and reports real time factor, per-call latency
+ * distribution, peak process RSS and the MD5 of the produced PCM.
+ * An optional reference PCM file is compared bit-exactly (or within
+ * a +/- LSB tolerance).
+ *
+ * usage:
+ *   adecbench [-t tol] [-n loops] [-k skip_ms] [-o out.pcm] lib fmt rate ch in.es [ref.pcm]
+ *   adecbench [-k skip_ms] -s suite.txt
+ *
+ * A suite file holds one case per line, with the same positional
+ * arguments; lines starting with '#' are ignored. The process exit
+ * code is the number of failed cases, so it can run as a regression job.
+ *
+ * -k ms times how long the start up drop takes to get ms into the stream,
+ * decoding everything and dropping the pcm against skipping the whole
+ * frames by their headers (adec-frame-skip.c) and decoding the rest.
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dlfcn.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <audio-dec.h>
+#include <adec-frame-skip.h>
+
+#define BENCH_IN_CHUNK      (8 * 1024)
+#define BENCH_MAX_CALLS     (1 << 20)
+
+typedef struct {
+    const char *name;
+    int fmt;
+} bench_fmt_t;
+
+static const bench_fmt_t bench_fmt_list[] = {
+    {"aac", ACODEC_FMT_AAC},
+    {"latm", ACODEC_FMT_AAC_LATM},
+    {"mp3", ACODEC_FMT_MPEG},
+    {"mp2", ACODEC_FMT_MPEG2},
+    {"mp1", ACODEC_FMT_MPEG1},
+    {"flac", ACODEC_FMT_FLAC},
+    {"ape", ACODEC_FMT_APE},
+    {"cook", ACODEC_FMT_COOK},
+    {"raac", ACODEC_FMT_RAAC},
+    {"amr", ACODEC_FMT_AMR},
+    {"adpcm", ACODEC_FMT_ADPCM},
+    {"pcm_s16le", ACODEC_FMT_PCM_S16LE},
+    {"pcm_s16be", ACODEC_FMT_PCM_S16BE},
+    {"pcm_u8", ACODEC_FMT_PCM_U8},
+    {"lpcm", ACODEC_FMT_PCM_BLURAY},
+    {"wfd", ACODEC_FMT_WIFIDISPLAY},
+    {"alaw", ACODEC_FMT_ALAW},
+    {"mulaw", ACODEC_FMT_MULAW},
+};
+
+typedef struct {
+    const char *lib;
+    int fmt;
+    int samplerate;
+    int channels;
+    const char *input;
+    const char *ref;
+    const char *output;
+    int tolerance;
+    int loops;
+    int skip_ms;
+} bench_case_t;
+
+typedef struct {
+    int64_t pcm_bytes;
+    int64_t es_bytes;
+    int64_t total_us;
+    int calls;
+    int errors;
+    int *call_us;
+    unsigned char md5[16];
+    int64_t mismatch;
+    int64_t max_diff;
+    int low_byte;
+} bench_result_t;
+
+/*---------------------------------------------------------------------------
+ * minimal MD5 (RFC 1321), kept local so the runner has no extra deps
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t h[4];
+    uint64_t len;
+    unsigned char buf[64];
+} bench_md5_t;
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+static const unsigned char md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static void md5_block(bench_md5_t *m, const unsigned char *p)
+{
+    uint32_t w[16], a, b, c, d, f, t;
+    int i, g;
+    for (i = 0; i < 16; i++) {
+        w[i] = p[i * 4] | (p[i * 4 + 1] << 8) | (p[i * 4 + 2] << 16) | ((uint32_t)p[i * 4 + 3] << 24);
+    }
+    a = m->h[0];
+    b = m->h[1];
+    c = m->h[2];
+    d = m->h[3];
+    for (i = 0; i < 64; i++) {
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        t = d;
+        d = c;
+        c = b;
+        f += a + md5_k[i] + w[g];
+        b += (f << md5_r[i]) | (f >> (32 - md5_r[i]));
+        a = t;
+    }
+    m->h[0] += a;
+    m->h[1] += b;
+    m->h[2] += c;
+    m->h[3] += d;
+}
+
+static void md5_init(bench_md5_t *m)
+{
+    m->h[0] = 0x67452301;
+    m->h[1] = 0xefcdab89;
+    m->h[2] = 0x98badcfe;
+    m->h[3] = 0x10325476;
+    m->len = 0;
+}
+
+static void md5_update(bench_md5_t *m, const unsigned char *p, int len)
+{
+    int fill = m->len & 63;
+    m->len += len;
+    while (len > 0) {
+        int n = 64 - fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(m->buf + fill, p, n);
+        fill += n;
+        p += n;
+        len -= n;
+        if (fill == 64) {
+            md5_block(m, m->buf);
+            fill = 0;
+        }
+    }
+}
+
+static void md5_final(bench_md5_t *m, unsigned char out[16])
+{
+    static const unsigned char pad[64] = {0x80};
+    unsigned char lenbuf[8];
+    uint64_t bits = m->len << 3;
+    int i;
+    for (i = 0; i < 8; i++) {
+        lenbuf[i] = bits >> (8 * i);
+    }
+    md5_update(m, pad, 1 + ((119 - (int)(m->len & 63)) & 63));
+    md5_update(m, lenbuf, 8);
+    for (i = 0; i < 16; i++) {
+        out[i] = m->h[i >> 2] >> (8 * (i & 3));
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+
+static int64_t bench_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* whole process high water mark: the decoder plus the es, reference and
+ * timing buffers of the bench itself, not the decoder's own allocations */
+static long bench_peak_rss_kb(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) < 0) {
+        return -1;
+    }
+    return ru.ru_maxrss;
+}
+
+static int bench_parse_fmt(const char *s)
+{
+    unsigned i;
+    for (i = 0; i < ARRAY_SIZE(bench_fmt_list); i++) {
+        if (!strcmp(s, bench_fmt_list[i].name)) {
+            return bench_fmt_list[i].fmt;
+        }
+    }
+    return atoi(s);
+}
+
+static int bench_cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static unsigned char *bench_load_file(const char *path, int *size)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char *buf;
+    long len;
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(len > 0 ? len : 1);
+    if (buf && fread(buf, 1, len, fp) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    *size = len;
+    return buf;
+}
+
+/*
+ * compare 16bit pcm against the reference, counting samples outside tolerance;
+ * decoders may return odd sized chunks, so samples are rebuilt on the global
+ * byte offset and a dangling low byte is carried over to the next call
+ */
+static void bench_compare(bench_result_t *res, const unsigned char *pcm, int len,
+                          const unsigned char *ref, int ref_len, int64_t ref_pos, int tolerance)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        int64_t pos = ref_pos + i;
+        int a, b, diff;
+        if (!(pos & 1)) {
+            res->low_byte = pcm[i];
+            continue;
+        }
+        if (pos >= ref_len) {
+            res->mismatch++;
+            continue;
+        }
+        a = (short)(res->low_byte | (pcm[i] << 8));
+        b = (short)(ref[pos - 1] | (ref[pos] << 8));
+        diff = a > b ? a - b : b - a;
+        if (diff > res->max_diff) {
+            res->max_diff = diff;
+        }
+        if (diff > tolerance) {
+            res->mismatch++;
+        }
+    }
+}
+
+static int bench_run_once(const bench_case_t *bc, audio_decoder_operations_t *ops,
+                          const unsigned char *es, int es_len,
+                          const unsigned char *ref, int ref_len, FILE *out,
+                          bench_result_t *res)
+{
+    aml_audio_dec_t *audec;
+    char *outbuf;
+    bench_md5_t md5;
+    int declen = 0;
+    int chunk;
+
+    audec = calloc(1, sizeof(*audec));
+    outbuf = malloc(AVCODEC_MAX_AUDIO_FRAME_SIZE);
+    if (!audec || !outbuf) {
+        free(audec);
+        free(outbuf);
+        return -1;
+    }
+    audec->format = bc->fmt;
+    audec->samplerate = bc->samplerate;
+    audec->channels = bc->channels;
+    audec->data_width = AV_SAMPLE_FMT_S16;
+    audec->adec_ops = ops;
+
+    ops->priv_data = audec;
+    ops->priv_dec_data = NULL;
+    ops->pdecoder = NULL;
+    ops->samplerate = bc->samplerate;
+    ops->channels = bc->channels;
+    ops->bps = 16;
+    ops->extradata_size = 0;
+    if (ops->init(ops) == -1) {
+        adec_print("[%s] %s init failed\n", __FUNCTION__, bc->lib);
+        free(outbuf);
+        free(audec);
+        return -1;
+    }
+
+    md5_init(&md5);
+    chunk = ops->nInBufSize > 0 ? ops->nInBufSize : BENCH_IN_CHUNK;
+    while (declen < es_len && res->calls < BENCH_MAX_CALLS) {
+        int inlen = es_len - declen;
+        int outlen = AVCODEC_MAX_AUDIO_FRAME_SIZE;
+        int dlen;
+        int64_t t0;
+        if (inlen > chunk) {
+            inlen = chunk;
+        }
+        t0 = bench_now_us();
+        dlen = ops->decode(ops, outbuf, &outlen, (char *)es + declen, inlen);
+        res->call_us[res->calls] = (int)(bench_now_us() - t0);
+        res->total_us += res->call_us[res->calls];
+        res->calls++;
+        if (dlen <= 0) {
+            /* same policy as adec_armdec_loop: drop the rest on repeated errors */
+            res->errors++;
+            if (inlen == es_len - declen) {
+                break;
+            }
+            chunk += BENCH_IN_CHUNK;
+            continue;
+        }
+        declen += dlen;
+        res->es_bytes += dlen;
+        if (outlen > 0 && outlen <= AVCODEC_MAX_AUDIO_FRAME_SIZE) {
+            md5_update(&md5, (unsigned char *)outbuf, outlen);
+            if (ref) {
+                bench_compare(res, (unsigned char *)outbuf, outlen, ref, ref_len, res->pcm_bytes, bc->tolerance);
+            }
+            if (out) {
+                fwrite(outbuf, 1, outlen, out);
+            }
+            res->pcm_bytes += outlen;
+        }
+    }
+    md5_final(&md5, res->md5);
+    if (ref && res->pcm_bytes < ref_len) {
+        res->mismatch += (ref_len - res->pcm_bytes) / 2;
+    }
+
+    ops->release(ops);
+    free(outbuf);
+    free(audec);
+    return 0;
+}
+
+/*
+ * decode from es+start until the pcm reaches pcm_target bytes,
+ * returns the time spent or -1
+ */
+static int64_t bench_decode_until(const bench_case_t *bc, audio_decoder_operations_t *ops,
+                                  const unsigned char *es, int es_len, int start,
+                                  int64_t pcm_target, int *errors)
+{
+    aml_audio_dec_t *audec;
+    char *outbuf;
+    int64_t t0, pcm = 0;
+    int declen = start, chunk;
+
+    audec = calloc(1, sizeof(*audec));
+    outbuf = malloc(AVCODEC_MAX_AUDIO_FRAME_SIZE);
+    if (!audec || !outbuf) {
+        free(audec);
+        free(outbuf);
+        return -1;
+    }
+    audec->format = bc->fmt;
+    audec->samplerate = bc->samplerate;
+    audec->channels = bc->channels;
+    audec->adec_ops = ops;
+    ops->priv_data = audec;
+    ops->priv_dec_data = NULL;
+    ops->pdecoder = NULL;
+    ops->samplerate = bc->samplerate;
+    ops->channels = bc->channels;
+    ops->bps = 16;
+    ops->extradata_size = 0;
+    t0 = bench_now_us();
+    if (ops->init(ops) == -1) {
+        free(outbuf);
+        free(audec);
+        return -1;
+    }
+    chunk = ops->nInBufSize > 0 ? ops->nInBufSize : BENCH_IN_CHUNK;
+    while (pcm < pcm_target && declen < es_len) {
+        int inlen = es_len - declen;
+        int outlen = AVCODEC_MAX_AUDIO_FRAME_SIZE;
+        int dlen;
+        if (inlen > chunk) {
+            inlen = chunk;
+        }
+        dlen = ops->decode(ops, outbuf, &outlen, (char *)es + declen, inlen);
+        if (dlen <= 0) {
+            (*errors)++;
+            if (inlen == es_len - declen) {
+                break;
+            }
+            chunk += BENCH_IN_CHUNK;
+            continue;
+        }
+        declen += dlen;
+        if (outlen > 0 && outlen <= AVCODEC_MAX_AUDIO_FRAME_SIZE) {
+            pcm += outlen;
+        }
+    }
+    t0 = bench_now_us() - t0;
+    ops->release(ops);
+    free(outbuf);
+    free(audec);
+    return pcm >= pcm_target ? t0 : -1;
+}
+
+static void bench_run_skip(const bench_case_t *bc, audio_decoder_operations_t *ops,
+                           const unsigned char *es, int es_len)
+{
+    adec_frame_info_t info;
+    int64_t bytes_per_sec = (int64_t)bc->samplerate * bc->channels * 2;
+    int64_t target = (int64_t)bc->skip_ms * 90, pts = 0, drop_us, skip_us, t0;
+    int pos = 0, frames = 0, preroll, drop_err = 0, skip_err = 0;
+
+    if (!adec_frame_skip_format(bc->fmt)) {
+        printf("  skip: no frame parser for format %d\n", bc->fmt);
+        return;
+    }
+    drop_us = bench_decode_until(bc, ops, es, es_len, 0, target * bytes_per_sec / 90000, &drop_err);
+
+    /* same rule as adec_frame_skip(), the preroll frames are decoded */
+    preroll = adec_frame_skip_preroll(bc->fmt);
+    t0 = bench_now_us();
+    while (pos < es_len && adec_frame_parse(bc->fmt, es + pos, es_len - pos, &info) == 1) {
+        int64_t dur = info.samples ? (int64_t)info.samples * 90000 / info.samplerate : 0;
+        if (pts + dur * (preroll + 1) > target || info.frame_size > es_len - pos) {
+            break;
+        }
+        pts += dur;
+        frames += dur != 0;
+        pos += info.frame_size;
+    }
+    skip_us = bench_now_us() - t0;
+    t0 = bench_decode_until(bc, ops, es, es_len, pos, (target - pts) * bytes_per_sec / 90000, &skip_err);
+    skip_us = t0 < 0 ? -1 : skip_us + t0;
+
+    printf("  skip %d ms: decode+drop %.2f ms (%d errors), frame skip %.2f ms (%d frames, %lld ms pcm, %d errors)\n",
+           bc->skip_ms, drop_us / 1000.0, drop_err, skip_us / 1000.0, frames,
+           (long long)(target - pts) / 90, skip_err);
+}
+
+static int bench_run_case(const bench_case_t *bc)
+{
+    audio_decoder_operations_t ops;
+    bench_result_t res;
+    unsigned char *es, *ref = NULL;
+    int es_len = 0, ref_len = 0;
+    void *fd;
+    FILE *out = NULL;
+    int loop, i, failed = 0;
+    double audio_sec, rtf;
+    int64_t total_us = 0;
+    int *samples = NULL, nsamples = 0;
+
+    fd = dlopen(bc->lib, RTLD_NOW);
+    if (!fd) {
+        adec_print("[%s] dlopen %s failed: %s\n", __FUNCTION__, bc->lib, dlerror());
+        return 1;
+    }
+    memset(&ops, 0, sizeof(ops));
+    ops.name = bc->lib;
+    ops.nAudioDecoderType = AUDIO_ARM_DECODER;
+    ops.init = dlsym(fd, "audio_dec_init");
+    ops.decode = dlsym(fd, "audio_dec_decode");
+    ops.release = dlsym(fd, "audio_dec_release");
+    ops.getinfo = dlsym(fd, "audio_dec_getinfo");
+    if (!ops.init || !ops.decode || !ops.release) {
+        adec_print("[%s] %s misses audio_dec_* symbols\n", __FUNCTION__, bc->lib);
+        dlclose(fd);
+        return 1;
+    }
+
+    es = bench_load_file(bc->input, &es_len);
+    if (!es) {
+        adec_print("[%s] can't read %s\n", __FUNCTION__, bc->input);
+        dlclose(fd);
+        return 1;
+    }
+    if (bc->ref) {
+        ref = bench_load_file(bc->ref, &ref_len);
+        if (!ref) {
+            adec_print("[%s] can't read reference %s\n", __FUNCTION__, bc->ref);
+        }
+    }
+
+    memset(&res, 0, sizeof(res));
+    res.call_us = malloc(sizeof(int) * BENCH_MAX_CALLS);
+    for (loop = 0; loop < bc->loops && res.call_us; loop++) {
+        bench_result_t r;
+        memset(&r, 0, sizeof(r));
+        r.call_us = res.call_us;
+        if (loop == 0 && bc->output) {
+            out = fopen(bc->output, "wb");
+        }
+        if (bench_run_once(bc, &ops, es, es_len, loop == 0 ? ref : NULL, ref_len, out, &r) < 0) {
+            failed = 1;
+            break;
+        }
+        if (out) {
+            fclose(out);
+            out = NULL;
+        }
+        total_us += r.total_us;
+        /* the call timings of every loop go to the percentiles */
+        if (r.calls > 0) {
+            int *tmp = realloc(samples, sizeof(int) * (nsamples + r.calls));
+            if (!tmp) {
+                failed = 1;
+                break;
+            }
+            samples = tmp;
+            memcpy(samples + nsamples, r.call_us, sizeof(int) * r.calls);
+            nsamples += r.calls;
+        }
+        if (loop == 0) {
+            res = r;
+        }
+    }
+
+    if (!failed && res.call_us) {
+        int bytes_per_sec = bc->samplerate * bc->channels * 2;
+        qsort(samples, nsamples, sizeof(int), bench_cmp_int);
+        audio_sec = bytes_per_sec > 0 ? (double)res.pcm_bytes / bytes_per_sec : 0;
+        rtf = total_us > 0 ? audio_sec * bc->loops / (total_us / 1000000.0) : 0;
+        printf("%s %s\n", bc->lib, bc->input);
+        printf("  es %lld bytes, pcm %lld bytes (%.2f s), %d calls, %d errors\n",
+               (long long)res.es_bytes, (long long)res.pcm_bytes, audio_sec, res.calls, res.errors);
+        printf("  realtime factor x%.1f over %d loop(s)\n", rtf, bc->loops);
+        if (nsamples > 0) {
+            printf("  call us: p50 %d p95 %d p99 %d max %d over %d calls\n",
+                   samples[nsamples * 50 / 100], samples[nsamples * 95 / 100],
+                   samples[nsamples * 99 / 100], samples[nsamples - 1], nsamples);
+        }
+        printf("  process peak rss %ld kB (bench buffers included)\n", bench_peak_rss_kb());
+        printf("  md5 ");
+        for (i = 0; i < 16; i++) {
+            printf("%02x", res.md5[i]);
+        }
+        printf("\n");
+        if (ref) {
+            printf("  ref %s: %lld samples over tol %d, max diff %lld -> %s\n", bc->ref,
+                   (long long)res.mismatch, bc->tolerance, (long long)res.max_diff,
+                   res.mismatch ? "FAIL" : "PASS");
+            failed = res.mismatch != 0;
+        }
+        if (bc->skip_ms > 0) {
+            bench_run_skip(bc, &ops, es, es_len);
+        }
+    }
+
+    free(res.call_us);
+    free(samples);
+    free(ref);
+    free(es);
+    dlclose(fd);
+    return failed;
+}
+
+static int bench_run_suite(const char *path, const bench_case_t *defaults)
+{
+    char line[1024];
+    int failed = 0, total = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        adec_print("can't open suite %s\n", path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char lib[256], fmt[32], in[512], ref[512];
+        bench_case_t bc = *defaults;
+        int n;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        ref[0] = '\0';
+        n = sscanf(line, "%255s %31s %d %d %511s %511s", lib, fmt, &bc.samplerate, &bc.channels, in, ref);
+        if (n < 5) {
+            continue;
+        }
+        bc.lib = lib;
+        bc.fmt = bench_parse_fmt(fmt);
+        bc.input = in;
+        bc.ref = n > 5 ? ref : NULL;
+        bc.output = NULL;
+        failed += bench_run_case(&bc);
+        total++;
+    }
+    fclose(fp);
+    printf("suite %s: %d/%d passed\n", path, total - failed, total);
+    return failed;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [-t tol] [-n loops] [-k skip_ms] [-o out.pcm] lib fmt rate ch in.es [ref.pcm]\n", prog);
+    printf("       %s [-t tol] [-n loops] [-k skip_ms] -s suite.txt\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    bench_case_t bc;
+    const char *suite = NULL;
+    int i;
+
+    memset(&bc, 0, sizeof(bc));
+    bc.loops = 1;
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "-t")) {
+            bc.tolerance = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n")) {
+            bc.loops = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-o")) {
+            bc.output = argv[++i];
+        } else if (!strcmp(argv[i], "-s")) {
+            suite = argv[++i];
+        } else if (!strcmp(argv[i], "-k")) {
+            bc.skip_ms = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (bc.loops < 1) {
+        bc.loops = 1;
+    }
+    if (suite) {
+        return bench_run_suite(suite, &bc);
+    }
+    if (argc - i < 5) {
+        usage(argv[0]);
+        return 1;
+    }
+    bc.lib = argv[i];
+    bc.fmt = bench_parse_fmt(argv[i + 1]);
+    bc.samplerate = atoi(argv[i + 2]);
+    bc.channels = atoi(argv[i + 3]);
+    bc.input = argv[i + 4];
+    bc.ref = argc - i > 5 ? argv[i + 5] : NULL;
+    return bench_run_case(&bc);
+}
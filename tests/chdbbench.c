@@ -0,0 +1,184 @@
+/**
+ * \file chdbbench.c
+ * \brief  Channel lookup cost, text channel files vs the binary channel db
+ *
+ * Writes a synthetic line-up (-n services over -f frequencies) as a text
+ * export, imports it into the binary channel database (chmgr_db.c) and
+ * times, per lookup of a random service:
+ *  - text:   scanning the text export for the service and its fields
+ *  - chinfo: aml_load_channel_info() of a one channel text file, the
+ *            per-field re-read the zap path used so far
+ *  - db:     aml_dvb_db_find_service() on the mmap'ed database
+ * plus the cost of opening (mapping) the database.
+ *
+ * usage: chdbbench [-n services] [-f frequencies] [-l lookups] [-d dir]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "am_chmgr.h"
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* what a text based lookup has to do: read the file up to the service */
+static int text_lookup(const char *path, int service_id, aml_dvb_db_channel_t *out)
+{
+    char line[256];
+    aml_dvb_db_channel_t cur;
+    int found = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) {
+        return -1;
+    }
+    memset(&cur, 0, sizeof(cur));
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strncmp(line, "freq=", 5)) {
+            if (found) {
+                break;
+            }
+            memset(&cur, 0, sizeof(cur));
+            cur.freq = atoi(line + 5);
+        } else if (!strncmp(line, "service_id=", 11)) {
+            cur.service_id = atoi(line + 11);
+            found = cur.service_id == service_id;
+        } else if (!strncmp(line, "v_pid=", 6)) {
+            cur.v_pid = atoi(line + 6);
+        } else if (!strncmp(line, "a_pid=", 6)) {
+            cur.a_pid = atoi(line + 6);
+        }
+    }
+    fclose(fp);
+    *out = cur;
+    return found ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = "/data/local/tmp";
+    char text[256], db_path[256], chinfo[256];
+    aml_dvb_db_channel_t *list, rec;
+    const aml_dvb_db_channel_t *hit;
+    aml_dvb_param_t param;
+    aml_dvb_db_t *db;
+    int n = 400, nfreq = 50, lookups = 2000, opt, i, miss = 0, first;
+    int64_t t0, t_text, t_chinfo, t_db, t_open;
+    FILE *fp;
+
+    while ((opt = getopt(argc, argv, "n:f:l:d:")) != -1) {
+        switch (opt) {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 'f':
+            nfreq = atoi(optarg);
+            break;
+        case 'l':
+            lookups = atoi(optarg);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            printf("usage: %s [-n services] [-f frequencies] [-l lookups] [-d dir]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n <= 0 || nfreq <= 0 || lookups <= 0 || n > 65535) {
+        return 1;
+    }
+    snprintf(text, sizeof(text), "%s/chdbbench.txt", dir);
+    snprintf(db_path, sizeof(db_path), "%s/chdbbench.db", dir);
+    snprintf(chinfo, sizeof(chinfo), "%s/chdbbench.chinfo", dir);
+
+    /* build the line-up through the text import path */
+    list = calloc(n, sizeof(aml_dvb_db_channel_t));
+    if (!list) {
+        return 1;
+    }
+    for (i = 0; i < n; i++) {
+        list[i].freq = 474000000 + (i % nfreq) * 8000000;
+        list[i].symbol_rate = 6875000;
+        list[i].qam = 3;
+        list[i].service_id = i + 1;
+        list[i].pmt_pid = 0x100 + i;
+        list[i].v_pid = 0x200 + i;
+        list[i].a_pid = 0x300 + i;
+        list[i].v_type = 2;
+        list[i].a_type = 0;
+        snprintf(list[i].name, AML_DVB_DB_NAME_LEN, "service %d", i + 1);
+    }
+    if (aml_dvb_db_write(db_path, list, n) || !(db = aml_dvb_db_open(db_path)) ||
+        aml_dvb_db_export(db, text)) {
+        printf("can't write the database to %s\n", dir);
+        return 1;
+    }
+    aml_dvb_db_close(db);
+    if (aml_dvb_db_import(text, db_path) || !(db = aml_dvb_db_open(db_path)) || aml_dvb_db_count(db) != n) {
+        printf("text import failed\n");
+        return 1;
+    }
+    aml_dvb_db_close(db);
+    fp = fopen(chinfo, "w");
+    if (!fp) {
+        return 1;
+    }
+    fprintf(fp, "channel_info=1\nfreq=%d\nsymbol_rate=6875000\nqam=3\nv_pid=%d\na_pid=%d\nv_type=2\na_type=0\n",
+            list[0].freq, list[0].v_pid, list[0].a_pid);
+    fclose(fp);
+
+    srand(1);
+    t0 = now_us();
+    for (i = 0; i < lookups; i++) {
+        int sid = rand() % n + 1;
+        miss += text_lookup(text, sid, &rec) < 0 || rec.v_pid != 0x200 + sid - 1;
+    }
+    t_text = now_us() - t0;
+
+    t0 = now_us();
+    for (i = 0; i < lookups; i++) {
+        miss += aml_load_channel_info(chinfo, &param) < 0;
+    }
+    t_chinfo = now_us() - t0;
+
+    t0 = now_us();
+    for (i = 0; i < lookups; i++) {
+        db = aml_dvb_db_open(db_path);
+        aml_dvb_db_close(db);
+    }
+    t_open = now_us() - t0;
+
+    db = aml_dvb_db_open(db_path);
+    srand(1);
+    t0 = now_us();
+    for (i = 0; i < lookups; i++) {
+        int sid = rand() % n + 1;
+        hit = aml_dvb_db_find_service(db, list[sid - 1].freq, sid);
+        miss += !hit || hit->v_pid != 0x200 + sid - 1;
+    }
+    t_db = now_us() - t0;
+    miss += aml_dvb_db_find_freq(db, list[0].freq, &first) != (n + nfreq - 1) / nfreq;
+    aml_dvb_db_close(db);
+
+    printf("%d services on %d frequencies, %d lookups, %d mismatches\n", n, nfreq, lookups, miss);
+    printf("text    %9.2f us/lookup\n", (double)t_text / lookups);
+    printf("chinfo  %9.2f us/lookup (one channel file)\n", (double)t_chinfo / lookups);
+    printf("db      %9.2f us/lookup, %.2f us/open\n", (double)t_db / lookups, (double)t_open / lookups);
+
+    unlink(text);
+    unlink(db_path);
+    unlink(chinfo);
+    free(list);
+    return miss ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * \file codecemubench.c
+ * \brief  Feed/latency benchmark of the amcodec write path on emulated devices
+ *
+ * Opens a video ES codec in non-blocking mode on the userspace amstream
+ * emulation (codec_h_emu.c) and pushes data as fast as the buffer model
+ * accepts it, checking in one pts per chunk. Reports the feed throughput,
+ * the cost of each codec_write() call and the checkin to checkout latency
+ * seen through codec_get_vpts(), so changes to the feeding code can be
+ * measured without decoder hardware.
+ *
+ * usage: codecemubench [-b vbps] [-c chunk] [-t seconds] [input.es]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <codec.h>
+#include "codec_h_ctrl.h"
+
+#define BENCH_MAX_LAT   (1 << 16)
+#define BENCH_PENDING   1024
+
+typedef struct {
+    unsigned long pts;
+    int64_t us;
+} pending_pts_t;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void print_percentiles(const char *name, int *v, int n)
+{
+    if (n <= 0) {
+        printf("%-18s no samples\n", name);
+        return;
+    }
+    qsort(v, n, sizeof(int), cmp_int);
+    printf("%-18s p50 %d p95 %d p99 %d max %d us (%d samples)\n", name,
+           v[n / 2], v[n * 95 / 100], v[n * 99 / 100], v[n - 1], n);
+}
+
+int main(int argc, char **argv)
+{
+    codec_para_t codec;
+    codec_emu_para_t emu_para;
+    struct buf_status vbuf;
+    pending_pts_t pending[BENCH_PENDING];
+    int pend_rd = 0, pend_wr = 0;
+    static int write_lat[BENCH_MAX_LAT], pts_lat[BENCH_MAX_LAT];
+    int nwrite = 0, npts = 0, eagain = 0;
+    int chunk = 32 * 1024, seconds = 5, opt;
+    unsigned long pts = 90000;
+    int64_t total = 0, start, t0, wrote;
+    char *buf;
+    FILE *fp = NULL;
+
+    memset(&emu_para, 0, sizeof(emu_para));
+    emu_para.vbuf_size = 6 * 1024 * 1024;
+    emu_para.abuf_size = 768 * 1024;
+    emu_para.video_bps = 8 * 1000 * 1000;
+    emu_para.audio_bps = 256 * 1000;
+    emu_para.width = 1920;
+    emu_para.height = 1080;
+    emu_para.fps = 30;
+    while ((opt = getopt(argc, argv, "b:c:t:")) != -1) {
+        switch (opt) {
+        case 'b':
+            emu_para.video_bps = atoi(optarg);
+            break;
+        case 'c':
+            chunk = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-b vbps] [-c chunk] [-t seconds] [input.es]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc && !(fp = fopen(argv[optind], "rb"))) {
+        printf("can't open %s\n", argv[optind]);
+        return 1;
+    }
+    if (chunk <= 0 || emu_para.video_bps <= 0) {
+        printf("invalid chunk size or bitrate\n");
+        return 1;
+    }
+    codec_h_emu_config(&emu_para);
+
+    buf = malloc(chunk);
+    memset(buf, 0, chunk);
+    memset(&codec, 0, sizeof(codec));
+    codec.has_video = 1;
+    codec.video_type = VFORMAT_H264;
+    codec.stream_type = STREAM_TYPE_ES_VIDEO;
+    codec.noblock = 1;
+    if (codec_init(&codec) != CODEC_ERROR_NONE) {
+        printf("codec init failed\n");
+        return 1;
+    }
+
+    start = now_us();
+    while (now_us() - start < (int64_t)seconds * 1000000) {
+        int len = chunk, ret;
+        unsigned int vpts;
+
+        if (fp) {
+            len = fread(buf, 1, chunk, fp);
+            if (len <= 0) {
+                rewind(fp);
+                continue;
+            }
+        }
+        codec_checkin_pts(&codec, pts);
+        if ((pend_wr + 1) % BENCH_PENDING != pend_rd) {
+            pending[pend_wr].pts = pts;
+            pending[pend_wr].us = now_us();
+            pend_wr = (pend_wr + 1) % BENCH_PENDING;
+        }
+        pts += 3003;
+
+        wrote = 0;
+        while (wrote < len) {
+            t0 = now_us();
+            ret = codec_write(&codec, buf + wrote, len - wrote);
+            if (nwrite < BENCH_MAX_LAT) {
+                write_lat[nwrite++] = (int)(now_us() - t0);
+            }
+            if (ret > 0) {
+                wrote += ret;
+            } else if (errno == EAGAIN) {
+                eagain++;
+                usleep(1000);
+            } else {
+                printf("codec write failed %d\n", ret);
+                goto out;
+            }
+            vpts = codec_get_vpts(&codec);
+            while (pend_rd != pend_wr && pending[pend_rd].pts <= vpts) {
+                if (npts < BENCH_MAX_LAT) {
+                    pts_lat[npts++] = (int)(now_us() - pending[pend_rd].us);
+                }
+                pend_rd = (pend_rd + 1) % BENCH_PENDING;
+            }
+        }
+        total += len;
+    }
+
+out:
+    t0 = now_us() - start;
+    codec_get_vbuf_state(&codec, &vbuf);
+    printf("fed %lld bytes in %lld ms, %.2f Mbps (configured %.2f Mbps)\n",
+           (long long)total, (long long)(t0 / 1000), total * 8.0 / t0,
+           emu_para.video_bps / 1000000.0);
+    printf("drained %.2f Mbps, vbuf size %d level %d, %d EAGAIN retries\n",
+           (total - vbuf.data_len) * 8.0 / t0, vbuf.size, vbuf.data_len, eagain);
+    print_percentiles("codec_write", write_lat, nwrite);
+    print_percentiles("checkin->checkout", pts_lat, npts);
+    codec_close(&codec);
+    if (fp) {
+        fclose(fp);
+    }
+    free(buf);
+    return 0;
+}
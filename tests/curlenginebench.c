@@ -0,0 +1,169 @@
+/**
+ * \file curlenginebench.c
+ * \brief  CPU use and throughput of concurrent curl_fetch sessions
+ *
+ * Opens N sessions on the same http url through curl_fetch (libcurl-ffmpeg),
+ * all driven by the shared curl multi engine, and drains each one from its
+ * own reader thread, optionally rate limited so the fifo fills up and the
+ * transfers get paused/resumed. Prints the aggregate throughput, the process
+ * CPU time per MB and the thread count, e.g. for 1, 4 and 8 streams against
+ * a local http server.
+ *
+ * usage: curlenginebench [-n streams] [-t seconds] [-r reader_kbps] url
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include "curl_fetch.h"
+
+#define BENCH_MAX_STREAMS   32
+#define BENCH_READ_SIZE     (32 * 1024)
+
+typedef struct {
+    pthread_t tid;
+    CFContext *cfc;
+    int64_t bytes;
+    int error;
+} bench_stream_t;
+
+static volatile int bench_quit = 0;
+static int bench_rate_kbps = 0;
+static const char *bench_url;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t cpu_us(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (int64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static int thread_count(void)
+{
+    int n = 0;
+    struct dirent *d;
+    DIR *dir = opendir("/proc/self/task");
+
+    if (!dir) {
+        return -1;
+    }
+    while ((d = readdir(dir))) {
+        n += d->d_name[0] != '.';
+    }
+    closedir(dir);
+    return n;
+}
+
+static void *bench_reader(void *arg)
+{
+    bench_stream_t *s = arg;
+    char *buf = malloc(BENCH_READ_SIZE);
+    int64_t start = now_us(), due;
+    int ret;
+
+    while (!bench_quit && buf) {
+        ret = curl_fetch_read(s->cfc, buf, BENCH_READ_SIZE);
+        if (ret > 0) {
+            s->bytes += ret;
+            if (bench_rate_kbps > 0) {
+                due = start + s->bytes * 8000 / bench_rate_kbps;
+                if (due > now_us()) {
+                    usleep(due - now_us());
+                }
+            }
+        } else if (ret == C_ERROR_EAGAIN) {
+            usleep(SLEEP_TIME_UNIT);
+        } else {
+            /* finished or failed, loop the url */
+            s->error = ret;
+            if (curl_fetch_seek(s->cfc, 0, SEEK_SET) < 0) {
+                break;
+            }
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static bench_stream_t streams[BENCH_MAX_STREAMS];
+    int n = 1, seconds = 10, opt, i, threads;
+    int64_t t0, c0, wall, cpu, total = 0;
+
+    while ((opt = getopt(argc, argv, "n:t:r:")) != -1) {
+        switch (opt) {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        case 'r':
+            bench_rate_kbps = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind >= argc || n <= 0 || n > BENCH_MAX_STREAMS) {
+        printf("usage: %s [-n streams(1-%d)] [-t seconds] [-r reader_kbps] url\n", argv[0], BENCH_MAX_STREAMS);
+        return 1;
+    }
+    bench_url = argv[optind];
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    for (i = 0; i < n; i++) {
+        streams[i].cfc = curl_fetch_init(bench_url, NULL, 0);
+        if (!streams[i].cfc) {
+            printf("can't open %s\n", bench_url);
+            return 1;
+        }
+        /* no perform thread yet, don't wait for it in the first open */
+        streams[i].cfc->thread_quited = 1;
+        if (curl_fetch_http_keepalive_open(streams[i].cfc, NULL)) {
+            printf("can't open %s\n", bench_url);
+            return 1;
+        }
+    }
+    t0 = now_us();
+    c0 = cpu_us();
+    for (i = 0; i < n; i++) {
+        pthread_create(&streams[i].tid, NULL, bench_reader, &streams[i]);
+    }
+    sleep(seconds);
+    threads = thread_count();
+    bench_quit = 1;
+    for (i = 0; i < n; i++) {
+        pthread_join(streams[i].tid, NULL);
+        total += streams[i].bytes;
+    }
+    wall = now_us() - t0;
+    cpu = cpu_us() - c0;
+    for (i = 0; i < n; i++) {
+        curl_fetch_close(streams[i].cfc);
+    }
+
+    printf("%d streams, %d threads: %.1f MB/s total, %.1f MB/s per stream\n", n, threads,
+           total / (double)wall, total / (double)wall / n);
+    printf("cpu %.1f%% of one core, %.2f ms cpu per MB\n",
+           cpu * 100.0 / wall, total > 0 ? cpu / 1000.0 / (total / 1000000.0) : 0.0);
+    return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ * \file esinjectbench.c
+ * \brief  Syscalls and copies per second of es injection, staging vs buffer pool
+ *
+ * Feeds a synthetic video + audio es stream (default 40 Mbps: 25 fps video
+ * frames plus 48KHz AAC sized audio packets) to the video and audio es
+ * devices of the userspace amstream emulation (codec_h_emu.c), once the
+ * way the callers did it so far (demux into a staging buffer, copy, check
+ * in the pts, codec_write() per packet) and once through the codec buffer
+ * pool (demux straight into a pooled buffer, codec_buf_submit(), writev per
+ * run, audio pts checked in every -g ms). The "demux" is a memcpy from an
+ * input block in both cases. Prints the write calls, pts ioctls, staging
+ * copies and CPU time per second of stream.
+ *
+ * usage: esinjectbench [-b total_kbps] [-a audio_kbps] [-f fps] [-g audio_pts_gap_ms] [-t stream_seconds]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <codec.h>
+#include "codec_h_ctrl.h"
+
+#define BENCH_AUDIO_RATE    48000
+#define BENCH_AUDIO_FRAME   1024
+#define BENCH_POOL_BUFS     64
+
+typedef struct {
+    int64_t writes;
+    int64_t ioctls;
+    int64_t copies;
+    int64_t copy_bytes;
+    int64_t cpu_us;
+} bench_result_t;
+
+typedef struct {
+    int video_size;         ///< bytes per video frame
+    int audio_size;         ///< bytes per audio packet
+    int fps;
+    int seconds;
+    int pts_gap_ms;
+} bench_stream_t;
+
+static unsigned char *bench_input;
+
+static int64_t cpu_us(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (int64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static int bench_open(codec_para_t *codec, const char *dev)
+{
+    memset(codec, 0, sizeof(*codec));
+    codec->handle = codec_h_open(dev, O_WRONLY);
+    return codec->handle < 0 ? -1 : 0;
+}
+
+typedef struct {
+    int64_t video;
+    int64_t audio;
+} bench_sched_t;
+
+/* next packet in pts order: 1 video, 0 audio, -1 at the end */
+static int bench_next(const bench_stream_t *s, bench_sched_t *sc, int64_t *pts)
+{
+    int64_t vn = (int64_t)s->fps * s->seconds;
+    int64_t an = (int64_t)BENCH_AUDIO_RATE * s->seconds / BENCH_AUDIO_FRAME;
+    int64_t vpts = sc->video * 90000 / s->fps;
+    int64_t apts = sc->audio * BENCH_AUDIO_FRAME * 90000 / BENCH_AUDIO_RATE;
+
+    if (sc->video < vn && (sc->audio >= an || vpts <= apts)) {
+        sc->video++;
+        *pts = vpts;
+        return 1;
+    }
+    if (sc->audio < an) {
+        sc->audio++;
+        *pts = apts;
+        return 0;
+    }
+    return -1;
+}
+
+static void bench_write_all(codec_para_t *codec, unsigned char *buf, int len, bench_result_t *r)
+{
+    int ret;
+
+    while (len > 0) {
+        ret = codec_write(codec, buf, len);
+        r->writes++;
+        if (ret > 0) {
+            buf += ret;
+            len -= ret;
+        } else if (errno != EAGAIN) {
+            break;
+        }
+    }
+}
+
+static void bench_staging(const bench_stream_t *s, codec_para_t *vcodec, codec_para_t *acodec, bench_result_t *r)
+{
+    unsigned char *demux = malloc(s->video_size);
+    unsigned char *staging = malloc(s->video_size);
+    bench_sched_t sc = {0, 0};
+    int64_t c0 = cpu_us();
+    int64_t pts;
+    int is_video;
+
+    while ((is_video = bench_next(s, &sc, &pts)) >= 0) {
+        codec_para_t *codec = is_video ? vcodec : acodec;
+        int len = is_video ? s->video_size : s->audio_size;
+
+        memcpy(demux, bench_input, len);
+        memcpy(staging, demux, len);
+        r->copies++;
+        r->copy_bytes += len;
+        codec_checkin_pts(codec, (unsigned long)pts);
+        r->ioctls++;
+        bench_write_all(codec, staging, len, r);
+    }
+    r->cpu_us = cpu_us() - c0;
+    free(demux);
+    free(staging);
+}
+
+static void bench_pool(const bench_stream_t *s, codec_para_t *vcodec, codec_para_t *acodec, bench_result_t *r)
+{
+    codec_buf_pool_t *vpool = codec_buf_pool_create(vcodec, 4, s->video_size);
+    codec_buf_pool_t *apool = codec_buf_pool_create(acodec, BENCH_POOL_BUFS, s->audio_size);
+    codec_buf_stat_t vst, ast;
+    bench_sched_t sc = {0, 0};
+    int64_t c0 = cpu_us();
+    int64_t pts;
+    int is_video;
+
+    if (!vpool || !apool) {
+        return;
+    }
+    /* video frames go out one by one, audio in runs */
+    codec_buf_pool_set_batch(vpool, 1, 0);
+    codec_buf_pool_set_batch(apool, BENCH_POOL_BUFS / 2, 0);
+    codec_buf_pool_set_pts_gap(apool, s->pts_gap_ms * 90);
+    while ((is_video = bench_next(s, &sc, &pts)) >= 0) {
+        codec_buf_pool_t *pool = is_video ? vpool : apool;
+        codec_buf_t *buf;
+
+        while (!(buf = codec_buf_get(pool))) {
+            codec_buf_flush(pool);
+        }
+        buf->len = is_video ? s->video_size : s->audio_size;
+        memcpy(buf->data, bench_input, buf->len);
+        buf->pts = (unsigned long)pts;
+        buf->flags = CODEC_BUF_FLAG_PTS;
+        codec_buf_submit(pool, buf);
+    }
+    while (codec_buf_pending(vpool) > 0 && codec_buf_flush(vpool) >= 0);
+    while (codec_buf_pending(apool) > 0 && codec_buf_flush(apool) >= 0);
+    r->cpu_us = cpu_us() - c0;
+    codec_buf_pool_get_stat(vpool, &vst);
+    codec_buf_pool_get_stat(apool, &ast);
+    r->writes = vst.writes + ast.writes;
+    r->ioctls = vst.ioctls + ast.ioctls;
+    codec_buf_pool_destroy(vpool);
+    codec_buf_pool_destroy(apool);
+}
+
+static void bench_print(const char *name, const bench_stream_t *s, const bench_result_t *r)
+{
+    printf("%-8s writes %7.1f/s  pts ioctls %7.1f/s  syscalls %7.1f/s  staging copies %6.1f/s (%5.2f MB/s)  cpu %.2f ms/s\n",
+           name, (double)r->writes / s->seconds, (double)r->ioctls / s->seconds,
+           (double)(r->writes + r->ioctls) / s->seconds, (double)r->copies / s->seconds,
+           r->copy_bytes / 1e6 / s->seconds, r->cpu_us / 1000.0 / s->seconds);
+}
+
+int main(int argc, char **argv)
+{
+    codec_emu_para_t emu_para;
+    codec_para_t vcodec, acodec;
+    bench_stream_t s;
+    bench_result_t r;
+    int kbps = 40000, akbps = 384, opt;
+
+    memset(&s, 0, sizeof(s));
+    s.fps = 25;
+    s.seconds = 60;
+    s.pts_gap_ms = 100;
+    while ((opt = getopt(argc, argv, "b:a:f:g:t:")) != -1) {
+        switch (opt) {
+        case 'b':
+            kbps = atoi(optarg);
+            break;
+        case 'a':
+            akbps = atoi(optarg);
+            break;
+        case 'f':
+            s.fps = atoi(optarg);
+            break;
+        case 'g':
+            s.pts_gap_ms = atoi(optarg);
+            break;
+        case 't':
+            s.seconds = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-b total_kbps] [-a audio_kbps] [-f fps] [-g audio_pts_gap_ms] [-t stream_seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (kbps <= akbps || akbps <= 0 || s.fps <= 0 || s.seconds <= 0) {
+        return 1;
+    }
+    s.video_size = (int)((int64_t)(kbps - akbps) * 1000 / 8 / s.fps);
+    s.audio_size = (int)((int64_t)akbps * 1000 / 8 * BENCH_AUDIO_FRAME / BENCH_AUDIO_RATE);
+    bench_input = calloc(1, s.video_size);
+
+    /* the emulated buffers only count bytes, make them big enough to never fill */
+    memset(&emu_para, 0, sizeof(emu_para));
+    emu_para.vbuf_size = 1024 * 1024 * 1024;
+    emu_para.abuf_size = 256 * 1024 * 1024;
+    emu_para.video_bps = 2000 * 1000 * 1000;
+    emu_para.audio_bps = 1000 * 1000 * 1000;
+    emu_para.width = 1920;
+    emu_para.height = 1080;
+    emu_para.fps = s.fps;
+    codec_h_emu_config(&emu_para);
+    if (!bench_input || bench_open(&vcodec, CODEC_VIDEO_ES_DEVICE) || bench_open(&acodec, CODEC_AUDIO_ES_DEVICE)) {
+        printf("can't open the emulated es devices\n");
+        return 1;
+    }
+    printf("%d kbps: video %d bytes x %d fps, audio %d bytes x %.1f/s, %ds of stream\n",
+           kbps, s.video_size, s.fps, s.audio_size, (double)BENCH_AUDIO_RATE / BENCH_AUDIO_FRAME, s.seconds);
+
+    memset(&r, 0, sizeof(r));
+    bench_staging(&s, &vcodec, &acodec, &r);
+    bench_print("staging", &s, &r);
+    memset(&r, 0, sizeof(r));
+    bench_pool(&s, &vcodec, &acodec, &r);
+    bench_print("pool", &s, &r);
+
+    codec_h_close(vcodec.handle);
+    codec_h_close(acodec.handle);
+    free(bench_input);
+    return 0;
+}
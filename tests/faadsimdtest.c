@@ -0,0 +1,192 @@
+/**
+ * \file faadsimdtest.c
+ * \brief  Conformance and speed check of the libfaad SIMD kernels
+ *
+ * Runs cfftf/cfftb for every transform size used by the (I)MDCT and
+ * the SBR QMF analysis/synthesis banks once on the C path and once on
+ * the vector path selected by faad_simd_init(), then compares outputs
+ * within a relative tolerance and prints the time spent by each path.
+ * The power of two sizes must take the float vector cfft, which is
+ * compared with the float tolerance.
+ *
+ * Decode speed on real HE-AAC(v2) content is measured with adecbench,
+ * e.g. "FAAD_SIMD=0 adecbench -n 20 libfaad.so aac 48000 2 in.aac".
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "common.h"
+#include "structs.h"
+#include "cfft.h"
+#include "sbr_qmf.h"
+#include "faad_simd.h"
+
+#define TEST_TOLERANCE  1e-9
+#define TEST_TOLERANCE_FLOAT    1e-5
+#define TEST_LOOPS      2000
+
+static const uint16_t cfft_sizes[] = { 64, 60, 240, 256, 480, 512 };
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static double rand_real(void)
+{
+    return (double)rand() / RAND_MAX * 2.0 - 1.0;
+}
+
+static double max_rel_err(const real_t *a, const real_t *b, int n)
+{
+    double err = 0, peak = 1e-30;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (fabs(a[i] - b[i]) > err) {
+            err = fabs(a[i] - b[i]);
+        }
+        if (fabs(b[i]) > peak) {
+            peak = fabs(b[i]);
+        }
+    }
+    return err / peak;
+}
+
+static const char *cfft_path(const cfft_info *cfft)
+{
+    if (cfft->simd && faad_dsp->cfft) {
+        return "float simd";
+    }
+    if (faad_dsp->passf4 && faad_simd_cfft_size(cfft->n)) {
+        return "radix-4 simd";
+    }
+    return "C";
+}
+
+/* fwd gets cfftf of in, out cfftb(cfftf(in)) after the timed loops */
+static int run_cfft(uint8_t level, uint16_t n, const complex_t *in, complex_t *fwd, complex_t *out,
+                    int64_t *us, const char **path)
+{
+    cfft_info *cfft = cffti(n);
+    int64_t t0;
+    int i;
+
+    if (!cfft) {
+        return -1;
+    }
+    faad_simd_select(level);
+    *path = cfft_path(cfft);
+    memcpy(fwd, in, n * sizeof(complex_t));
+    cfftf(cfft, fwd);
+    t0 = now_us();
+    for (i = 0; i < TEST_LOOPS; i++) {
+        memcpy(out, in, n * sizeof(complex_t));
+        cfftf(cfft, out);
+        cfftb(cfft, out);
+    }
+    *us = now_us() - t0;
+    cfftu(cfft);
+    return 0;
+}
+
+static void run_qmf(uint8_t level, const real_t *in, real_t *out, int64_t *us)
+{
+    static qmf_t X[MAX_NTSRHFG][64];
+    sbr_info *sbr = calloc(1, sizeof(sbr_info));
+    qmfa_info *qmfa;
+    qmfs_info *qmfs32, *qmfs64;
+    int64_t t0;
+    int i;
+
+    faad_simd_select(level);
+    sbr->numTimeSlotsRate = 32;
+    qmfa = qmfa_init(32);
+    qmfs32 = qmfs_init(32);
+    qmfs64 = qmfs_init(64);
+    t0 = now_us();
+    for (i = 0; i < TEST_LOOPS / 10; i++) {
+        sbr_qmf_analysis_32(sbr, qmfa, in, X, 0, 32);
+        sbr_qmf_synthesis_32(sbr, qmfs32, X, out);
+        sbr_qmf_synthesis_64(sbr, qmfs64, X, out + 32 * 32);
+    }
+    *us = now_us() - t0;
+    qmfa_end(qmfa);
+    qmfs_end(qmfs32);
+    qmfs_end(qmfs64);
+    free(sbr);
+}
+
+int main(int argc, char **argv)
+{
+    complex_t *in, *ref, *vec, *fref, *fvec;
+    real_t *qin, *qref, *qvec;
+    uint8_t level;
+    int64_t us_c, us_v;
+    const char *path;
+    double err, tol;
+    unsigned i;
+    int j, failed = 0;
+
+    level = faad_simd_init();
+    printf("faad simd level %d\n", level);
+    if (level == FAAD_SIMD_NONE) {
+        printf("no vector path on this cpu/build, nothing to compare\n");
+        return 0;
+    }
+
+    in = malloc(512 * sizeof(complex_t));
+    ref = malloc(512 * sizeof(complex_t));
+    vec = malloc(512 * sizeof(complex_t));
+    fref = malloc(512 * sizeof(complex_t));
+    fvec = malloc(512 * sizeof(complex_t));
+    for (j = 0; j < 512; j++) {
+        RE(in[j]) = rand_real();
+        IM(in[j]) = rand_real();
+    }
+    for (i = 0; i < sizeof(cfft_sizes) / sizeof(cfft_sizes[0]); i++) {
+        uint16_t n = cfft_sizes[i];
+        int pow2 = !(n & (n - 1));
+        run_cfft(FAAD_SIMD_NONE, n, in, fref, ref, &us_c, &path);
+        run_cfft(level, n, in, fvec, vec, &us_v, &path);
+        tol = strcmp(path, "float simd") ? TEST_TOLERANCE : TEST_TOLERANCE_FLOAT;
+        err = max_rel_err((real_t *)fvec, (real_t *)fref, 2 * n);
+        if (max_rel_err((real_t *)vec, (real_t *)ref, 2 * n) > err) {
+            err = max_rel_err((real_t *)vec, (real_t *)ref, 2 * n);
+        }
+        printf("cfft %4d: %s, max rel err %.3g, C %lld us, simd %lld us -> %s\n", n, path, err,
+               (long long)us_c, (long long)us_v,
+               err > tol || (pow2 && strcmp(path, "float simd")) ? "FAIL" : "PASS");
+        failed += err > tol || (pow2 && strcmp(path, "float simd"));
+    }
+
+    qin = malloc(32 * 32 * sizeof(real_t));
+    qref = malloc((32 + 64) * 32 * sizeof(real_t));
+    qvec = malloc((32 + 64) * 32 * sizeof(real_t));
+    for (j = 0; j < 32 * 32; j++) {
+        qin[j] = rand_real() * 32767.0;
+    }
+    run_qmf(FAAD_SIMD_NONE, qin, qref, &us_c);
+    run_qmf(level, qin, qvec, &us_v);
+    err = max_rel_err(qvec, qref, (32 + 64) * 32);
+    printf("sbr qmf:   max rel err %.3g, C %lld us, simd %lld us -> %s\n", err,
+           (long long)us_c, (long long)us_v, err > TEST_TOLERANCE ? "FAIL" : "PASS");
+    failed += err > TEST_TOLERANCE;
+
+    free(in);
+    free(ref);
+    free(vec);
+    free(fref);
+    free(fvec);
+    free(qin);
+    free(qref);
+    free(qvec);
+    return failed;
+}
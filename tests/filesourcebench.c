@@ -0,0 +1,185 @@
+/**
+ * \file filesourcebench.c
+ * \brief  Local file reads through streamsource: ffmpeg file protocol vs filesource
+ *
+ * Reads a local file through the thread_read layer of streamsource the
+ * way the amss: protocol does (32KB reads), with the source picked by
+ * filesource_config():
+ *  - ffmpeg: filesource off, the ffmpeg file URLProtocol copied into the
+ *            streambuf blocks
+ *  - pread:  filesource with large preads and fadvise readahead
+ *  - mmap:   filesource with the file mapped, the streambuf referencing
+ *            the pages
+ * and prints the process CPU time per GB read, the throughput and the
+ * latency of -k random seeks (seek plus the first 64KB). -c drops the
+ * file from the page cache before each run (POSIX_FADV_DONTNEED), -b
+ * paces the reads at a playback bitrate, -m limits the bytes read.
+ *
+ * usage: filesourcebench -f file [-m MB] [-k seeks] [-b kbps] [-c]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <libavformat/avformat.h>
+#include "thread_read.h"
+#include "source.h"
+
+#define BENCH_READ      (32 * 1024)
+#define BENCH_SEEK_READ (64 * 1024)
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static double cpu_s(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void drop_cache(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static void bench_mode(const char *name, const char *path, int64_t max_bytes, int seeks, int kbps, int cold)
+{
+    struct thread_read *tr;
+    struct source_options op;
+    char *buf = malloc(BENCH_SEEK_READ);
+    int64_t total = 0, t0, *lat = NULL;
+    double c0, cpu, s;
+    int ret, i, n = 0;
+
+    if (!buf) {
+        return;
+    }
+    if (cold) {
+        drop_cache(path);
+    }
+    c0 = cpu_s();
+    t0 = now_us();
+    tr = new_thread_read(path, NULL, AVIO_FLAG_READ);
+    if (!tr) {
+        printf("%-6s open failed\n", name);
+        free(buf);
+        return;
+    }
+    thread_read_get_options(tr, &op);
+    if (op.filesize <= 0) {
+        printf("%-6s open failed\n", name);
+        goto out;
+    }
+    while (total < max_bytes) {
+        ret = thread_read_read(tr, buf, BENCH_READ);
+        if (ret <= 0) {
+            break;
+        }
+        total += ret;
+        if (kbps) {
+            int64_t due = t0 + total * 8 * 1000 / kbps;
+            while (now_us() < due) {
+                usleep(1000);
+            }
+        }
+    }
+    s = (now_us() - t0) / 1e6;
+    cpu = cpu_s() - c0;
+    printf("%-6s read %lld MB in %.2fs (%.1f MB/s), cpu %.2fs, %.2f cpu s/GB\n", name,
+           total >> 20, s, s > 0 ? total / s / 1048576 : 0.0, cpu, total ? cpu * 1073741824.0 / total : 0.0);
+
+    lat = malloc(sizeof(int64_t) * (seeks > 0 ? seeks : 1));
+    srand(1);
+    for (i = 0; lat && i < seeks; i++) {
+        int64_t pos = ((int64_t)rand() << 16 ^ rand()) % op.filesize;
+        int got = 0;
+        pos &= ~(int64_t)187;
+        t0 = now_us();
+        if (thread_read_seek(tr, pos, SEEK_SET) != pos) {
+            continue;
+        }
+        while (got < BENCH_SEEK_READ) {
+            ret = thread_read_read(tr, buf + got, BENCH_SEEK_READ - got);
+            if (ret <= 0) {
+                break;
+            }
+            got += ret;
+        }
+        lat[n++] = now_us() - t0;
+    }
+    if (n) {
+        qsort(lat, n, sizeof(int64_t), cmp_int64);
+        printf("%-6s %d seeks: p50 %.2fms p90 %.2fms max %.2fms\n", name, n,
+               lat[n / 2] / 1000.0, lat[n * 9 / 10] / 1000.0, lat[n - 1] / 1000.0);
+    }
+out:
+    thread_read_stop(tr);
+    thread_read_release(tr);
+    free(lat);
+    free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int64_t max_bytes = (int64_t)1 << 40;
+    int seeks = 50, kbps = 0, cold = 0, opt;
+
+    while ((opt = getopt(argc, argv, "f:m:k:b:c")) != -1) {
+        switch (opt) {
+        case 'f':
+            path = optarg;
+            break;
+        case 'm':
+            max_bytes = (int64_t)atoi(optarg) << 20;
+            break;
+        case 'k':
+            seeks = atoi(optarg);
+            break;
+        case 'b':
+            kbps = atoi(optarg);
+            break;
+        case 'c':
+            cold = 1;
+            break;
+        default:
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        printf("usage: %s -f file [-m MB] [-k seeks] [-b kbps] [-c]\n", argv[0]);
+        return 1;
+    }
+    av_register_all();
+    source_init_all();
+    filesource_config(0, -1);
+    bench_mode("ffmpeg", path, max_bytes, seeks, kbps, cold);
+    filesource_config(1, 0);
+    bench_mode("pread", path, max_bytes, seeks, kbps, cold);
+    filesource_config(1, 4096);
+    bench_mode("mmap", path, max_bytes, seeks, kbps, cold);
+    return 0;
+}
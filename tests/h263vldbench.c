@@ -0,0 +1,211 @@
+/**
+ * \file h263vldbench.c
+ * \brief  Throughput of the h263 vld rewriter on the Sorenson frames of an FLV
+ *
+ * Loads the Sorenson H.263 video tags (codec id 2) of an FLV file and runs
+ * h263vld() over them the way the player does for VFORMAT_H263 before the
+ * decoder can take the stream, for -t seconds. Prints the frames/s, the
+ * macroblocks/s and the input MB/s, and how many frames the rewriter gave
+ * up on (returned 0). -n limits the number of frames loaded.
+ *
+ * usage: h263vldbench -f file.flv [-t seconds] [-n frames]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "h263vld.h"
+
+#define FLV_TAG_VIDEO       9
+#define FLV_CODECID_H263    2
+
+struct frame {
+    unsigned char *data;
+    int size;
+};
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static unsigned rb(const unsigned char *p, int n)
+{
+    unsigned v = 0;
+    while (n-- > 0) {
+        v = (v << 8) | *p++;
+    }
+    return v;
+}
+
+/* bits [pos,pos+n) of the picture header */
+static unsigned hdr_bits(const unsigned char *p, int pos, int n)
+{
+    unsigned v = 0;
+    while (n-- > 0) {
+        v = (v << 1) | ((p[pos >> 3] >> (7 - (pos & 7))) & 1);
+        pos++;
+    }
+    return v;
+}
+
+static void sorenson_size(const unsigned char *p, int size, int *w, int *h)
+{
+    static const int fixed[7][2] = {
+        {0, 0}, {0, 0}, {352, 288}, {176, 144}, {128, 96}, {320, 240}, {160, 120}
+    };
+    int fmt;
+
+    *w = *h = 0;
+    if (size < 9 || hdr_bits(p, 0, 17) != 1) {
+        return;
+    }
+    fmt = hdr_bits(p, 30, 3);
+    if (fmt == 0) {
+        *w = hdr_bits(p, 33, 8);
+        *h = hdr_bits(p, 41, 8);
+    } else if (fmt == 1) {
+        *w = hdr_bits(p, 33, 16);
+        *h = hdr_bits(p, 49, 16);
+    } else if (fmt < 7) {
+        *w = fixed[fmt][0];
+        *h = fixed[fmt][1];
+    }
+}
+
+static int load_flv(const char *path, struct frame **frames, int max_frames)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char hdr[11];
+    struct frame *f = NULL;
+    int n = 0, cap = 0;
+
+    if (!fp) {
+        return -1;
+    }
+    if (fread(hdr, 1, 9, fp) != 9 || memcmp(hdr, "FLV", 3)) {
+        fclose(fp);
+        return -1;
+    }
+    fseek(fp, rb(hdr + 5, 4) + 4, SEEK_SET);
+    while (n < max_frames && fread(hdr, 1, 11, fp) == 11) {
+        int type = hdr[0] & 0x1f, size = rb(hdr + 1, 3);
+        unsigned char *buf;
+
+        if (type != FLV_TAG_VIDEO || size < 2) {
+            fseek(fp, size + 4, SEEK_CUR);
+            continue;
+        }
+        buf = malloc(size);
+        if (!buf || fread(buf, 1, size, fp) != (size_t)size) {
+            free(buf);
+            break;
+        }
+        fseek(fp, 4, SEEK_CUR);
+        if ((buf[0] & 0x0f) != FLV_CODECID_H263) {
+            free(buf);
+            continue;
+        }
+        if (n == cap) {
+            struct frame *nf;
+            cap = cap ? cap * 2 : 256;
+            nf = realloc(f, cap * sizeof(struct frame));
+            if (!nf) {
+                free(buf);
+                break;
+            }
+            f = nf;
+        }
+        /* the payload follows the flags byte */
+        memmove(buf, buf + 1, size - 1);
+        f[n].data = buf;
+        f[n].size = size - 1;
+        n++;
+    }
+    fclose(fp);
+    *frames = f;
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    struct frame *frames = NULL;
+    unsigned char *out;
+    int64_t t0, elapsed, done = 0, failed = 0, bytes = 0, in_bytes = 0;
+    int seconds = 5, max_frames = 1 << 30, n, i, w, h, out_size, mbs, opt;
+
+    while ((opt = getopt(argc, argv, "f:t:n:")) != -1) {
+        switch (opt) {
+        case 'f':
+            path = optarg;
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        case 'n':
+            max_frames = atoi(optarg);
+            break;
+        default:
+            path = NULL;
+            break;
+        }
+    }
+    if (!path) {
+        printf("usage: %s -f file.flv [-t seconds] [-n frames]\n", argv[0]);
+        return 1;
+    }
+    n = load_flv(path, &frames, max_frames);
+    if (n <= 0) {
+        printf("no sorenson h263 frames in %s\n", path);
+        return 1;
+    }
+    sorenson_size(frames[0].data, frames[0].size, &w, &h);
+    if (w <= 0 || h <= 0) {
+        printf("bad picture header in the first frame\n");
+        return 1;
+    }
+    for (i = 0; i < n; i++) {
+        in_bytes += frames[i].size;
+    }
+    mbs = ((w + 15) / 16) * ((h + 15) / 16);
+    /* same size the player gives the rewriter */
+    out_size = w * h * 2 + H263VLD_MB_MAX_OUT;
+    out = malloc(out_size);
+    if (!out) {
+        return 1;
+    }
+    printf("%s: %d frames %dx%d, %lld bytes/frame\n", path, n, w, h, in_bytes / n);
+
+    t0 = now_us();
+    do {
+        for (i = 0; i < n; i++) {
+            int ret = h263vld(frames[i].data, out, frames[i].size, out_size, 1);
+            if (ret <= 0) {
+                failed++;
+            } else {
+                bytes += ret;
+            }
+        }
+        done += n;
+        elapsed = now_us() - t0;
+    } while (elapsed < (int64_t)seconds * 1000000);
+
+    printf("%lld frames in %.2fs: %.0f frames/s, %.0f macroblocks/s, in %.1f MB/s, out %.1f MB/s\n",
+           done, elapsed / 1e6, done * 1e6 / elapsed, done * mbs * 1e6 / elapsed,
+           (double)in_bytes * (done / n) / elapsed, (double)bytes / elapsed);
+    printf("%lld frames not rewritten\n", failed / (done / n));
+    for (i = 0; i < n; i++) {
+        free(frames[i].data);
+    }
+    free(frames);
+    free(out);
+    return 0;
+}
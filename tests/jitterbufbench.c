@@ -0,0 +1,224 @@
+/**
+ * \file jitterbufbench.c
+ * \brief  Latency and output smoothness of the live TS jitter buffer
+ *
+ * Simulates a CBR multicast TS (7 packets per datagram, PCR every 40ms)
+ * sent over a network with random delay, periodic bursts (the path stalls
+ * and then delivers everything at once) and sender clock drift, and runs
+ * it through jitterbuf_put()/jitterbuf_get() (player_jitterbuf.c) on a
+ * simulated clock, the consumer polling every ms like raw_read. For each
+ * target latency prints the end-to-end latency over the fastest path, the
+ * spread of the output timing against the sender timing and the buffer
+ * statistics; "direct" is feeding the data as it arrives.
+ *
+ * usage: jitterbufbench [-b kbps] [-j mean_jitter_ms] [-B burst_ms] [-d drift_ppm] [-t seconds]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "player_jitterbuf.h"
+
+#define BENCH_PKTS      7
+#define BENCH_DGRAM     (188 * BENCH_PKTS)
+#define BENCH_PCR_PID   0x100
+#define BENCH_PCR_MS    40
+#define BENCH_BURST_MS  1000    /* one stall per second */
+#define BENCH_BASE_US   5000
+
+typedef struct {
+    int64_t send;       ///< sender time, us
+    int64_t arrival;
+    int64_t out;        ///< when the consumer got the first byte
+    uint8_t data[BENCH_DGRAM];
+} bench_dgram_t;
+
+static int bench_cmp(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double rand_exp(double mean)
+{
+    return -mean * log((rand() + 1.0) / (RAND_MAX + 2.0));
+}
+
+static void bench_make_packet(uint8_t *p, int64_t pcr27, int cc)
+{
+    memset(p, 0xff, 188);
+    p[0] = 0x47;
+    p[1] = BENCH_PCR_PID >> 8;
+    p[2] = BENCH_PCR_PID & 0xff;
+    if (pcr27 >= 0) {
+        int64_t base = pcr27 / 300;
+        int ext = (int)(pcr27 % 300);
+        p[3] = 0x30 | (cc & 0x0f);
+        p[4] = 7;
+        p[5] = 0x10;
+        p[6] = (uint8_t)(base >> 25);
+        p[7] = (uint8_t)(base >> 17);
+        p[8] = (uint8_t)(base >> 9);
+        p[9] = (uint8_t)(base >> 1);
+        p[10] = (uint8_t)(((base & 1) << 7) | 0x7e | (ext >> 8));
+        p[11] = (uint8_t)ext;
+    } else {
+        p[3] = 0x10 | (cc & 0x0f);
+    }
+}
+
+/* sender side timing plus network model, arrival times are fifo ordered */
+static bench_dgram_t *bench_make_stream(int n, int kbps, int jitter_ms, int burst_ms, int drift_ppm)
+{
+    bench_dgram_t *d = calloc(n, sizeof(bench_dgram_t));
+    int64_t bytes = 0, next_pcr = 0, last = 0;
+    int i, k, cc = 0;
+
+    for (i = 0; i < n && d; i++) {
+        int64_t t = bytes * 8000 / kbps;    /* stream time, us */
+        d[i].send = t;
+        for (k = 0; k < BENCH_PKTS; k++) {
+            int64_t pt = (bytes + k * 188) * 8000 / kbps;
+            int64_t pcr = -1;
+            if (pt >= next_pcr) {
+                pcr = pt * 27;
+                next_pcr += BENCH_PCR_MS * 1000;
+            }
+            bench_make_packet(d[i].data + k * 188, pcr, cc++);
+        }
+        bytes += BENCH_DGRAM;
+        /* the sender clock runs drift_ppm fast against ours */
+        d[i].send = t - t * drift_ppm / 1000000;
+        d[i].arrival = d[i].send + BENCH_BASE_US + (int64_t)(rand_exp(jitter_ms * 1000.0));
+        if (burst_ms > 0 && (d[i].send % (BENCH_BURST_MS * 1000)) < burst_ms * 1000) {
+            /* stalled path, released at the end of the stall */
+            int64_t stall_end = d[i].send - d[i].send % (BENCH_BURST_MS * 1000) + burst_ms * 1000;
+            d[i].arrival = stall_end + BENCH_BASE_US;
+        }
+        if (d[i].arrival < last) {
+            d[i].arrival = last;
+        }
+        last = d[i].arrival;
+    }
+    return d;
+}
+
+static void bench_report(const char *name, bench_dgram_t *d, int n, int64_t *tmp, const jitterbuf_stats_t *st)
+{
+    int i, m = 0;
+
+    for (i = n / 10; i < n; i++) {  /* skip the start up */
+        if (d[i].out >= 0) {
+            tmp[m++] = d[i].out - d[i].send;
+        }
+    }
+    if (!m) {
+        printf("%-10s no output\n", name);
+        return;
+    }
+    qsort(tmp, m, sizeof(int64_t), bench_cmp);
+    printf("%-10s latency p50 %6.1fms p99 %6.1fms  output spread p99-p1 %6.1fms",
+           name, tmp[m / 2] / 1000.0, tmp[m * 99 / 100] / 1000.0,
+           (tmp[m * 99 / 100] - tmp[m / 100]) / 1000.0);
+    if (st) {
+        printf("  under %d over %d late %d jitter %.1fms maxvar %.1fms lock %d",
+               st->underruns, st->overruns, st->late_chunks, st->jitter_us / 1000.0,
+               st->max_delay_var_us / 1000.0, st->clock_locked);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const int targets[] = {50, 100, 200, 400};
+    int kbps = 8000, jitter_ms = 5, burst_ms = 60, drift_ppm = 50, seconds = 60;
+    int n, i, t, opt, got, wait;
+    bench_dgram_t *d;
+    int64_t *tmp, now, out_bytes, end;
+    uint8_t *buf;
+
+    while ((opt = getopt(argc, argv, "b:j:B:d:t:")) != -1) {
+        switch (opt) {
+        case 'b':
+            kbps = atoi(optarg);
+            break;
+        case 'j':
+            jitter_ms = atoi(optarg);
+            break;
+        case 'B':
+            burst_ms = atoi(optarg);
+            break;
+        case 'd':
+            drift_ppm = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-b kbps] [-j mean_jitter_ms] [-B burst_ms] [-d drift_ppm] [-t seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (kbps <= 0 || seconds <= 0) {
+        return 1;
+    }
+    n = (int)((int64_t)kbps * 1000 / 8 * seconds / BENCH_DGRAM);
+    srand(1);
+    d = bench_make_stream(n, kbps, jitter_ms, burst_ms, drift_ppm);
+    tmp = malloc(n * sizeof(int64_t));
+    buf = malloc(188 * 100);
+    if (!d || !tmp || !buf) {
+        return 1;
+    }
+    printf("%d kbps, %ds, jitter mean %dms, %dms stall per second, drift %dppm\n",
+           kbps, seconds, jitter_ms, burst_ms, drift_ppm);
+
+    for (i = 0; i < n; i++) {
+        d[i].out = d[i].arrival;
+    }
+    bench_report("direct", d, n, tmp, NULL);
+
+    end = d[n - 1].arrival + 1000000;
+    for (t = 0; t < (int)(sizeof(targets) / sizeof(targets[0])); t++) {
+        jitterbuf_t *jb = jitterbuf_open(targets[t], 0);
+        jitterbuf_stats_t st;
+        char name[32];
+        int in = 0;
+
+        if (!jb) {
+            return 1;
+        }
+        for (i = 0; i < n; i++) {
+            d[i].out = -1;
+        }
+        out_bytes = 0;
+        for (now = 0; now < end; now += 1000) {
+            while (in < n && d[in].arrival <= now) {
+                if (jitterbuf_put(jb, d[in].data, BENCH_DGRAM, d[in].arrival) == 0) {
+                    break;
+                }
+                in++;
+            }
+            while ((got = jitterbuf_get(jb, buf, 188 * 100, now, &wait)) > 0) {
+                int64_t k;
+                for (k = (out_bytes + BENCH_DGRAM - 1) / BENCH_DGRAM; k * BENCH_DGRAM < out_bytes + got && k < n; k++) {
+                    d[k].out = now;
+                }
+                out_bytes += got;
+            }
+        }
+        jitterbuf_get_stats(jb, &st);
+        snprintf(name, sizeof(name), "%dms", targets[t]);
+        bench_report(name, d, n, tmp, &st);
+        jitterbuf_close(jb);
+    }
+    free(buf);
+    free(tmp);
+    free(d);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * \file kfindexbench.c
+ * \brief  Keyframe index build/seek benchmark for ts/ps/es files
+ *
+ * Builds the background keyframe index of the player (player_kfindex.c)
+ * over a local file, reports the scan throughput and the keyframe count,
+ * then seeks to random times through the index and reports the lookup and
+ * the lookup + first keyframe read latency, the part of a seek the index
+ * replaces.
+ *
+ * usage: kfindexbench [-c ts|ps|es] [-v h264|mpeg2|hevc] [-p pid] [-r frame_dur]
+ *                     [-d cache_dir] [-n seeks] input
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include "player_kfindex.h"
+
+#define BENCH_MAX_SEEKS     4096
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void print_percentiles(const char *name, int *v, int n)
+{
+    if (n <= 0) {
+        printf("%-18s no samples\n", name);
+        return;
+    }
+    qsort(v, n, sizeof(int), cmp_int);
+    printf("%-18s p50 %d p95 %d p99 %d max %d us (%d samples)\n", name,
+           v[n / 2], v[n * 95 / 100], v[n * 99 / 100], v[n - 1], n);
+}
+
+int main(int argc, char **argv)
+{
+    static int lookup_lat[BENCH_MAX_SEEKS], seek_lat[BENCH_MAX_SEEKS];
+    int container = KFINDEX_CONTAINER_TS, codec = KFINDEX_CODEC_H264;
+    int pid = 0x100, frame_dur = 3003, seeks = 1000, opt, i, n = 0, fd;
+    const char *cache_dir = NULL;
+    kfindex_entry_t first, last, e;
+    kfindex_t *idx;
+    int64_t start, t0, t1, scanned;
+    char *buf;
+
+    while ((opt = getopt(argc, argv, "c:v:p:r:d:n:")) != -1) {
+        switch (opt) {
+        case 'c':
+            container = !strcmp(optarg, "ps") ? KFINDEX_CONTAINER_PS :
+                        !strcmp(optarg, "es") ? KFINDEX_CONTAINER_ES : KFINDEX_CONTAINER_TS;
+            break;
+        case 'v':
+            codec = !strcmp(optarg, "mpeg2") ? KFINDEX_CODEC_MPEG2 :
+                    !strcmp(optarg, "hevc") ? KFINDEX_CODEC_HEVC : KFINDEX_CODEC_H264;
+            break;
+        case 'p':
+            pid = strtol(optarg, NULL, 0);
+            break;
+        case 'r':
+            frame_dur = atoi(optarg);
+            break;
+        case 'd':
+            cache_dir = optarg;
+            break;
+        case 'n':
+            seeks = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind >= argc) {
+        printf("usage: %s [-c ts|ps|es] [-v h264|mpeg2|hevc] [-p pid] [-r frame_dur] [-d cache_dir] [-n seeks] input\n", argv[0]);
+        return 1;
+    }
+    if (seeks > BENCH_MAX_SEEKS) {
+        seeks = BENCH_MAX_SEEKS;
+    }
+
+    start = now_us();
+    idx = kfindex_open(argv[optind], container, codec, pid, frame_dur, cache_dir);
+    if (!idx) {
+        printf("can't index %s\n", argv[optind]);
+        return 1;
+    }
+    while (!kfindex_is_complete(idx)) {
+        usleep(10 * 1000);
+    }
+    t0 = now_us() - start;
+    scanned = kfindex_scan_pos(idx);
+    printf("indexed %lld bytes in %lld ms, %.2f MB/s, %d keyframes\n",
+           (long long)scanned, (long long)(t0 / 1000),
+           t0 > 0 ? scanned / (double)t0 : 0.0, kfindex_count(idx));
+    if (kfindex_count(idx) == 0 ||
+        kfindex_lookup(idx, 0, 1, &first) != 0 ||
+        kfindex_lookup(idx, INT64_MAX, -1, &last) != 0) {
+        kfindex_close(idx);
+        return 0;
+    }
+    printf("pts 0x%llx - 0x%llx, last keyframe at 0x%llx size %d\n",
+           (long long)first.pts, (long long)last.pts, (long long)last.offset, last.size);
+
+    fd = open(argv[optind], O_RDONLY);
+    buf = malloc(8 * 1024 * 1024);
+    srand(1);
+    for (i = 0; i < seeks && fd >= 0 && buf; i++) {
+        int64_t pts = first.pts + (int64_t)((double)rand() / RAND_MAX * (last.pts - first.pts));
+        t0 = now_us();
+        if (kfindex_lookup(idx, pts, -1, &e) != 0) {
+            continue;
+        }
+        t1 = now_us();
+        pread(fd, buf, e.size < 8 * 1024 * 1024 ? e.size : 8 * 1024 * 1024, e.offset);
+        lookup_lat[n] = (int)(t1 - t0);
+        seek_lat[n++] = (int)(now_us() - t0);
+    }
+    print_percentiles("lookup", lookup_lat, n);
+    print_percentiles("lookup+keyframe", seek_lat, n);
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(buf);
+    kfindex_close(idx);
+    return 0;
+}
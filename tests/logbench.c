@@ -0,0 +1,139 @@
+/**
+ * \file logbench.c
+ * \brief  Cost of a log_print() call, sync vs async (log_print.c)
+ *
+ * Each of -t threads logs -n lines shaped like the per packet lines of
+ * the read and write loops (a function name, integers, a 64 bit pts and
+ * a float), first with the default synchronous log_lprint(), then after
+ * log_async_start(). Prints the mean and the worst cost per call seen by
+ * the logging threads and, for the async run, the time to drain and the
+ * dropped lines. -d sleeps that many us between lines, like a paced
+ * stream; without it the async run shows the drop path.
+ *
+ * usage: logbench [-n lines] [-t threads] [-d delay_us] [-r ring_size] [-o log_file]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <log_print.h>
+
+#define MAX_THREADS 16
+
+typedef struct {
+    int index;
+    int lines;
+    int delay_us;
+    long long total_ns;
+    long long max_ns;
+} bench_thread_t;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *bench_thread(void *arg)
+{
+    bench_thread_t *t = (bench_thread_t *)arg;
+    long long t0, dt;
+    int i;
+
+    for (i = 0; i < t->lines; i++) {
+        t0 = now_ns();
+        log_print("[%s:%d]thread %d read %d bytes, pts 0x%llx, level %.2f, %s\n", __FUNCTION__, __LINE__,
+                  t->index, 188 * (i & 63), (unsigned long long)i * 3600, (i & 1023) / 1024.0, "ok");
+        dt = now_ns() - t0;
+        t->total_ns += dt;
+        if (dt > t->max_ns) {
+            t->max_ns = dt;
+        }
+        if (t->delay_us) {
+            usleep(t->delay_us);
+        }
+    }
+    return NULL;
+}
+
+static void bench_run(const char *name, int threads, int lines, int delay_us)
+{
+    bench_thread_t t[MAX_THREADS];
+    pthread_t tid[MAX_THREADS];
+    long long total = 0, max = 0;
+    int i;
+
+    for (i = 0; i < threads; i++) {
+        memset(&t[i], 0, sizeof(t[i]));
+        t[i].index = i;
+        t[i].lines = lines;
+        t[i].delay_us = delay_us;
+        pthread_create(&tid[i], NULL, bench_thread, &t[i]);
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+        total += t[i].total_ns;
+        if (t[i].max_ns > max) {
+            max = t[i].max_ns;
+        }
+    }
+    fprintf(stderr, "%-5s %d threads x %d lines: %8.1f ns/call, worst %8.1f us\n",
+            name, threads, lines, (double)total / threads / lines, max / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *log_file = NULL;
+    unsigned int logged, dropped;
+    int lines = 20000, threads = 4, delay_us = 0, ring_size = 0, opt;
+    long long t0;
+
+    while ((opt = getopt(argc, argv, "n:t:d:r:o:")) != -1) {
+        switch (opt) {
+        case 'n':
+            lines = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'd':
+            delay_us = atoi(optarg);
+            break;
+        case 'r':
+            ring_size = atoi(optarg);
+            break;
+        case 'o':
+            log_file = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n lines] [-t threads] [-d delay_us] [-r ring_size] [-o log_file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lines <= 0 || threads <= 0 || threads > MAX_THREADS) {
+        return 1;
+    }
+    if (log_file && log_open(log_file) < 0) {
+        fprintf(stderr, "can't open %s\n", log_file);
+        return 1;
+    }
+    bench_run("sync", threads, lines, delay_us);
+    if (log_async_start(ring_size) < 0) {
+        fprintf(stderr, "async log start failed\n");
+        return 1;
+    }
+    bench_run("async", threads, lines, delay_us);
+    t0 = now_ns();
+    log_flush();
+    log_async_get_stats(&logged, &dropped);
+    fprintf(stderr, "async drain %.1f ms, %u queued, %u dropped\n", (now_ns() - t0) / 1e6, logged, dropped);
+    log_async_stop();
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * \file mediascanbench.c
+ * \brief  Files per second of the media scanner, cold and warm cache
+ *
+ * Scans a directory with mediascan_dir() (player_mediascan.c) twice: once
+ * with an empty cache, every file parsed on -j threads with a -p byte /
+ * -a ms probe budget, then again with the cache the first pass wrote, when
+ * only new or modified files are parsed. -j 1 -p 5000000 -a 5000 is close
+ * to the one file at a time thumbnail path the media library used so far.
+ * Prints the files per second, how many came from the cache and the parse
+ * errors of each pass.
+ *
+ * usage: mediascanbench [-j threads] [-p probesize] [-a analyze_ms] [-r] [-c cache_file] [-v] dir
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <player_mediascan.h>
+
+typedef struct {
+    int files;
+    int cached;
+    int errors;
+    int verbose;
+} bench_count_t;
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void bench_cb(void *opaque, const mediascan_result_t *res)
+{
+    bench_count_t *c = (bench_count_t *)opaque;
+
+    c->files++;
+    c->cached += res->cached;
+    c->errors += res->error < 0;
+    if (c->verbose) {
+        printf("%s%s %lldms v%d a%d s%d %dx%d rot %d \"%s\" \"%s\" \"%s\"\n",
+               res->cached ? "[cached] " : "", res->path, (long long)(res->duration / 1000),
+               res->vtracks, res->atracks, res->stracks, res->width, res->height,
+               res->rotation, res->title, res->artist, res->album);
+    }
+}
+
+static void bench_pass(const char *name, const char *dir, const mediascan_para_t *para, int verbose)
+{
+    bench_count_t c;
+    int64_t t0;
+    double s;
+    int ret;
+
+    memset(&c, 0, sizeof(c));
+    c.verbose = verbose;
+    t0 = now_us();
+    ret = mediascan_dir(dir, para, bench_cb, &c);
+    s = (now_us() - t0) / 1e6;
+    printf("%-5s %6d files in %7.2fs  %8.1f files/s  cached %d  errors %d%s\n",
+           name, c.files, s, s > 0 ? c.files / s : 0.0, c.cached, c.errors,
+           ret < 0 ? "  (scan failed)" : "");
+}
+
+int main(int argc, char **argv)
+{
+    mediascan_para_t para;
+    char cache[256];
+    int opt, verbose = 0, keep = 0;
+
+    memset(&para, 0, sizeof(para));
+    snprintf(cache, sizeof(cache), "/data/local/tmp/mediascanbench.%d", (int)getpid());
+    while ((opt = getopt(argc, argv, "j:p:a:rc:v")) != -1) {
+        switch (opt) {
+        case 'j':
+            para.threads = atoi(optarg);
+            break;
+        case 'p':
+            para.probesize = atoi(optarg);
+            break;
+        case 'a':
+            para.analyze_ms = atoi(optarg);
+            break;
+        case 'r':
+            para.recursive = 1;
+            break;
+        case 'c':
+            snprintf(cache, sizeof(cache), "%s", optarg);
+            keep = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        printf("usage: %s [-j threads] [-p probesize] [-a analyze_ms] [-r] [-c cache_file] [-v] dir\n", argv[0]);
+        return 1;
+    }
+    if (!keep) {
+        unlink(cache);
+    }
+    para.cache_path = cache;
+    bench_pass(keep ? "first" : "cold", argv[optind], &para, verbose);
+    bench_pass("warm", argv[optind], &para, verbose);
+    if (!keep) {
+        unlink(cache);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * \file movopenbench.c
+ * \brief  Open time, memory and seek latency of the mov/mp4 demuxer
+ *
+ * Opens a file with libavformat, reports the header parse time and the
+ * RSS growth it caused, then seeks to random times and reads the next
+ * packet. Run it once with the compact sample index (default) and once
+ * with "setprop libplayer.mov.compactindex 0" to compare against the full
+ * AVIndexEntry table on long recordings.
+ *
+ * usage: movopenbench [-n seeks] input.mp4
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <libavformat/avformat.h>
+
+#define BENCH_MAX_SEEKS     4096
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static long rss_kb(void)
+{
+    char line[128];
+    long kb = -1;
+    FILE *fp = fopen("/proc/self/status", "r");
+
+    if (!fp) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strncmp(line, "VmRSS:", 6)) {
+            kb = atol(line + 6);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void print_percentiles(const char *name, int *v, int n)
+{
+    if (n <= 0) {
+        printf("%-18s no samples\n", name);
+        return;
+    }
+    qsort(v, n, sizeof(int), cmp_int);
+    printf("%-18s p50 %d p95 %d p99 %d max %d us (%d samples)\n", name,
+           v[n / 2], v[n * 95 / 100], v[n * 99 / 100], v[n - 1], n);
+}
+
+int main(int argc, char **argv)
+{
+    static int seek_lat[BENCH_MAX_SEEKS];
+    AVFormatContext *ic = NULL;
+    AVPacket pkt;
+    int seeks = 200, opt, i, n = 0;
+    int64_t t0, open_us, info_us;
+    long rss0, rss1;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            seeks = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind >= argc) {
+        printf("usage: %s [-n seeks] input.mp4\n", argv[0]);
+        return 1;
+    }
+    if (seeks > BENCH_MAX_SEEKS) {
+        seeks = BENCH_MAX_SEEKS;
+    }
+
+    av_register_all();
+    rss0 = rss_kb();
+    t0 = now_us();
+    if (av_open_input_file(&ic, argv[optind], NULL, 0, NULL) < 0) {
+        printf("can't open %s\n", argv[optind]);
+        return 1;
+    }
+    open_us = now_us() - t0;
+    rss1 = rss_kb();
+    t0 = now_us();
+    av_find_stream_info(ic);
+    info_us = now_us() - t0;
+    printf("open %lld ms (+%lld ms stream info), rss +%ld KB, duration %lld s\n",
+           (long long)(open_us / 1000), (long long)(info_us / 1000), rss1 - rss0,
+           (long long)(ic->duration / AV_TIME_BASE));
+    for (i = 0; i < (int)ic->nb_streams; i++) {
+        printf("stream %d: %d index entries\n", i, ic->streams[i]->nb_index_entries);
+    }
+
+    srand(1);
+    for (i = 0; i < seeks && ic->duration > 0; i++) {
+        int64_t ts = (int64_t)((double)rand() / RAND_MAX * ic->duration);
+        t0 = now_us();
+        if (av_seek_frame(ic, -1, ts, AVSEEK_FLAG_BACKWARD) < 0) {
+            continue;
+        }
+        if (av_read_frame(ic, &pkt) == 0) {
+            av_free_packet(&pkt);
+        }
+        seek_lat[n++] = (int)(now_us() - t0);
+    }
+    print_percentiles("seek+read", seek_lat, n);
+    av_close_input_file(ic);
+    return 0;
+}
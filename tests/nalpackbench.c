@@ -0,0 +1,165 @@
+/**
+ * \file nalpackbench.c
+ * \brief  Packets/sec benchmark of the avcC to Annex-B packetizer
+ *
+ * Builds synthetic length prefixed h264 access units (AUD, a few slices,
+ * an IDR every gop) with 4, 2 or 1 byte NAL length fields and runs them
+ * through nal_packetizer_convert() (player_nalpack.c), the per packet
+ * work done by h264_update_frame_header() before codec_write(). Each
+ * iteration restores the packet first, so the rate of the restore copy
+ * alone is printed as the baseline. Also checks the converted output once.
+ *
+ * usage: nalpackbench [-l length_size] [-s packet_size] [-n packets]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "player_nalpack.h"
+
+#define BENCH_GOP       30
+#define BENCH_PACKETS   64
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int put_nal(unsigned char *p, int n, int type, int len)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        p[i] = (len >> (8 * (n - 1 - i))) & 0xff;
+    }
+    p[n] = type;
+    memset(p + n + 1, 0xaa, len - 1);
+    return n + len;
+}
+
+static int make_packet(unsigned char *p, int n, int size, int key)
+{
+    int len = 0, slices = 4, slice_len;
+
+    len += put_nal(p + len, n, 0x09, 2);
+    slice_len = (size - len) / slices - n;
+    if (n == 2 && slice_len > 0xffff) {
+        slice_len = 0xffff;
+    }
+    while (slices--) {
+        len += put_nal(p + len, n, key ? 0x65 : 0x41, slice_len);
+    }
+    return len;
+}
+
+static int check_annexb(const unsigned char *p, int size, int *nals)
+{
+    int i;
+    *nals = 0;
+    for (i = 0; i + 4 <= size; i++) {
+        if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 0 && p[i + 3] == 1) {
+            (*nals)++;
+        }
+    }
+    return *nals > 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const unsigned char avcc[] = {
+        0x01, 0x64, 0x00, 0x28, 0xff, 0xe1, 0x00, 0x04, 0x67, 0x64, 0x00, 0x28,
+        0x01, 0x00, 0x03, 0x68, 0xee, 0x3c
+    };
+    static const unsigned char sets[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xee, 0x3c
+    };
+    unsigned char avcc_cfg[sizeof(avcc)];
+    unsigned char *src[BENCH_PACKETS], *work;
+    int src_len[BENCH_PACKETS];
+    int n = 4, size = 64 * 1024, packets = 200000, opt, i, nals;
+    int64_t t0, copy_us, total_us;
+    nal_packetizer_t pz;
+
+    while ((opt = getopt(argc, argv, "l:s:n:")) != -1) {
+        switch (opt) {
+        case 'l':
+            n = atoi(optarg);
+            break;
+        case 's':
+            size = atoi(optarg);
+            break;
+        case 'n':
+            packets = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-l length_size] [-s packet_size] [-n packets]\n", argv[0]);
+            return 1;
+        }
+    }
+    if ((n != 1 && n != 2 && n != 4) || size < 64 || packets <= 0) {
+        printf("invalid length size, packet size or count\n");
+        return 1;
+    }
+
+    work = malloc(size);
+    for (i = 0; i < BENCH_PACKETS; i++) {
+        src[i] = malloc(size);
+        src_len[i] = make_packet(src[i], n, size, i % BENCH_GOP == 0);
+    }
+    memcpy(avcc_cfg, avcc, sizeof(avcc));
+    avcc_cfg[4] = 0xfc | (n - 1);
+
+    /* correctness, a seek landing before a non IDR gets the sets repeated */
+    nal_packetizer_init(&pz);
+    nal_packetizer_set_config(&pz, 0, avcc_cfg, sizeof(avcc_cfg), sets, sizeof(sets));
+    for (i = 1; i <= BENCH_GOP; i++) {
+        unsigned char *data = work;
+        int len = src_len[i % BENCH_PACKETS];
+        memcpy(work, src[i % BENCH_PACKETS], len);
+        nal_packetizer_convert(&pz, &data, &len);
+        if (!check_annexb(data, len, &nals) || nals != 5 + (i == BENCH_GOP ? 2 : 0)) {
+            printf("conversion check failed at packet %d, %d nals\n", i, nals);
+            return 1;
+        }
+    }
+    printf("conversion check ok, sets inserted before the first IDR after config\n");
+
+    t0 = now_us();
+    for (i = 0; i < packets; i++) {
+        memcpy(work, src[i % BENCH_PACKETS], src_len[i % BENCH_PACKETS]);
+    }
+    copy_us = now_us() - t0;
+
+    t0 = now_us();
+    for (i = 0; i < packets; i++) {
+        unsigned char *data = work;
+        int len = src_len[i % BENCH_PACKETS];
+        memcpy(work, src[i % BENCH_PACKETS], len);
+        nal_packetizer_convert(&pz, &data, &len);
+    }
+    total_us = now_us() - t0;
+    if (copy_us <= 0) {
+        copy_us = 1;
+    }
+    if (total_us <= 0) {
+        total_us = 1;
+    }
+    printf("length size %d, %d bytes packets\n", n, size);
+    printf("copy only          %.0f packets/s, %.1f ns/packet\n",
+           packets * 1000000.0 / copy_us, copy_us * 1000.0 / packets);
+    printf("copy + convert     %.0f packets/s, %.1f ns/packet\n",
+           packets * 1000000.0 / total_us, total_us * 1000.0 / packets);
+    nal_packetizer_release(&pz);
+    for (i = 0; i < BENCH_PACKETS; i++) {
+        free(src[i]);
+    }
+    free(work);
+    return 0;
+}
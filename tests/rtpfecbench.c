@@ -0,0 +1,431 @@
+/**
+ * \file rtpfecbench.c
+ * \brief  SMPTE 2022-1 FEC recovery rate and cost (libavformat/rtpfec.c)
+ *
+ * A local sender builds an MPEG-TS over RTP stream (7 TS packets per
+ * datagram, some shorter ones) protected by an L x D column FEC and, with
+ * -w, the row FEC, then drops packets at random (-p percent, plus bursts
+ * of -B packets started with -b percent) and reorders some (-r percent
+ * held back for up to -R packets). Media and FEC packets see the same
+ * network.
+ *
+ * By default the packets go straight into ff_rtp_fec_add_media() and
+ * ff_rtp_fec_add_fec(); every rebuilt packet is compared with what was
+ * sent. Prints the loss before and after FEC, the recovery rate and the
+ * CPU cost per media packet. With -u the sender goes over loopback UDP to
+ * rtp://127.0.0.1:port?fec=1 read through the cache mode of rtpproto.c,
+ * and the reader counts the datagrams missing from the byte stream.
+ *
+ * usage: rtpfecbench [-n packets] [-L columns] [-D rows] [-w] [-p loss%]
+ *                    [-b burst%] [-B burst_len] [-r reorder%] [-R distance]
+ *                    [-u port] [-k kbps]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+#include "libavformat/rtpfec.h"
+
+#define BENCH_PAYLOAD   (188 * 7)
+#define BENCH_PKT       (12 + BENCH_PAYLOAD)
+#define BENCH_FEC_PT    96
+#define BENCH_HOLD      64
+#define BENCH_TAIL      1000    /* sent after the run in -u mode, flushes the receive cache */
+
+typedef struct {
+    uint8_t buf[12 + 16 + BENCH_PAYLOAD];
+    int len;
+    int stream;                 ///< -1 media, 0 column FEC, 1 row FEC
+    int release;                ///< when a held back packet goes out
+} bench_pkt_t;
+
+typedef struct {
+    int n, L, D, rows;
+    double loss, burst, reorder;
+    int burst_len, distance;
+    int fixed_len;
+    /* network */
+    int burst_left;
+    bench_pkt_t hold[BENCH_HOLD];
+    int nhold, sent;
+    /* in process receiver */
+    RTPFECContext *fec;
+    uint8_t *received;          ///< per media index: 1 received, 2 recovered
+    int newest;
+    unsigned int bad;
+    int64_t fec_ns;
+    /* udp sender */
+    int sock;
+    struct sockaddr_in addr;
+    int port, kbps;
+    unsigned int dropped;
+} bench_t;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double cpu_s(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void wb16(uint8_t *p, unsigned v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void wb32(uint8_t *p, unsigned v)
+{
+    wb16(p, v >> 16);
+    wb16(p + 2, v);
+}
+
+static int media_len(bench_t *b, int idx)
+{
+    return b->fixed_len || idx % 97 ? BENCH_PKT : 12 + 188 * (1 + idx % 6);
+}
+
+static void media_build(bench_t *b, int idx, uint8_t *buf)
+{
+    int len = media_len(b, idx), j;
+
+    buf[0] = 0x80;
+    buf[1] = 33 | (idx % 50 == 0 ? 0x80 : 0);
+    wb16(buf + 2, idx);
+    wb32(buf + 4, idx * 90);
+    wb32(buf + 8, 0x12345678);
+    for (j = 12; j < len; j++) {
+        buf[j] = (idx * 31 + j * 7) & 0xff;
+    }
+    for (j = 12; j < len; j += 188) {
+        buf[j] = 0x47;
+        wb32(buf + j + 1, idx);
+    }
+}
+
+/* XOR of the packets idx0, idx0 + offset, ... into an FEC packet */
+static int fec_build(bench_t *b, uint8_t *out, int idx0, int offset, int na, int row, int fec_seq)
+{
+    uint8_t media[BENCH_PKT];
+    uint8_t *h = out + 12, *payload = out + 28;
+    int i, j, len_rec = 0, pt = 0, b0 = 0, mk = 0, max = 0;
+    unsigned ts = 0;
+
+    memset(out, 0, 28 + BENCH_PAYLOAD);
+    for (i = 0; i < na; i++) {
+        int idx = idx0 + i * offset, len = media_len(b, idx);
+        media_build(b, idx, media);
+        len_rec ^= len - 12;
+        pt ^= media[1] & 0x7f;
+        mk ^= media[1] & 0x80;
+        b0 ^= media[0] & 0x3f;
+        ts ^= idx * 90;
+        for (j = 12; j < len; j++) {
+            payload[j - 12] ^= media[j];
+        }
+        if (len - 12 > max) {
+            max = len - 12;
+        }
+    }
+    out[0] = 0x80 | b0;
+    out[1] = mk | BENCH_FEC_PT;
+    wb16(out + 2, fec_seq);
+    wb32(out + 4, 0);
+    wb32(out + 8, 0x12345679);
+    wb16(h, idx0);
+    wb16(h + 2, len_rec);
+    h[4] = 0x80 | pt;
+    wb32(h + 8, ts);
+    h[12] = row ? 0x40 : 0;
+    h[13] = offset;
+    h[14] = na;
+    return 28 + max;
+}
+
+static void deliver(bench_t *b, bench_pkt_t *p)
+{
+    int64_t t0;
+
+    if (b->sock >= 0) {
+        struct sockaddr_in to = b->addr;
+        to.sin_port = htons(b->port + (p->stream < 0 ? 0 : p->stream ? RTP_FEC_ROW_PORT_OFFSET : RTP_FEC_COLUMN_PORT_OFFSET));
+        sendto(b->sock, p->buf, p->len, 0, (struct sockaddr *)&to, sizeof(to));
+        return;
+    }
+    t0 = now_ns();
+    if (p->stream < 0) {
+        int idx = b->newest - (uint16_t)(b->newest - ((p->buf[2] << 8) | p->buf[3]));
+        if (idx >= 0 && idx < b->n && !b->received[idx]) {
+            b->received[idx] = 1;
+        }
+        ff_rtp_fec_add_media(b->fec, p->buf, p->len);
+    } else {
+        ff_rtp_fec_add_fec(b->fec, p->buf, p->len);
+    }
+    b->fec_ns += now_ns() - t0;
+}
+
+/* the network: loss, bursts and reordering */
+static void net_send(bench_t *b, const uint8_t *buf, int len, int stream)
+{
+    bench_pkt_t p;
+    int i;
+
+    b->sent++;
+    for (i = 0; i < b->nhold;) {
+        if (b->hold[i].release <= b->sent) {
+            deliver(b, &b->hold[i]);
+            b->hold[i] = b->hold[--b->nhold];
+        } else {
+            i++;
+        }
+    }
+    if (!b->burst_left && rand() < b->burst * RAND_MAX) {
+        b->burst_left = b->burst_len;
+    }
+    if (b->burst_left) {
+        b->burst_left--;
+        b->dropped++;
+        return;
+    }
+    if (rand() < b->loss * RAND_MAX) {
+        b->dropped++;
+        return;
+    }
+    memcpy(p.buf, buf, len);
+    p.len = len;
+    p.stream = stream;
+    if (b->nhold < BENCH_HOLD && rand() < b->reorder * RAND_MAX) {
+        p.release = b->sent + 1 + rand() % b->distance;
+        b->hold[b->nhold++] = p;
+        return;
+    }
+    deliver(b, &p);
+}
+
+static void net_flush(bench_t *b)
+{
+    while (b->nhold) {
+        deliver(b, &b->hold[--b->nhold]);
+    }
+}
+
+static void sender_run(bench_t *b, int count)
+{
+    uint8_t buf[28 + BENCH_PAYLOAD];
+    int matrix = b->L * b->D, idx, c, len, fec_seq[2] = {0, 0};
+    int64_t t0 = now_ns(), due;
+
+    for (idx = 0; idx < count; idx++) {
+        media_build(b, idx, buf);
+        if (b->sock < 0) {
+            b->newest = idx;
+        }
+        net_send(b, buf, media_len(b, idx), -1);
+        if (b->rows && idx % b->L == b->L - 1) {
+            len = fec_build(b, buf, idx - b->L + 1, 1, b->L, 1, fec_seq[1]++);
+            net_send(b, buf, len, 1);
+        }
+        if (idx % matrix == matrix - 1) {
+            for (c = 0; c < b->L; c++) {
+                len = fec_build(b, buf, idx - matrix + 1 + c, b->L, b->D, 0, fec_seq[0]++);
+                net_send(b, buf, len, 0);
+            }
+        }
+        if (b->kbps) {
+            due = t0 + (int64_t)(idx + 1) * BENCH_PKT * 8 * 1000000LL / b->kbps;
+            while (now_ns() < due) {
+                usleep(200);
+            }
+        }
+    }
+    net_flush(b);
+}
+
+static void bench_recovered(void *opaque, const uint8_t *buf, int len)
+{
+    bench_t *b = opaque;
+    uint8_t ref[BENCH_PKT];
+    int idx = b->newest - (uint16_t)(b->newest - ((buf[2] << 8) | buf[3]));
+
+    if (idx < 0 || idx >= b->n) {
+        b->bad++;
+        return;
+    }
+    media_build(b, idx, ref);
+    if (len != media_len(b, idx) || memcmp(buf, ref, len)) {
+        b->bad++;
+        return;
+    }
+    if (!b->received[idx]) {
+        b->received[idx] = 2;
+    }
+}
+
+static int bench_local(bench_t *b)
+{
+    RTPFECStats stats;
+    int i, got = 0, rebuilt = 0;
+    double c0;
+
+    b->received = calloc(b->n, 1);
+    b->fec = ff_rtp_fec_open(bench_recovered, b);
+    if (!b->received || !b->fec) {
+        return 1;
+    }
+    c0 = cpu_s();
+    sender_run(b, b->n);
+    c0 = cpu_s() - c0;
+    for (i = 0; i < b->n; i++) {
+        got += b->received[i] == 1;
+        rebuilt += b->received[i] == 2;
+    }
+    ff_rtp_fec_get_stats(b->fec, &stats);
+    printf("%d media packets, %dx%d matrix%s, %u of %d datagrams dropped\n",
+           b->n, b->L, b->D, b->rows ? " + rows" : "", b->dropped, b->sent);
+    printf("media lost %.3f%%, after fec %.3f%%, recovered %.1f%% of the lost (%d), %u bad\n",
+           100.0 * (b->n - got) / b->n, 100.0 * (b->n - got - rebuilt) / b->n,
+           got < b->n ? 100.0 * rebuilt / (b->n - got) : 100.0, rebuilt, b->bad);
+    printf("fec %u packets, %u expired, %.0f ns per media packet in fec, run %.3fs cpu\n",
+           stats.fec, stats.expired, (double)b->fec_ns / b->n, c0);
+    ff_rtp_fec_close(b->fec);
+    free(b->received);
+    return b->bad ? 1 : 0;
+}
+
+static void *udp_sender(void *arg)
+{
+    bench_t *b = arg;
+
+    usleep(300 * 1000);
+    sender_run(b, b->n + BENCH_TAIL);
+    return NULL;
+}
+
+static int bench_udp(bench_t *b)
+{
+    char url[128];
+    URLContext *h = NULL;
+    pthread_t tid;
+    uint8_t buf[BENCH_PAYLOAD];
+    int last = -1, missing = 0, idx;
+    double c0;
+
+    av_register_all();
+    b->fixed_len = 1;
+    b->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&b->addr, 0, sizeof(b->addr));
+    b->addr.sin_family = AF_INET;
+    b->addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    snprintf(url, sizeof(url), "rtp://127.0.0.1:%d?fec=1", b->port);
+    if (b->sock < 0 || ffurl_open(&h, url, AVIO_FLAG_READ | AVIO_FLAG_CACHE) < 0) {
+        printf("can't open %s\n", url);
+        return 1;
+    }
+    c0 = cpu_s();
+    pthread_create(&tid, NULL, udp_sender, b);
+    while (last < b->n - 1 && ffurl_read_complete(h, buf, BENCH_PAYLOAD) == BENCH_PAYLOAD) {
+        idx = (buf[1] << 24) | (buf[2] << 16) | (buf[3] << 8) | buf[4];
+        if (idx > last + 1) {
+            missing += idx - last - 1;
+        }
+        if (idx > last) {
+            last = idx;
+        }
+    }
+    pthread_join(tid, NULL);
+    printf("udp: %d media packets, %dx%d matrix%s, %u of %d datagrams dropped, %d missing after fec (%.3f%%), %.3fs cpu\n",
+           b->n, b->L, b->D, b->rows ? " + rows" : "", b->dropped, b->sent, missing,
+           100.0 * missing / b->n, cpu_s() - c0);
+    ffurl_close(h);
+    close(b->sock);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bench_t b;
+    int opt;
+
+    memset(&b, 0, sizeof(b));
+    b.n = 200000;
+    b.L = 10;
+    b.D = 10;
+    b.loss = 0.01;
+    b.burst_len = 5;
+    b.distance = 8;
+    b.sock = -1;
+    while ((opt = getopt(argc, argv, "n:L:D:wp:b:B:r:R:u:k:")) != -1) {
+        switch (opt) {
+        case 'n':
+            b.n = atoi(optarg);
+            break;
+        case 'L':
+            b.L = atoi(optarg);
+            break;
+        case 'D':
+            b.D = atoi(optarg);
+            break;
+        case 'w':
+            b.rows = 1;
+            break;
+        case 'p':
+            b.loss = atof(optarg) / 100;
+            break;
+        case 'b':
+            b.burst = atof(optarg) / 100;
+            break;
+        case 'B':
+            b.burst_len = atoi(optarg);
+            break;
+        case 'r':
+            b.reorder = atof(optarg) / 100;
+            break;
+        case 'R':
+            b.distance = atoi(optarg);
+            break;
+        case 'u':
+            b.port = atoi(optarg);
+            break;
+        case 'k':
+            b.kbps = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-n packets] [-L columns] [-D rows] [-w] [-p loss%%] [-b burst%%] [-B burst_len] "
+                   "[-r reorder%%] [-R distance] [-u port] [-k kbps]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (b.n <= 0 || b.L < 1 || b.L > 20 || b.D < 1 || b.D > 20 || b.L * b.D > 100 || b.distance < 1) {
+        printf("bad parameters, 2022-1 allows L, D <= 20 and L * D <= 100\n");
+        return 1;
+    }
+    srand(1);
+    if (b.port) {
+        if (!b.kbps) {
+            b.kbps = 8000;
+        }
+        return bench_udp(&b);
+    }
+    return bench_local(&b);
+}
@@ -0,0 +1,169 @@
+/**
+ * \file threadpoolbench.c
+ * \brief  Short job cost, thread per job vs the amthreadpool task pool
+ *
+ * Runs -n jobs of -w us of busy work each, -b at a time:
+ *  - thread: amthreadpool_pthread_create() + amthreadpool_pthread_join()
+ *            per job, how probe and estimate jobs were started so far
+ *  - pool:   amthreadpool_task_submit() + amthreadpool_task_wait()
+ * and prints the jobs per second and the mean dispatch latency, from the
+ * submit to the job starting. Then registers -t idle threads and times
+ * amthreadpool_on_requare_exit(0), the check ffmpeg does in every read.
+ *
+ * usage: threadpoolbench [-n jobs] [-w work_us] [-b batch] [-j workers] [-t threads]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <amthreadpool.h>
+
+#define MAX_BATCH   256
+
+typedef struct {
+    int64_t submit_us;
+    int64_t start_us;
+    int work_us;
+} bench_job_t;
+
+static volatile int idle_exit;
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void *bench_job(void *arg)
+{
+    bench_job_t *job = (bench_job_t *)arg;
+
+    job->start_us = now_us();
+    while (now_us() - job->start_us < job->work_us) {
+        ;
+    }
+    return arg;
+}
+
+static void *bench_idle(void *arg)
+{
+    while (!idle_exit) {
+        amthreadpool_thread_usleep(10 * 1000);
+    }
+    return arg;
+}
+
+static void bench_mode(int pool, int n, int work_us, int batch)
+{
+    bench_job_t job[MAX_BATCH];
+    pthread_t pid[MAX_BATCH];
+    amthreadpool_task_t *task[MAX_BATCH];
+    int64_t t0, latency = 0;
+    int done = 0, i, b, failed = 0;
+    double s;
+
+    t0 = now_us();
+    while (done < n) {
+        b = n - done < batch ? n - done : batch;
+        for (i = 0; i < b; i++) {
+            job[i].work_us = work_us;
+            job[i].submit_us = now_us();
+            if (pool) {
+                task[i] = amthreadpool_task_submit(bench_job, &job[i], AMTHREADPOOL_PRIO_NORMAL);
+                failed += !task[i];
+            } else if (amthreadpool_pthread_create(&pid[i], NULL, bench_job, &job[i])) {
+                pid[i] = 0;
+                failed++;
+            }
+        }
+        for (i = 0; i < b; i++) {
+            if (pool && task[i]) {
+                amthreadpool_task_wait(task[i]);
+            } else if (!pool && pid[i]) {
+                amthreadpool_pthread_join(pid[i], NULL);
+            }
+            latency += job[i].start_us - job[i].submit_us;
+        }
+        done += b;
+    }
+    s = (now_us() - t0) / 1e6;
+    printf("%-6s %d jobs of %dus in %.3fs  %9.1f jobs/s  dispatch %.1fus%s\n",
+           pool ? "pool" : "thread", n, work_us, s, s > 0 ? n / s : 0.0,
+           (double)latency / n, failed ? "  (submit failures)" : "");
+}
+
+static void bench_lookup(int threads)
+{
+    pthread_t *pid = calloc(threads, sizeof(pthread_t));
+    int64_t t0;
+    int i, started = 0, loops = 1000000, hits = 0;
+
+    if (!pid) {
+        return;
+    }
+    idle_exit = 0;
+    for (i = 0; i < threads; i++) {
+        started += !amthreadpool_pthread_create(&pid[i], NULL, bench_idle, NULL);
+    }
+    t0 = now_us();
+    for (i = 0; i < loops; i++) {
+        hits += amthreadpool_on_requare_exit(0);
+    }
+    printf("on_requare_exit with %d threads registered: %.1fns/call\n",
+           started, (now_us() - t0) * 1000.0 / loops);
+    idle_exit = 1;
+    for (i = 0; i < started; i++) {
+        amthreadpool_pthread_join(pid[i], NULL);
+    }
+    free(pid);
+}
+
+int main(int argc, char **argv)
+{
+    amthreadpool_task_stats_t stats;
+    int n = 20000, work_us = 50, batch = 8, workers = 0, threads = 200, opt;
+
+    while ((opt = getopt(argc, argv, "n:w:b:j:t:")) != -1) {
+        switch (opt) {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 'w':
+            work_us = atoi(optarg);
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'j':
+            workers = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        default:
+            printf("usage: %s [-n jobs] [-w work_us] [-b batch] [-j workers] [-t threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n <= 0 || batch <= 0 || batch > MAX_BATCH) {
+        return 1;
+    }
+    amthreadpool_system_init();
+    if (amthreadpool_task_pool_init(workers) < 0) {
+        printf("task pool start failed\n");
+        return 1;
+    }
+    bench_mode(0, n, work_us, batch);
+    bench_mode(1, n, work_us, batch);
+    amthreadpool_task_get_stats(&stats);
+    printf("pool: %d workers, %u submitted, %u completed, %u stolen\n",
+           stats.workers, stats.submitted, stats.completed, stats.stolen);
+    bench_lookup(threads);
+    return 0;
+}
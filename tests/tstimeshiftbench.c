@@ -0,0 +1,163 @@
+/**
+ * \file tstimeshiftbench.c
+ * \brief  Ingest throughput and seek latency of the TsPlayer timeshift ring
+ *
+ * Replays a TS file (looped -l times) into the timeshift ring of
+ * examples/TsPlayer (ts_timeshift.c) as fast as possible while a reader
+ * thread follows the live edge, and reports the sustained write rate. Then
+ * seeks to random points of the recorded window and reports the latency of
+ * the index lookup plus the first read from the new position.
+ *
+ * usage: tstimeshiftbench [-o ring_file] [-s ring_mb] [-p video_pid] [-v h264|mpeg2|hevc]
+ *                         [-l loops] [-n seeks] input.ts
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <amports/vformat.h>
+#include "ts_timeshift.h"
+
+#define BENCH_MAX_SEEKS     4096
+#define BENCH_CHUNK         (188 * 7 * 10)
+#define BENCH_READ_SIZE     (64 * 1024)
+
+static volatile int bench_quit = 0;
+static int64_t bench_read_bytes = 0;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static void print_percentiles(const char *name, int *v, int n)
+{
+    if (n <= 0) {
+        printf("%-18s no samples\n", name);
+        return;
+    }
+    qsort(v, n, sizeof(int), cmp_int);
+    printf("%-18s p50 %d p95 %d p99 %d max %d us (%d samples)\n", name,
+           v[n / 2], v[n * 95 / 100], v[n * 99 / 100], v[n - 1], n);
+}
+
+static void *bench_live_reader(void *arg)
+{
+    ts_timeshift_t *ts = arg;
+    unsigned char *buf = malloc(BENCH_READ_SIZE);
+    int ret;
+
+    while (!bench_quit && buf) {
+        ret = ts_timeshift_read(ts, buf, BENCH_READ_SIZE);
+        if (ret > 0) {
+            bench_read_bytes += ret;
+        } else {
+            usleep(1000);
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static int seek_lat[BENCH_MAX_SEEKS];
+    const char *ring = "/data/tstimeshift.ring";
+    int ring_mb = 512, pid = 0x100, vformat = VFORMAT_H264, loops = 1, seeks = 200;
+    int opt, i, n = 0, len, depth;
+    unsigned char chunk[BENCH_CHUNK], *buf;
+    int64_t t0, written = 0, us;
+    ts_timeshift_t *ts;
+    pthread_t tid;
+    FILE *fp;
+
+    while ((opt = getopt(argc, argv, "o:s:p:v:l:n:")) != -1) {
+        switch (opt) {
+        case 'o':
+            ring = optarg;
+            break;
+        case 's':
+            ring_mb = atoi(optarg);
+            break;
+        case 'p':
+            pid = strtol(optarg, NULL, 0);
+            break;
+        case 'v':
+            vformat = !strcmp(optarg, "mpeg2") ? VFORMAT_MPEG12 :
+                      !strcmp(optarg, "hevc") ? VFORMAT_HEVC : VFORMAT_H264;
+            break;
+        case 'l':
+            loops = atoi(optarg);
+            break;
+        case 'n':
+            seeks = atoi(optarg);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind >= argc) {
+        printf("usage: %s [-o ring_file] [-s ring_mb] [-p video_pid] [-v h264|mpeg2|hevc] [-l loops] [-n seeks] input.ts\n", argv[0]);
+        return 1;
+    }
+    if (seeks > BENCH_MAX_SEEKS) {
+        seeks = BENCH_MAX_SEEKS;
+    }
+    fp = fopen(argv[optind], "rb");
+    ts = ts_timeshift_open(ring, (int64_t)ring_mb << 20, pid, vformat);
+    if (!fp || !ts) {
+        printf("can't open %s or ring %s\n", argv[optind], ring);
+        return 1;
+    }
+
+    pthread_create(&tid, NULL, bench_live_reader, ts);
+    t0 = now_us();
+    for (i = 0; i < loops; i++) {
+        fseek(fp, 0, SEEK_SET);
+        while ((len = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+            ts_timeshift_write(ts, chunk, len);
+            written += len;
+        }
+    }
+    us = now_us() - t0;
+    bench_quit = 1;
+    pthread_join(tid, NULL);
+    depth = ts_timeshift_get_depth(ts);
+    printf("ingest %lld MB in %lld ms, %.1f MB/s, live reader got %lld MB\n",
+           (long long)(written >> 20), (long long)(us / 1000),
+           us > 0 ? written / (double)us : 0.0, (long long)(bench_read_bytes >> 20));
+    printf("ring holds %d ms\n", depth);
+
+    buf = malloc(BENCH_READ_SIZE);
+    srand(1);
+    for (i = 0; i < seeks && depth > 0 && buf; i++) {
+        int back = (int)((double)rand() / RAND_MAX * depth);
+        t0 = now_us();
+        if (ts_timeshift_seek(ts, back) != 0) {
+            continue;
+        }
+        if (ts_timeshift_read(ts, buf, BENCH_READ_SIZE) <= 0) {
+            continue;
+        }
+        seek_lat[n++] = (int)(now_us() - t0);
+    }
+    print_percentiles("seek+read", seek_lat, n);
+    free(buf);
+    ts_timeshift_close(ts);
+    fclose(fp);
+    return 0;
+}
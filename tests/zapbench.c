@@ -0,0 +1,193 @@
+/**
+ * \file zapbench.c
+ * \brief  Channel change time, table acquisition first vs fast zap
+ *
+ * Zaps round robin through the services of a channel database with
+ * aml_dvb_zap() (dvbplayer/dvb/dvb.c), first acquiring PAT/PMT before the
+ * decoders start, then in fast mode (decoders started on the cached pids
+ * while the tables are acquired). Meant to run against a multiplex replayed
+ * into the tuner by a modulator, so every run sees the same tables and
+ * timing. The zap time is from the aml_dvb_zap() call to the next frame
+ * counted by /sys/module/amvideo/parameters/new_frame_count.
+ *
+ * -s scans the frequencies of the dvb param file and writes the channel
+ * database first; -x points the cached pids of every other service at a
+ * wrong PID to exercise the correction path.
+ *
+ * usage: zapbench -p dvb_param_file -d channel_db [-s] [-x] [-n zaps]
+ */
+/* Copyright (C) 2007-2011, Amlogic Inc.
+ * All right reserved
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "dvb.h"
+#include "am_chmgr.h"
+
+#define FRAME_COUNT_FILE    "/sys/module/amvideo/parameters/new_frame_count"
+#define FRAME_TIMEOUT_MS    10000
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int frame_count(void)
+{
+    char buf[32];
+    int n = -1;
+    FILE *fp = fopen(FRAME_COUNT_FILE, "r");
+
+    if (fp) {
+        if (fgets(buf, sizeof(buf), fp)) {
+            n = atoi(buf);
+        }
+        fclose(fp);
+    }
+    return n;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static int bench_scan(aml_dvb_init_param_t *init, const char *db_path)
+{
+    aml_dvb_param_t parm;
+    int i;
+
+    for (i = 0; i < init->freq_numbers; i++) {
+        memset(&parm, 0, sizeof(parm));
+        parm.freq = init->freq_list[i];
+        parm.symbol_rate = init->symbol_rate;
+        parm.qam = init->qam;
+        if (aml_dvb_start_section(parm) < 0) {
+            printf("no tables at %d\n", parm.freq);
+        }
+    }
+    return aml_dvb_store_channel_db(db_path);
+}
+
+static void bench_mode(aml_dvb_db_t *db, int fast, int zaps, int break_pids)
+{
+    aml_dvb_db_channel_t ch;
+    aml_dvb_zap_info_t info;
+    int *zap_ms = malloc(zaps * sizeof(int));
+    int i, n = 0, timeouts = 0, corrected = 0, count = aml_dvb_db_count(db);
+    int64_t av_sum = 0, table_sum = 0;
+    int table_n = 0;
+
+    if (!zap_ms || !count) {
+        free(zap_ms);
+        return;
+    }
+    for (i = 0; i < zaps; i++) {
+        int frames;
+        int64_t t0, t;
+
+        ch = *aml_dvb_db_get(db, i % count);
+        if (break_pids && (i & 1)) {
+            ch.v_pid = 0x1ffe;
+        }
+        frames = frame_count();
+        t0 = now_ms();
+        if (aml_dvb_zap(&ch, fast) < 0) {
+            printf("zap to 0x%x failed\n", ch.service_id);
+            continue;
+        }
+        while ((t = now_ms()) - t0 < FRAME_TIMEOUT_MS && frame_count() == frames) {
+            usleep(2000);
+        }
+        if (t - t0 >= FRAME_TIMEOUT_MS) {
+            timeouts++;
+            continue;
+        }
+        zap_ms[n++] = (int)(t - t0);
+        /* let the tables of the fast zap come in before reading the info */
+        usleep(500 * 1000);
+        aml_dvb_get_zap_info(&info);
+        av_sum += info.av_ms;
+        if (info.table_ms >= 0) {
+            table_sum += info.table_ms;
+            table_n++;
+        }
+        corrected += info.corrected;
+    }
+    aml_dvb_stop();
+    if (!n) {
+        printf("%-6s no frames (%d timeouts)\n", fast ? "fast" : "normal", timeouts);
+        free(zap_ms);
+        return;
+    }
+    qsort(zap_ms, n, sizeof(int), cmp_int);
+    printf("%-6s %d zaps: first frame p50 %dms p90 %dms max %dms, decoders started %.0fms, "
+           "tables %.0fms, corrected %d, timeouts %d\n",
+           fast ? "fast" : "normal", n, zap_ms[n / 2], zap_ms[n * 9 / 10], zap_ms[n - 1],
+           (double)av_sum / n, table_n ? (double)table_sum / table_n : -1.0, corrected, timeouts);
+    free(zap_ms);
+}
+
+int main(int argc, char **argv)
+{
+    aml_dvb_init_param_t init;
+    const char *param_path = NULL, *db_path = NULL;
+    int opt, scan = 0, break_pids = 0, zaps = 40;
+    aml_dvb_db_t *db;
+
+    while ((opt = getopt(argc, argv, "p:d:sxn:")) != -1) {
+        switch (opt) {
+        case 'p':
+            param_path = optarg;
+            break;
+        case 'd':
+            db_path = optarg;
+            break;
+        case 's':
+            scan = 1;
+            break;
+        case 'x':
+            break_pids = 1;
+            break;
+        case 'n':
+            zaps = atoi(optarg);
+            break;
+        default:
+            param_path = NULL;
+            break;
+        }
+    }
+    if (!param_path || !db_path || zaps <= 0) {
+        printf("usage: %s -p dvb_param_file -d channel_db [-s] [-x] [-n zaps]\n", argv[0]);
+        return 1;
+    }
+    memset(&init, 0, sizeof(init));
+    if (aml_load_dvb_param(param_path, &init) < 0 || aml_dvb_init(init) < 0) {
+        printf("dvb init from %s failed\n", param_path);
+        return 1;
+    }
+    if (scan && bench_scan(&init, db_path) < 0) {
+        printf("scan failed\n");
+        aml_dvb_deinit();
+        return 1;
+    }
+    db = aml_dvb_db_open(db_path);
+    if (!db || !aml_dvb_db_count(db)) {
+        printf("no services in %s\n", db_path);
+        aml_dvb_deinit();
+        return 1;
+    }
+    printf("%d services, %d zaps per mode\n", aml_dvb_db_count(db), zaps);
+    bench_mode(db, 0, zaps, break_pids);
+    bench_mode(db, 1, zaps, break_pids);
+    aml_dvb_db_close(db);
+    aml_dvb_deinit();
+    free(init.freq_list);
+    return 0;
+}
@@ -0,0 +1,370 @@
+/******
+*  description: shared event driven curl multi engine for all download sessions
+******/
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include "curl_engine.h"
+#include "curl_log.h"
+
+#define CURL_ENGINE_MAX_EVENTS  32
+#define CURL_ENGINE_IDLE_WAIT   1000    // ms, epoll wait without curl timer
+
+#define C_ENGINE_CMD_ADD        1
+#define C_ENGINE_CMD_REMOVE     2
+#define C_ENGINE_CMD_RESUME     4
+
+typedef struct _CurlEngine {
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t share_lock[CURL_LOCK_DATA_LAST];
+    CURLM * multi;
+    CURLSH * share;
+    int epfd;
+    int wakefd[2];
+    int64_t deadline;       // us, -1 for no curl timer
+    int running;
+    CURLWHandle * pending;  // handles with engine_cmd set, linked by engine_next
+} CurlEngine;
+
+static CurlEngine engine;
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
+static int engine_ok = 0;
+
+static int64_t curl_engine_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void curl_engine_share_lock(CURL * curl, curl_lock_data data, curl_lock_access access, void * userp)
+{
+    if (data >= 0 && data < CURL_LOCK_DATA_LAST) {
+        pthread_mutex_lock(&engine.share_lock[data]);
+    }
+}
+
+static void curl_engine_share_unlock(CURL * curl, curl_lock_data data, void * userp)
+{
+    if (data >= 0 && data < CURL_LOCK_DATA_LAST) {
+        pthread_mutex_unlock(&engine.share_lock[data]);
+    }
+}
+
+static int curl_engine_socket_cb(CURL * curl, curl_socket_t s, int what, void * userp, void * socketp)
+{
+    struct epoll_event ev;
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(engine.epfd, EPOLL_CTL_DEL, s, NULL);
+        return 0;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) | ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+    ev.data.fd = s;
+    if (epoll_ctl(engine.epfd, EPOLL_CTL_MOD, s, &ev) < 0 && errno == ENOENT) {
+        epoll_ctl(engine.epfd, EPOLL_CTL_ADD, s, &ev);
+    }
+    return 0;
+}
+
+static int curl_engine_timer_cb(CURLM * multi, long timeout_ms, void * userp)
+{
+    engine.deadline = timeout_ms < 0 ? -1 : curl_engine_now() + (int64_t)timeout_ms * 1000;
+    return 0;
+}
+
+static void curl_engine_wakeup(void)
+{
+    char c = 1;
+    int ret;
+    do {
+        ret = write(engine.wakefd[1], &c, 1);
+    } while (ret < 0 && errno == EINTR);
+}
+
+/* run the queued add/remove/resume requests, engine thread only */
+static void curl_engine_run_cmds(void)
+{
+    CURLWHandle * h;
+    CURLWHandle * list;
+    int cmd, state, result;
+
+    pthread_mutex_lock(&engine.lock);
+    list = engine.pending;
+    engine.pending = NULL;
+    pthread_mutex_unlock(&engine.lock);
+
+    while (list) {
+        h = list;
+        pthread_mutex_lock(&engine.lock);
+        list = h->engine_next;
+        h->engine_next = NULL;
+        cmd = h->engine_cmd;
+        state = h->engine_state;
+        result = h->engine_result;
+        pthread_mutex_unlock(&engine.lock);
+
+        if ((cmd & C_ENGINE_CMD_REMOVE) && state == C_ENGINE_RUNNING) {
+            curl_multi_remove_handle(engine.multi, h->curl);
+            state = C_ENGINE_IDLE;
+            engine.running--;
+        }
+        if ((cmd & C_ENGINE_CMD_ADD) && state != C_ENGINE_RUNNING) {
+            curl_easy_setopt(h->curl, CURLOPT_PRIVATE, (void *)h);
+            result = CURLE_OK;
+            if (curl_multi_add_handle(engine.multi, h->curl) == CURLM_OK) {
+                state = C_ENGINE_RUNNING;
+                engine.running++;
+            } else {
+                CLOGE("curl_engine add handle failed\n");
+                result = CURLE_FAILED_INIT;
+                state = C_ENGINE_DONE;
+            }
+        }
+        if ((cmd & C_ENGINE_CMD_RESUME) && state == C_ENGINE_RUNNING) {
+            /* may call the write callback at once, which may pause again */
+            result = curl_easy_pause(h->curl, CURLPAUSE_CONT);
+            if (result != CURLE_OK) {
+                /* failed by the write callback, it does not come back as a done message */
+                curl_multi_remove_handle(engine.multi, h->curl);
+                state = C_ENGINE_DONE;
+                engine.running--;
+            }
+        }
+
+        pthread_mutex_lock(&engine.lock);
+        h->engine_state = state;
+        h->engine_result = result;
+        /* a request queued again meanwhile keeps its new bits */
+        h->engine_cmd &= ~cmd;
+        if (h->engine_cmd && !h->engine_next) {
+            h->engine_next = engine.pending;
+            engine.pending = h;
+        }
+        pthread_cond_broadcast(&engine.cond);
+        pthread_mutex_unlock(&engine.lock);
+    }
+}
+
+static void curl_engine_read_done(void)
+{
+    CURLMsg * msg;
+    int msgs_left;
+    CURLWHandle * h;
+
+    while ((msg = curl_multi_info_read(engine.multi, &msgs_left))) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        h = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&h);
+        curl_multi_remove_handle(engine.multi, msg->easy_handle);
+        if (!h) {
+            continue;
+        }
+        pthread_mutex_lock(&engine.lock);
+        h->engine_result = msg->data.result;
+        h->engine_state = C_ENGINE_DONE;
+        engine.running--;
+        pthread_cond_broadcast(&engine.cond);
+        pthread_mutex_unlock(&engine.lock);
+    }
+}
+
+static void * curl_engine_thread_run(void * arg)
+{
+    struct epoll_event evs[CURL_ENGINE_MAX_EVENTS];
+    int i, n, wait, still_running;
+    char drain[64];
+    int64_t now;
+
+    CLOGI("curl_engine_thread_run enter\n");
+    for (;;) {
+        wait = CURL_ENGINE_IDLE_WAIT;
+        if (engine.deadline >= 0) {
+            now = curl_engine_now();
+            wait = engine.deadline <= now ? 0 : (int)CURLMIN((engine.deadline - now + 999) / 1000, CURL_ENGINE_IDLE_WAIT);
+        }
+        n = epoll_wait(engine.epfd, evs, CURL_ENGINE_MAX_EVENTS, wait);
+        for (i = 0; i < n; i++) {
+            if (evs[i].data.fd == engine.wakefd[0]) {
+                while (read(engine.wakefd[0], drain, sizeof(drain)) > 0);
+                continue;
+            }
+            int mask = 0;
+            if (evs[i].events & EPOLLIN) {
+                mask |= CURL_CSELECT_IN;
+            }
+            if (evs[i].events & EPOLLOUT) {
+                mask |= CURL_CSELECT_OUT;
+            }
+            if (evs[i].events & (EPOLLERR | EPOLLHUP)) {
+                mask |= CURL_CSELECT_ERR;
+            }
+            curl_multi_socket_action(engine.multi, evs[i].data.fd, mask, &still_running);
+        }
+        curl_engine_run_cmds();
+        if (engine.deadline >= 0 && engine.deadline <= curl_engine_now()) {
+            engine.deadline = -1;
+            curl_multi_socket_action(engine.multi, CURL_SOCKET_TIMEOUT, 0, &still_running);
+        }
+        curl_engine_read_done();
+    }
+    return NULL;
+}
+
+static void curl_engine_init(void)
+{
+    struct epoll_event ev;
+    int i;
+
+    memset(&engine, 0, sizeof(engine));
+    engine.deadline = -1;
+    engine.wakefd[0] = engine.wakefd[1] = -1;
+    pthread_mutex_init(&engine.lock, NULL);
+    pthread_cond_init(&engine.cond, NULL);
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&engine.share_lock[i], NULL);
+    }
+
+    engine.share = curl_share_init();
+    if (engine.share) {
+        curl_share_setopt(engine.share, CURLSHOPT_LOCKFUNC, curl_engine_share_lock);
+        curl_share_setopt(engine.share, CURLSHOPT_UNLOCKFUNC, curl_engine_share_unlock);
+        curl_share_setopt(engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        /* keep-alive connections are reused by the one shot easy requests too */
+        curl_share_setopt(engine.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+
+    engine.multi = curl_multi_init();
+    engine.epfd = epoll_create(CURL_ENGINE_MAX_EVENTS);
+    if (!engine.multi || engine.epfd < 0 || pipe(engine.wakefd) < 0) {
+        CLOGE("curl_engine init failed\n");
+        return;
+    }
+    fcntl(engine.wakefd[0], F_SETFL, O_NONBLOCK);
+    fcntl(engine.wakefd[1], F_SETFL, O_NONBLOCK);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = engine.wakefd[0];
+    epoll_ctl(engine.epfd, EPOLL_CTL_ADD, engine.wakefd[0], &ev);
+
+    curl_multi_setopt(engine.multi, CURLMOPT_SOCKETFUNCTION, curl_engine_socket_cb);
+    curl_multi_setopt(engine.multi, CURLMOPT_TIMERFUNCTION, curl_engine_timer_cb);
+
+    if (pthread_create(&engine.tid, NULL, curl_engine_thread_run, NULL)) {
+        CLOGE("curl_engine thread create failed\n");
+        return;
+    }
+    engine_ok = 1;
+}
+
+static int curl_engine_get(void)
+{
+    pthread_once(&engine_once, curl_engine_init);
+    return engine_ok;
+}
+
+/* engine.lock held */
+static void curl_engine_queue(CURLWHandle * h, int cmd)
+{
+    if (!h->engine_cmd && !h->engine_next) {
+        h->engine_next = engine.pending;
+        engine.pending = h;
+    }
+    h->engine_cmd |= cmd;
+}
+
+void curl_engine_share(CURL * curl)
+{
+    if (curl_engine_get() && engine.share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, engine.share);
+    }
+}
+
+int curl_engine_add(CURLWHandle * h)
+{
+    if (!h || !h->curl || !curl_engine_get()) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine.lock);
+    curl_engine_queue(h, C_ENGINE_CMD_ADD);
+    pthread_mutex_unlock(&engine.lock);
+    curl_engine_wakeup();
+    return 0;
+}
+
+int curl_engine_remove(CURLWHandle * h)
+{
+    struct timespec timeout;
+    int64_t start;
+
+    if (!h || !engine_ok) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine.lock);
+    if (h->engine_state != C_ENGINE_RUNNING && !h->engine_cmd) {
+        pthread_mutex_unlock(&engine.lock);
+        return 0;
+    }
+    h->engine_cmd &= ~(C_ENGINE_CMD_ADD | C_ENGINE_CMD_RESUME);
+    curl_engine_queue(h, C_ENGINE_CMD_REMOVE);
+    curl_engine_wakeup();
+    start = curl_engine_now();
+    while (h->engine_state == C_ENGINE_RUNNING || h->engine_cmd) {
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += 1;
+        if (pthread_cond_timedwait(&engine.cond, &engine.lock, &timeout) == ETIMEDOUT) {
+            CLOGI("curl_engine_remove waiting %lld ms\n", (long long)((curl_engine_now() - start) / 1000));
+        }
+    }
+    pthread_mutex_unlock(&engine.lock);
+    return 0;
+}
+
+int curl_engine_resume(CURLWHandle * h)
+{
+    if (!h || !engine_ok) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine.lock);
+    if (h->engine_state != C_ENGINE_RUNNING || (h->engine_cmd & C_ENGINE_CMD_RESUME)) {
+        pthread_mutex_unlock(&engine.lock);
+        return 0;
+    }
+    curl_engine_queue(h, C_ENGINE_CMD_RESUME);
+    pthread_mutex_unlock(&engine.lock);
+    curl_engine_wakeup();
+    return 0;
+}
+
+int curl_engine_busy(CURLWHandle * h)
+{
+    int busy;
+    pthread_mutex_lock(&engine.lock);
+    busy = h->engine_state == C_ENGINE_RUNNING || (h->engine_cmd & C_ENGINE_CMD_ADD);
+    pthread_mutex_unlock(&engine.lock);
+    return busy;
+}
+
+void curl_engine_wait(int ms)
+{
+    struct timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_sec += ms / 1000;
+    timeout.tv_nsec += (ms % 1000) * 1000000;
+    if (timeout.tv_nsec >= 1000000000) {
+        timeout.tv_sec++;
+        timeout.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&engine.lock);
+    pthread_cond_timedwait(&engine.cond, &engine.lock, &timeout);
+    pthread_mutex_unlock(&engine.lock);
+}
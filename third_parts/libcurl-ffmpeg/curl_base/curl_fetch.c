@@ -175,6 +175,7 @@ int curl_fetch_open(CFContext * h)
         if(h->interrupt) {
             if((*(h->interrupt))()) {
                 CLOGE("***** CURL INTERRUPTED *****");
+                curl_wrapper_abort(h->cwh_h);
                 return -1;  // consider for seek interrupt
             }
         }
@@ -286,6 +287,7 @@ int curl_fetch_http_keepalive_open(CFContext * h, const char * uri)
         if(h->interrupt) {
             if((*(h->interrupt))()) {
                 CLOGE("***** CURL INTERRUPTED *****");
+                curl_wrapper_abort(h->cwh_h);
                 return -1;  // consider for seek interrupt
             }
         }
@@ -395,7 +397,7 @@ int curl_fetch_read(CFContext * h, char * buf, int size)
     if (avail) {
         size = CURLMIN(avail, size);
         curl_fifo_generic_read(h->cwh_h->cfifo, buf, size, NULL);
-        pthread_cond_signal(&h->cwh_h->pthread_cond);
+        curl_wrapper_fifo_drained(h->cwh_h);
         pthread_mutex_unlock(&h->cwh_h->fifo_mutex);
         return size;
     } else if (h->thread_quited) {
@@ -570,18 +572,16 @@ int curl_fetch_get_info(CFContext * h, curl_info cmd, uint32_t flag, void * info
     return -1;
 }
 
-#if 0
+/* the caller was interrupted, stop the transfer on the engine thread too */
 int curl_fetch_interrupt(CFContext * h)
 {
     CLOGI("***** curl_fetch_interrupt *****\n");
     if(!h || !h->cwh_h) {
         return -1;
     }
-    h->cwh_h->open_quited = 1;
-    //pthread_cond_signal(&h->cwh_h->info_cond);
+    curl_wrapper_abort(h->cwh_h);
     return 0;
 }
-#endif
 
 void curl_fetch_register_interrupt(CFContext * h, interruptcallback pfunc)
 {
@@ -5,9 +5,12 @@
 ******/
 
 #include "curl_wrapper.h"
+#include "curl_engine.h"
 #include "curl_log.h"
 
 #define CURL_FIFO_BUFFER_SIZE 2*1024*1024
+/* free fifo room before a paused transfer is resumed */
+#define CURL_FIFO_RESUME_SPACE 256*1024
 
 static int curl_wrapper_open_cnx(CURLWContext *con, CURLWHandle *h, Curl_Data *buf, curl_prot_type flags, int64_t off);
 
@@ -104,6 +107,10 @@ static size_t write_response(void *ptr, size_t size, size_t nmemb, void *data)
     return realsize;
 }
 
+/*
+*   runs on the engine thread, never blocks: when the fifo has no room the
+*   transfer is paused and the reader resumes it in curl_wrapper_fifo_drained.
+*/
 static size_t curl_dl_chunkdata_callback(void *ptr, size_t size, size_t nmemb, void *data)
 {
     size_t realsize = size * nmemb;
@@ -116,67 +123,56 @@ static size_t curl_dl_chunkdata_callback(void *ptr, size_t size, size_t nmemb, v
         CLOGI("curl_dl_chunkdata_callback quited\n");
         return -1;
     }
+    /* the interrupt callback knows the player threads only, not this one */
+    if (mem->handle->aborted) {
+        CLOGI("curl_dl_chunkdata_callback interrupted\n");
+        return -1;
+    }
     pthread_mutex_lock(&mem->handle->fifo_mutex);
-    int left = curl_fifo_space(mem->handle->cfifo);
-    //left = CURLMIN(left, mem->handle->cfifo->end - mem->handle->cfifo->wptr);
-    //if(mem->handle->cfifo->wptr + realsize >= mem->handle->cfifo->end && mem->handle->cfifo->buffer + realsize < mem->handle->cfifo->rptr) {
-    //  mem->handle->cfifo->wptr = mem->handle->cfifo->buffer;
-    //}
-
-    struct timeval now;
-    struct timespec timeout;
-    int retcode = 0;
-    gettimeofday(&now, NULL);
-    timeout.tv_sec = now.tv_sec + (5000000 + now.tv_usec) / 1000000;
-    timeout.tv_nsec = now.tv_usec * 1000;
-    while ((left <= 0 || left < realsize) && retcode != ETIMEDOUT) {
-        if (mem->handle->quited) {
-            CLOGI("curl_dl_chunkdata_callback quited\n");
-            pthread_mutex_unlock(&mem->handle->fifo_mutex);
-            return -1;
-        }
-        if(mem->handle->interrupt) {
-            if((*(mem->handle->interrupt))()) {
-                CLOGI("curl_dl_chunkdata_callback interrupted\n");
-                return -1;
-            }
-        }
-        retcode = pthread_cond_timedwait(&mem->handle->pthread_cond, &mem->handle->fifo_mutex, &timeout);
-        if (retcode == ETIMEDOUT && mem->handle->quited) {
-            CLOGI("curl_dl_chunkdata_callback wait for fifo too long, left=%d, realsize=%d\n", left, realsize);
-            pthread_mutex_unlock(&mem->handle->fifo_mutex);
-            return -1;
-        }
-        left = curl_fifo_space(mem->handle->cfifo);
-        //left = CURLMIN(left, mem->handle->cfifo->end - mem->handle->cfifo->wptr);
-    }
-    if (mem->handle->cfifo->wptr + realsize >= mem->handle->cfifo->end) {
-        int preval = mem->handle->cfifo->wptr + realsize - mem->handle->cfifo->end;
-        if (mem->handle->cfifo->buffer + preval >= mem->handle->cfifo->rptr) {
-            retcode = pthread_cond_timedwait(&mem->handle->pthread_cond, &mem->handle->fifo_mutex, &timeout);
-            if (retcode == ETIMEDOUT) {
-                CLOGI("curl_dl_chunkdata_callback fifo not enough\n");
-                pthread_mutex_unlock(&mem->handle->fifo_mutex);
-                return -1;
-            }
-        }
-        memcpy(mem->handle->cfifo->wptr, ptr, realsize - preval);
-        mem->handle->cfifo->wptr = mem->handle->cfifo->buffer;
-        if (preval) {
-            memcpy(mem->handle->cfifo->wptr, ptr + realsize - preval, preval);
-            mem->handle->cfifo->wptr += preval;
-        }
-        mem->handle->cfifo->wndx += realsize;
-    } else {
-        memcpy(mem->handle->cfifo->wptr, ptr, realsize);
-        mem->handle->cfifo->wptr += realsize;
-        mem->handle->cfifo->wndx += realsize;
+    if (curl_fifo_space(mem->handle->cfifo) < (int)realsize) {
+        mem->handle->paused = 1;
+        mem->handle->paused_size = realsize;
+        pthread_mutex_unlock(&mem->handle->fifo_mutex);
+        return CURL_WRITEFUNC_PAUSE;
     }
+    curl_fifo_generic_write(mem->handle->cfifo, ptr, realsize, NULL);
     pthread_mutex_unlock(&mem->handle->fifo_mutex);
     mem->size += realsize;
     return realsize;
 }
 
+/*
+*   called from the interrupted thread, the engine thread fails the transfer
+*   at its next write callback; a paused one is resumed to get there.
+*   open and seek clear it.
+*/
+void curl_wrapper_abort(CURLWHandle *h)
+{
+    if (!h) {
+        return;
+    }
+    pthread_mutex_lock(&h->fifo_mutex);
+    h->aborted = 1;
+    if (h->paused) {
+        h->paused = 0;
+        curl_engine_resume(h);
+    }
+    pthread_mutex_unlock(&h->fifo_mutex);
+}
+
+/* fifo_mutex held by the reader */
+int curl_wrapper_fifo_drained(CURLWHandle *h)
+{
+    if (!h || !h->paused) {
+        return 0;
+    }
+    if (curl_fifo_space(h->cfifo) < CURLMAX(h->paused_size, CURL_FIFO_RESUME_SPACE)) {
+        return 0;
+    }
+    h->paused = 0;
+    return curl_engine_resume(h);
+}
+
 static int curl_wrapper_add_curl_handle(CURLWContext *con, CURLWHandle *h)
 {
     int ret = -1;
@@ -235,7 +231,6 @@ static int curl_wrapper_del_curl_handle(CURLWContext *con, CURLWHandle *h)
     }
     pthread_mutex_destroy(&h->fifo_mutex);
     pthread_mutex_destroy(&h->info_mutex);
-    pthread_cond_destroy(&h->pthread_cond);
     pthread_cond_destroy(&h->info_cond);
     if (h->curl) {
         curl_easy_cleanup(h->curl);
@@ -277,7 +272,6 @@ static int curl_wrapper_del_all_curl_handle(CURLWContext *con)
         }
         pthread_mutex_destroy(&tmp_p->fifo_mutex);
         pthread_mutex_destroy(&tmp_p->info_mutex);
-        pthread_cond_destroy(&tmp_p->pthread_cond);
         pthread_cond_destroy(&tmp_p->info_cond);
         if (tmp_p->curl) {
             curl_easy_cleanup(tmp_p->curl);
@@ -434,11 +428,7 @@ CURLWContext * curl_wrapper_init(int flags)
         CLOGE("Failed to allocate memory for CURLWContext handle\n");
         return NULL;
     }
-    handle->multi_curl = curl_multi_init();
-    if (!handle->multi_curl) {
-        CLOGE("CURLWContext multi_curl init failed\n");
-        return NULL;
-    }
+    handle->quited = 0;
     handle->interrupt = NULL;
     handle->curl_h_num = 0;
     handle->curl_handle = NULL;
@@ -463,6 +453,7 @@ CURLWHandle * curl_wrapper_open(CURLWContext *h, const char * uri, const char *
     }
     curl_h->infonotify = NULL;
     curl_h->interrupt = NULL;
+    curl_h->aborted = 0;
     if (curl_wrapper_add_curl_handle(h, curl_h) == -1) {
         return NULL;
     }
@@ -477,8 +468,13 @@ CURLWHandle * curl_wrapper_open(CURLWContext *h, const char * uri, const char *
     }
     pthread_mutex_init(&curl_h->fifo_mutex, NULL);
     pthread_mutex_init(&curl_h->info_mutex, NULL);
-    pthread_cond_init(&curl_h->pthread_cond, NULL);
     pthread_cond_init(&curl_h->info_cond, NULL);
+    curl_h->paused = 0;
+    curl_h->paused_size = 0;
+    curl_h->engine_state = C_ENGINE_IDLE;
+    curl_h->engine_cmd = 0;
+    curl_h->engine_result = CURLE_OK;
+    curl_h->engine_next = NULL;
     curl_h->relocation = NULL;
     curl_h->get_headers = NULL;
     curl_h->post_headers = NULL;
@@ -506,6 +502,7 @@ static int curl_wrapper_open_cnx(CURLWContext *con, CURLWHandle *h, Curl_Data *b
             CLOGE("CURLWHandle easy init failed\n");
             return ret;
         }
+        curl_engine_share(h->curl);
     }
     if (flags == C_PROT_HTTP || flags == C_PROT_HTTPS) {
         ret = curl_wrapper_easy_setopt_http_basic(h, buf);
@@ -521,10 +518,12 @@ static int curl_wrapper_open_cnx(CURLWContext *con, CURLWHandle *h, Curl_Data *b
     curl_wrapper_setopt_error(h, curl_easy_setopt(h->curl, CURLOPT_ACCEPT_ENCODING, "gzip"));
     con->quited = 0;
     h->quited = 0;
+    h->aborted = 0;
     h->open_quited = 0;
     h->seekable = 0;
     h->perform_error_code = 0;
     h->dl_speed = 0.0f;
+    h->paused = 0;
     buf->handle = h;
     buf->size = off ? off : 0;
     ret = 0;
@@ -541,6 +540,7 @@ int curl_wrapper_http_keepalive_open(CURLWContext *con, CURLWHandle *h, const ch
     }
     con->quited = 0;
     h->quited = 0;
+    h->aborted = 0;
     h->open_quited = 0;
     h->seekable = 0;
     h->perform_error_code = 0;
@@ -555,6 +555,10 @@ int curl_wrapper_http_keepalive_open(CURLWContext *con, CURLWHandle *h, const ch
     return ret;
 }
 
+/*
+*   hands the transfers of con to the shared engine and waits for them, the
+*   data goes to each handle fifo from the engine thread.
+*/
 int curl_wrapper_perform(CURLWContext *con)
 {
     CLOGI("curl_wrapper_perform enter\n");
@@ -562,16 +566,6 @@ int curl_wrapper_perform(CURLWContext *con)
         CLOGE("CURLWContext invalid\n");
         return C_ERROR_UNKNOW;
     }
-    if (!con->multi_curl) {
-        CLOGE("Invalid multi curl handle\n");
-        return C_ERROR_UNKNOW;
-    }
-    CURLWHandle * tmp_h = NULL;
-    for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
-        if (CURLM_OK != curl_multi_add_handle(con->multi_curl, tmp_h->curl)) {
-            return C_ERROR_UNKNOW;
-        }
-    }
 
     if(con->interrupt) {
         if((*(con->interrupt))()) {
@@ -580,21 +574,15 @@ int curl_wrapper_perform(CURLWContext *con)
         }
     }
 
-    long multi_timeout = 100;
-    int running_handle_cnt = 0;
-    curl_multi_timeout(con->multi_curl, &multi_timeout);
-    curl_multi_perform(con->multi_curl, &running_handle_cnt);
+    CURLWHandle * tmp_h = NULL;
+    for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
+        if (curl_engine_add(tmp_h)) {
+            return C_ERROR_UNKNOW;
+        }
+    }
 
+    int running_handle_cnt = 1;
     while (running_handle_cnt) {
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 200*1000;
-        int max_fd;
-
-        fd_set fd_read;
-        fd_set fd_write;
-        fd_set fd_except;
-
         if (con->quited) {
             CLOGI("curl_wrapper_perform quited when multi perform\n");
             break;
@@ -602,89 +590,56 @@ int curl_wrapper_perform(CURLWContext *con)
         if(con->interrupt) {
             if((*(con->interrupt))()) {
                 CLOGI("curl_wrapper_perform interrupted when multi perform\n");
+                for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
+                    curl_wrapper_abort(tmp_h);
+                }
                 break;
             }
         }
-
-        FD_ZERO(&fd_read);
-        FD_ZERO(&fd_write);
-        FD_ZERO(&fd_except);
-
-        curl_multi_fdset(con->multi_curl, &fd_read, &fd_write, &fd_except, &max_fd);
-        int rc = select(max_fd + 1, &fd_read, &fd_write, &fd_except, &tv);
-        switch (rc) {
-        case -1:
-            CLOGE("curl_wrapper_perform select error\n");
-            break;
-        case 0:
-        default:
-            while (CURLM_CALL_MULTI_PERFORM == curl_multi_perform(con->multi_curl, &running_handle_cnt)) {
-                CLOGI("curl_wrapper_perform runing_handle_count : %d \n", running_handle_cnt);
-            }
-            break;
+        running_handle_cnt = 0;
+        for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
+            running_handle_cnt += curl_engine_busy(tmp_h);
+        }
+        if (running_handle_cnt) {
+            curl_engine_wait(200);
         }
     }
 
-    int msgs_left;
-    CURLMsg *msg;
     CURLcode retcode;
     curl_error_code ret = C_ERROR_OK;
-    while ((msg = curl_multi_info_read(con->multi_curl, &msgs_left))) {
-        if (msg->msg == CURLMSG_DONE) {
-            int found = 0;
-            for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
-                found = (msg->easy_handle == tmp_h->curl);
-                if (found) {
-                    break;
-                }
-            }
-            if (!tmp_h) {
-                CLOGI("curl_multi_info_read curl not found\n");
-            } else {
-                CLOGI("[perform done]: completed with status: [%d]\n", msg->data.result);
-                if(CURLE_OK != msg->data.result) {
-                    tmp_h->perform_error_code = CURLERROR(msg->data.result + C_ERROR_PERFORM_BASE_ERROR);
-                    ret = tmp_h->perform_error_code;
-                }
-
-                if(CURLE_RECV_ERROR == msg->data.result
-                || CURLE_COULDNT_CONNECT == msg->data.result) {
-                    tmp_h->open_quited = 1;
-                }
+    for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
+        if (running_handle_cnt) {
+            /* quited or interrupted, stop the transfer before returning */
+            curl_engine_remove(tmp_h);
+            continue;
+        }
+        if (tmp_h->engine_state != C_ENGINE_DONE) {
+            continue;
+        }
+        CLOGI("[perform done]: completed with status: [%d]\n", tmp_h->engine_result);
+        if(CURLE_OK != tmp_h->engine_result) {
+            tmp_h->perform_error_code = CURLERROR(tmp_h->engine_result + C_ERROR_PERFORM_BASE_ERROR);
+            ret = tmp_h->perform_error_code;
+        }
 
-#if 1
-                long arg = 0;
-                char * argc = NULL;
-                retcode = curl_wrapper_get_info(tmp_h, C_INFO_RESPONSE_CODE, 0, &arg);
-                if (CURLE_OK == retcode) {
-                    CLOGI("[perform done]: response_code: [%ld]\n", arg);
-                }
-                /*
-                if (404 == arg) {
-                    ret = C_ERROR_HTTP_404;
-                }
-                if (retcode == CURLE_PARTIAL_FILE) {
-                    ret = C_ERROR_PARTIAL_DATA;
-                } else if (retcode == CURLE_OPERATION_TIMEDOUT) {
-                    ret = C_ERROR_TRANSFERTIMEOUT;
-                }
-                retcode = curl_wrapper_get_info(tmp_h, C_INFO_EFFECTIVE_URL, 0, argc);
-                if (CURLE_OK == retcode) {
-                    CLOGI("uri:[%s], effective_url=[%s]\n", tmp_h->uri, argc);
-                }
-                */
-                retcode = curl_wrapper_get_info(tmp_h, C_INFO_SPEED_DOWNLOAD, 0, &tmp_h->dl_speed);
-                if(CURLE_OK == retcode) {
-                    CLOGI("[perform done]: This uri's average download speed is: %0.2f kbps\n", (tmp_h->dl_speed * 8)/1024.00);
-                }
+        if(CURLE_RECV_ERROR == tmp_h->engine_result
+        || CURLE_COULDNT_CONNECT == tmp_h->engine_result) {
+            tmp_h->open_quited = 1;
+        }
 
-                /* just for download speed now, maybe more later */
-                if(tmp_h->infonotify) {
-                    (*(tmp_h->infonotify))((void *)&tmp_h->dl_speed, NULL);
-                }
-#endif
+        long arg = 0;
+        retcode = curl_wrapper_get_info(tmp_h, C_INFO_RESPONSE_CODE, 0, &arg);
+        if (CURLE_OK == retcode) {
+            CLOGI("[perform done]: response_code: [%ld]\n", arg);
+        }
+        retcode = curl_wrapper_get_info(tmp_h, C_INFO_SPEED_DOWNLOAD, 0, &tmp_h->dl_speed);
+        if(CURLE_OK == retcode) {
+            CLOGI("[perform done]: This uri's average download speed is: %0.2f kbps\n", (tmp_h->dl_speed * 8)/1024.00);
+        }
 
-            }
+        /* just for download speed now, maybe more later */
+        if(tmp_h->infonotify) {
+            (*(tmp_h->infonotify))((void *)&tmp_h->dl_speed, NULL);
         }
     }
     return ret;
@@ -698,15 +653,9 @@ int curl_wrapper_clean_after_perform(CURLWContext *con)
         CLOGE("CURLWContext invalid\n");
         return ret;
     }
-    if (con->multi_curl) {
-        if (con->curl_handle) {
-            CURLWHandle * tmp_h = NULL;
-            for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
-                curl_multi_remove_handle(con->multi_curl, tmp_h->curl);
-                //curl_easy_cleanup(tmp_h->curl);
-                //tmp_h->curl = NULL;
-            }
-        }
+    CURLWHandle * tmp_h = NULL;
+    for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
+        curl_engine_remove(tmp_h);
     }
     ret = 0;
     return ret;
@@ -735,19 +684,13 @@ int curl_wrapper_set_to_quit(CURLWContext * con, CURLWHandle * h)
         for (tmp_h = con->curl_handle; tmp_h; tmp_h = tmp_h->next) {
             if (h) {
                 if (h == tmp_h) {
-                    pthread_cond_signal(&tmp_h->pthread_cond);
                     tmp_h->quited = 1;
-                    if (tmp_h->curl) {
-                        curl_multi_remove_handle(con->multi_curl, tmp_h->curl);
-                        //curl_easy_cleanup(tmp_h->curl);
-                        //tmp_h->curl = NULL;
-                    }
+                    curl_engine_remove(tmp_h);
                     ret = curl_wrapper_del_curl_handle(con, h);
                     break;
                 }
                 continue;
             }
-            pthread_cond_signal(&tmp_h->pthread_cond);
             tmp_h->quited = 1;
         }
     }
@@ -787,11 +730,8 @@ int curl_wrapper_close(CURLWContext * h)
     if (!h) {
         return ret;
     }
-    if (h->multi_curl) {
-        curl_multi_cleanup(h->multi_curl);
-        h->multi_curl = NULL;
-    }
     if (h->curl_handle) {
+        curl_wrapper_clean_after_perform(h);
         curl_wrapper_del_all_curl_handle(h);
     }
     c_free(h);
@@ -811,6 +751,7 @@ int curl_wrapper_get_info_easy(CURLWHandle * h, curl_info cmd, uint32_t flag, in
     CURL *tmp_c = NULL;
     tmp_c = curl_easy_init();
     if (tmp_c) {
+        curl_engine_share(tmp_c);
         if (cmd == C_INFO_CONTENT_LENGTH_DOWNLOAD) {
             curl_easy_setopt(tmp_c, CURLOPT_URL, h->uri);
             curl_easy_setopt(tmp_c, CURLOPT_NOBODY, 1L);
@@ -116,6 +116,7 @@ static int curl_ffmpeg_read(URLContext *h, uint8_t *buf, int size)
 #if 1
     do {
         if (url_interrupt_cb()) {
+            curl_fetch_interrupt(s->cfc_h);
             return AVERROR(EINTR);
         }
         ret = curl_fetch_read(s->cfc_h, buf, size);
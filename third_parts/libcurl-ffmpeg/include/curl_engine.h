@@ -0,0 +1,32 @@
+#ifndef CURL_ENGINE_H_
+#define CURL_ENGINE_H_
+
+#include "curl_wrapper.h"
+
+/*
+*   one process wide network thread drives a single curl multi handle with
+*   curl_multi_socket_action() and epoll for every open CURLWHandle, so the
+*   connection/dns cache is shared by all sessions. the multi handle is only
+*   touched by that thread, requests from other threads are queued to it.
+*/
+
+typedef enum {
+    C_ENGINE_IDLE = 0,      // not in the multi handle
+    C_ENGINE_RUNNING,       // transfer in progress
+    C_ENGINE_DONE,          // finished, engine_result holds the CURLcode
+} curl_engine_state;
+
+/* attach the shared dns/ssl session/connection cache to an easy handle */
+void curl_engine_share(CURL * curl);
+/* start the transfer of h, returns at once */
+int curl_engine_add(CURLWHandle * h);
+/* stop the transfer of h, returns when the engine does not use h->curl any more */
+int curl_engine_remove(CURLWHandle * h);
+/* unpause h after the reader freed room in its fifo */
+int curl_engine_resume(CURLWHandle * h);
+/* 1 while h is queued or transferring */
+int curl_engine_busy(CURLWHandle * h);
+/* wait up to ms for any transfer to change state */
+void curl_engine_wait(int ms);
+
+#endif
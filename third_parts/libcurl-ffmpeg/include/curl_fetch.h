@@ -35,6 +35,6 @@ int curl_fetch_http_set_headers(CFContext * handle, const char * headers);
 int curl_fetch_http_set_cookie(CFContext * handle, const char * cookie);
 int curl_fetch_get_info(CFContext * handle, curl_info cmd, uint32_t flag, void * info);
 void curl_fetch_register_interrupt(CFContext * handle, interruptcallback pfunc);
-//int curl_fetch_interrupt(CFContext * handle);
+int curl_fetch_interrupt(CFContext * handle);
 
 #endif
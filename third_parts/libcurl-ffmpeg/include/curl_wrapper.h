@@ -38,10 +38,16 @@ typedef struct _CURLWHandle {
     double dl_speed;
     void (*infonotify)(void * info, int * ext);
     int (*interrupt)(void);
+    int aborted;            // interrupted, set by the perform thread for the engine thread
     pthread_mutex_t fifo_mutex;
     pthread_mutex_t info_mutex;
-    pthread_cond_t pthread_cond;
     pthread_cond_t info_cond;
+    int paused;             // write callback paused the transfer, fifo full
+    int paused_size;        // size of the chunk waiting in libcurl
+    int engine_state;       // curl_engine_state
+    int engine_cmd;
+    int engine_result;      // CURLcode of the finished transfer
+    struct _CURLWHandle * engine_next;
     struct _CURLWHandle * prev;
     struct _CURLWHandle * next;
 } CURLWHandle;
@@ -50,7 +56,6 @@ typedef struct _CURLWContext {
     int quited;
     int curl_h_num;
     int (*interrupt)(void);
-    CURLM *multi_curl;
     CURLWHandle * curl_handle;
 } CURLWContext;
 
@@ -73,6 +78,8 @@ int curl_wrapper_set_to_quit(CURLWContext * con, CURLWHandle * h);
 int curl_wrapper_get_info_easy(CURLWHandle * handle, curl_info cmd, uint32_t flag, int64_t * iinfo, char * cinfo);
 int curl_wrapper_get_info(CURLWHandle * handle, curl_info cmd, uint32_t flag, void * info);
 int curl_wrapper_register_notify(CURLWHandle * handle, infonotifycallback pfunc);
+int curl_wrapper_fifo_drained(CURLWHandle * handle);
+void curl_wrapper_abort(CURLWHandle * handle);
 
 #endif
 
@@ -7,7 +7,8 @@ LOCAL_MODULE_TAGS := optional
 LIBPLAYER_PATH=$(TOP)/packages/amlogic/LibPlayer/
 LOCAL_SRC_FILES := \
 	hls_download.c\
-    hls_bandwidth_measure.c
+    hls_bandwidth_measure.c\
+    hls_fetch_cache.c
 	
 LOCAL_C_INCLUDES := \
 	$(TOP)/frameworks/native/include\
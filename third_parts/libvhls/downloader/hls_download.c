@@ -27,6 +27,9 @@
 
 typedef struct _PreEstBWContext{
     void * url_handle;
+    int bytes;
+    volatile int abort;
+    volatile int exit;
 }PreEstBWContext;
 
 typedef struct _HLSHttpContext{
@@ -388,18 +391,71 @@ int hls_http_close(void* handle){
 //#define _DEBUG_NO_LIBPLAYER 1
 
 int fetchHttpSmallFile(const char* url,const char* headers,void** buf,int* length,char** redirectUrl){
+    return fetchHttpSmallFileCond(url,headers,NULL,buf,length,redirectUrl);
+}
+
+static const char* _add_conditional_headers(const char* headers,HLSHttpValidator_t* validator,char* out,int size){
+    int len = 0;
+    if(validator==NULL||(validator->etag[0]=='\0'&&validator->last_modified[0]=='\0')){
+        return headers;
+    }
+    if(headers!=NULL&&strlen(headers)>0){
+        if(strlen(headers)+2*HLS_VALIDATOR_MAX+64>=size){
+            return headers;
+        }
+        len = snprintf(out,size,"%s",headers);
+        if(len<2||strcmp(out+len-2,"\r\n")){
+            len += snprintf(out+len,size-len,"\r\n");
+        }
+    }
+    if(validator->etag[0]!='\0'){
+        len += snprintf(out+len,size-len,"If-None-Match: %s\r\n",validator->etag);
+    }
+    if(validator->last_modified[0]!='\0'){
+        len += snprintf(out+len,size-len,"If-Modified-Since: %s\r\n",validator->last_modified);
+    }
+    return out;
+}
+
+static void _update_validator(void* handle,HLSHttpValidator_t* validator){
+#ifdef _USE_FFMPEG_CODE
+    HLSHttpContext* ctx = (HLSHttpContext*)handle;
+    URLContext* h = (URLContext*)(ctx->h);
+    if(h==NULL){
+        return;
+    }
+    validator->not_modified = h->http_code==304;
+    if(validator->not_modified){//keep the old ones unless the 304 carries new ones
+        if(h->etag!=NULL){
+            strlcpy(validator->etag,h->etag,HLS_VALIDATOR_MAX);
+        }
+        if(h->last_modified!=NULL){
+            strlcpy(validator->last_modified,h->last_modified,HLS_VALIDATOR_MAX);
+        }
+        return;
+    }
+    strlcpy(validator->etag,h->etag!=NULL?h->etag:"",HLS_VALIDATOR_MAX);
+    strlcpy(validator->last_modified,h->last_modified!=NULL?h->last_modified:"",HLS_VALIDATOR_MAX);
+#endif
+}
+
+int fetchHttpSmallFileCond(const char* url,const char* headers,HLSHttpValidator_t* validator,void** buf,int* length,char** redirectUrl){
     if(url==NULL){
         return -1;
     }
 
     void* handle = NULL;
     int ret = -1;
+    char cond_headers[MAX_URL_SIZE];
     
 #ifdef _DEBUG_NO_LIBPLAYER    
     av_register_all();
 #endif
+    if(validator!=NULL){
+        validator->not_modified = 0;
+    }
  
-    ret = hls_http_open(url,headers,NULL,&handle);
+    ret = hls_http_open(url,_add_conditional_headers(headers,validator,cond_headers,MAX_URL_SIZE),NULL,&handle);
    
     if(ret!=0){
         LOGV("Failed to open http handle\n");
@@ -409,6 +465,16 @@ int fetchHttpSmallFile(const char* url,const char* headers,void** buf,int* lengt
         }
         return -1;
     }
+    if(validator!=NULL){
+        _update_validator(handle,validator);
+        if(validator->not_modified){
+            *buf = NULL;
+            *length = 0;
+            *redirectUrl = NULL;
+            hls_http_close(handle);
+            return 0;
+        }
+    }
     int64_t flen = hls_http_get_fsize(handle);
     int64_t rsize = 0;
     unsigned char* buffer = NULL;
@@ -434,7 +500,7 @@ int fetchHttpSmallFile(const char* url,const char* headers,void** buf,int* lengt
     int isize = 0;
 
     do{
-        ret = hls_http_read(handle,buffer+isize,buf_len);
+        ret = hls_http_read(handle,buffer+isize,buf_len-isize);
         if(ret<=0){
             if (ret!= HLSERROR(EAGAIN)) {
                 if(ret!=0 && ret != HLSERROR(ERROR_END_OF_STREAM)){
@@ -473,8 +539,6 @@ int fetchHttpSmallFile(const char* url,const char* headers,void** buf,int* lengt
 }
 
 #define PRE_ESTIMATE_BW_TIME 3*1000*1000 //us
-int pre_bw_bytes = 0;
-int pre_bw_worker_exit = 0;
 
 static void *_pre_estimate_bw_worker(void *ctx) {
     PreEstBWContext *handle = (PreEstBWContext *)ctx;
@@ -500,10 +564,10 @@ static void *_pre_estimate_bw_worker(void *ctx) {
     int isize = 0;
 
     do{
-        if(in_gettimeUs()-startUs >= PRE_ESTIMATE_BW_TIME) {
+        if(buffer == NULL || handle->abort>0 || in_gettimeUs()-startUs >= PRE_ESTIMATE_BW_TIME) {
             break;
         }
-        ret = hls_http_read(hd,buffer+isize,buf_len);
+        ret = hls_http_read(hd,buffer+isize,buf_len-isize);
         if(ret<=0){
             if (ret!= HLSERROR(EAGAIN)) {
                 break;
@@ -513,13 +577,14 @@ static void *_pre_estimate_bw_worker(void *ctx) {
             }
         }else{
             isize+=ret;
-            pre_bw_bytes+=ret;
+            __sync_fetch_and_add(&handle->bytes,ret);
         }
     }while(isize<buf_len);
-    pre_bw_worker_exit = 1;
-    free(handle);
-    handle = NULL;
+    if(buffer){
+        free(buffer);
+    }
     hls_http_close(hd);
+    handle->exit = 1;
     return NULL;
 } 
 
@@ -532,28 +597,34 @@ int preEstimateBandwidth(void *h, void * buf, int length) {
         return -1;
     }
     handle->url_handle = h;
-    pre_bw_bytes = 0;
-    pre_bw_worker_exit = 0;
+    handle->bytes = 0;
+    handle->abort = 0;
+    handle->exit = 0;
     pthread_t tid;
-    int ret = -1;
-    pthread_attr_t pthread_attr;
+    int ret = -1;
+    pthread_attr_t pthread_attr;
     pthread_attr_init(&pthread_attr);
+    /*player sub-thread,so a player cancel interrupts its blocking reads too*/
     ret = hls_task_create(&tid, &pthread_attr, _pre_estimate_bw_worker, handle);
-    pthread_setname_np(tid,"hls_estimate");
-    if(ret!=0){
-        pthread_attr_destroy(&pthread_attr);
-        return -1;
+    pthread_attr_destroy(&pthread_attr);
+    if(ret!=0){
+        free(handle);
+        return -1;
     }
+    pthread_setname_np(tid,"hls_estimate");
     int64_t thread_startUs = in_gettimeUs();
-    pthread_attr_destroy(&pthread_attr);
     while((in_gettimeUs()-thread_startUs) < PRE_ESTIMATE_BW_TIME && !url_interrupt_cb()) {
-        if(pre_bw_worker_exit>0) {
+        if(handle->exit>0) {
             break;
         }
 	 amthreadpool_thread_usleep(10*1000);
     }
-    int64_t pre_bw = (int64_t)pre_bw_bytes * 8 * 1000000/(in_gettimeUs()-thread_startUs);
+    int64_t pre_bw = (int64_t)__sync_fetch_and_add(&handle->bytes,0) * 8 * 1000000/(in_gettimeUs()-thread_startUs);
     pre_bw = (pre_bw * 8)/10;
+    /*the worker still owns the url handle,stop it and wait before returning*/
+    handle->abort = 1;
+    hls_task_join(tid,NULL);
+    free(handle);
     return pre_bw;   
 }
 
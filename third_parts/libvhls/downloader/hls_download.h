@@ -53,6 +53,14 @@ typedef struct _AESKeyInfo{
     void* key_info;    
 }AESKeyInfo_t;
 
+#define HLS_VALIDATOR_MAX 128
+
+typedef struct _HLSHttpValidator{
+    char etag[HLS_VALIDATOR_MAX];           /* of the last 200 response,"" if none */
+    char last_modified[HLS_VALIDATOR_MAX];
+    int not_modified;                       /* set when the server answered 304 */
+}HLSHttpValidator_t;
+
 int hls_http_open(const char* url,const char* headers,void* key,void** handle);
 int64_t hls_http_get_fsize(void* handle);
 int hls_http_read(void* handle,void* buf,int size);
@@ -65,6 +73,8 @@ int hls_http_seek_by_time(void* handle,int64_t timeUs);
 int hls_http_close(void* handle);
 
 int fetchHttpSmallFile(const char* url,const char* headers,void** buf,int* length,char** redirectUrl);
+//conditional GET with the validator's ETag/Last-Modified,no data is returned on 304
+int fetchHttpSmallFileCond(const char* url,const char* headers,HLSHttpValidator_t* validator,void** buf,int* length,char** redirectUrl);
 int preEstimateBandwidth(void *handle, void *buf, int length);
 
 int hls_task_create(pthread_t *thread_out, pthread_attr_t const * attr, void *(*start_routine)(void *), void * arg);
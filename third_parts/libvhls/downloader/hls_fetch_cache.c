@@ -0,0 +1,286 @@
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FetchCache"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "hls_download.h"
+#include "hls_fetch_cache.h"
+#include "hls_utils.h"
+
+#ifdef HAVE_ANDROID_OS
+#include "hls_common.h"
+#else
+#include "hls_debug.h"
+#endif
+
+#include "libavformat/avio.h"
+
+#define FETCH_CACHE_ENTRIES_DEF     32
+#define FETCH_CACHE_KEY_TTL_DEF     600     //seconds
+#define FETCH_CACHE_STATIC_TTL_DEF  60      //seconds,master and ended playlists
+#define FETCH_CACHE_TARGET_DEF      10      //seconds,no #EXT-X-TARGETDURATION
+#define FETCH_CACHE_WAIT_STEP_US    (100*1000)
+
+typedef struct _FetchCacheEntry{
+    char* url;
+    char* headers;              /* key headers,cookies or tokens may change the answer */
+    void* data;                 /* NUL terminated copy,NULL until the first fetch */
+    int length;
+    char* redirect_url;
+    HLSHttpValidator_t validator;
+    int64_t fetch_timeUs;       /* data known current at this time */
+    int64_t ttlUs;
+    int64_t last_useUs;
+    int fetching;               /* a session is downloading it,the others wait */
+}FetchCacheEntry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static FetchCacheEntry_t* cache_entries = NULL;
+static int cache_entry_max = 0;
+static int64_t cache_key_ttlUs = 0;
+static int64_t cache_static_ttlUs = 0;
+static HLSFetchCacheStats_t cache_stats;
+
+static void _fetch_cache_init(void){
+    float v = in_get_sys_prop_float("libplayer.hls.fetchcache");
+    if(v==0){
+        LOGI("shared fetch cache disabled\n");
+        return;
+    }
+    v = in_get_sys_prop_float("libplayer.hls.fetchcache.num");
+    cache_entry_max = v>0?(int)v:FETCH_CACHE_ENTRIES_DEF;
+    v = in_get_sys_prop_float("libplayer.hls.fetchcache.keyttl");
+    cache_key_ttlUs = (v>=0?v:FETCH_CACHE_KEY_TTL_DEF)*1000000ll;
+    cache_static_ttlUs = FETCH_CACHE_STATIC_TTL_DEF*1000000ll;
+    cache_entries = calloc(cache_entry_max,sizeof(FetchCacheEntry_t));
+    if(cache_entries==NULL){
+        cache_entry_max = 0;
+    }
+}
+
+/*
+ * a live media playlist changes about once per target duration,a copy
+ * younger than half of it is as good as a new request.
+ */
+static int64_t _playlist_ttlUs(const char* data){
+    const char* p;
+    int target = FETCH_CACHE_TARGET_DEF;
+    if(strstr(data,"#EXT-X-ENDLIST")!=NULL||strstr(data,"#EXT-X-STREAM-INF")!=NULL){
+        return cache_static_ttlUs;
+    }
+    p = strstr(data,"#EXT-X-TARGETDURATION:");
+    if(p!=NULL&&atoi(p+strlen("#EXT-X-TARGETDURATION:"))>0){
+        target = atoi(p+strlen("#EXT-X-TARGETDURATION:"));
+    }
+    return target*1000000ll/2;
+}
+
+static FetchCacheEntry_t* _find_entry(const char* url,const char* headers){
+    int i;
+    for(i = 0;i<cache_entry_max;i++){
+        if(cache_entries[i].url!=NULL&&!strcmp(cache_entries[i].url,url)&&
+           !strcmp(cache_entries[i].headers,headers)){
+            return &cache_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void _clear_entry(FetchCacheEntry_t* e){
+    free(e->url);
+    free(e->headers);
+    free(e->data);
+    free(e->redirect_url);
+    memset(e,0,sizeof(FetchCacheEntry_t));
+}
+
+//a free slot,or the least recently used one nobody is fetching
+static FetchCacheEntry_t* _new_entry(const char* url,const char* headers){
+    FetchCacheEntry_t* e = NULL;
+    int i;
+    for(i = 0;i<cache_entry_max;i++){
+        FetchCacheEntry_t* c = &cache_entries[i];
+        if(c->url==NULL){
+            e = c;
+            break;
+        }
+        if(!c->fetching&&(e==NULL||c->last_useUs<e->last_useUs)){
+            e = c;
+        }
+    }
+    if(e==NULL){
+        return NULL;
+    }
+    _clear_entry(e);
+    e->url = strdup(url);
+    e->headers = strdup(headers);
+    if(e->url==NULL||e->headers==NULL){
+        _clear_entry(e);
+        return NULL;
+    }
+    return e;
+}
+
+static int _copy_out(FetchCacheEntry_t* e,void** buf,int* length,char** redirectUrl){
+    //keys are read as AES_BLOCK_SIZE bytes whatever the server sent
+    char* data = calloc(1,e->length+16);
+    if(data==NULL){
+        return -1;
+    }
+    memcpy(data,e->data,e->length);
+    *buf = data;
+    *length = e->length;
+    *redirectUrl = e->redirect_url!=NULL?strdup(e->redirect_url):NULL;
+    return 0;
+}
+
+int hls_fetch_cache_get(int type,const char* url,const char* headers,const char* keyHeaders,
+                        int64_t newerThanUs,void** buf,int* length,char** redirectUrl,int64_t* fetchTimeUs){
+    FetchCacheEntry_t* e;
+    HLSHttpValidator_t validator;
+    void* data = NULL;
+    char* redirect = NULL;
+    int len = 0,ret,waited = 0;
+    int64_t nowUs;
+
+    pthread_once(&cache_once,_fetch_cache_init);
+    if(cache_entry_max<=0){
+        if(fetchTimeUs!=NULL){
+            *fetchTimeUs = in_gettimeUs();
+        }
+        return fetchHttpSmallFile(url,headers,buf,length,redirectUrl);
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    cache_stats.lookups++;
+    for(;;){
+        e = _find_entry(url,keyHeaders!=NULL?keyHeaders:"");
+        if(e==NULL){
+            e = _new_entry(url,keyHeaders!=NULL?keyHeaders:"");
+            if(e==NULL){//all busy,don't cache this one
+                pthread_mutex_unlock(&cache_lock);
+                if(fetchTimeUs!=NULL){
+                    *fetchTimeUs = in_gettimeUs();
+                }
+                return fetchHttpSmallFile(url,headers,buf,length,redirectUrl);
+            }
+        }
+        nowUs = in_gettimeUs();
+        if(e->data!=NULL&&e->fetch_timeUs>newerThanUs&&nowUs-e->fetch_timeUs<e->ttlUs){
+            ret = _copy_out(e,buf,length,redirectUrl);
+            if(ret==0){
+                if(waited){
+                    cache_stats.shared++;
+                }else{
+                    cache_stats.hits++;
+                }
+                cache_stats.saved_bytes += e->length;
+                e->last_useUs = nowUs;
+                if(fetchTimeUs!=NULL){
+                    *fetchTimeUs = e->fetch_timeUs;
+                }
+            }
+            pthread_mutex_unlock(&cache_lock);
+            return ret;
+        }
+        if(!e->fetching){
+            break;
+        }
+        //another session is getting it,wait for its copy
+        struct timeval tv;
+        struct timespec ts;
+        gettimeofday(&tv,NULL);
+        ts.tv_sec = tv.tv_sec;
+        ts.tv_nsec = tv.tv_usec*1000ll+FETCH_CACHE_WAIT_STEP_US*1000ll;
+        if(ts.tv_nsec>=1000000000){
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&cache_cond,&cache_lock,&ts);
+        if(url_interrupt_cb()){
+            pthread_mutex_unlock(&cache_lock);
+            return HLSERROR(EINTR);
+        }
+        waited = 1;
+    }
+    e->fetching = 1;
+    if(e->data!=NULL){
+        validator = e->validator;
+    }else{
+        memset(&validator,0,sizeof(validator));
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    ret = fetchHttpSmallFileCond(url,headers,&validator,&data,&len,&redirect);
+
+    pthread_mutex_lock(&cache_lock);
+    e->fetching = 0;
+    pthread_cond_broadcast(&cache_cond);
+    nowUs = in_gettimeUs();
+    if(ret!=0){
+        pthread_mutex_unlock(&cache_lock);
+        if(data!=NULL){
+            free(data);
+        }
+        return ret;
+    }
+    if(validator.not_modified){
+        cache_stats.revalidated++;
+        cache_stats.saved_bytes += e->length;
+        e->validator = validator;
+        e->fetch_timeUs = nowUs;
+        e->last_useUs = nowUs;
+        ret = _copy_out(e,buf,length,redirectUrl);
+        if(ret==0&&fetchTimeUs!=NULL){
+            *fetchTimeUs = nowUs;
+        }
+        pthread_mutex_unlock(&cache_lock);
+        return ret;
+    }
+    cache_stats.misses++;
+    free(e->data);
+    free(e->redirect_url);
+    e->data = malloc(len+1);
+    e->redirect_url = redirect!=NULL?strdup(redirect):NULL;
+    if(e->data!=NULL){
+        memcpy(e->data,data,len);
+        ((char*)e->data)[len] = '\0';
+        e->length = len;
+        e->validator = validator;
+        e->ttlUs = type==HLS_FETCH_KEY?cache_key_ttlUs:_playlist_ttlUs(e->data);
+        e->fetch_timeUs = nowUs;
+        e->last_useUs = nowUs;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    //the fetched buffer goes to the caller as it is
+    *buf = data;
+    *length = len;
+    *redirectUrl = redirect;
+    if(fetchTimeUs!=NULL){
+        *fetchTimeUs = nowUs;
+    }
+    return 0;
+}
+
+void hls_fetch_cache_get_stats(HLSFetchCacheStats_t* stats){
+    pthread_mutex_lock(&cache_lock);
+    *stats = cache_stats;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void hls_fetch_cache_dump_stats(void){
+    HLSFetchCacheStats_t st;
+    hls_fetch_cache_get_stats(&st);
+    if(st.lookups<=0){
+        return;
+    }
+    LOGI("fetch cache:lookups %d,hit %d,shared %d,revalidated %d,miss %d,hit rate %.1f%%,saved %lld bytes\n",
+         st.lookups,st.hits,st.shared,st.revalidated,st.misses,
+         (st.hits+st.shared+st.revalidated)*100.0/st.lookups,(long long)st.saved_bytes);
+}
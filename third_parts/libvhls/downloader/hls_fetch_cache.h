@@ -0,0 +1,51 @@
+#ifndef HLS_FETCH_CACHE_H
+#define HLS_FETCH_CACHE_H
+
+/*
+ * process wide cache of the small HLS files,AES keys and playlists,
+ * shared by all the m3u sessions so that players on the same channel
+ * (or a quick zap back to it) don't pay the round trips again.
+ */
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C"{
+#endif
+#endif /* __cplusplus */
+
+typedef enum _HLSFetchCacheType{
+    HLS_FETCH_KEY = 0,
+    HLS_FETCH_PLAYLIST = 1,
+}HLSFetchCacheType_e;
+
+typedef struct _HLSFetchCacheStats{
+    int lookups;
+    int hits;           /* served from the cache without a request */
+    int revalidated;    /* 304 to a conditional request */
+    int shared;         /* waited for the same file fetched by another session */
+    int misses;         /* full downloads */
+    int64_t saved_bytes;
+}HLSFetchCacheStats_t;
+
+/*
+ * same contract as fetchHttpSmallFile(),*buf is the caller's copy.
+ * headers go out with the request,keyHeaders (NULL for none) are what
+ * else than the url decides the answer:the headers without the per
+ * session ones,so that sessions share the entries.
+ * a copy fetched or revalidated at or before newerThanUs is not used
+ * (the caller has it already),-1 takes any fresh one. *fetchTimeUs,if
+ * not NULL,gets the time the returned data was known current.
+ */
+int hls_fetch_cache_get(int type,const char* url,const char* headers,const char* keyHeaders,
+                        int64_t newerThanUs,void** buf,int* length,char** redirectUrl,int64_t* fetchTimeUs);
+void hls_fetch_cache_get_stats(HLSFetchCacheStats_t* stats);
+void hls_fetch_cache_dump_stats(void);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif
+#endif /* __cplusplus */
+
+
+#endif
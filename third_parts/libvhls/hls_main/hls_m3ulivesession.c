@@ -9,9 +9,11 @@
 #include "hls_m3uparser.h"
 #include "hls_utils.h"
 #include "hls_download.h"
+#include "hls_fetch_cache.h"
 #include "hls_bandwidth_measure.h"
 #include "libavformat/avio.h"
 #include <amthreadpool.h>
+#include <amtrace.h>
 
 #ifdef HAVE_ANDROID_OS
 #include "hls_common.h"
@@ -128,6 +130,7 @@ typedef struct _M3ULiveSession{
     pthread_t tid;
     int64_t durationUs;    
     int64_t last_bandwidth_list_fetch_timeUs;
+    int64_t last_playlist_data_timeUs;  /* when the playlist held was known current,maybe fetched by another session */
     int64_t download_monitor_timer;
     uint8_t last_bandwidth_list_hash[HASH_KEY_SIZE];
     void* cache;  
@@ -144,6 +147,12 @@ typedef struct _M3ULiveSession{
     int *last_notify_err_seq_num;
     int onInterruptwait;
     int no_new_file_can_download;
+    int lowlatency;         /* LL-HLS,-1 not decided,0 whole segments,1 parts */
+    int cur_part;           /* next part of cur_seq_num to download */
+    int ll_hint_failed_msn; /* preload hint that failed,don't retry it before a reload */
+    int ll_hint_failed_part;
+    int ll_parts_num;
+    int ll_reloads_num;
 }M3ULiveSession;
 
 
@@ -159,7 +168,11 @@ static void _init_m3u_live_session_context(M3ULiveSession* ss){
     ss->cur_seq_num =-1;
     ss->first_seq_num = -1;
     ss->last_bandwidth_list_fetch_timeUs = -1;
+    ss->last_playlist_data_timeUs = -1;
     ss->seekposByte = -1;
+    ss->lowlatency = -1;
+    ss->ll_hint_failed_msn = -1;
+    ss->ll_hint_failed_part = -1;
     ss->is_ts_media = -1;
     ss->is_variant = -1;
     ss->is_livemode = -1;
@@ -286,7 +299,7 @@ static int _is_add_fake_leader_block(M3ULiveSession* ss){
     }
     return 0;
 }
-static void* _fetch_play_list(const char* url,M3ULiveSession* ss,int* unchanged){
+static void* _fetch_play_list_in(const char* url,M3ULiveSession* ss,int* unchanged){
     *unchanged = 0;
     void* buf = NULL;
     int blen = -1;
@@ -305,7 +318,14 @@ static void* _fetch_play_list(const char* url,M3ULiveSession* ss,int* unchanged)
             snprintf(headers+strlen(headers),MAX_URL_SIZE-strlen(headers),"\r\n");
         }
     }
-    ret = fetchHttpSmallFile(url,headers,&buf,&blen,&redirectUrl);
+ /* a shared copy is only good if it is newer than the one this session has */
+    int64_t newerThanUs = -1;
+    int64_t dataTimeUs = -1;
+    if(ss->last_m3u8_url && !strcmp(ss->last_m3u8_url, url)){
+        newerThanUs = ss->last_playlist_data_timeUs;
+    }
+    //not keyed on the session id,the other sessions on this url share the copy
+    ret = hls_fetch_cache_get(HLS_FETCH_PLAYLIST,url,headers,ss->headers,newerThanUs,&buf,&blen,&redirectUrl,&dataTimeUs);
     if(ret!=0){   
         if(buf!=NULL){
             free(buf);
@@ -313,6 +333,7 @@ static void* _fetch_play_list(const char* url,M3ULiveSession* ss,int* unchanged)
         ss->err_code = -ret;//small trick,avoid to exit player thread
         return NULL;
     }
+    ss->last_playlist_data_timeUs = dataTimeUs;
 
     if(redirectUrl){
         LOGI("Got re-direct url,location:%s\n",redirectUrl);
@@ -374,6 +395,14 @@ PASS_THROUGH:
     return bandwidth_list;    
 
 }
+
+static void* _fetch_play_list(const char* url,M3ULiveSession* ss,int* unchanged){
+    void* bandwidth_list;
+    amtrace_begin(AMTRACE_HLS_PLAYLIST);
+    bandwidth_list = _fetch_play_list_in(url,ss,unchanged);
+    amtrace_end(AMTRACE_HLS_PLAYLIST);
+    return bandwidth_list;
+}
 static int  _time_to_refresh_bandwidth_list(M3ULiveSession* ss,int64_t nowUs){
     if (ss->playlist==NULL) {
         if(ss->refresh_state ==INITIAL_MINIMUM_RELOAD_DELAY){
@@ -602,7 +631,7 @@ static int _get_decrypt_key(M3ULiveSession* s,int playlistIndex,AESKeyInfo_t* ke
         int isize = 0;
         int ret = -1;
         char* redirectUrl = NULL;
-        ret = fetchHttpSmallFile(keyUrl, s->headers,(void**)&keydat,&isize,&redirectUrl);
+        ret = hls_fetch_cache_get(HLS_FETCH_KEY,keyUrl,s->headers,s->headers,-1,(void**)&keydat,&isize,&redirectUrl,NULL);
         if(ret !=0){
             LOGV("Failed to get aes key\n");
             return -1;
@@ -682,6 +711,56 @@ static int _get_decrypt_key(M3ULiveSession* s,int playlistIndex,AESKeyInfo_t* ke
     in_hex_dump("AES IV ",aes_ivec,16);
     return 0;
 }
+//first part to play,PART-HOLD-BACK behind the live edge,on an independent part
+static void _ll_seek_live_edge(M3ULiveSession* s){
+    int num = m3u_get_part_num(s->playlist);
+    int64_t holdUs = m3u_get_part_hold_backUs(s->playlist);
+    M3uPartNode* part = m3u_get_part_by_index(s->playlist,num-1);
+    int64_t edgeUs = part->startUs+part->durationUs;
+    int i;
+    if(holdUs<=0){
+        holdUs = 3*m3u_get_part_targetUs(s->playlist);
+    }
+    for(i = num-1;i>0;i--){
+        if(edgeUs-m3u_get_part_by_index(s->playlist,i)->startUs>=holdUs){
+            break;
+        }
+    }
+    for(;i>0;i--){
+        part = m3u_get_part_by_index(s->playlist,i);
+        if(part->independent||part->part==0){
+            break;
+        }
+    }
+    part = m3u_get_part_by_index(s->playlist,i);
+    s->cur_seq_num = part->msn;
+    s->cur_part = part->part;
+    LOGI("LL-HLS,start at seq:%d,part:%d,%lld ms behind live edge\n",
+         s->cur_seq_num,s->cur_part,(long long)(edgeUs-part->startUs)/1000);
+}
+
+//session lock held
+static void _ll_init(M3ULiveSession* s){
+    s->lowlatency = 0;
+    if(m3u_is_complete(s->playlist)>0||s->is_livemode==1
+        ||m3u_get_part_targetUs(s->playlist)<=0||m3u_get_part_num(s->playlist)<=0){
+        return;
+    }
+    //libplayer.hls.lowlatency=0 plays these streams on whole segments
+    if(in_get_sys_prop_float("libplayer.hls.lowlatency")==0){
+        LOGI("LL-HLS stream,low latency mode disabled\n");
+        return;
+    }
+    if(s->is_encrypt_media>0){//keys are handled per segment
+        LOGI("LL-HLS stream is encrypted,download whole segments\n");
+        return;
+    }
+    s->lowlatency = 1;
+    LOGI("LL-HLS,part target:%lld ms,blocking reload:%d\n",
+         (long long)m3u_get_part_targetUs(s->playlist)/1000,m3u_can_block_reload(s->playlist));
+    _ll_seek_live_edge(s);
+}
+
 static int _choose_bandwidth_and_init_playlist(M3ULiveSession* s){
     if(s == NULL){
         LOGE("failed to init playlist\n");
@@ -778,9 +857,14 @@ static int _choose_bandwidth_and_init_playlist(M3ULiveSession* s){
     }
     s->target_duration = m3u_get_target_duration(s->playlist);
     s->last_bandwidth_list_fetch_timeUs = in_gettimeUs();
+    if(s->lowlatency<0&&rv<0){
+        _ll_init(s);
+    }
 
-    if(s->log_level >= HLS_SHOW_URL) {
-        LOGV("playback,first segment from seq:%d,url:%s\n",s->cur_seq_num,m3u_get_node_by_index(s->playlist,s->cur_seq_num-firstSeqNumberInPlaylist)->fileUrl);
+    //LL-HLS can start on the segment still being made,it isn't listed yet
+    M3uBaseNode* first = m3u_get_node_by_index(s->playlist,s->cur_seq_num-firstSeqNumberInPlaylist);
+    if(s->log_level >= HLS_SHOW_URL && first!=NULL) {
+        LOGV("playback,first segment from seq:%d,url:%s\n",s->cur_seq_num,first->fileUrl);
     } else {
         LOGV("playback,first segment from seq:%d\n",s->cur_seq_num);
     }
@@ -894,6 +978,9 @@ static int _refresh_playlist(M3ULiveSession* s){
         return -1;    
     }
     
+    if(s->lowlatency>0){//reloaded by the part download
+        return 0;
+    }
     int bandwidthIndex = _get_best_bandwidth_index(s);
     void* new_playlist = NULL;
 rinse_repeat:
@@ -976,7 +1063,7 @@ rinse_repeat:
                     // unchanged from the last time we tried.   
                     if(reserved_segment_check ==0){
                         pthread_mutex_unlock(&s->session_lock);                        
-                        s->last_bandwidth_list_fetch_timeUs = in_gettimeUs();
+                        s->last_bandwidth_list_fetch_timeUs = s->last_playlist_data_timeUs>=0?s->last_playlist_data_timeUs:in_gettimeUs();
                         _thread_wait_timeUs(s,100*1000);
                         goto rinse_repeat;
                     }
@@ -995,7 +1082,8 @@ rinse_repeat:
                 }
             }         
         }
-        s->last_bandwidth_list_fetch_timeUs = in_gettimeUs();
+        //reload on the schedule of the copy,sessions on one channel then share each reload
+        s->last_bandwidth_list_fetch_timeUs = s->last_playlist_data_timeUs>=0?s->last_playlist_data_timeUs:in_gettimeUs();
         
     }else{
         pthread_mutex_unlock(&s->session_lock);
@@ -1213,6 +1301,7 @@ open_retry:
         need_retry=0;
     }
     
+    amtrace_begin(AMTRACE_HLS_SEGMENT_OPEN);
     if(s->is_encrypt_media >0 ){
         
         AESKeyInfo_t keyinfo;
@@ -1229,6 +1318,7 @@ open_retry:
     }else{
         ret = hls_http_open(url, headers,NULL,&handle);
     }
+    amtrace_end(AMTRACE_HLS_SEGMENT_OPEN);
     int errcode = 0;
     if(ret !=0){
         errcode = hls_http_get_error_code(handle);    
@@ -1293,7 +1383,8 @@ open_retry:
     unsigned char buf_tmp[buf_tmp_size];
     int buf_tmp_rsize = 0;
 
-    int is_add_ts_fake_head = _is_add_fake_leader_block(s);
+    //the leader carries a segment duration,a part doesn't know it
+    int is_add_ts_fake_head = segment->flags&PARTIAL_FLAG?0:_is_add_fake_leader_block(s);
 
     
 
@@ -1451,11 +1542,200 @@ open_retry:
     
 }
 }
+/*
+ * LL-HLS playlist reload,blocking until (msn,part) is listed if the server
+ * can do it(part<0,until segment msn is complete),else a plain poll every
+ * half part target.
+ */
+static int _ll_reload(M3ULiveSession* s,int bandwidthIndex,int msn,int part){
+    char url[MAX_URL_SIZE];
+    const char* base;
+    void* playlist;
+    int unchanged = 0;
+    int blocking;
+    int64_t waitUs;
+
+    pthread_mutex_lock(&s->session_lock);
+    if(s->bandwidth_item_num>0){
+        base = s->bandwidth_list[bandwidthIndex]->url;
+    }else{
+        base = s->redirectUrl!=NULL?s->redirectUrl:s->baseUrl;
+    }
+    blocking = m3u_can_block_reload(s->playlist)>0;
+    waitUs = m3u_get_part_targetUs(s->playlist)/2;
+    if(blocking&&part>=0){
+        snprintf(url,MAX_URL_SIZE,"%s%c_HLS_msn=%d&_HLS_part=%d",base,strchr(base,'?')!=NULL?'&':'?',msn,part);
+    }else if(blocking){//until segment msn is complete
+        snprintf(url,MAX_URL_SIZE,"%s%c_HLS_msn=%d",base,strchr(base,'?')!=NULL?'&':'?',msn);
+    }else{
+        strlcpy(url,base,MAX_URL_SIZE);
+    }
+    s->ll_reloads_num++;
+    pthread_mutex_unlock(&s->session_lock);
+
+    if(!blocking){
+        _thread_wait_timeUs(s,waitUs);
+    }
+    //not under the session lock,a blocking reload takes up to a part target
+    playlist = _fetch_play_list(url,s,&unchanged);
+    if(playlist==NULL){
+        if(unchanged){
+            //held request timed out,or a poll too early,don't reload right away
+            _thread_wait_timeUs(s,waitUs>0?waitUs:100*1000);
+            return 0;
+        }
+        if(s->log_level >= HLS_SHOW_URL) {
+            LOGE("failed to reload LL-HLS playlist at url '%s'",url);
+        }
+        _thread_wait_timeUs(s,100*1000);
+        return HLSERROR(EAGAIN);
+    }
+    if(m3u_get_node_num(playlist)<=0){
+        m3u_release(playlist);
+        _thread_wait_timeUs(s,100*1000);
+        return HLSERROR(EAGAIN);
+    }
+    pthread_mutex_lock(&s->session_lock);
+    if(s->prev_bandwidth_index!=bandwidthIndex){
+        LOGI("LL-HLS,bandwidth index %d -> %d at seq:%d\n",s->prev_bandwidth_index,bandwidthIndex,msn);
+    }
+    if(s->bandwidth_item_num>0&&s->bandwidth_list){
+        if(s->bandwidth_list[bandwidthIndex]->playlist!=NULL){
+            m3u_release(s->bandwidth_list[bandwidthIndex]->playlist);
+        }
+        s->bandwidth_list[bandwidthIndex]->playlist = playlist;
+    }else if(s->playlist!=NULL){
+        m3u_release(s->playlist);
+    }
+    s->playlist = playlist;
+    s->prev_bandwidth_index = bandwidthIndex;
+    s->last_bandwidth_list_fetch_timeUs = s->last_playlist_data_timeUs>=0?s->last_playlist_data_timeUs:in_gettimeUs();
+    pthread_mutex_unlock(&s->session_lock);
+    return 0;
+}
+
+#define LL_USE_SEGMENT  1
+/*
+ * LL-HLS,download the next part of cur_seq_num.returns LL_USE_SEGMENT when
+ * it is a whole segment that has to be loaded(older than the parts listed,
+ * or a seek),the fetch result or 0 when it only moved on/reloaded.
+ */
+static int _download_next_part(M3ULiveSession* s){
+    M3uBaseNode segment;
+    M3uPartNode* part;
+    const char* hint;
+    int32_t firstSeqNumberInPlaylist;
+    int msn,partIndex,hintMsn = -1,hintPart = -1;
+    int ret;
+
+    if(s->cur_part==0&&s->bandwidth_item_num>1&&s->seektimeUs<0){//switch on segment boundaries
+        int bandwidthIndex = _get_best_bandwidth_index(s);
+        if(bandwidthIndex!=s->prev_bandwidth_index){
+            return _ll_reload(s,bandwidthIndex,s->cur_seq_num,0);
+        }
+    }
+    pthread_mutex_lock(&s->session_lock);
+    if(s->playlist==NULL||s->seektimeUs>=0){
+        s->cur_part = 0;
+        pthread_mutex_unlock(&s->session_lock);
+        return LL_USE_SEGMENT;
+    }
+    firstSeqNumberInPlaylist = m3u_get_node_by_index(s->playlist,0)->media_sequence;
+    if(firstSeqNumberInPlaylist==-1){
+        firstSeqNumberInPlaylist = 0;
+    }
+    if(s->cur_seq_num<firstSeqNumberInPlaylist&&m3u_get_part_num(s->playlist)>0){
+        LOGI("LL-HLS,seq:%d fell out of the playlist,back to the live edge\n",s->cur_seq_num);
+        _ll_seek_live_edge(s);
+    }
+    msn = s->cur_seq_num;
+    partIndex = s->cur_part;
+    part = m3u_get_part(s->playlist,msn,partIndex);
+    if(part==NULL){
+        if(msn-firstSeqNumberInPlaylist<m3u_get_node_num(s->playlist)){//the segment is complete
+            if(partIndex==0){
+                pthread_mutex_unlock(&s->session_lock);
+                return LL_USE_SEGMENT;
+            }
+            //all its parts are loaded,or they were dropped from the playlist under us
+            if(m3u_get_part(s->playlist,msn,0)==NULL){
+                LOGI("LL-HLS,parts of seq:%d gone,skip to the next segment\n",msn);
+            }
+            s->cur_seq_num++;
+            s->cur_part = 0;
+            pthread_mutex_unlock(&s->session_lock);
+            return 0;
+        }
+        hint = m3u_get_preload_hint(s->playlist,&hintMsn,&hintPart);
+        if(hint==NULL||hintMsn!=msn||hintPart!=partIndex
+            ||(s->ll_hint_failed_msn==msn&&s->ll_hint_failed_part==partIndex)){
+            int bandwidthIndex = s->prev_bandwidth_index;
+            pthread_mutex_unlock(&s->session_lock);
+            if(hint!=NULL&&(hintMsn<msn||(hintMsn==msn&&hintPart<partIndex))){
+                /*
+                 * the hint was the part just loaded,the playlist listing it
+                 * is ready now and hints the wanted one.blocking on the wanted
+                 * part would wait a whole part and then load it in one go.
+                 */
+                return _ll_reload(s,bandwidthIndex,partIndex>0?msn:msn-1,partIndex-1);
+            }
+            return _ll_reload(s,bandwidthIndex,msn,partIndex);
+        }
+        //the server holds the request until the part is ready
+        memset(&segment,0,sizeof(M3uBaseNode));
+        strlcpy(segment.fileUrl,hint,MAX_URL_SIZE);
+        segment.durationUs = m3u_get_part_targetUs(s->playlist);
+        segment.range_length = -1;
+    }else{
+        if(part->gap){
+            s->cur_part++;
+            pthread_mutex_unlock(&s->session_lock);
+            return 0;
+        }
+        memset(&segment,0,sizeof(M3uBaseNode));
+        strlcpy(segment.fileUrl,part->fileUrl,MAX_URL_SIZE);
+        segment.startUs = part->startUs;
+        segment.durationUs = part->durationUs;
+        segment.range_offset = part->range_offset;
+        segment.range_length = part->range_length;
+        hint = NULL;
+    }
+    segment.index = msn-firstSeqNumberInPlaylist;
+    segment.media_sequence = msn;
+    segment.flags = PARTIAL_FLAG;
+    pthread_mutex_unlock(&s->session_lock);
+
+    if(s->log_level >= HLS_SHOW_URL) {
+        LOGI("start fetch %s,url:%s,seq:%d,part:%d\n",hint!=NULL?"preload hint":"part",segment.fileUrl,msn,partIndex);
+    } else {
+        LOGV("start fetch %s,seq:%d,part:%d\n",hint!=NULL?"preload hint":"part",msn,partIndex);
+    }
+    ret = _fetch_segment_file(s,&segment,1);
+    pthread_mutex_lock(&s->session_lock);
+    if(hint!=NULL&&ret!=0){
+        s->ll_hint_failed_msn = msn;
+        s->ll_hint_failed_part = partIndex;
+        ret = 0;
+    }else if((ret==0||ret==HLSERROR(EAGAIN))&&s->seekflag<=0&&s->is_closed<=0
+        &&s->cur_seq_num==msn&&s->cur_part==partIndex){
+        s->cur_part++;
+        s->ll_parts_num++;
+    }
+    pthread_mutex_unlock(&s->session_lock);
+    return ret;
+}
+
 static int _download_next_segment(M3ULiveSession* s){
     if(s == NULL){
         LOGE("Sanity check\n");
         return -2;
     }
+    if(s->lowlatency>0){
+        int ret = _download_next_part(s);
+        if(ret!=LL_USE_SEGMENT){
+            return ret;
+        }
+    }
     
     int32_t firstSeqNumberInPlaylist = -1;
 
@@ -1974,6 +2254,7 @@ int64_t m3u_session_seekUs(void* hSession,int64_t posUs,int (*interupt_func_cb)(
     
     int64_t realPosUs = posUs;
     M3uBaseNode* node = NULL;
+    amtrace_begin(AMTRACE_HLS_SEEK);
     pthread_mutex_lock(&session->session_lock);
     if(session->playlist!=NULL){
         node = m3u_get_node_by_time(session->playlist,posUs);
@@ -2009,6 +2290,7 @@ int64_t m3u_session_seekUs(void* hSession,int64_t posUs,int (*interupt_func_cb)(
         }
         amthreadpool_thread_usleep(1000*10);
     }   
+    amtrace_end(AMTRACE_HLS_SEEK);
     
     if ((posUs - realPosUs) > POS_SEEK_THRESHOLD)
         return posUs - POS_SEEK_THRESHOLD;
@@ -2298,7 +2580,11 @@ int m3u_session_close(void* hSession){
 #endif        
     pthread_mutex_destroy(&session->session_lock);
     pthread_cond_destroy(&session->session_cond);    
+    if(session->lowlatency>0){
+        LOGI("LL-HLS,%d parts downloaded,%d playlist reloads\n",session->ll_parts_num,session->ll_reloads_num);
+    }
     free(session);
+    hls_fetch_cache_dump_stats();
     LOGI("m3u live session released\n");
 
     return 0;
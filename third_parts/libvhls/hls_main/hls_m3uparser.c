@@ -33,6 +33,15 @@ typedef struct _M3UParser{
     int64_t durationUs;
 	struct list_head  head;		
 	pthread_mutex_t parser_lock; 	    
+    //LL-HLS
+    int64_t part_targetUs;
+    int64_t part_hold_backUs;
+    int can_block_reload;
+    M3uPartNode** parts;    //in playlist order
+    int part_num;
+    char* preload_hint;
+    int preload_msn;
+    int preload_part;
 }M3UParser;
 
 
@@ -542,6 +551,94 @@ static int parseCipherInfo(const char* line,const char* baseUrl,M3uKeyInfo* info
 
 }
 
+//LL-HLS attribute lists,EXT-X-PART,EXT-X-PRELOAD-HINT,EXT-X-PART-INF and EXT-X-SERVER-CONTROL
+struct ll_info {
+    char duration[32];
+    char uri[MAX_URL_SIZE];
+    char independent[8];
+    char gap[8];
+    char byterange[64];
+    char byterange_start[32];
+    char type[16];
+    char part_target[32];
+    char part_hold_back[32];
+    char can_block_reload[8];
+};
+
+static void handle_ll_args(struct ll_info *info, const char *key,
+                           int key_len, char **dest, int *dest_len)
+{
+    if (!strncmp(key, "DURATION=", key_len)) {
+        *dest     =        info->duration;
+        *dest_len = sizeof(info->duration);
+    } else if (!strncmp(key, "URI=", key_len)) {
+        *dest     =        info->uri;
+        *dest_len = sizeof(info->uri);
+    } else if (!strncmp(key, "INDEPENDENT=", key_len)) {
+        *dest     =        info->independent;
+        *dest_len = sizeof(info->independent);
+    } else if (!strncmp(key, "GAP=", key_len)) {
+        *dest     =        info->gap;
+        *dest_len = sizeof(info->gap);
+    } else if (!strncmp(key, "BYTERANGE=", key_len)) {
+        *dest     =        info->byterange;
+        *dest_len = sizeof(info->byterange);
+    } else if (!strncmp(key, "BYTERANGE-START=", key_len)) {
+        *dest     =        info->byterange_start;
+        *dest_len = sizeof(info->byterange_start);
+    } else if (!strncmp(key, "TYPE=", key_len)) {
+        *dest     =        info->type;
+        *dest_len = sizeof(info->type);
+    } else if (!strncmp(key, "PART-TARGET=", key_len)) {
+        *dest     =        info->part_target;
+        *dest_len = sizeof(info->part_target);
+    } else if (!strncmp(key, "PART-HOLD-BACK=", key_len)) {
+        *dest     =        info->part_hold_back;
+        *dest_len = sizeof(info->part_hold_back);
+    } else if (!strncmp(key, "CAN-BLOCK-RELOAD=", key_len)) {
+        *dest     =        info->can_block_reload;
+        *dest_len = sizeof(info->can_block_reload);
+    }
+}
+
+static int parseLLInfo(const char* line,struct ll_info* info){
+    const char *match = strstr(line,":");
+
+    if (match == NULL) {
+        return -1;
+    }
+    memset(info,0,sizeof(struct ll_info));
+    parseKeyValue(match+1, (parse_key_val_cb)handle_ll_args,info);
+    return 0;
+}
+
+//*rangeOffset is where the previous part of the same resource ended
+static M3uPartNode* parsePart(M3UParser* var,const char* line,uint64_t* rangeOffset){
+    struct ll_info info;
+    M3uPartNode* part;
+
+    if(parseLLInfo(line,&info)!=0||info.uri[0]=='\0'||info.duration[0]=='\0'){
+        return NULL;
+    }
+    part = (M3uPartNode*)malloc(sizeof(M3uPartNode));
+    if(part==NULL){
+        return NULL;
+    }
+    memset(part,0,sizeof(M3uPartNode));
+    makeUrl(part->fileUrl,sizeof(part->fileUrl),var->baseUrl,info.uri);
+    part->durationUs = (int64_t)(atof(info.duration)*1E6);
+    part->independent = !strcasecmp(info.independent,"YES");
+    part->gap = !strcasecmp(info.gap,"YES");
+    part->range_length = -1;
+    if(info.byterange[0]!='\0'){
+        char* at = strchr(info.byterange,'@');
+        part->range_length = strtoull(info.byterange,NULL,10);
+        part->range_offset = at!=NULL?strtoull(at+1,NULL,10):*rangeOffset;
+        *rangeOffset = part->range_offset+part->range_length;
+    }
+    return part;
+}
+
 //=====================================m3uParse==============================================
 #define EXTM3U						"#EXTM3U"
 #define EXTINF						"#EXTINF"
@@ -555,6 +652,10 @@ static int parseCipherInfo(const char* line,const char* baseUrl,M3uKeyInfo* info
 #define EXT_X_DISCONTINUITY		    "#EXT-X-DISCONTINUITY"
 #define EXT_X_VERSION				"#EXT-X-VERSION"
 #define EXT_X_BYTERANGE             "#EXT-X-BYTERANGE"  //>=version 4
+#define EXT_X_SERVER_CONTROL        "#EXT-X-SERVER-CONTROL"
+#define EXT_X_PART_INF              "#EXT-X-PART-INF"
+#define EXT_X_PART                  "#EXT-X-PART:"
+#define EXT_X_PRELOAD_HINT          "#EXT-X-PRELOAD-HINT"
 
 #define LINE_SIZE_MAX 1024
 
@@ -571,6 +672,10 @@ static int fast_parse(M3UParser* var,const void *_data, int size){
     int ret = 0, bandwidth = 0;
     int hasKey = 0;
     uint64_t segmentRangeOffset = 0;
+    uint64_t partRangeOffset = 0;
+    int firstMsn = 0;           //media sequence number of the first segment
+    int segmentParts = 0;       //parts seen of the segment being listed
+    int64_t segmentPartsUs = 0;
     int64_t duration = 0;
     int64_t totaltime = 0;
     const char* ptr = NULL;   
@@ -630,6 +735,9 @@ static int fast_parse(M3UParser* var,const void *_data, int size){
                     return -1;
                 }	                
                 tmpNode.media_sequence = parseMetaData(line); 
+                if(tmpNode.media_sequence>0){
+                    firstMsn = tmpNode.media_sequence;
+                }
 
             }else if(startsWith(line,EXT_X_KEY)){
                 if(isVariantPlaylist){
@@ -658,6 +766,45 @@ static int fast_parse(M3UParser* var,const void *_data, int size){
                     LOGV("Cipher info,url:%s,method:%s\n",keyinfo->keyUrl,keyinfo->method);
                 }
 
+            }else if(startsWith(line,EXT_X_SERVER_CONTROL)){
+                struct ll_info info;
+                if(parseLLInfo(line,&info)==0){
+                    var->can_block_reload = !strcasecmp(info.can_block_reload,"YES");
+                    var->part_hold_backUs = (int64_t)(atof(info.part_hold_back)*1E6);
+                }
+            }else if(startsWith(line,EXT_X_PART_INF)){
+                struct ll_info info;
+                if(parseLLInfo(line,&info)==0){
+                    var->part_targetUs = (int64_t)(atof(info.part_target)*1E6);
+                }
+            }else if(startsWith(line,EXT_X_PART)){
+                if(isVariantPlaylist){
+                    var->is_initcheck = -1;
+                    break;
+                }
+                M3uPartNode* part = parsePart(var,line,&partRangeOffset);
+                if(part!=NULL){
+                    //the parts come before the segment they make up
+                    part->msn = firstMsn+index;
+                    part->part = segmentParts++;
+                    part->startUs = var->durationUs+segmentPartsUs;
+                    segmentPartsUs += part->durationUs;
+                    in_dynarray_add(&var->parts,&var->part_num,part);
+                }
+            }else if(startsWith(line,EXT_X_PRELOAD_HINT)){
+                struct ll_info info;
+                //only whole parts,a hinted byte range would need an open ended request
+                if(parseLLInfo(line,&info)==0&&!strcasecmp(info.type,"PART")&&info.uri[0]!='\0'
+                    &&info.byterange_start[0]=='\0'){
+                    char hint[MAX_URL_SIZE];
+                    makeUrl(hint,sizeof(hint),var->baseUrl,info.uri);
+                    if(var->preload_hint){
+                        free(var->preload_hint);
+                    }
+                    var->preload_hint = strdup(hint);
+                    var->preload_msn = firstMsn+index;
+                    var->preload_part = segmentParts;
+                }
             }else if(startsWith(line,EXT_X_ENDLIST)){
                 var->is_complete = 1;
             }else if(startsWith(line,EXTINF)){
@@ -744,6 +891,8 @@ static int fast_parse(M3UParser* var,const void *_data, int size){
             add_node_to_head(var,node);            
             ++index;  
             memset(&tmpNode,0,sizeof(M3uBaseNode));
+            segmentParts = 0;
+            segmentPartsUs = 0;
 
         }
     	
@@ -771,6 +920,7 @@ static int fast_parse(M3UParser* var,const void *_data, int size){
 int m3u_parse(const char *baseUrl,const void *data, size_t size,void** hParse){
     M3UParser* p = (M3UParser*)malloc(sizeof(M3UParser));
     //init 
+    memset(p,0,sizeof(M3UParser));
     p->baseUrl = strndup(baseUrl,MAX_URL_SIZE);
 
     p->base_node_num = 0;
@@ -907,7 +1057,86 @@ int m3u_release(void* hParse){
         free(p->baseUrl);
     }
     clean_all_nodes(p);    
+    if(p->part_num>0){
+        int i;
+        for(i = 0;i<p->part_num;i++){
+            free(p->parts[i]);
+        }
+        in_freepointer(&p->parts);
+        p->part_num = 0;
+    }
+    if(p->preload_hint!=NULL){
+        free(p->preload_hint);
+    }
     pthread_mutex_destroy(&p->parser_lock);
     free(p);
     return 0;
 }
+
+int64_t m3u_get_part_targetUs(void* hParse){
+    if(NULL ==hParse){
+        return -2;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    return p->part_targetUs;
+}
+int64_t m3u_get_part_hold_backUs(void* hParse){
+    if(NULL ==hParse){
+        return -2;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    return p->part_hold_backUs;
+}
+int m3u_can_block_reload(void* hParse){
+    if(NULL ==hParse){
+        return -2;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    return p->can_block_reload;
+}
+int m3u_get_part_num(void* hParse){
+    if(NULL ==hParse){
+        return -2;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    return p->part_num;
+}
+M3uPartNode* m3u_get_part_by_index(void* hParse,int index){
+    if(NULL ==hParse){
+        return NULL;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    if(index<0||index>=p->part_num){
+        return NULL;
+    }
+    return p->parts[index];
+}
+M3uPartNode* m3u_get_part(void* hParse,int msn,int part){
+    if(NULL ==hParse){
+        return NULL;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    int i;
+    //the wanted part is near the live edge,at the end
+    for(i = p->part_num-1;i>=0;i--){
+        if(p->parts[i]->msn==msn&&p->parts[i]->part==part){
+            return p->parts[i];
+        }
+        if(p->parts[i]->msn<msn){
+            break;
+        }
+    }
+    return NULL;
+}
+const char* m3u_get_preload_hint(void* hParse,int* msn,int* part){
+    if(NULL ==hParse){
+        return NULL;
+    }
+    M3UParser* p = (M3UParser*)hParse;
+    if(p->preload_hint==NULL){
+        return NULL;
+    }
+    *msn = p->preload_msn;
+    *part = p->preload_part;
+    return p->preload_hint;
+}
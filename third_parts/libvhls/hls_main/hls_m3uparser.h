@@ -16,6 +16,7 @@ extern "C" {
 #define DISCONTINUE_FLAG    			(1<<0) 
 #define ALLOW_CACHE_FLAG                (1<<1)
 #define CIPHER_INFO_FLAG                (1<<5)
+#define PARTIAL_FLAG                    (1<<6)  //a LL-HLS part,not a whole segment
 
 
 typedef struct _M3uKeyInfo{
@@ -38,6 +39,19 @@ typedef struct _M3uBaseNode {
     struct list_head  list;
 }M3uBaseNode;
 
+//LL-HLS partial segment,EXT-X-PART
+typedef struct _M3uPartNode {
+    char fileUrl[MAX_URL_SIZE];
+    int msn;                    //media sequence number of the segment it belongs to
+    int part;                   //index in that segment
+    int64_t startUs;
+    int64_t durationUs;
+    int64_t range_offset;
+    int64_t range_length;
+    int independent;
+    int gap;                    //not available,skip it
+}M3uPartNode;
+
 
 
 int m3u_parse(const char *baseURI,const void *data, size_t size,void** hParse);
@@ -52,6 +66,15 @@ M3uBaseNode* m3u_get_node_by_time(void* hParse,int64_t timeUs);
 int64_t m3u_get_node_span_size(void* hParse,int start_index,int end_index);
 int m3u_release(void* hParse);
 
+//LL-HLS,part target is 0 for a playlist without EXT-X-PART-INF
+int64_t m3u_get_part_targetUs(void* hParse);
+int64_t m3u_get_part_hold_backUs(void* hParse);
+int m3u_can_block_reload(void* hParse);
+int m3u_get_part_num(void* hParse);
+M3uPartNode* m3u_get_part_by_index(void* hParse,int index);
+M3uPartNode* m3u_get_part(void* hParse,int msn,int part);
+const char* m3u_get_preload_hint(void* hParse,int* msn,int* part);
+
 
 #ifdef __cplusplus
 }
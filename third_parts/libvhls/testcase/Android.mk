@@ -36,3 +36,20 @@ LOCAL_STATIC_LIBRARIES := libhls libhls_http libhls_common
 LOCAL_SHARED_LIBRARIES :=libamplayer libcutils libssl libamavutils libcrypto
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_PRELINK_MODULE := false
+LOCAL_MODULE_TAGS := tests
+LOCAL_ARM_MODE := arm
+LOCAL_SRC_FILES := fetchcache_testcase.c 
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/../common\
+        $(LOCAL_PATH)/../downloader\
+        $(LOCAL_PATH)/../include
+        
+
+LOCAL_MODULE := hls_fetchcache_test 
+LOCAL_STATIC_LIBRARIES := libhls libhls_http libhls_common 
+
+LOCAL_SHARED_LIBRARIES :=libamplayer libcutils libssl libamavutils libcrypto
+include $(BUILD_EXECUTABLE)
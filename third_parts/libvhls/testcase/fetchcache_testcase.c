@@ -0,0 +1,143 @@
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FetchCacheTest"
+
+/*
+ * two sessions on one live playlist url through the shared fetch cache:
+ * they send different X-Playback-Session-Id headers and the same key
+ * headers,the second one has to be served from the cache.a session with
+ * other key headers (a different cookie) has to go to the origin.
+ * the origin is a local http server counting the requests.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "hls_utils.h"
+#include "hls_download.h"
+#include "hls_fetch_cache.h"
+#ifdef HAVE_ANDROID_OS
+#include "hls_common.h"
+#else
+#include "hls_debug.h"
+#endif
+
+static const char* test_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:3\n"
+    "#EXT-X-TARGETDURATION:10\n"
+    "#EXT-X-MEDIA-SEQUENCE:100\n"
+    "#EXTINF:10.0,\n"
+    "seg100.ts\n"
+    "#EXTINF:10.0,\n"
+    "seg101.ts\n";
+
+static int origin_fd = -1;
+static int origin_requests = 0;
+
+static void* origin_task(void* arg){
+    char req[4096];
+    char resp[1024];
+    int fd,len;
+    for(;;){
+        fd = accept(origin_fd,NULL,NULL);
+        if(fd<0){
+            break;
+        }
+        len = 0;
+        while(len<(int)sizeof(req)-1){
+            int r = recv(fd,req+len,sizeof(req)-1-len,0);
+            if(r<=0){
+                break;
+            }
+            len += r;
+            req[len] = '\0';
+            if(strstr(req,"\r\n\r\n")!=NULL){
+                break;
+            }
+        }
+        __sync_fetch_and_add(&origin_requests,1);
+        len = snprintf(resp,sizeof(resp),
+                       "HTTP/1.1 200 OK\r\nContent-Type: application/vnd.apple.mpegurl\r\n"
+                       "Content-Length: %d\r\nConnection: close\r\n\r\n%s",
+                       (int)strlen(test_playlist),test_playlist);
+        send(fd,resp,len,0);
+        close(fd);
+    }
+    return NULL;
+}
+
+static int origin_start(int* port){
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    pthread_t tid;
+    origin_fd = socket(AF_INET,SOCK_STREAM,0);
+    if(origin_fd<0){
+        return -1;
+    }
+    memset(&addr,0,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(origin_fd,(struct sockaddr*)&addr,sizeof(addr))!=0||listen(origin_fd,8)!=0
+        ||getsockname(origin_fd,(struct sockaddr*)&addr,&alen)!=0){
+        close(origin_fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    if(pthread_create(&tid,NULL,origin_task,NULL)!=0){
+        close(origin_fd);
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+//one playlist fetch of a session,as _fetch_play_list_in does it
+static int session_fetch(const char* url,const char* sessionId,const char* keyHeaders){
+    char headers[1024];
+    void* buf = NULL;
+    char* redirect = NULL;
+    int len = 0,ret;
+    snprintf(headers,sizeof(headers),"X-Playback-Session-Id: %s\r\n%s",sessionId,keyHeaders);
+    ret = hls_fetch_cache_get(HLS_FETCH_PLAYLIST,url,headers,keyHeaders,-1,&buf,&len,&redirect,NULL);
+    if(ret==0&&(len!=(int)strlen(test_playlist)||memcmp(buf,test_playlist,len))){
+        ret = -1;
+    }
+    free(buf);
+    free(redirect);
+    return ret;
+}
+
+static int check(const char* what,int ok){
+    printf("%-48s %s\n",what,ok?"PASS":"FAIL");
+    return ok?0:1;
+}
+
+int main(int argc,char** argv){
+    HLSFetchCacheStats_t st;
+    char url[128];
+    int port = 0,failed = 0;
+
+    if(origin_start(&port)!=0){
+        printf("can't start the local origin\n");
+        return 1;
+    }
+    snprintf(url,sizeof(url),"http://127.0.0.1:%d/live/index.m3u8",port);
+
+    failed += check("session A fetches the playlist",
+                    session_fetch(url,"0000-A","Cookie: user=1")==0&&origin_requests==1);
+    failed += check("session B on the same url is a cache hit",
+                    session_fetch(url,"0000-B","Cookie: user=1")==0&&origin_requests==1);
+    hls_fetch_cache_get_stats(&st);
+    failed += check("stats: 2 lookups,1 miss,1 hit",st.lookups==2&&st.misses==1&&st.hits==1);
+    failed += check("other key headers go to the origin",
+                    session_fetch(url,"0000-C","Cookie: user=2")==0&&origin_requests==2);
+    hls_fetch_cache_dump_stats();
+    close(origin_fd);
+    return failed;
+}